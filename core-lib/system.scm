@@ -54,7 +54,7 @@
 
 (define-macro (%with-output-to-string string? &body body)
   (with-gensyms (port)
-    `(let ((,port (string-output-port)))
+    `(let ((,port (local-string-output-port)))
        (with-output-to-port ,port
          ,@body)
        (string-output-port-value ,port ,string?))))
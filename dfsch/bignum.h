@@ -64,6 +64,12 @@ void dfsch_bignum_div(dfsch_bignum_t* a, dfsch_bignum_t* b,
 dfsch_bignum_t* dfsch_bignum_exp(dfsch_bignum_t* b, 
                                  dfsch_bignum_t* e, 
                                  dfsch_bignum_t* m);
+/** Modular exponentation with running time and memory access pattern 
+    independent of exponent value (but not of its length in words), 
+    modulus has to be odd. */
+dfsch_bignum_t* dfsch_bignum_exp_consttime(dfsch_bignum_t* b, 
+                                           dfsch_bignum_t* e, 
+                                           dfsch_bignum_t* m);
 
 dfsch_bignum_t* dfsch_bignum_logand(dfsch_bignum_t* a, dfsch_bignum_t* b);
 dfsch_bignum_t* dfsch_bignum_logior(dfsch_bignum_t* a, dfsch_bignum_t* b);
@@ -380,6 +380,9 @@ extern "C" {
   extern dfsch_object_t* dfsch_list_package_symbols(dfsch_package_t* pkg);
   extern dfsch_object_t* dfsch_list_all_package_symbols(dfsch_package_t* pkg);
   extern dfsch_object_t* dfsch_package_exported_symbols(dfsch_package_t* pkg);
+  /** Return list of packages used by given package followed by 
+   * (alias . package) pairs for packages used under alias */
+  extern dfsch_object_t* dfsch_package_use_list(dfsch_package_t* pkg);
 
   
 
@@ -502,6 +505,12 @@ extern "C" {
   extern dfsch_object_t* dfsch_env_revscan(dfsch_object_t* env, 
                                            dfsch_object_t* value,
                                            int canonical);
+  /**
+   * Same as dfsch_env_revscan(env, value, 1), but uses cached reverse
+   * index, so repeated lookups in same environment take constant time.
+   */
+  extern dfsch_object_t* dfsch_env_canonical_name(dfsch_object_t* env, 
+                                                  dfsch_object_t* value);
 
   extern dfsch_object_t* dfsch_variable_constant_value(dfsch_object_t* name, 
                                                        dfsch_object_t* env);
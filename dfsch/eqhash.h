@@ -92,6 +92,8 @@ int dfsch_eqhash_set_if_exists(dfsch_eqhash_t* hash,
                                unsigned short* flags);
 dfsch_object_t* dfsch_eqhash_ref(dfsch_eqhash_t* hash,
                                  dfsch_object_t* key) DFSCH_FUNC_HOT;
+dfsch_object_t* dfsch_eqhash_ref_shared(dfsch_eqhash_t* hash,
+                                        dfsch_object_t* key);
 int dfsch_eqhash_ref_ex(dfsch_eqhash_t* hash,
                         dfsch_object_t* key, 
                         dfsch_object_t** value, 
@@ -31,6 +31,20 @@ extern "C" {
   extern char* dfsch_format(char* string, 
                              dfsch_object_t* args);
 
+  extern dfsch_type_t dfsch_compiled_format_type;
+#define DFSCH_COMPILED_FORMAT_TYPE (&dfsch_compiled_format_type)
+
+  /** Parse control string into reusable directive program */
+  extern dfsch_object_t* dfsch_compile_format(char* string);
+  /** Format arguments according to format (string or compiled format) 
+      and pass output to proc */
+  extern void dfsch_format_output(dfsch_object_t* format, 
+                                  dfsch_object_t* args,
+                                  dfsch_output_proc_t proc,
+                                  void* baton);
+  extern dfsch_object_t* dfsch_format_string(dfsch_object_t* format, 
+                                             dfsch_object_t* args);
+
 #ifdef __cplusplus
 }
 #endif
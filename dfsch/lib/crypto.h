@@ -5,6 +5,38 @@
 #include <dfsch/random.h>
 #include <stdint.h>
 
+/*
+ * Names defined in package crypto by the crypto module, for programs
+ * that declare them with dfsch_autoload_pkgcstr() and load the module
+ * only on first use. Keep in sync with dfsch_module_crypto_register().
+ */
+#define DFSCH_CRYPTO_AUTOLOAD_NAMES                                         \
+  { "<aes>", "<xtea>", "<blowfish>", "<block-cipher>", "<ecb>", "<cbc>",    \
+   "<cfb>", "<ofb>", "<ctr>", "<rc4>", "<rc4-drop768>", "<rc4-drop3072>",   \
+   "<stream-cipher>", "<sha-256>", "<hmac-sha-256>", "<sha-512>",           \
+   "<hmac-sha-512>", "<sha-1>", "<hmac-sha-1>", "<md5>", "<hmac-md5>",      \
+   "<md4>", "<hmac-md4>", "<hash>", "setup-block-cipher",                   \
+   "encrypt-block", "decrypt-block", "setup-block-cipher-mode",             \
+   "encrypt-blocks", "decrypt-blocks", "encrypt-bytes", "decrypt-bytes",    \
+   "encrypt-bytes-with-iv", "decrypt-bytes-with-iv",                        \
+   "encrypt-bytes-with-iv-and-mac", "decrypt-bytes-with-iv-and-mac",        \
+   "setup-stream-cipher", "get-keystream", "apply-stream-cipher",           \
+   "make-ofb-cipher", "make-ctr-cipher", "setup-hash", "hash-process",      \
+   "hash-result", "hash-string", "hash-strings",                            \
+   "*curve25519-basepoint*", "curve25519", "curve25519-private-key",        \
+   "<rsa-public-key>", "<rsa-private-key>", "rsa-generate-key",             \
+   "rsa-get-public-key", "rsa-public-key->list", "rsa-private-key->list",   \
+   "make-rsa-public-key", "make-rsa-private-key", "list->rsa-public-key",   \
+   "list->rsa-private-key", "rsa-encrypt-number", "rsa-decrypt-number",     \
+   "oaep-encode", "oaep-decode", "pss-encode", "pss-verify",                \
+   "rsa-pss-sign", "rsa-pss-verify", "prng-state",                          \
+   "<sign25519-public-key>", "<sign25519-private-key>",                     \
+   "sign25519-generate-key", "sign25519-get-public-key",                    \
+   "sign25519-sign", "sign25519-verify",                                    \
+   "sign25519-private-key->byte-vector",                                    \
+   "sign25519-public-key->byte-vector", "sign25519-make-private-key",       \
+   "sign25519-make-public-key", "verify-message", NULL }
+
 typedef struct dfsch_block_cipher_context_t dfsch_block_cipher_context_t;
 
 typedef void (*dfsch_block_cipher_operation_t)
@@ -15,6 +47,11 @@ typedef void (*dfsch_block_cipher_setup_t)
 (dfsch_block_cipher_context_t* context,
  uint8_t* key,
  size_t key_len);
+typedef void (*dfsch_block_cipher_blocks_operation_t)
+(dfsch_block_cipher_context_t* context,
+ uint8_t* in,
+ uint8_t* out,
+ size_t blocks);
 
 typedef struct dfsch_block_cipher_t {
   dfsch_type_t type;
@@ -26,6 +63,11 @@ typedef struct dfsch_block_cipher_t {
   dfsch_block_cipher_operation_t decrypt;
   dfsch_block_cipher_setup_t setup;
 
+  /* Optional, process consecutive independent blocks (in may be same
+     as out) */
+  dfsch_block_cipher_blocks_operation_t encrypt_blocks;
+  dfsch_block_cipher_blocks_operation_t decrypt_blocks;
+
   DFSCH_ALIGN8_DUMMY
 } DFSCH_ALIGN8_ATTR dfsch_block_cipher_t;
 
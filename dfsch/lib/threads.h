@@ -49,6 +49,14 @@ extern "C" {
   extern void dfsch_channel_write(dfsch_object_t* channel,
                                   dfsch_object_t* object);
 
+  extern dfsch_object_t* dfsch_isolate_create(dfsch_object_t* env,
+                                              dfsch_object_t* expression,
+                                              size_t buffer);
+  extern void dfsch_isolate_send(dfsch_object_t* isolate,
+                                 dfsch_object_t* object);
+  extern dfsch_object_t* dfsch_isolate_receive(dfsch_object_t* isolate);
+  extern dfsch_object_t* dfsch_isolate_join(dfsch_object_t* isolate);
+
   extern dfsch_object_t* dfsch_module_threads_register(dfsch_object_t *ctx);
 
 #ifdef __cplusplus
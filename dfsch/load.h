@@ -37,6 +37,7 @@
 #define H__dfsch__load__
 
 #include <dfsch/dfsch.h>
+#include <dfsch/parse.h>
 #include <stdio.h>
 
 #ifdef __cplusplus
@@ -59,6 +60,21 @@ extern "C" {
                                dfsch_object_t* path_list);
   /** Provide given module (mark as loaded) */
   extern void dfsch_provide(dfsch_object_t* env, char* name);
+  /** 
+   * Require module when given symbol is looked up while unbound.
+   *
+   * Declaration applies to top-level environment of env and module is
+   * loaded into it. Native modules cannot describe themselves before
+   * they are loaded, so names have to be supplied by caller (usually
+   * from stub table in module's header, like
+   * DFSCH_CRYPTO_AUTOLOAD_NAMES) and module has to define all of them
+   * in top-level environment.
+   */
+  extern void dfsch_autoload(dfsch_object_t* env, dfsch_object_t* name,
+                             char* module);
+  /** Declare autoload for NULL-terminated array of symbol names */
+  extern void dfsch_autoload_pkgcstr(dfsch_object_t* env, char* module,
+                                     char* package, char** names);
 
 
   /** Load given shared object module and register it into given context. */
@@ -77,6 +93,11 @@ extern "C" {
   extern void dfsch_load_scm(dfsch_object_t* ctx, char* scm_name, 
                              int toplevel);
 
+  /** Save non-canonical bindings of given environment frame into image. */
+  extern void dfsch_save_image(dfsch_object_t* env, char* fname);
+  /** Restore bindings saved by dfsch_save_image() into environment. */
+  extern void dfsch_load_image(dfsch_object_t* env, char* fname);
+
   /** Read scheme list from given file. */
   extern dfsch_object_t* dfsch_read_scm(char* scm_name, 
                                         dfsch_object_t* eval_env);
@@ -84,6 +105,22 @@ extern "C" {
   extern dfsch_object_t* dfsch_read_scm_fd(int f, 
                                            char* name, 
                                            dfsch_object_t* eval_env);
+  /** 
+   * Read objects from given file and pass each of them to callback as 
+   * soon as it is complete. File is read in fixed-size chunks, so memory
+   * usage does not depend on file size. Reading stops when callback 
+   * returns 0.
+   */
+  extern void dfsch_read_scm_callback(char* scm_name, 
+                                      dfsch_object_t* eval_env,
+                                      dfsch_parser_callback_t callback,
+                                      void* baton);
+  /** Same as dfsch_read_scm_callback() for file descriptor. */
+  extern void dfsch_read_scm_fd_callback(int f, 
+                                         char* name, 
+                                         dfsch_object_t* eval_env,
+                                         dfsch_parser_callback_t callback,
+                                         void* baton);
   /** Read scheme list from given stdio stream. */
   extern dfsch_object_t* dfsch_read_scm_stream(FILE* f, 
                                                char* name, 
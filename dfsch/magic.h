@@ -113,6 +113,8 @@ extern "C" {
     void* trace_baton;
     dfsch_breakpoint_hook_t user_trace_hook;
     void* user_trace_baton;
+
+    void* random;
   };
 
   extern dfsch__thread_info_t* dfsch__get_thread_info();
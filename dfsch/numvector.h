@@ -0,0 +1,100 @@
+/*
+ * dfsch - dfox's quick and dirty scheme implementation
+ *   Homogeneous numeric vectors
+ * Copyright (C) 2005-2014 Ales Hakl
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/** \file dfsch/numvector.h
+ *
+ * Vectors of unboxed machine numbers (doubles, signed 64bit integers and
+ * bytes).
+ */
+
+#ifndef H__dfsch__numvector__
+#define H__dfsch__numvector__
+
+#include <dfsch/dfsch.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  extern dfsch_type_t dfsch_numeric_vector_type;
+#define DFSCH_NUMERIC_VECTOR_TYPE (&dfsch_numeric_vector_type)
+  extern dfsch_type_t dfsch_f64vector_type;
+#define DFSCH_F64VECTOR_TYPE (&dfsch_f64vector_type)
+  extern dfsch_type_t dfsch_s64vector_type;
+#define DFSCH_S64VECTOR_TYPE (&dfsch_s64vector_type)
+  extern dfsch_type_t dfsch_u8vector_type;
+#define DFSCH_U8VECTOR_TYPE (&dfsch_u8vector_type)
+
+  /** Allocate zero-filled vector of given type (one of f64vector,
+      s64vector or u8vector types) */
+  dfsch_object_t* dfsch_make_numeric_vector(dfsch_type_t* type,
+                                            size_t length);
+  /** Convert list of numbers into vector of given type */
+  dfsch_object_t* dfsch_list_2_numeric_vector(dfsch_type_t* type,
+                                              dfsch_object_t* list);
+  size_t dfsch_numeric_vector_length(dfsch_object_t* nv);
+
+  /** Direct access to element storage, length is stored into len when
+      not NULL */
+  double* dfsch_f64vector_data(dfsch_object_t* nv, size_t* len);
+  int64_t* dfsch_s64vector_data(dfsch_object_t* nv, size_t* len);
+  uint8_t* dfsch_u8vector_data(dfsch_object_t* nv, size_t* len);
+
+  /** Element-wise arithmetic. Second operand is either vector of same
+      type and length or real number. Integer vectors wrap around on
+      overflow and truncate on division. */
+  dfsch_object_t* dfsch_numeric_vector_add(dfsch_object_t* a,
+                                           dfsch_object_t* b);
+  dfsch_object_t* dfsch_numeric_vector_sub(dfsch_object_t* a,
+                                           dfsch_object_t* b);
+  dfsch_object_t* dfsch_numeric_vector_mul(dfsch_object_t* a,
+                                           dfsch_object_t* b);
+  dfsch_object_t* dfsch_numeric_vector_div(dfsch_object_t* a,
+                                           dfsch_object_t* b);
+
+  /** Reductions, sum and dot product of integer vectors are exact. Min
+      and max of f64vector containing NaN are NaN. */
+  dfsch_object_t* dfsch_numeric_vector_sum(dfsch_object_t* nv);
+  dfsch_object_t* dfsch_numeric_vector_min(dfsch_object_t* nv);
+  dfsch_object_t* dfsch_numeric_vector_max(dfsch_object_t* nv);
+  dfsch_object_t* dfsch_numeric_vector_dot(dfsch_object_t* a,
+                                           dfsch_object_t* b);
+
+  /** Running sums, prefix sums of integer vectors are s64vectors */
+  dfsch_object_t* dfsch_numeric_vector_prefix_sum(dfsch_object_t* nv);
+  /** New vector a * x + y */
+  dfsch_object_t* dfsch_numeric_vector_axpy(dfsch_object_t* a,
+                                            dfsch_object_t* x,
+                                            dfsch_object_t* y);
+  /** Sort vector in place, returns it's argument */
+  dfsch_object_t* dfsch_numeric_vector_sort(dfsch_object_t* nv);
+  /** s64vector of counts of elements falling into each of bins equally
+      sized parts of [lo, hi] */
+  dfsch_object_t* dfsch_numeric_vector_histogram(dfsch_object_t* nv,
+                                                 size_t bins,
+                                                 double lo, double hi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -56,6 +56,7 @@ typedef struct dfsch_standard_class_t {
   dfsch_object_t* write_instance;
   dfsch_object_t* initfuncs;
   dfsch_object_t* initargs;
+  struct dfsch__instance_plan_t* serialization_plan;
 } dfsch_standard_class_t;
 
 
@@ -71,6 +71,8 @@ extern dfsch_type_t dfsch_parse_error_type;
    * Feed some data into parser.
    */
   extern int dfsch_parser_feed(dfsch_parser_ctx_t *ctx, char* data);
+  extern int dfsch_parser_feed_buf(dfsch_parser_ctx_t *ctx, 
+                                   char* data, size_t len);
   extern int dfsch_parser_feed_line(dfsch_parser_ctx_t* ctx, char* data);
 
   /**
@@ -50,6 +50,18 @@ extern "C" {
   typedef void (*dfsch_port_batch_read_start_t)(dfsch_object_t* port);
   typedef void (*dfsch_port_batch_read_end_t)(dfsch_object_t* port);
   typedef int (*dfsch_port_batch_read_t)(dfsch_object_t* port);
+  typedef char* (*dfsch_port_batch_read_buf_t)(dfsch_object_t* port,
+                                               size_t* len);
+  typedef void (*dfsch_port_batch_read_consume_t)(dfsch_object_t* port,
+                                                  size_t len);
+
+  typedef void (*dfsch_port_flush_t)(dfsch_object_t* port);
+  typedef void (*dfsch_port_set_buffering_t)(dfsch_object_t* port,
+                                             int mode, size_t size);
+
+#define DFSCH_PORT_BUFFER_NONE 0
+#define DFSCH_PORT_BUFFER_LINE 1
+#define DFSCH_PORT_BUFFER_FULL 2
 
   typedef int (*dfsch_port_get_caps_t)(dfsch_object_t* port);
 
@@ -100,6 +112,26 @@ extern "C" {
      * unlocked_stdio(3).
      */
     dfsch_port_batch_read_t batch_read;
+    /**
+     * Lend port's internal buffer to caller. Returns pointer to buffered
+     * data and stores its length into len, refilling the buffer when it 
+     * is empty (len is 0 on end of file). Data stays in port until 
+     * batch_read_consume() is called. May be NULL when not supported.
+     */
+    dfsch_port_batch_read_buf_t batch_read_buf;
+    /**
+     * Drop first len bytes returned by last batch_read_buf().
+     */
+    dfsch_port_batch_read_consume_t batch_read_consume;
+    /**
+     * Write out buffered output data. May be NULL for unbuffered ports.
+     */
+    dfsch_port_flush_t flush;
+    /**
+     * Change output buffering mode (one of DFSCH_PORT_BUFFER_*) and 
+     * buffer size (0 means default). May be NULL when not supported.
+     */
+    dfsch_port_set_buffering_t set_buffering;
   } dfsch_port_type_t;
 
   typedef struct dfsch_port_t {
@@ -127,6 +159,9 @@ extern "C" {
 #define DFSCH_NULL_PORT_TYPE (&dfsch_null_port_type)
   extern dfsch_port_type_t dfsch_string_output_port_type;
 #define DFSCH_STRING_OUTPUT_PORT_TYPE (&dfsch_string_output_port_type)
+  extern dfsch_port_type_t dfsch_local_string_output_port_type;
+#define DFSCH_LOCAL_STRING_OUTPUT_PORT_TYPE \
+  (&dfsch_local_string_output_port_type)
   extern dfsch_port_type_t dfsch_string_input_port_type;
 #define DFSCH_STRING_INPUT_PORT_TYPE (&dfsch_string_input_port_type)
   extern dfsch_port_type_t dfsch_file_port_type;
@@ -145,6 +180,10 @@ extern "C" {
 
   void dfsch_port_write_buf(dfsch_port_t* port, char*buf, size_t size);
   void dfsch_port_write_cstr(dfsch_port_t* port, char*str);
+  /** Write representation of object into port, max_depth of -1 means 
+      circular structure aware output */
+  void dfsch_port_write_object(dfsch_port_t* port, dfsch_object_t* obj,
+                               int max_depth, int readability);
   ssize_t dfsch_port_read_buf(dfsch_port_t* port, char*buf, size_t size);
   dfsch_strbuf_t* dfsch_port_read_whole(dfsch_port_t* port);
   void dfsch_port_seek(dfsch_port_t* port, int64_t offset, int whence);
@@ -154,8 +193,12 @@ extern "C" {
   void dfsch_port_batch_read_end(dfsch_port_t* port);
   int dfsch_port_batch_read(dfsch_port_t* port);
   void dfsch_port_batch_unread(dfsch_port_t* port, char ch);
+  char* dfsch_port_batch_read_buf(dfsch_port_t* port, size_t* len);
+  void dfsch_port_batch_read_consume(dfsch_port_t* port, size_t len);
 
   void dfsch_port_freshline(dfsch_port_t* port);
+  void dfsch_port_flush(dfsch_port_t* port);
+  void dfsch_port_set_buffering(dfsch_port_t* port, int mode, size_t size);
 
   dfsch_strbuf_t* dfsch_port_readline(dfsch_port_t* port);
   dfsch_strbuf_t* dfsch_port_readline_len(dfsch_port_t* port,
@@ -176,6 +219,9 @@ extern "C" {
   void dfsch_set_current_error_port(dfsch_port_t* port);
 
   dfsch_object_t* dfsch_string_output_port();
+  /** Unsynchronized string output port with initial buffer of size_hint 
+      bytes */
+  dfsch_object_t* dfsch_local_string_output_port(size_t size_hint);
   dfsch_strbuf_t* dfsch_string_output_port_value(dfsch_object_t* port);
 
   dfsch_object_t* dfsch_eof_object();
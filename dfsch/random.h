@@ -5,11 +5,14 @@
 
 typedef void (*dfsch_random_get_bytes_t)(dfsch_object_t* state, 
                                          uint8_t* buf, size_t len);
+typedef uint64_t (*dfsch_random_get_u64_t)(dfsch_object_t* state);
 
 typedef struct dfsch_random_state_type_t {
   dfsch_type_t type;
   dfsch_random_get_bytes_t get_bytes;
   int deterministic;
+  /* Optional, generators producing whole words should provide this */
+  dfsch_random_get_u64_t get_u64;
 } dfsch_random_state_type_t;
 
 extern dfsch_type_t dfsch_random_state_type;
@@ -22,20 +25,45 @@ extern dfsch_random_state_type_t dfsch_file_random_state_type;
 #define DFSCH_FILE_RANDOM_STATE_TYPE (&dfsch_file_random_state_type)
 extern dfsch_random_state_type_t dfsch_lcg_random_state_type;
 #define DFSCH_LCG_RANDOM_STATE_TYPE (&dfsch_lcg_random_state_type)
+extern dfsch_random_state_type_t dfsch_xoshiro_random_state_type;
+#define DFSCH_XOSHIRO_RANDOM_STATE_TYPE (&dfsch_xoshiro_random_state_type)
 
+extern dfsch_type_t dfsch_random_snapshot_type;
+#define DFSCH_RANDOM_SNAPSHOT_TYPE (&dfsch_random_snapshot_type)
+
+/** Default random state of current thread */
 dfsch_object_t* dfsch_get_random_state();
 void dfsch_set_random_state(dfsch_object_t* state);
+/** Reset master seed, current thread gets first stream derived from it
+    and threads created afterwards get following ones */
+void dfsch_random_set_seed(uint8_t* seed, size_t len);
+/** Allocate next stream derived from master seed, used to give new
+    threads their random state */
+dfsch_object_t* dfsch_random_make_stream();
+/** Snapshot of random states of all threads, should be taken and
+    restored while other threads do not generate random numbers */
+dfsch_object_t* dfsch_random_save_states();
+void dfsch_random_restore_states(dfsch_object_t* snapshot);
 
 void dfsch_random_get_bytes(dfsch_object_t* state, uint8_t* buf, size_t len);
+uint64_t dfsch_random_get_u64(dfsch_object_t* state);
 int64_t dfsch_random_get_integer(dfsch_object_t* state, int64_t max);
 double dfsch_random_get_double(dfsch_object_t* state);
 dfsch_object_t* dfsch_random_get_number(dfsch_object_t* state, 
                                         dfsch_object_t* max);
 dfsch_object_t* dfsch_random_get_bignum(dfsch_object_t* state,
                                         size_t len);
+/** Fill byte-vector or numeric vector with random data, f64vectors get
+    uniformly distributed numbers from [0, 1) */
+void dfsch_random_fill(dfsch_object_t* state, dfsch_object_t* vector);
 
 dfsch_object_t* dfsch_make_default_random_state(uint8_t* seed, size_t len);
 dfsch_object_t* dfsch_make_file_random_state(char* filename);
+dfsch_object_t* dfsch_make_lcg_random_state(uint32_t seed);
+dfsch_object_t* dfsch_make_xoshiro_random_state(uint8_t* seed, size_t len);
+/** Copy of state advanced by count * 2^128 steps, streams obtained by
+    different counts do not overlap in practice */
+dfsch_object_t* dfsch_random_state_jump(dfsch_object_t* state, size_t count);
 
 void dfsch_get_random_id(char buf[18]);
 void dfsch_get_random_scoped_id(char buf[20], char scope[16]);
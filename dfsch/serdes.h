@@ -7,6 +7,8 @@
 extern dfsch_type_t dfsch_serializer_type;
 #define DFSCH_SERIALIZER_TYPE (&dfsch_serializer_type)
 
+/** Output procedure is called with short temporary buffers, it must not
+    retain pointers to buffers shorter than 512 bytes */
 dfsch_serializer_t* dfsch_make_serializer(dfsch_output_proc_t op,
                                           void* baton);
 dfsch_serializer_t* dfsch_serializer(dfsch_object_t* obj);
@@ -41,6 +43,14 @@ int (*dfsch_serializer_unserializable_hook_t)(dfsch_serializer_t* serializer,
                                               dfsch_object_t* obj,
                                               void* baton);
 
+/** Stream-local index of plan (layout written only once per stream) 
+    for key, -1 when not yet written */
+int dfsch_serializer_plan_index(dfsch_serializer_t* s,
+                                dfsch_object_t* key);
+/** Allocate next plan index for key, caller writes the plan itself */
+int dfsch_serializer_add_plan(dfsch_serializer_t* s,
+                              dfsch_object_t* key);
+
 void dfsch_serializer_set_object_hook(dfsch_serializer_t* s,
                                       dfsch_serializer_object_hook_t h,
                                       void *baton);
@@ -49,6 +59,11 @@ void dfsch_serializer_set_unserializable_hook(dfsch_serializer_t* s,
                                               void* baton);
 void dfsch_serializer_set_canonical_environment(dfsch_serializer_t* s,
                                                 dfsch_object_t* env);
+/** Serialize vectors with at least threshold elements and strings of at
+    least threshold bytes as independent subtrees, that can be skipped or
+    deserialized lazily. Zero disables this. */
+void dfsch_serializer_set_lazy_threshold(dfsch_serializer_t* s,
+                                         size_t threshold);
 
 extern dfsch_type_t dfsch_deserializer_type;
 #define DFSCH_DESERIALIZER_TYPE (&dfsch_deserializer_type)
@@ -72,6 +87,10 @@ void dfsch_deserializer_put_partial_object(dfsch_deserializer_t* ds,
                                            dfsch_object_t* obj);
 dfsch_object_t** dfsch_deserializer__skip_object(dfsch_deserializer_t* ds);
 
+/** Plans are numbered in the same order as on serializer side */
+void dfsch_deserializer_add_plan(dfsch_deserializer_t* ds, void* plan);
+void* dfsch_deserializer_plan_ref(dfsch_deserializer_t* ds, int idx);
+
 typedef 
 dfsch_object_t* (*dfsch_deserializer_unknown_hook_t)(dfsch_deserializer_t* ds,
                                                      char* name,
@@ -82,6 +101,11 @@ void dfsch_deserializer_set_unknown_hook(dfsch_deserializer_t* ds,
                                          void* baton);
 void dfsch_deserializer_set_canonical_environment(dfsch_deserializer_t* ds,
                                                   dfsch_object_t* env);
+/** Return lazy subtrees as lazy-object proxies instead of building them.
+    Proxies keep source (eg. mapped byte-vector stream is read from) 
+    reachable until they are forced. */
+void dfsch_deserializer_set_lazy(dfsch_deserializer_t* ds,
+                                 dfsch_object_t* source);
 
 typedef dfsch_object_t* (*dfsch_deserializer_handler_t)(dfsch_deserializer_t* ds);
 
@@ -104,6 +128,37 @@ dfsch_object_t* dfsch_deserialize(dfsch_strbuf_t* sb,
                                   dfsch_object_t* canon_env);
 
 
+extern dfsch_type_t dfsch_lazy_object_type;
+#define DFSCH_LAZY_OBJECT_TYPE (&dfsch_lazy_object_type)
+
+/** Deserialize lazy object (when not already done) and return its value,
+    other objects are returned unchanged */
+dfsch_object_t* dfsch_force_lazy_object(dfsch_object_t* obj);
+int dfsch_lazy_object_forced_p(dfsch_object_t* obj);
+
+/* Record streams */
+
+/** Write one length-prefixed record */
+void dfsch_serialize_record(dfsch_output_proc_t op, void* baton,
+                            dfsch_object_t* obj,
+                            dfsch_object_t* canon_env,
+                            size_t lazy_threshold);
+
+extern dfsch_type_t dfsch_record_cursor_type;
+#define DFSCH_RECORD_CURSOR_TYPE (&dfsch_record_cursor_type)
+
+/** Cursor over records read from port or from byte-vector or string. 
+    Records read from buffers share storage with it. */
+dfsch_object_t* dfsch_make_record_cursor(dfsch_object_t* source,
+                                         dfsch_object_t* canon_env,
+                                         int lazy);
+/** Next record or EOF object */
+dfsch_object_t* dfsch_record_cursor_next(dfsch_object_t* cursor);
+/** Skip up to count records without deserializing them, returns number
+    of records skipped */
+size_t dfsch_record_cursor_skip(dfsch_object_t* cursor, size_t count);
+size_t dfsch_record_cursor_index(dfsch_object_t* cursor);
+
 #define DFSCH_SERIALIZER_ARG(al, name) \
   DFSCH_GENERIC_ARG(al, name, dfsch_serializer_t*, dfsch_serializer)
 #define DFSCH_DESERIALIZER_ARG(al, name) \
@@ -19,5 +19,14 @@ void dfsch_sha256_process(dfsch_sha256_context_t* md,
                           unsigned long inlen);
 void dfsch_sha256_result(dfsch_sha256_context_t * md, unsigned char *out);
 
+/** Hash count independent messages, digests (32 bytes each) are stored
+    into buffers in out. Messages are compressed in parallel when CPU
+    allows it. */
+void dfsch_sha256_digest_many(size_t count,
+                              const unsigned char** in, size_t* len,
+                              unsigned char** out);
+/** Name of compression function implementation in use */
+char* dfsch_sha256_implementation();
+
 
 #endif
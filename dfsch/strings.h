@@ -57,6 +57,13 @@ extern "C" {
 
   extern dfsch_object_t* dfsch_make_string_nocopy(dfsch_strbuf_t* buf);
 
+  /** Map file read-only into memory outside of GC heap as string */
+  extern dfsch_object_t* dfsch_make_string_mapped(char* fname);
+  /** Map file read-only into memory outside of GC heap as byte-vector */
+  extern dfsch_object_t* dfsch_make_byte_vector_mapped(char* fname);
+  /** Release mapping before it is collected */
+  extern void dfsch_unmap_string(dfsch_object_t* obj);
+
   extern char* dfsch_string_to_cstr(dfsch_object_t* obj);
   extern char* dfsch_proto_string_to_cstr(dfsch_object_t* obj);
   extern dfsch_strbuf_t* dfsch_string_to_buf(dfsch_object_t* obj);
@@ -123,6 +130,8 @@ extern "C" {
 
   extern char* dfsch_char_category(uint32_t c);
 
+  extern int dfsch_string_valid_utf8_p(dfsch_strbuf_t* buf);
+
   extern int dfsch_string_search(dfsch_strbuf_t* needle, 
                                  dfsch_strbuf_t* haystack);
   extern int dfsch_string_search_ci(dfsch_strbuf_t* needle, 
@@ -161,6 +170,22 @@ extern "C" {
   extern dfsch_type_t dfsch_byte_vector_type;
 #define DFSCH_BYTE_VECTOR_TYPE (&dfsch_byte_vector_type)
 
+  extern dfsch_type_t dfsch_string_builder_type;
+#define DFSCH_STRING_BUILDER_TYPE (&dfsch_string_builder_type)
+
+  /** Create string builder, size_hint is initial capacity in bytes */
+  dfsch_object_t* dfsch_make_string_builder(size_t size_hint);
+  void dfsch_string_builder_append_buf(dfsch_object_t* builder, 
+                                       char* ptr, size_t len);
+  void dfsch_string_builder_append_char(dfsch_object_t* builder, 
+                                        uint32_t ch);
+  /** Append string, character or decimal representation of number */
+  void dfsch_string_builder_append(dfsch_object_t* builder, 
+                                   dfsch_object_t* obj);
+  size_t dfsch_string_builder_byte_length(dfsch_object_t* builder);
+  /** Return contents as string without copying and reset builder */
+  dfsch_object_t* dfsch_string_builder_to_string(dfsch_object_t* builder);
+
   dfsch_object_t* dfsch_make_byte_vector(char* ptr, size_t len);
   dfsch_object_t* dfsch_alloc_byte_vector(char** ptr, size_t len);
   dfsch_object_t* dfsch_make_byte_vector_strbuf(dfsch_strbuf_t* strbuf);
@@ -91,6 +91,9 @@ typedef pthread_rwlock_t dfsch_rwlock_t;
 typedef pthread_mutex_t dfsch_rwlock_t;
 #endif
 
+/* Full memory barrier for code that is read without holding a lock */
+#define DFSCH_MEMORY_BARRIER() __sync_synchronize()
+
 char* dfsch_getcwd();
 char* dfsch_get_path_directory(char* path);
 char* dfsch_realpath(char* path);
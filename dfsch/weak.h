@@ -48,6 +48,8 @@ extern "C" {
                                                size_t k, 
                                                dfsch_object_t* obj);
 
+  extern dfsch_object_t* dfsch_make_weak_key_hash();
+
   extern dfsch_type_t dfsch_weak_reference_type;
 #define DFSCH_WEAK_REFERENCE_TYPE (&dfsch_weak_reference_type)
   extern dfsch_type_t dfsch_weak_vector_type;
@@ -19,6 +19,10 @@ extern "C" {
                                                 dfsch_output_proc_t proc,
                                                 void* baton);
   void dfsch_invalidate_writer_state(dfsch_writer_state_t* state);
+  void dfsch_write_object_circular(dfsch_object_t* obj,
+                                   int readability,
+                                   dfsch_output_proc_t proc,
+                                   void* baton);
   int dfsch_writer_state_print_p(dfsch_writer_state_t* state);
   int dfsch_writer_state_strict_write_p(dfsch_writer_state_t* state);
   int dfsch_writer_state_pprint_p(dfsch_writer_state_t* state);
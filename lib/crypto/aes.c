@@ -33,10 +33,21 @@
 #include <dfsch/lib/crypto.h>
 #include "macros.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+  && !defined(DFSCH_NO_SIMD)
+#define X86_SIMD
+#include <immintrin.h>
+#endif
+
 typedef struct aes_key_t {
   dfsch_block_cipher_t* cipher;
   ulong32 eK[60], dK[60];
   int Nr;
+  /* eK and dK in byte order, for AES-NI */
+  unsigned char ni_eK[240], ni_dK[240];
 } aes_key_t;
 
 
@@ -183,6 +194,11 @@ static int aes_setup(aes_key_t* ctx,
     *rk++ = *rrk++;
     *rk++ = *rrk++;
     *rk   = *rrk;
+
+    for (i = 0; i < j; i++) {
+        STORE32H(ctx->eK[i], ctx->ni_eK + 4 * i);
+        STORE32H(ctx->dK[i], ctx->ni_dK + 4 * i);
+    }
 }
 
 /**
@@ -192,7 +208,7 @@ static int aes_setup(aes_key_t* ctx,
   @param skey The key as scheduled
   @return CRYPT_OK if successful
 */
-static int aes_encrypt(aes_key_t* ctx, uint8_t* pt, uint8_t* ct)
+static void aes_encrypt_c(aes_key_t* ctx, uint8_t* pt, uint8_t* ct)
 {
     ulong32 s0, s1, s2, s3, t0, t1, t2, t3, *rk;
     int Nr, r;
@@ -312,7 +328,7 @@ static int aes_encrypt(aes_key_t* ctx, uint8_t* pt, uint8_t* ct)
   @param skey The key as scheduled 
   @return CRYPT_OK if successful
 */
-static int aes_decrypt(aes_key_t* ctx, uint8_t* ct, uint8_t* pt)
+static void aes_decrypt_c(aes_key_t* ctx, uint8_t* ct, uint8_t* pt)
 {
     ulong32 s0, s1, s2, s3, t0, t1, t2, t3, *rk;
     int Nr, r;
@@ -427,6 +443,141 @@ static int aes_decrypt(aes_key_t* ctx, uint8_t* ct, uint8_t* pt)
 }
 
 
+#ifdef X86_SIMD
+
+/*
+ * AES-NI, round keys are the same as above stored in byte order. Eight
+ * blocks are kept in flight to cover latency of aesenc/aesdec.
+ */
+
+#define AESNI_ROUNDS(op, last, rk, nr, in, out, blocks) {               \
+    __m128i k_[15], b_[8];                                              \
+    int i_, r_;                                                         \
+    for (r_ = 0; r_ <= (nr); r_++) {                                    \
+        k_[r_] = _mm_loadu_si128((__m128i*)((rk) + 16 * r_));           \
+    }                                                                   \
+    while ((blocks) >= 8) {                                             \
+        for (i_ = 0; i_ < 8; i_++) {                                    \
+            b_[i_] = _mm_xor_si128(_mm_loadu_si128((__m128i*)(in) + i_), \
+                                   k_[0]);                              \
+        }                                                               \
+        for (r_ = 1; r_ < (nr); r_++) {                                 \
+            for (i_ = 0; i_ < 8; i_++) {                                \
+                b_[i_] = op(b_[i_], k_[r_]);                            \
+            }                                                           \
+        }                                                               \
+        for (i_ = 0; i_ < 8; i_++) {                                    \
+            _mm_storeu_si128((__m128i*)(out) + i_,                      \
+                             last(b_[i_], k_[(nr)]));                   \
+        }                                                               \
+        (in) += 128;                                                    \
+        (out) += 128;                                                   \
+        (blocks) -= 8;                                                  \
+    }                                                                   \
+    while ((blocks) > 0) {                                              \
+        b_[0] = _mm_xor_si128(_mm_loadu_si128((__m128i*)(in)), k_[0]);  \
+        for (r_ = 1; r_ < (nr); r_++) {                                 \
+            b_[0] = op(b_[0], k_[r_]);                                  \
+        }                                                               \
+        _mm_storeu_si128((__m128i*)(out), last(b_[0], k_[(nr)]));       \
+        (in) += 16;                                                     \
+        (out) += 16;                                                    \
+        (blocks)--;                                                     \
+    }}
+
+__attribute__((target("aes,sse2")))
+static void aes_encrypt_ni(aes_key_t* ctx, uint8_t* in, uint8_t* out,
+                           size_t blocks)
+{
+    AESNI_ROUNDS(_mm_aesenc_si128, _mm_aesenclast_si128, 
+                 ctx->ni_eK, ctx->Nr, in, out, blocks);
+}
+
+__attribute__((target("aes,sse2")))
+static void aes_decrypt_ni(aes_key_t* ctx, uint8_t* in, uint8_t* out,
+                           size_t blocks)
+{
+    AESNI_ROUNDS(_mm_aesdec_si128, _mm_aesdeclast_si128, 
+                 ctx->ni_dK, ctx->Nr, in, out, blocks);
+}
+
+#endif
+
+/* AES-NI is used when available, unless DFSCH_SIMD=none */
+static int aes_ni = -1;
+
+static int aes_ni_p()
+{
+    int p = 0;
+
+    if (aes_ni < 0) {
+#ifdef X86_SIMD
+        char* limit = getenv("DFSCH_SIMD");
+
+        __builtin_cpu_init();
+        p = !(limit && strcmp(limit, "none") == 0) &&
+            __builtin_cpu_supports("aes");
+#endif
+        aes_ni = p; /* every thread selects the same thing */
+    }
+    return aes_ni;
+}
+
+static void aes_encrypt(aes_key_t* ctx, uint8_t* pt, uint8_t* ct)
+{
+#ifdef X86_SIMD
+    if (aes_ni_p()) {
+        aes_encrypt_ni(ctx, pt, ct, 1);
+        return;
+    }
+#endif
+    aes_encrypt_c(ctx, pt, ct);
+}
+
+static void aes_decrypt(aes_key_t* ctx, uint8_t* ct, uint8_t* pt)
+{
+#ifdef X86_SIMD
+    if (aes_ni_p()) {
+        aes_decrypt_ni(ctx, ct, pt, 1);
+        return;
+    }
+#endif
+    aes_decrypt_c(ctx, ct, pt);
+}
+
+static void aes_encrypt_blocks(aes_key_t* ctx, uint8_t* in, uint8_t* out,
+                               size_t blocks)
+{
+#ifdef X86_SIMD
+    if (aes_ni_p()) {
+        aes_encrypt_ni(ctx, in, out, blocks);
+        return;
+    }
+#endif
+    while (blocks--) {
+        aes_encrypt_c(ctx, in, out);
+        in += 16;
+        out += 16;
+    }
+}
+
+static void aes_decrypt_blocks(aes_key_t* ctx, uint8_t* in, uint8_t* out,
+                               size_t blocks)
+{
+#ifdef X86_SIMD
+    if (aes_ni_p()) {
+        aes_decrypt_ni(ctx, in, out, blocks);
+        return;
+    }
+#endif
+    while (blocks--) {
+        aes_decrypt_c(ctx, in, out);
+        in += 16;
+        out += 16;
+    }
+}
+
+
 dfsch_block_cipher_t dfsch_crypto_aes_cipher = {
   .type = {
     .type = DFSCH_BLOCK_CIPHER_TYPE,
@@ -440,5 +591,7 @@ dfsch_block_cipher_t dfsch_crypto_aes_cipher = {
   
   .encrypt = aes_encrypt,
   .decrypt = aes_decrypt,
-  .setup = aes_setup
+  .setup = aes_setup,
+  .encrypt_blocks = aes_encrypt_blocks,
+  .decrypt_blocks = aes_decrypt_blocks
 };
@@ -85,7 +85,7 @@ dfsch_type_t dfsch_stream_cipher_type = {
 };
 
 dfsch_stream_cipher_t* dfsch_stream_cipher(dfsch_object_t* obj){
-  return DFSCH_ASSERT_TYPE(obj, DFSCH_STREAM_CIPHER_TYPE);
+  return DFSCH_ASSERT_INSTANCE(obj, DFSCH_STREAM_CIPHER_TYPE);
 }
 
 dfsch_stream_cipher_context_t* 
@@ -102,7 +102,7 @@ dfsch_setup_stream_cipher(dfsch_stream_cipher_t* cipher,
 }
 
 int dfsch_stream_cipher_context_p(dfsch_object_t* obj){
-  return DFSCH_TYPE_OF(DFSCH_TYPE_OF(obj)) == DFSCH_STREAM_CIPHER_TYPE;
+  return DFSCH_INSTANCE_P(DFSCH_TYPE_OF(obj), DFSCH_STREAM_CIPHER_TYPE);
 }
 
 dfsch_stream_cipher_context_t* 
@@ -134,3 +134,31 @@
     }                                                                   \
   }
 
+
+/* same as HASH_PROCESS, but runs of complete blocks are passed to
+   compress function at once */
+#define HASH_PROCESS_BLOCKS(func_name, blocks_name, type, block_size)   \
+  void func_name (type* md, const unsigned char *in, unsigned long inlen) \
+  {                                                                     \
+    unsigned long n;                                                    \
+    while (inlen > 0) {                                                 \
+      if (md->curlen == 0 && inlen >= block_size) {                     \
+        n = inlen / block_size;                                         \
+        blocks_name (md, (unsigned char *)in, n);                       \
+        md->length += n * block_size * 8;                               \
+        in             += n * block_size;                               \
+        inlen          -= n * block_size;                               \
+      } else {                                                          \
+        n = MIN(inlen, (block_size - md->curlen));                      \
+        memcpy(md->buf + md->curlen, in, (size_t)n);                    \
+        md->curlen += n;                                                \
+        in             += n;                                            \
+        inlen          -= n;                                            \
+        if (md->curlen == block_size) {                                 \
+          blocks_name (md, md->buf, 1);                                 \
+          md->length += 8*block_size;                                   \
+          md->curlen = 0;                                               \
+        }                                                               \
+      }                                                                 \
+    }                                                                   \
+  }
@@ -1,5 +1,43 @@
 #include <dfsch/lib/crypto.h>
 
+#include <string.h>
+
+/* Independent blocks are passed to cipher's multi-block operations (when
+   there are some) in chunks of this many blocks */
+#define CHUNK_BLOCKS 8
+
+static void encrypt_blocks(dfsch_block_cipher_context_t* cipher,
+                           uint8_t* in,
+                           uint8_t* out,
+                           size_t blocks){
+  size_t bsize = cipher->cipher->block_size;
+  size_t i;
+
+  if (cipher->cipher->encrypt_blocks){
+    cipher->cipher->encrypt_blocks(cipher, in, out, blocks);
+    return;
+  }
+  for (i = 0; i < blocks; i++){
+    cipher->cipher->encrypt(cipher, in + (bsize * i), out + (bsize * i));
+  }
+}
+
+static void decrypt_blocks(dfsch_block_cipher_context_t* cipher,
+                           uint8_t* in,
+                           uint8_t* out,
+                           size_t blocks){
+  size_t bsize = cipher->cipher->block_size;
+  size_t i;
+
+  if (cipher->cipher->decrypt_blocks){
+    cipher->cipher->decrypt_blocks(cipher, in, out, blocks);
+    return;
+  }
+  for (i = 0; i < blocks; i++){
+    cipher->cipher->decrypt(cipher, in + (bsize * i), out + (bsize * i));
+  }
+}
+
 static void ecb_setup(dfsch_block_cipher_mode_context_t* cipher,
                       uint8_t* iv,
                       size_t iv_len){
@@ -12,26 +50,14 @@ static void ecb_encrypt(dfsch_block_cipher_mode_context_t* context,
                         uint8_t* in,
                         uint8_t* out,
                         size_t blocks){
-  size_t bsize = context->cipher->cipher->block_size;
-  int i;
-
-  for (i = 0; i < blocks; i++){
-    context->cipher->cipher->encrypt(context->cipher, 
-                                     in + (bsize * i), out + (bsize * i));
-  }
+  encrypt_blocks(context->cipher, in, out, blocks);
 }
 
 static void ecb_decrypt(dfsch_block_cipher_mode_context_t* context,
                         uint8_t* in,
                         uint8_t* out,
                         size_t blocks){
-  size_t bsize = context->cipher->cipher->block_size;
-  int i;
-
-  for (i = 0; i < blocks; i++){
-    context->cipher->cipher->decrypt(context->cipher, 
-                                     in + (bsize * i), out + (bsize * i));
-  }
+  decrypt_blocks(context->cipher, in, out, blocks);
 }
 
 dfsch_block_cipher_mode_t dfsch_crypto_ecb_mode = {
@@ -94,16 +120,21 @@ static void cbc_decrypt(cbc_context_t* context,
                         uint8_t* out,
                         size_t blocks){
   size_t bsize = context->parent.cipher->cipher->block_size;
-  int i;
-  uint8_t tmp[bsize];
-
-  for (i = 0; i < blocks; i++){
-    memcpy(tmp, in + (bsize * i), bsize);
-    context->parent.cipher->cipher->decrypt(context->parent.cipher, 
-                                            in + (bsize * i), 
-                                            out + (bsize * i));
-    memxor(out + (bsize * i), context->iv, bsize);
-    memcpy(context->iv, tmp, bsize);
+  size_t n;
+  uint8_t tmp[bsize * CHUNK_BLOCKS];
+
+  /* Decryption of all blocks is independent, ciphertext is copied as
+     it serves as IV for next block and out can be same as in */
+  while (blocks){
+    n = blocks < CHUNK_BLOCKS ? blocks : CHUNK_BLOCKS;
+    memcpy(tmp, in, bsize * n);
+    decrypt_blocks(context->parent.cipher, tmp, out, n);
+    memxor(out, context->iv, bsize);
+    memxor(out + bsize, tmp, bsize * (n - 1));
+    memcpy(context->iv, tmp + bsize * (n - 1), bsize);
+    in += bsize * n;
+    out += bsize * n;
+    blocks -= n;
   }
 }
 
@@ -158,16 +189,22 @@ static void cfb_decrypt(cfb_context_t* context,
                         uint8_t* out,
                         size_t blocks){
   size_t bsize = context->parent.cipher->cipher->block_size;
-  int i;
-  uint8_t tmp[bsize];
-
-  for (i = 0; i < blocks; i++){
-    memcpy(tmp, in + (bsize * i), bsize);
-    context->parent.cipher->cipher->encrypt(context->parent.cipher, 
-                                            context->iv, 
-                                            out + (bsize * i));
-    memxor(out + (bsize * i), tmp, bsize);
-    memcpy(context->iv, tmp, bsize);
+  size_t n;
+  uint8_t tmp[bsize * CHUNK_BLOCKS];
+
+  /* Keystream is encryption of IV followed by all ciphertext blocks
+     but last one */
+  while (blocks){
+    n = blocks < CHUNK_BLOCKS ? blocks : CHUNK_BLOCKS;
+    memcpy(tmp, context->iv, bsize);
+    memcpy(tmp + bsize, in, bsize * (n - 1));
+    memcpy(context->iv, in + bsize * (n - 1), bsize);
+    encrypt_blocks(context->parent.cipher, tmp, tmp, n);
+    memmove(out, in, bsize * n);
+    memxor(out, tmp, bsize * n);
+    in += bsize * n;
+    out += bsize * n;
+    blocks -= n;
   }
 }
 
@@ -255,29 +292,39 @@ static void ctr_setup(ctr_context_t* context,
   memcpy(context->ctr, iv, iv_len);
 }
 
+static void ctr_increment(uint8_t* ctr, size_t len){
+  size_t j;
+
+  /* Increment counter, little endian */
+  for (j = 0; j < len; j++){
+    ctr[j]++;
+    if (ctr[j] != 0){
+      break;
+    }
+  }
+}
+
 static void ctr_operate(ctr_context_t* context,
                         uint8_t* in,
                         uint8_t* out,
                         size_t blocks){
   size_t bsize = context->parent.cipher->cipher->block_size;
-  int i;
-  int j;
-  uint8_t tmp[bsize];
-
-  for (i = 0; i < blocks; i++){
-    context->parent.cipher->cipher->encrypt(context->parent.cipher, 
-                                            context->ctr, 
-                                            tmp);
-    memcpy(out + (bsize * i), in + (bsize * i), bsize);
-    memxor(out + (bsize * i), tmp, bsize);
-
-    /* Increment counter, little endian */
-    for (j = 0; j < bsize; j++){
-      context->ctr[j]++;
-      if (context->ctr[j] != 0){
-        break;
-      }
+  size_t i;
+  size_t n;
+  uint8_t tmp[bsize * CHUNK_BLOCKS];
+
+  while (blocks){
+    n = blocks < CHUNK_BLOCKS ? blocks : CHUNK_BLOCKS;
+    for (i = 0; i < n; i++){
+      memcpy(tmp + (bsize * i), context->ctr, bsize);
+      ctr_increment(context->ctr, bsize);
     }
+    encrypt_blocks(context->parent.cipher, tmp, tmp, n);
+    memmove(out, in, bsize * n);
+    memxor(out, tmp, bsize * n);
+    in += bsize * n;
+    out += bsize * n;
+    blocks -= n;
   }
 }
 
@@ -361,6 +408,7 @@ dfsch_stream_cipher_t* dfsch_make_ofb_cipher(dfsch_block_cipher_t* cipher){
   bs->parent.type.name = dfsch_saprintf("%s-ofb", cipher->type.name);
   bs->parent.type.size = sizeof(block_stream_context_t);
   
+  bs->cipher = cipher;
   bs->parent.setup = bs_ofb_setup;
   bs->parent.encrypt_bytes = bs_ofb_encrypt_bytes;
 
@@ -389,21 +437,31 @@ static void bs_ctr_setup(block_stream_context_t* ctx,
 static void bs_ctr_encrypt_bytes(block_stream_context_t* ctx,
                                  uint8_t* out,
                                  size_t outlen){
-  int i;
+  size_t bsize = ctx->output_size;
+  size_t i;
+  size_t n;
+  uint8_t tmp[bsize * CHUNK_BLOCKS];
 
   while (outlen){
+    if (ctx->output_offset >= bsize && outlen >= bsize){
+      /* whole blocks of keystream */
+      n = outlen / bsize;
+      n = n < CHUNK_BLOCKS ? n : CHUNK_BLOCKS;
+      for (i = 0; i < n; i++){
+        memcpy(tmp + (bsize * i), ctx->next_input, bsize);
+        ctr_increment(ctx->next_input, bsize);
+      }
+      encrypt_blocks(ctx->cipher, tmp, tmp, n);
+      memxor(out, tmp, bsize * n);
+      out += bsize * n;
+      outlen -= bsize * n;
+      continue;
+    }
     if (ctx->output_offset >= ctx->output_size){
       ctx->cipher->cipher->encrypt(ctx->cipher, 
                                    ctx->next_input, 
                                    ctx->last_output);
-      
-      for (i = 0; i < ctx->output_size; i++){
-        ctx->next_input[i]++;
-        if (ctx->next_input[i] != 0){
-          break;
-        }
-      }
-
+      ctr_increment(ctx->next_input, ctx->output_size);
       ctx->output_offset = 0;
     }
     *out ^= ctx->last_output[ctx->output_offset];
@@ -422,6 +480,7 @@ dfsch_stream_cipher_t* dfsch_make_ctr_cipher(dfsch_block_cipher_t* cipher){
   bs->parent.type.name = dfsch_saprintf("%s-ctr", cipher->type.name);
   bs->parent.type.size = sizeof(block_stream_context_t);
 
+  bs->cipher = cipher;
   bs->parent.setup = bs_ctr_setup;
   bs->parent.encrypt_bytes = bs_ctr_encrypt_bytes;
 
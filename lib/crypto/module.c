@@ -1,5 +1,6 @@
 #include <dfsch/lib/crypto.h>
 #include <dfsch/bignum.h>
+#include <dfsch/sha256.h>
 
 DFSCH_DEFINE_PRIMITIVE(setup_block_cipher,
                        "Create new block cipher context (expanded key)"){
@@ -538,6 +539,58 @@ DFSCH_DEFINE_PRIMITIVE(hash_string,
   return dfsch_make_byte_vector_strbuf(result);
 }
 
+DFSCH_DEFINE_PRIMITIVE(hash_strings,
+                       "Hash each string in list, returns list of digests"){
+  dfsch_crypto_hash_t* hash;
+  dfsch_strbuf_t* key;
+  dfsch_object_t* inputs;
+  dfsch_object_t* i;
+  dfsch_strbuf_t* buf;
+  dfsch_list_collector_t* lc = dfsch_make_list_collector();
+  const unsigned char** in;
+  unsigned char** out;
+  size_t* len;
+  long count;
+  long j;
+
+  DFSCH_CRYPTO_HASH_ARG(args, hash);
+  DFSCH_OBJECT_ARG(args, inputs);
+  DFSCH_BUFFER_ARG_OPT(args, key, DFSCH_EMPTY_STRBUF);
+  DFSCH_ARG_END(args);
+
+  if (hash != DFSCH_CRYPTO_SHA256 || key->len != 0){
+    i = inputs;
+    while (DFSCH_PAIR_P(i)){
+      buf = dfsch_string_to_buf(DFSCH_FAST_CAR(i));
+      dfsch_list_collect(lc, 
+                         dfsch_make_byte_vector_strbuf(
+                           dfsch_crypto_hash_buffer(hash, 
+                                                    buf->ptr, buf->len, 
+                                                    key->ptr, key->len)));
+      i = DFSCH_FAST_CDR(i);
+    }
+    return dfsch_collected_list(lc);
+  }
+
+  /* plain SHA-256 can hash multiple messages at once */
+  count = dfsch_list_length_check(inputs);
+  in = GC_MALLOC(sizeof(unsigned char*) * count);
+  out = GC_MALLOC(sizeof(unsigned char*) * count);
+  len = GC_MALLOC_ATOMIC(sizeof(size_t) * count);
+
+  i = inputs;
+  for (j = 0; j < count; j++){
+    buf = dfsch_string_to_buf(DFSCH_FAST_CAR(i));
+    in[j] = (unsigned char*)buf->ptr;
+    len[j] = buf->len;
+    dfsch_list_collect(lc, dfsch_alloc_byte_vector((char**)&out[j], 32));
+    i = DFSCH_FAST_CDR(i);
+  }
+
+  dfsch_sha256_digest_many(count, in, len, out);
+
+  return dfsch_collected_list(lc);
+}
 
 
 DFSCH_DEFINE_PRIMITIVE(curve25519,
@@ -1033,6 +1086,8 @@ void dfsch_module_crypto_register(dfsch_object_t* env){
                          DFSCH_PRIMITIVE_REF(hash_result));
   dfsch_defcanon_pkgcstr(env, crypto, "hash-string",
                          DFSCH_PRIMITIVE_REF(hash_string));
+  dfsch_defcanon_pkgcstr(env, crypto, "hash-strings",
+                         DFSCH_PRIMITIVE_REF(hash_strings));
 
   dfsch_defcanon_pkgcstr(env, crypto, "*curve25519-basepoint*",
                          dfsch_make_string_buf(curve25519_basepoint, 32));
@@ -236,8 +236,8 @@ dfsch_object_t* dfsch_rsa_decrypt(dfsch_rsa_private_key_t* prk,
   dfsch_bignum_t* dQ = dfsch_bignum_from_number(prk->exponent2);
   dfsch_bignum_t* qInv = dfsch_bignum_from_number(prk->coefficient);
 
-  dfsch_bignum_t* m1 = dfsch_bignum_exp(c, dP, p);
-  dfsch_bignum_t* m2 = dfsch_bignum_exp(c, dQ, q);
+  dfsch_bignum_t* m1 = dfsch_bignum_exp_consttime(c, dP, p);
+  dfsch_bignum_t* m2 = dfsch_bignum_exp_consttime(c, dQ, q);
   
   dfsch_bignum_t* h;
   dfsch_bignum_div(dfsch_bignum_mul(qInv,
@@ -245,6 +245,9 @@ dfsch_object_t* dfsch_rsa_decrypt(dfsch_rsa_private_key_t* prk,
                    p,
                    NULL,
                    &h);
+  if (dfsch_bignum_sign(h) < 0){
+    h = dfsch_bignum_add(h, p);
+  }
 
   return dfsch_number_add(dfsch_bignum_to_number(m2),
                           dfsch_number_mul(prk->prime2,
@@ -12,6 +12,15 @@
 #include <dfsch/lib/crypto.h>
 #include "macros.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+  && !defined(DFSCH_NO_SIMD)
+#define X86_SIMD
+#include <immintrin.h>
+#endif
+
 /**
   @file sha1.c
   LTC_SHA1 code by Tom St Denis 
@@ -32,7 +41,7 @@ typedef struct sha1_state {
 #define F2(x,y,z)  ((x & y) | (z & (x | y)))
 #define F3(x,y,z)  (x ^ y ^ z)
 
-static int  sha1_compress(sha1_context_t*md, unsigned char *buf)
+static void sha1_compress(ulong32* state, unsigned char *buf)
 {
     ulong32 a,b,c,d,e,W[80],i;
 
@@ -42,11 +51,11 @@ static int  sha1_compress(sha1_context_t*md, unsigned char *buf)
     }
 
     /* copy state */
-    a = md->state[0];
-    b = md->state[1];
-    c = md->state[2];
-    d = md->state[3];
-    e = md->state[4];
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
 
     /* expand it */
     for (i = 16; i < 80; i++) {
@@ -101,11 +110,133 @@ static int  sha1_compress(sha1_context_t*md, unsigned char *buf)
     #undef FF3
 
     /* store */
-    md->state[0] = md->state[0] + a;
-    md->state[1] = md->state[1] + b;
-    md->state[2] = md->state[2] + c;
-    md->state[3] = md->state[3] + d;
-    md->state[4] = md->state[4] + e;
+    state[0] = state[0] + a;
+    state[1] = state[1] + b;
+    state[2] = state[2] + c;
+    state[3] = state[3] + d;
+    state[4] = state[4] + e;
+}
+
+static void sha1_blocks_c(ulong32* state, const unsigned char* in,
+                          size_t blocks)
+{
+    while (blocks--) {
+        sha1_compress(state, (unsigned char*)in);
+        in += 64;
+    }
+}
+
+#ifdef X86_SIMD
+
+/*
+ * SHA extensions, ABCD is kept in one register (A in highest lane) and
+ * E is carried through sha1nexte.
+ */
+
+#define SHANI_LOAD_MSG(in, i)                                           \
+    _mm_shuffle_epi8(_mm_loadu_si128((__m128i*)((in) + 16 * (i))),      \
+                     _mm_set_epi64x(0x0001020304050607ULL,              \
+                                    0x08090a0b0c0d0e0fULL))
+
+/* Four rounds using message words m. Next message words are prepared
+   on the way, e_cur has E for these rounds and e_next receives E for
+   following ones. */
+#define SHANI_QROUNDS(abcd, e_cur, e_next, m, m1, m2, m3, f) {          \
+    e_cur = _mm_sha1nexte_epu32(e_cur, m);                              \
+    e_next = abcd;                                                      \
+    m1 = _mm_sha1msg2_epu32(m1, m);                                     \
+    abcd = _mm_sha1rnds4_epu32(abcd, e_cur, f);                         \
+    m3 = _mm_sha1msg1_epu32(m3, m);                                     \
+    m2 = _mm_xor_si128(m2, m); }
+
+__attribute__((target("sha,ssse3,sse4.1")))
+static void sha1_blocks_shani(ulong32* state, const unsigned char* in,
+                              size_t blocks)
+{
+    __m128i abcd, abcd_save, e0, e0_save, e1, m0, m1, m2, m3;
+
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((__m128i*)state), 0x1b);
+    e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+    while (blocks--) {
+        abcd_save = abcd;
+        e0_save = e0;
+
+        /* rounds 0-11, message schedule is not yet complete */
+        m0 = SHANI_LOAD_MSG(in, 0);
+        e0 = _mm_add_epi32(e0, m0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        m1 = SHANI_LOAD_MSG(in, 1);
+        e1 = _mm_sha1nexte_epu32(e1, m1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        m0 = _mm_sha1msg1_epu32(m0, m1);
+
+        m2 = SHANI_LOAD_MSG(in, 2);
+        e0 = _mm_sha1nexte_epu32(e0, m2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        m1 = _mm_sha1msg1_epu32(m1, m2);
+        m0 = _mm_xor_si128(m0, m2);
+
+        m3 = SHANI_LOAD_MSG(in, 3);
+
+        /* rounds 12-79 */
+        SHANI_QROUNDS(abcd, e1, e0, m3, m0, m1, m2, 0);
+        SHANI_QROUNDS(abcd, e0, e1, m0, m1, m2, m3, 0);
+        SHANI_QROUNDS(abcd, e1, e0, m1, m2, m3, m0, 1);
+        SHANI_QROUNDS(abcd, e0, e1, m2, m3, m0, m1, 1);
+        SHANI_QROUNDS(abcd, e1, e0, m3, m0, m1, m2, 1);
+        SHANI_QROUNDS(abcd, e0, e1, m0, m1, m2, m3, 1);
+        SHANI_QROUNDS(abcd, e1, e0, m1, m2, m3, m0, 1);
+        SHANI_QROUNDS(abcd, e0, e1, m2, m3, m0, m1, 2);
+        SHANI_QROUNDS(abcd, e1, e0, m3, m0, m1, m2, 2);
+        SHANI_QROUNDS(abcd, e0, e1, m0, m1, m2, m3, 2);
+        SHANI_QROUNDS(abcd, e1, e0, m1, m2, m3, m0, 2);
+        SHANI_QROUNDS(abcd, e0, e1, m2, m3, m0, m1, 2);
+        SHANI_QROUNDS(abcd, e1, e0, m3, m0, m1, m2, 3);
+        SHANI_QROUNDS(abcd, e0, e1, m0, m1, m2, m3, 3);
+        SHANI_QROUNDS(abcd, e1, e0, m1, m2, m3, m0, 3);
+        SHANI_QROUNDS(abcd, e0, e1, m2, m3, m0, m1, 3);
+        SHANI_QROUNDS(abcd, e1, e0, m3, m0, m1, m2, 3);
+
+        e0 = _mm_sha1nexte_epu32(e0, e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+        in += 64;
+    }
+
+    _mm_storeu_si128((__m128i*)state, _mm_shuffle_epi32(abcd, 0x1b));
+    state[4] = _mm_extract_epi32(e0, 3);
+}
+
+#endif
+
+/* Compression function is selected on first use, DFSCH_SIMD=none forces
+   portable code */
+static void (*blocks_kernel)(ulong32* state, const unsigned char* in,
+                             size_t blocks) = NULL;
+
+static void sha1_blocks(sha1_context_t* md, unsigned char* buf, 
+                        size_t blocks)
+{
+    if (!blocks_kernel) {
+        void (*k)(ulong32* state, const unsigned char* in,
+                  size_t blocks) = sha1_blocks_c;
+#ifdef X86_SIMD
+        char* limit = getenv("DFSCH_SIMD");
+
+        __builtin_cpu_init();
+        if (!(limit && strcmp(limit, "none") == 0) &&
+            __builtin_cpu_supports("sha") &&
+            __builtin_cpu_supports("sse4.1")) {
+            k = sha1_blocks_shani;
+        }
+#endif
+        blocks_kernel = k; /* every thread selects the same thing */
+    }
+    blocks_kernel(md->state, buf, blocks);
 }
 
 /**
@@ -136,7 +267,7 @@ int sha1_setup(sha1_context_t* md, uint8_t* key, size_t keylen)
    @param inlen  The length of the data (octets)
    @return CRYPT_OK if successful
 */
-HASH_PROCESS(sha1_process, sha1_compress, sha1_context_t, 64)
+HASH_PROCESS_BLOCKS(sha1_process, sha1_blocks, sha1_context_t, 64)
 
 /**
    Terminate the hash to get the digest
@@ -162,7 +293,7 @@ int sha1_result(sha1_context_t* md, unsigned char *out)
         while (md->curlen < 64) {
             md->buf[md->curlen++] = (unsigned char)0;
         }
-        sha1_compress(md, md->buf);
+        sha1_blocks(md, md->buf, 1);
         md->curlen = 0;
     }
 
@@ -173,7 +304,7 @@ int sha1_result(sha1_context_t* md, unsigned char *out)
 
     /* store length */
     STORE64H(md->length, md->buf+56);
-    sha1_compress(md, md->buf);
+    sha1_blocks(md, md->buf, 1);
 
     /* copy output */
     for (i = 0; i < 5; i++) {
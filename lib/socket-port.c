@@ -1,5 +1,6 @@
 #include <dfsch/lib/socket-port.h>
 #include <dfsch/magic.h>
+#include <dfsch/util.h>
 
 #include <unistd.h>
 #include <errno.h>
@@ -25,39 +26,153 @@ typedef struct socket_port_t {
   size_t buflen;
   pthread_mutex_t* mutex;
   char* name;
+
+  /* Output buffer, protected by wmutex */
+  char* wbuf;
+  size_t wbuflen;
+  size_t wbufsize;
+  int wmode;
+  pthread_mutex_t* wmutex;
 } socket_port_t;
 
 static void socket_port_write(socket_port_t* sp, dfsch_writer_state_t* state){
   dfsch_write_unreadable(state, sp, "%d %s", sp->fd, sp->name);
 }
 
-static void socket_port_write_buf(socket_port_t* port, 
-                                  char*buf, size_t len){
+/*
+ * Write all buffers in iov, data that does not fit into first write() are
+ * retried until everything is written or error occurs.
+ */
+static void socket_port_real_writev(socket_port_t* port, 
+                                    struct iovec* iov, int iovcnt){
   ssize_t ret;
 
-  if (!port->open){
-    dfsch_error("Port is closed", (dfsch_object_t*)port);
-  }
-
   signal(SIGPIPE, SIG_IGN);
 
-  while (len){
-    ret = write(port->fd, buf, len);
+  while (iovcnt){
+    ret = writev(port->fd, iov, iovcnt);
     if (ret == 0){
       return;
     }
     if (ret < 0){
       if (errno == EINTR){
         dfsch_async_apply_check();
+        continue;
       } else {
-        dfsch_operating_system_error("write");    
+        dfsch_operating_system_error("writev");    
       }
     }
-    len -= ret;
-    buf += ret;
+
+    while (iovcnt && ret >= iov->iov_len){
+      ret -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt){
+      iov->iov_base = (char*)iov->iov_base + ret;
+      iov->iov_len -= ret;
+    }
+  }
+}
+
+static void socket_port_flush_locked(socket_port_t* port){
+  struct iovec iov;
+
+  if (!port->wbuflen){
+    return;
+  }
+
+  iov.iov_base = port->wbuf;
+  iov.iov_len = port->wbuflen;
+  port->wbuflen = 0; /* data are lost on error anyway */
+  socket_port_real_writev(port, &iov, 1);
+}
+
+static void socket_port_flush(socket_port_t* port){
+  if (!port->open){
+    dfsch_error("Port is closed", (dfsch_object_t*)port);
+  }
+
+  pthread_mutex_lock(port->wmutex);
+  DFSCH_UNWIND {
+    socket_port_flush_locked(port);
+  } DFSCH_PROTECT {
+    pthread_mutex_unlock(port->wmutex);
+  } DFSCH_PROTECT_END;
+}
+
+static void socket_port_write_buf(socket_port_t* port, 
+                                  char*buf, size_t len){
+  struct iovec iov[2];
+
+  if (!port->open){
+    dfsch_error("Port is closed", (dfsch_object_t*)port);
   }
+
+  pthread_mutex_lock(port->wmutex);
+  DFSCH_UNWIND {
+    if (port->wmode == DFSCH_PORT_BUFFER_NONE){
+      iov[0].iov_base = buf;
+      iov[0].iov_len = len;
+      socket_port_real_writev(port, iov, 1);
+    } else if (len > port->wbufsize - port->wbuflen){
+      if (len >= port->wbufsize){
+        /* Large write goes out together with buffer contents in one 
+           syscall */
+        iov[0].iov_base = port->wbuf;
+        iov[0].iov_len = port->wbuflen;
+        iov[1].iov_base = buf;
+        iov[1].iov_len = len;
+        port->wbuflen = 0;
+        socket_port_real_writev(port, iov, 2);
+      } else {
+        socket_port_flush_locked(port);
+        memcpy(port->wbuf, buf, len);
+        port->wbuflen = len;
+      }
+    } else {
+      memcpy(port->wbuf + port->wbuflen, buf, len);
+      port->wbuflen += len;
+      if (port->wbuflen == port->wbufsize){
+        socket_port_flush_locked(port);
+      }
+    }
+
+    if (port->wmode == DFSCH_PORT_BUFFER_LINE && memchr(buf, '\n', len)){
+      socket_port_flush_locked(port);
+    }
+  } DFSCH_PROTECT {
+    pthread_mutex_unlock(port->wmutex);
+  } DFSCH_PROTECT_END;
 }
 
+static void socket_port_set_buffering(socket_port_t* port, 
+                                      int mode, size_t size){
+  if (!port->open){
+    dfsch_error("Port is closed", (dfsch_object_t*)port);
+  }
+
+  if (size == 0){
+    size = SOCK_BUFFER_SIZE;
+  }
+
+  pthread_mutex_lock(port->wmutex);
+  DFSCH_UNWIND {
+    socket_port_flush_locked(port);
+    port->wmode = mode;
+    if (mode == DFSCH_PORT_BUFFER_NONE){
+      port->wbuf = NULL;
+      port->wbufsize = 0;
+    } else if (size != port->wbufsize) {
+      port->wbuf = GC_MALLOC_ATOMIC(size);
+      port->wbufsize = size;
+    }
+  } DFSCH_PROTECT {
+    pthread_mutex_unlock(port->wmutex);
+  } DFSCH_PROTECT_END;
+}
+
+/* Returns 0 on end of file, errors are signaled */
 static ssize_t socket_port_real_read(socket_port_t* port,
                                      char* buf, size_t len){
   ssize_t ret;
@@ -70,25 +185,17 @@ static ssize_t socket_port_real_read(socket_port_t* port,
       goto retry;
     } else {
       dfsch_operating_system_error("read");    
+      return 0;
     }
   }
 
   return ret;
 }
 
-static ssize_t socket_port_read_buf(socket_port_t* sp,
-                                    char* buf, size_t len){
+static ssize_t socket_port_read_buf_locked(socket_port_t* sp,
+                                           char* buf, size_t len){
   ssize_t my_ret = 0;
   ssize_t ret;
-  size_t tmplen;
-  struct iovec iov[2];
-  char* tmpbuf;
-
-  if (!sp->open){
-    dfsch_error("Port is closed", (dfsch_object_t*)sp);
-  }
-
-  pthread_mutex_lock(sp->mutex);
 
   if (sp->buf != sp->bufhead){
     memmove(sp->buf, sp->bufhead, sp->buflen);
@@ -105,7 +212,6 @@ static ssize_t socket_port_read_buf(socket_port_t* sp,
     while (len > SOCK_BUFFER_SIZE){
       ret = socket_port_real_read(sp, buf, len);
       if (ret == 0){
-        pthread_mutex_unlock(sp->mutex);
         return my_ret;
       }
       buf += ret;
@@ -121,8 +227,6 @@ static ssize_t socket_port_read_buf(socket_port_t* sp,
         buf += sp->buflen;
         len -= sp->buflen;
         sp->buflen = 0;
-
-        pthread_mutex_unlock(sp->mutex);
         return my_ret;
       }
       sp->buflen += ret;
@@ -133,15 +237,35 @@ static ssize_t socket_port_read_buf(socket_port_t* sp,
   sp->buflen -= len;
   my_ret += len;
   memmove(sp->buf, sp->buf + len, sp->buflen);
-  pthread_mutex_unlock(sp->mutex);
   return my_ret;  
 }
 
+static ssize_t socket_port_read_buf(socket_port_t* sp,
+                                    char* buf, size_t len){
+  ssize_t ret;
+
+  if (!sp->open){
+    dfsch_error("Port is closed", (dfsch_object_t*)sp);
+  }
+
+  socket_port_flush(sp);
+
+  pthread_mutex_lock(sp->mutex);
+  DFSCH_UNWIND {
+    ret = socket_port_read_buf_locked(sp, buf, len);
+  } DFSCH_PROTECT {
+    pthread_mutex_unlock(sp->mutex);
+  } DFSCH_PROTECT_END;
+
+  return ret;
+}
+
 static void socket_port_batch_read_start(socket_port_t* port){
   if (!port->open){
     dfsch_error("Port is already closed", (dfsch_object_t*)port);
   }
   
+  socket_port_flush(port);
   pthread_mutex_lock(port->mutex);
 }
 static void socket_port_batch_read_end(socket_port_t* port){
@@ -153,7 +277,7 @@ static void socket_port_batch_read_end(socket_port_t* port){
 }
 static int socket_port_batch_read(socket_port_t* sp){
   int ch;
-  size_t ret;
+  ssize_t ret;
 
   if (sp->buflen){
     ch = sp->bufhead[0];
@@ -174,6 +298,22 @@ static int socket_port_batch_read(socket_port_t* sp){
   }
 }
 
+static char* socket_port_batch_read_buf(socket_port_t* sp, size_t* len){
+  ssize_t ret;
+
+  if (!sp->buflen){
+    ret = socket_port_real_read(sp, sp->buf, SOCK_BUFFER_SIZE);
+    sp->bufhead = sp->buf;
+    sp->buflen = ret > 0 ? ret : 0;
+  }
+
+  *len = sp->buflen;
+  return sp->bufhead;
+}
+static void socket_port_batch_read_consume(socket_port_t* sp, size_t len){
+  sp->bufhead += len;
+  sp->buflen -= len;
+}
 
 
 dfsch_port_type_t dfsch_socket_port_type = {
@@ -191,10 +331,18 @@ dfsch_port_type_t dfsch_socket_port_type = {
   .batch_read_start = (dfsch_port_batch_read_start_t)socket_port_batch_read_start,
   .batch_read_end = (dfsch_port_batch_read_end_t)socket_port_batch_read_end,
   .batch_read = (dfsch_port_batch_read_t)socket_port_batch_read,
+  .batch_read_buf = (dfsch_port_batch_read_buf_t)socket_port_batch_read_buf,
+  .batch_read_consume = 
+  (dfsch_port_batch_read_consume_t)socket_port_batch_read_consume,
+  .flush = (dfsch_port_flush_t)socket_port_flush,
+  .set_buffering = (dfsch_port_set_buffering_t)socket_port_set_buffering,
 };
 
 static void socket_port_finalizer(socket_port_t* port, void* cd){
   if (port->open){
+    if (port->wbuflen){ /* best effort, errors cannot be reported here */
+      write(port->fd, port->wbuf, port->wbuflen);
+    }
     close(port->fd);
     port->open = 0;
   }
@@ -215,6 +363,14 @@ static dfsch_object_t* cons_socket_port(char* name,
   sp->bufhead = sp->buf;
   sp->mutex = dfsch_create_finalized_mutex();
 
+  sp->wbuf = GC_MALLOC_ATOMIC(SOCK_BUFFER_SIZE);
+  sp->wbuflen = 0;
+  sp->wbufsize = SOCK_BUFFER_SIZE;
+  /* Output buffering is opt-in (set-port-buffering!), so protocols
+     that never call flush-output keep working */
+  sp->wmode = DFSCH_PORT_BUFFER_NONE;
+  sp->wmutex = dfsch_create_finalized_mutex();
+
   return sp;
 }
 
@@ -322,8 +478,12 @@ dfsch_object_t* dfsch_socket_port_unix_connect(char* path){
 void dfsch_socket_port_close(dfsch_object_t* spo){
   socket_port_t* sp = DFSCH_ASSERT_TYPE(spo, DFSCH_SOCKET_PORT_TYPE);
   if (sp->open){
-    sp->open = 0;
-    close(sp->fd);
+    DFSCH_UNWIND {
+      socket_port_flush(sp);
+    } DFSCH_PROTECT {
+      sp->open = 0;
+      close(sp->fd);
+    } DFSCH_PROTECT_END;
   }
 }
 
@@ -22,6 +22,11 @@
 #include "dfsch/lib/threads.h"
 
 #include <dfsch/number.h>
+#include <dfsch/strings.h>
+#include <dfsch/serdes.h>
+#include <dfsch/conditions.h>
+#include <dfsch/magic.h>
+#include <dfsch/random.h>
 #include "src/util.h"
 #include <errno.h>
 #include <string.h>
@@ -48,9 +53,11 @@ static const dfsch_type_t thread_type = {
 typedef struct thread_args_t {
   dfsch_object_t* function;
   dfsch_object_t* args;
+  dfsch_object_t* random_state;
 } thread_args_t;
 
 dfsch_object_t* thread_function(thread_args_t* args){
+  dfsch_set_random_state(args->random_state);
   return dfsch_apply(args->function, args->args);
 }
 
@@ -62,6 +69,7 @@ dfsch_object_t* dfsch_thread_create(dfsch_object_t* function,
   
   args->function = function;
   args->args = arguments;
+  args->random_state = dfsch_random_make_stream();
   
   pthread_create(&(thread->thread), 
                  NULL, 
@@ -387,3 +395,146 @@ void dfsch_channel_write(dfsch_object_t* channel,
 }
 
 
+
+// Isolates
+
+/*
+ * Isolate is thread with its own top-level environment, created inside
+ * that thread, so lookups there never contend for environment lock. 
+ * Isolates share no mutable objects with rest of the program, all
+ * communication passes serialized objects through pair of channels.
+ * Objects bound in canonical environment (primitives, classes...) are
+ * transferred by name.
+ *
+ * Both sides hold an isolate endpoint object, endpoint seen by the
+ * isolate itself (bound to threads:*isolate*) has channels swapped.
+ */
+
+typedef struct isolate_t {
+  dfsch_type_t* type;
+  dfsch_object_t* env;
+  dfsch_object_t* input;
+  dfsch_object_t* output;
+  dfsch_object_t* thread;
+} isolate_t;
+
+static const dfsch_type_t isolate_type = {
+  DFSCH_STANDARD_TYPE,
+  NULL,
+  sizeof(isolate_t), 
+  "isolate",
+  NULL,
+  NULL,
+  NULL
+};
+
+typedef struct isolate_args_t {
+  isolate_t* endpoint;
+  dfsch_strbuf_t* code;
+  dfsch_object_t* random_state;
+} isolate_args_t;
+
+typedef struct isolate_result_t {
+  dfsch_strbuf_t* value;
+  dfsch_object_t* error;
+} isolate_result_t;
+
+static isolate_result_t* isolate_function(isolate_args_t* args){
+  isolate_result_t* res = GC_NEW(isolate_result_t);
+  dfsch_object_t* tag = dfsch_gensym();
+  dfsch_object_t* env = dfsch_make_top_level_environment();
+  dfsch_object_t* expr;
+
+  dfsch_set_random_state(args->random_state);
+  args->endpoint->env = env;
+  dfsch_module_threads_register(env);
+  dfsch_define_pkgcstr(env, 
+                       (dfsch_package_t*)dfsch_make_package("threads", NULL),
+                       "*isolate*", args->endpoint);
+
+  DFSCH_CATCH_BEGIN(tag){
+    dfsch_handler_bind(DFSCH_SERIOUS_CONDITION_TYPE, 
+                       dfsch_make_throw_proc_arg(tag));
+    expr = dfsch_deserialize(args->code, env);
+    res->value = dfsch_serialize(dfsch_eval(expr, env), env, 0);
+  } DFSCH_CATCH {
+    /* Condition object is the only thing isolate hands over to its
+       parent directly, thread is finished by the time it is read */
+    res->error = DFSCH_CATCH_VALUE;
+  } DFSCH_CATCH_END;
+
+  return res;
+}
+
+dfsch_object_t* dfsch_isolate_create(dfsch_object_t* env,
+                                     dfsch_object_t* expression,
+                                     size_t buffer){
+  isolate_t* parent = (isolate_t*)dfsch_make_object(&isolate_type);
+  isolate_t* child = (isolate_t*)dfsch_make_object(&isolate_type);
+  isolate_args_t* args = GC_NEW(isolate_args_t);
+  thread_obj_t* thread = (thread_obj_t*)dfsch_make_object(&thread_type);
+  int err;
+
+  parent->env = env;
+  parent->input = dfsch_channel_create(buffer);
+  parent->output = dfsch_channel_create(buffer);
+  parent->thread = (dfsch_object_t*)thread;
+
+  child->input = parent->output;
+  child->output = parent->input;
+
+  args->endpoint = child;
+  args->code = dfsch_serialize(expression, env, 0);
+  args->random_state = dfsch_random_make_stream();
+
+  err = pthread_create(&(thread->thread), 
+                       NULL, 
+                       (void*(*)(void*))isolate_function, 
+                       args);
+
+  if (err != 0){
+    dfsch_error("thread:unix-error",dfsch_make_string_cstr(strerror(err)));
+  }
+
+  return (dfsch_object_t*)parent;
+}
+
+static isolate_t* get_isolate(dfsch_object_t* isolate){
+  if (DFSCH_TYPE_OF(isolate) != &isolate_type)
+    dfsch_error("thread:not-an-isolate", isolate);
+  return (isolate_t*)isolate;
+}
+
+void dfsch_isolate_send(dfsch_object_t* isolate, dfsch_object_t* object){
+  isolate_t* i = get_isolate(isolate);
+
+  dfsch_channel_write(i->output, 
+                      dfsch_make_byte_vector_strbuf(dfsch_serialize(object,
+                                                                    i->env,
+                                                                    0)));
+}
+
+dfsch_object_t* dfsch_isolate_receive(dfsch_object_t* isolate){
+  isolate_t* i = get_isolate(isolate);
+
+  return dfsch_deserialize(dfsch_byte_vector_to_buf(dfsch_channel_read(i->input)),
+                           i->env);
+}
+
+dfsch_object_t* dfsch_isolate_join(dfsch_object_t* isolate){
+  isolate_t* i = get_isolate(isolate);
+  isolate_result_t* res;
+
+  if (!i->thread){
+    dfsch_error("thread:not-joinable", isolate);
+  }
+
+  res = (isolate_result_t*)dfsch_thread_join(i->thread);
+  i->thread = NULL;
+
+  if (res->error){
+    dfsch_error("thread:isolate-failed", res->error);
+  }
+
+  return dfsch_deserialize(res->value, i->env);
+}
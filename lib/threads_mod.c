@@ -155,6 +155,42 @@ DFSCH_DEFINE_PRIMITIVE(channel_write, "Write object into channel"){
   return object;
 }
 
+DFSCH_PRIMITIVE_HEAD(isolate_create){
+  dfsch_object_t* expression;
+  size_t buffer;
+  DFSCH_OBJECT_ARG(args, expression);
+  DFSCH_LONG_ARG_OPT(args, buffer, 16);
+  DFSCH_ARG_END(args);
+
+  return dfsch_isolate_create(baton, expression, buffer);
+}
+DFSCH_DEFINE_PRIMITIVE(isolate_send, "Send copy of object to isolate"){
+  dfsch_object_t* isolate;
+  dfsch_object_t* object;
+  DFSCH_OBJECT_ARG(args, isolate);
+  DFSCH_OBJECT_ARG(args, object);
+  DFSCH_ARG_END(args);
+
+  dfsch_isolate_send(isolate, object);
+  return object;
+}
+DFSCH_DEFINE_PRIMITIVE(isolate_receive, "Receive object from isolate"){
+  dfsch_object_t* isolate;
+  DFSCH_OBJECT_ARG(args, isolate);
+  DFSCH_ARG_END(args);
+
+  return dfsch_isolate_receive(isolate);
+}
+DFSCH_DEFINE_PRIMITIVE(isolate_join, 
+                       "Wait for isolate to finish and return copy of "
+                       "its result"){
+  dfsch_object_t* isolate;
+  DFSCH_OBJECT_ARG(args, isolate);
+  DFSCH_ARG_END(args);
+
+  return dfsch_isolate_join(isolate);
+}
+
 
 
 dfsch_object_t* dfsch_module_threads_register(dfsch_object_t *ctx){
@@ -196,6 +232,17 @@ dfsch_object_t* dfsch_module_threads_register(dfsch_object_t *ctx){
   dfsch_defcanon_pkgcstr(ctx, threads, "channel-write", 
                          DFSCH_PRIMITIVE_REF(channel_write));
 
+  dfsch_defcanon_pkgcstr(ctx, threads, "isolate-create", 
+                         DFSCH_PRIMITIVE_REF_MAKE(isolate_create, ctx,
+                                                  "Evaluate expression in new thread "
+                                                  "with separate top-level environment"));
+  dfsch_defcanon_pkgcstr(ctx, threads, "isolate-send", 
+                         DFSCH_PRIMITIVE_REF(isolate_send));
+  dfsch_defcanon_pkgcstr(ctx, threads, "isolate-receive", 
+                         DFSCH_PRIMITIVE_REF(isolate_receive));
+  dfsch_defcanon_pkgcstr(ctx, threads, "isolate-join", 
+                         DFSCH_PRIMITIVE_REF(isolate_join));
+
 
   return NULL;
 }
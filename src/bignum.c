@@ -28,21 +28,42 @@
 #include "internal.h"
 #include <string.h>
 
-#ifdef DFSCH_32BIT_BIGNUM
+/*
+ * Words always have one spare bit (WORD_BITS is one less than width of 
+ * word_t), so carries and borrows of additions fit into word itself. 
+ * 63-bit words are used whenever compiler has 128-bit integer type for 
+ * double word products.
+ */
+
+#if defined(DFSCH_32BIT_BIGNUM)
 #define WORD_BITS 31
 typedef uint32_t word_t;
 typedef uint64_t dword_t;
 typedef int64_t sword_t;
-#else
+#elif defined(DFSCH_16BIT_BIGNUM) || !defined(__SIZEOF_INT128__)
 #define WORD_BITS 15
 typedef uint16_t word_t;
 typedef uint32_t dword_t;
 typedef int32_t sword_t;
+#else
+#define WORD_BITS 63
+typedef uint64_t word_t;
+typedef unsigned __int128 dword_t;
+typedef __int128 sword_t;
 #endif
 
 
-#define WORD_BASE (1 << WORD_BITS)
-#define WORD_MASK (WORD_BASE - 1)
+#define WORD_BASE (((dword_t)1) << WORD_BITS)
+#define WORD_MASK ((word_t)(WORD_BASE - 1))
+
+/* 
+ * Operand sizes (in words) above which asymptotically faster algorithms 
+ * are used, measured with 63-bit words on x86-64.
+ */
+#define KARATSUBA_THRESHOLD 32
+#define TOOM3_THRESHOLD 160
+#define DIV_DC_THRESHOLD 48
+#define TO_STRING_DC_THRESHOLD 24
 
 
 struct dfsch_bignum_t {
@@ -67,7 +88,8 @@ static uint32_t bignum_hash(bignum_t* n){
   }
   r ^= n->length;
   for (i = 0; i < n->length; i++){
-    r ^= (r << WORD_BITS) + n->words[i] + (r >> 3);
+    r ^= (r << 7) + (uint32_t)n->words[i] 
+      + (uint32_t)(n->words[i] >> (WORD_BITS / 2)) + (r >> 3);
   }
   r ^= n->length;
   return r;
@@ -151,7 +173,7 @@ static bignum_t* copy_bignum_mod2(bignum_t* s, size_t m){
     memcpy(b->words, s->words, sizeof(word_t)*s->length);
   } else {
     memcpy(b->words, s->words, sizeof(word_t)*ws);
-    b->words[ws] = s->words[ws] & ((1 << bs) - 1);
+    b->words[ws] = s->words[ws] & ((((word_t)1) << bs) - 1);
   }
 
   normalize_bignum(b);
@@ -166,6 +188,7 @@ static bignum_t* copy_bignum_words(bignum_t* s, size_t count){
   b = make_bignum(count);
   b->negative = s->negative;
   memcpy(b->words, s->words, sizeof(word_t)*count);
+  normalize_bignum(b);
   return b;
 }
 
@@ -222,8 +245,8 @@ int dfsch_bignum_to_uint64(dfsch_bignum_t* b, uint64_t* rp){
   }
   
   if (rp){
-    if (UINT64_DIGITS > b->length + 1){
-      i = b->length + 1;
+    if (UINT64_DIGITS > b->length){
+      i = b->length;
     } else {
       i = UINT64_DIGITS;
     }
@@ -266,12 +289,12 @@ double dfsch_bignum_to_double(dfsch_bignum_t* b){
   double r = 0;
   int i;
 
-  for (i = b->length+1; i > 0; i--){
-    r *= WORD_BASE;
+  for (i = b->length; i > 0; i--){
+    r *= (double)WORD_BASE;
     r += b->words[i-1] & WORD_MASK;
   }
 
-  return r;
+  return b->negative ? -r : r;
 }
 
 
@@ -351,40 +374,6 @@ static size_t bignum_num_bits(bignum_t* b){
 static int bignum_get_bit(bignum_t* b, size_t n){
   return (b->words[n / WORD_BITS] >> (n % WORD_BITS)) & 0x01;
 }
-static word_t bignum_get_word(bignum_t* b, size_t n){
-  if (n % WORD_BITS < WORD_BITS - 8){
-    return (b->words[n / WORD_BITS] >> (n % WORD_BITS)) & WORD_MASK;
-  } else if (n / WORD_BITS + 1 > b->length) {
-    return (b->words[n / WORD_BITS] >> (n % WORD_BITS)) & WORD_MASK;
-  } else {
-    return (b->words[n / WORD_BITS] >> (n % WORD_BITS)) |
-      (b->words[n / WORD_BITS +1] << (WORD_BITS - n % WORD_BITS)) & 0xff;
-  }
-}
-static void bignum_set_word(bignum_t* b, size_t n, word_t v, word_t m){
-  if (n % WORD_BITS < WORD_BITS - 8){
-    b->words[n / WORD_BITS] = 
-      ((b->words[n / WORD_BITS] & 
-        ~(m << (n % WORD_BITS))) | 
-       (v << (n % WORD_BITS))) & WORD_MASK;
-  } else if (n / WORD_BITS + 1 > b->length) {
-    b->words[n / WORD_BITS] = 
-      ((b->words[n / WORD_BITS] & 
-        ~(m << (n % WORD_BITS))) | 
-       (v << (n % WORD_BITS))) & WORD_MASK;
-  } else {
-    b->words[n / WORD_BITS] = 
-      ((b->words[n / WORD_BITS] & 
-        ~(0xff << (n % WORD_BITS))) | 
-       (v << (n % WORD_BITS))) & WORD_MASK;
-    b->words[n / WORD_BITS + 1] = 
-      ((b->words[n / WORD_BITS + 1] & 
-        ~(m >> (WORD_BITS - n % WORD_BITS))) | 
-       (v >> (WORD_BITS - n % WORD_BITS))) & WORD_MASK;
-  }
-}
-
-
 static dfsch_bignum_t* bignum_add_abs(bignum_t* a, bignum_t* b){
   bignum_t* res;
   bignum_t* tmp;
@@ -520,27 +509,294 @@ dfsch_bignum_t* dfsch_bignum_abs(dfsch_bignum_t* a){
 }
 
 /*
- * Long multiplication (HAC 14.12, elementary school :))
- * O(n^2), but simple and works
+ * Multiplication works on raw word arrays, operands are not required to be
+ * normalized. Products of small operands are computed by long 
+ * multiplication (HAC 14.12), larger ones by Karatsuba's algorithm and 
+ * Toom-Cook 3-way splitting (with Bodrato's interpolation sequence). 
+ * Squares are detected by pointer equality and take cheaper paths.
  */
-dfsch_bignum_t* dfsch_bignum_mul(bignum_t* a, bignum_t* b){
-  bignum_t* res;
+
+/* r[0..an) = a + b, an >= bn, returns carry; r may be same as a */
+static word_t words_add(word_t* r, word_t* a, size_t an, 
+                        word_t* b, size_t bn){
+  size_t i;
+  word_t cy = 0;
+
+  for (i = 0; i < bn; i++){
+    cy += a[i] + b[i];
+    r[i] = cy & WORD_MASK;
+    cy >>= WORD_BITS;
+  }
+  for (; i < an && cy; i++){
+    cy += a[i];
+    r[i] = cy & WORD_MASK;
+    cy >>= WORD_BITS;
+  }
+  if (r != a && i < an){
+    memcpy(r + i, a + i, (an - i) * sizeof(word_t));
+  }
+  return cy;
+}
+
+/* r[0..an) = a - b, an >= bn, returns borrow; r may be same as a */
+static word_t words_sub(word_t* r, word_t* a, size_t an, 
+                        word_t* b, size_t bn){
+  size_t i;
+  word_t bw = 0;
+
+  for (i = 0; i < bn; i++){
+    bw = a[i] - b[i] - bw;
+    r[i] = bw & WORD_MASK;
+    bw = (bw >> WORD_BITS) & 1;
+  }
+  for (; i < an && bw; i++){
+    bw = a[i] - bw;
+    r[i] = bw & WORD_MASK;
+    bw = (bw >> WORD_BITS) & 1;
+  }
+  if (r != a && i < an){
+    memcpy(r + i, a + i, (an - i) * sizeof(word_t));
+  }
+  return bw;
+}
+
+static void words_mul_basecase(word_t* r, word_t* a, size_t an, 
+                               word_t* b, size_t bn){
   size_t i;
   size_t j;
   dword_t cy;
 
-  res = make_bignum(a->length + b->length);
-  for (i = 0; i < a->length; i++){
+  memset(r, 0, (an + bn) * sizeof(word_t));
+  for (i = 0; i < an; i++){
     cy = 0;
-    for (j = 0; j < b->length; j++){
-      cy = res->words[i+j] + a->words[i] * b->words[j] + cy;
-      res->words[i+j] = cy & WORD_MASK;
+    for (j = 0; j < bn; j++){
+      cy += (dword_t)a[i] * b[j] + r[i + j];
+      r[i + j] = cy & WORD_MASK;
       cy >>= WORD_BITS;
     }
-    res->words[i+j] += cy;
-    
+    r[i + bn] = cy;
+  }
+}
+
+/* Each cross product is computed only once and doubled (HAC 14.16) */
+static void words_sqr_basecase(word_t* r, word_t* a, size_t n){
+  size_t i;
+  size_t j;
+  dword_t cy;
+  word_t c;
+  word_t w;
+
+  memset(r, 0, 2 * n * sizeof(word_t));
+  for (i = 0; i < n; i++){
+    cy = 0;
+    for (j = i + 1; j < n; j++){
+      cy += (dword_t)a[i] * a[j] + r[i + j];
+      r[i + j] = cy & WORD_MASK;
+      cy >>= WORD_BITS;
+    }
+    r[i + n] = cy;
+  }
+
+  c = 0;
+  for (i = 0; i < 2 * n; i++){
+    w = (r[i] << 1) | c;
+    c = r[i] >> (WORD_BITS - 1);
+    r[i] = w & WORD_MASK;
+  }
+
+  cy = 0;
+  for (i = 0; i < n; i++){
+    dword_t p = (dword_t)a[i] * a[i];
+    cy += (p & WORD_MASK) + r[2 * i];
+    r[2 * i] = cy & WORD_MASK;
+    cy >>= WORD_BITS;
+    cy += (p >> WORD_BITS) + r[2 * i + 1];
+    r[2 * i + 1] = cy & WORD_MASK;
+    cy >>= WORD_BITS;
+  }
+}
+
+static void words_mul(word_t* r, word_t* a, size_t an, 
+                      word_t* b, size_t bn);
+
+/* 
+ * a = a1 B^m + a0, b = b1 B^m + b0,
+ * ab = a1b1 B^2m + ((a0 + a1)(b0 + b1) - a0b0 - a1b1) B^m + a0b0
+ */
+static void words_karatsuba(word_t* r, word_t* a, size_t an, 
+                            word_t* b, size_t bn){
+  size_t m = (an + 1) / 2;
+  size_t rn = an + bn;
+  size_t tn = 2 * m + 2;
+  int square = (a == b && an == bn);
+  word_t* sa = GC_MALLOC_ATOMIC((2 * (m + 1) + tn) * sizeof(word_t));
+  word_t* sb = sa + m + 1;
+  word_t* t = sb + m + 1;
+
+  sa[m] = words_add(sa, a, m, a + m, an - m);
+  if (square){
+    sb = sa;
+  } else {
+    sb[m] = words_add(sb, b, m, b + m, bn - m);
+  }
+
+  words_mul(r, a, m, b, m);
+  words_mul(r + 2 * m, a + m, an - m, b + m, bn - m);
+  words_mul(t, sa, m + 1, sb, m + 1);
+
+  words_sub(t, t, tn, r, 2 * m);
+  words_sub(t, t, tn, r + 2 * m, rn - 2 * m);
+  while (tn > rn - m){
+    tn--; /* these words are zero, middle term fits */
+  }
+  words_add(r + m, r + m, rn - m, t, tn);
+}
+
+static bignum_t* words_to_bignum(word_t* w, size_t n){
+  bignum_t* b = make_bignum(n);
+  memcpy(b->words, w, n * sizeof(word_t));
+  normalize_bignum(b);
+  return b;
+}
+static bignum_t* words_slice(word_t* w, size_t n, size_t start, size_t len){
+  if (start >= n){
+    return make_bignum(0);
+  }
+  if (start + len > n){
+    len = n - start;
+  }
+  return words_to_bignum(w + start, len);
+}
+static void bignum_div_digit(bignum_t* a, word_t b,
+                             bignum_t**qp, word_t* rp);
+static bignum_t* bignum_divexact_3(bignum_t* a){
+  bignum_t* q;
+  bignum_div_digit(a, 3, &q, NULL);
+  q->negative = a->negative;
+  return q;
+}
+
+/*
+ * Evaluation in 0, 1, -1, -2 and infinity, interpolation as in 
+ * M. Bodrato, A. Zanoni: Integer and Polynomial Multiplication: Towards
+ * Optimal Toom-Cook Matrices (2007)
+ */
+static void words_toom3(word_t* r, word_t* a, size_t an, 
+                        word_t* b, size_t bn){
+  size_t k = (an + 2) / 3;
+  size_t rn = an + bn;
+  bignum_t* a0 = words_slice(a, an, 0, k);
+  bignum_t* a1 = words_slice(a, an, k, k);
+  bignum_t* a2 = words_slice(a, an, 2 * k, an);
+  bignum_t* b0;
+  bignum_t* b1;
+  bignum_t* b2;
+  bignum_t* pa1;
+  bignum_t* pam1;
+  bignum_t* pam2;
+  bignum_t* pb1;
+  bignum_t* pbm1;
+  bignum_t* pbm2;
+  bignum_t* t;
+  bignum_t* r0;
+  bignum_t* r1;
+  bignum_t* r2;
+  bignum_t* r3;
+  bignum_t* r4;
+  bignum_t* rm1;
+  bignum_t* rm2;
+
+  t = dfsch_bignum_add(a0, a2);
+  pa1 = dfsch_bignum_add(t, a1);
+  pam1 = dfsch_bignum_sub(t, a1);
+  t = dfsch_bignum_add(pam1, a2);
+  pam2 = dfsch_bignum_sub(dfsch_bignum_add(t, t), a0);
+
+  if (a == b && an == bn){
+    r0 = dfsch_bignum_mul(a0, a0);
+    r1 = dfsch_bignum_mul(pa1, pa1);
+    rm1 = dfsch_bignum_mul(pam1, pam1);
+    rm2 = dfsch_bignum_mul(pam2, pam2);
+    r4 = dfsch_bignum_mul(a2, a2);
+  } else {
+    b0 = words_slice(b, bn, 0, k);
+    b1 = words_slice(b, bn, k, k);
+    b2 = words_slice(b, bn, 2 * k, bn);
+
+    t = dfsch_bignum_add(b0, b2);
+    pb1 = dfsch_bignum_add(t, b1);
+    pbm1 = dfsch_bignum_sub(t, b1);
+    t = dfsch_bignum_add(pbm1, b2);
+    pbm2 = dfsch_bignum_sub(dfsch_bignum_add(t, t), b0);
+
+    r0 = dfsch_bignum_mul(a0, b0);
+    r1 = dfsch_bignum_mul(pa1, pb1);
+    rm1 = dfsch_bignum_mul(pam1, pbm1);
+    rm2 = dfsch_bignum_mul(pam2, pbm2);
+    r4 = dfsch_bignum_mul(a2, b2);
+  }
+
+  r3 = bignum_divexact_3(dfsch_bignum_sub(rm2, r1));
+  r1 = dfsch_bignum_shr(dfsch_bignum_sub(r1, rm1), 1);
+  r2 = dfsch_bignum_sub(rm1, r0);
+  r3 = dfsch_bignum_add(dfsch_bignum_shr(dfsch_bignum_sub(r2, r3), 1), 
+                        dfsch_bignum_add(r4, r4));
+  r2 = dfsch_bignum_sub(dfsch_bignum_add(r2, r1), r4);
+  r1 = dfsch_bignum_sub(r1, r3);
+
+  /* all coefficients of product are non-negative */
+  memset(r, 0, rn * sizeof(word_t));
+  memcpy(r, r0->words, r0->length * sizeof(word_t));
+  memcpy(r + 4 * k, r4->words, r4->length * sizeof(word_t));
+  words_add(r + k, r + k, rn - k, r1->words, r1->length);
+  words_add(r + 2 * k, r + 2 * k, rn - 2 * k, r2->words, r2->length);
+  words_add(r + 3 * k, r + 3 * k, rn - 3 * k, r3->words, r3->length);
+}
+
+/* r[0..an+bn) = a * b, an >= bn > 0 */
+static void words_mul(word_t* r, word_t* a, size_t an, 
+                      word_t* b, size_t bn){
+  size_t i;
+  size_t n;
+  word_t* t;
+
+  if (bn < KARATSUBA_THRESHOLD){
+    if (a == b && an == bn){
+      words_sqr_basecase(r, a, an);
+    } else {
+      words_mul_basecase(r, a, an, b, bn);
+    }
+  } else if (bn <= (an + 1) / 2){
+    /* Unbalanced operands, split longer one into pieces of bn words */
+    t = GC_MALLOC_ATOMIC(2 * bn * sizeof(word_t));
+    memset(r, 0, (an + bn) * sizeof(word_t));
+    for (i = 0; i < an; i += bn){
+      n = an - i < bn ? an - i : bn;
+      words_mul(t, b, bn, a + i, n);
+      words_add(r + i, r + i, an + bn - i, t, n + bn);
+    }
+  } else if (bn < TOOM3_THRESHOLD){
+    words_karatsuba(r, a, an, b, bn);
+  } else {
+    words_toom3(r, a, an, b, bn);
   }
+}
 
+dfsch_bignum_t* dfsch_bignum_mul(bignum_t* a, bignum_t* b){
+  bignum_t* res;
+  bignum_t* tmp;
+
+  if (a->length == 0 || b->length == 0){
+    return make_bignum(0);
+  }
+  if (a->length < b->length){
+    tmp = a;
+    a = b;
+    b = tmp;
+  }
+
+  res = make_bignum(a->length + b->length);
+  words_mul(res->words, a->words, a->length, b->words, b->length);
   res->negative = !(a->negative == b->negative);
 
   normalize_bignum(res);
@@ -556,11 +812,11 @@ static bignum_t* bignum_muladd_digit(bignum_t* a, word_t q, word_t d){
   
   cy = d;
   for (i = 0; i < a->length; i++){
-    cy >>= WORD_BITS;
-    cy = q * a->words[i] + cy;
+    cy += (dword_t)q * a->words[i];
     res->words[i] = cy & WORD_MASK;
+    cy >>= WORD_BITS;
   }
-  res->words[a->length] = cy >> WORD_BITS;
+  res->words[a->length] = cy;
 
   res->negative = a->negative;
 
@@ -580,7 +836,7 @@ static bignum_t* bignum_add_abs_digit(bignum_t* a, word_t d){
   res = make_bignum(a->length+1);
   
   cy = a->words[0] + d;
-  res->words[0] = cy;
+  res->words[0] = cy & WORD_MASK;
   for (i = 1; i < a->length; i++){
     cy >>= WORD_BITS;
     cy = a->words[i] + cy;
@@ -606,7 +862,7 @@ static bignum_t* bignum_sub_abs_digit(bignum_t* a, word_t d){
   res = make_bignum(a->length+1);
   
   cy = a->words[0] - d;
-  res->words[0] = cy;
+  res->words[0] = cy & WORD_MASK;
   for (i = 1; i < a->length; i++){
     cy >>= WORD_BITS;
     cy &= 1;
@@ -625,6 +881,10 @@ static bignum_t* bignum_sub_abs_digit(bignum_t* a, word_t d){
 static bignum_t* bignum_shl_words(bignum_t* b, size_t count){
   bignum_t* res;
 
+  if (b->length == 0){
+    return b;
+  }
+
   res = make_bignum(b->length+count);
   memcpy(res->words + count, b->words, b->length*sizeof(word_t));
 
@@ -691,7 +951,7 @@ static void bignum_div_digit(bignum_t* a, word_t b,
     r = (r << WORD_BITS) + a->words[i - 1];
     d = r / b;
     q->words[i - 1] = d & WORD_MASK;
-    r -= d * b;
+    r -= (dword_t)d * b;
   }
 
   if (qp){
@@ -705,7 +965,7 @@ static void bignum_div_digit(bignum_t* a, word_t b,
 
 static void bignum_div_big(bignum_t* a, bignum_t* b, 
                            bignum_t**qp, bignum_t** rp){
-  word_t l = (1 << WORD_BITS) / (b->words[b->length - 1] + 1);
+  word_t l = WORD_BASE / ((dword_t)b->words[b->length - 1] + 1);
   bignum_t* x = bignum_muladd_digit(a, l, 0);
   bignum_t* y = bignum_muladd_digit(b, l, 0);
   bignum_t* q;
@@ -714,6 +974,7 @@ static void bignum_div_big(bignum_t* a, bignum_t* b,
   dword_t d;
   sword_t cy;
   dword_t m;
+  dword_t rh;
   word_t u;
 
   j = x->length - y->length + 1;
@@ -726,15 +987,17 @@ static void bignum_div_big(bignum_t* a, bignum_t* b,
       d = WORD_MASK;
     
     } else {
-      d = ((xi << WORD_BITS) + x->words[i - 1]) / y->words[y->length - 1];
+      d = ((((dword_t)xi) << WORD_BITS) + x->words[i - 1]) 
+        / y->words[y->length - 1];
     }
 
-    while ((y->words[y->length - 2] * d) > 
-           (((((dword_t)xi) << WORD_BITS) 
-             + x->words[i - 1] 
-             - d * y->words[y->length - 1]) << WORD_BITS)
-           + x->words[i - 2]){ /* 3.2 */
+    rh = (((dword_t)xi) << WORD_BITS) + x->words[i - 1] 
+      - d * y->words[y->length - 1];
+    while (rh < WORD_BASE &&
+           y->words[y->length - 2] * d > 
+           (rh << WORD_BITS) + x->words[i - 2]){ /* 3.2 */
       d--;
+      rh += y->words[y->length - 1];
     }
     
     cy = 0;
@@ -794,6 +1057,130 @@ static void bignum_div_big(bignum_t* a, bignum_t* b,
     bignum_div_digit(x, l, rp, NULL);
   }
 }
+static void bignum_div_basecase(bignum_t* a, bignum_t* b, 
+                                bignum_t**qp, bignum_t** rp){
+  word_t wr;
+
+  if (dfsch_bignum_cmp_abs(a, b) < 0){
+    *qp = make_bignum(0);
+    *rp = a;
+  } else if (b->length == 1){
+    bignum_div_digit(a, b->words[0], qp, &wr);
+    *rp = make_bignum_digit(wr);
+  } else {
+    bignum_div_big(a, b, qp, rp);
+  }
+}
+
+/*
+ * Recursive division of C. Burnikel, J. Ziegler: Fast Recursive Division
+ * (1998), with all quantities counted in words. Divisor b has n words, 
+ * its top word is normalized and a < b B^n. All values are non-negative.
+ */
+static void bignum_div_3n2n(bignum_t* a12, bignum_t* a3, bignum_t* b, 
+                            bignum_t* b1, bignum_t* b2, size_t n,
+                            bignum_t** qp, bignum_t** rp);
+
+static void bignum_div_2n1n(bignum_t* a, bignum_t* b, size_t n,
+                            bignum_t** qp, bignum_t** rp){
+  int pad;
+  size_t h;
+  bignum_t* b1;
+  bignum_t* b2;
+  bignum_t* q1;
+  bignum_t* q2;
+  bignum_t* r;
+
+  if (n < DIV_DC_THRESHOLD || a->length < n + DIV_DC_THRESHOLD){
+    bignum_div_basecase(a, b, qp, rp);
+    return;
+  }
+
+  pad = n & 1;
+  if (pad){
+    a = bignum_shl_words(a, 1);
+    b = bignum_shl_words(b, 1);
+    n++;
+  }
+  h = n / 2;
+  b1 = bignum_shr_words(b, h);
+  b2 = copy_bignum_words(b, h);
+
+  bignum_div_3n2n(bignum_shr_words(a, n), 
+                  copy_bignum_words(bignum_shr_words(a, h), h), 
+                  b, b1, b2, h, &q1, &r);
+  bignum_div_3n2n(r, copy_bignum_words(a, h), b, b1, b2, h, &q2, &r);
+
+  if (pad){
+    r = bignum_shr_words(r, 1);
+  }
+  *qp = dfsch_bignum_add(bignum_shl_words(q1, h), q2);
+  *rp = r;
+}
+
+static void bignum_div_3n2n(bignum_t* a12, bignum_t* a3, bignum_t* b, 
+                            bignum_t* b1, bignum_t* b2, size_t n,
+                            bignum_t** qp, bignum_t** rp){
+  bignum_t* q;
+  bignum_t* r;
+  size_t i;
+
+  if (dfsch_bignum_cmp_abs(bignum_shr_words(a12, n), b1) == 0){
+    q = make_bignum(n);
+    for (i = 0; i < n; i++){
+      q->words[i] = WORD_MASK;
+    }
+    r = dfsch_bignum_add(dfsch_bignum_sub(a12, bignum_shl_words(b1, n)), 
+                         b1);
+  } else {
+    bignum_div_2n1n(a12, b1, n, &q, &r);
+  }
+
+  r = dfsch_bignum_sub(dfsch_bignum_add(bignum_shl_words(r, n), a3),
+                       dfsch_bignum_mul(q, b2));
+  while (r->negative && r->length != 0){
+    q = bignum_sub_abs_digit(q, 1);
+    r = dfsch_bignum_add(r, b);
+  }
+
+  *qp = q;
+  *rp = r;
+}
+
+/* Long division in base B^n where n is length of divisor */
+static void bignum_div_dc(bignum_t* a, bignum_t* b, 
+                          bignum_t**qp, bignum_t** rp){
+  size_t n = b->length;
+  size_t s = WORD_BITS - 1 - dfsch_bignum_msb(b) % WORD_BITS;
+  size_t i;
+  bignum_t* q;
+  bignum_t* qi;
+  bignum_t* r;
+
+  a = dfsch_bignum_shl(a, s);
+  b = dfsch_bignum_shl(b, s);
+
+  i = (a->length + n - 1) / n;
+  q = make_bignum(i * n);
+  r = make_bignum(0);
+
+  for (; i > 0; i--){
+    bignum_div_2n1n(dfsch_bignum_add(bignum_shl_words(r, n),
+                                     words_slice(a->words, a->length, 
+                                                 (i - 1) * n, n)), 
+                    b, n, &qi, &r);
+    memcpy(q->words + (i - 1) * n, qi->words, qi->length * sizeof(word_t));
+  }
+
+  normalize_bignum(q);
+  if (qp){
+    *qp = q;
+  }
+  if (rp){
+    *rp = dfsch_bignum_shr(r, s);
+  }
+}
+
 void dfsch_bignum_div(bignum_t* a, bignum_t* b, 
                       bignum_t**qp, bignum_t** rp){
   word_t wr;
@@ -819,6 +1206,9 @@ void dfsch_bignum_div(bignum_t* a, bignum_t* b,
     if (rp){
       (*rp) = make_bignum_digit(wr);
     }
+  } else if (b->length >= DIV_DC_THRESHOLD && 
+             a->length >= b->length + DIV_DC_THRESHOLD){
+    bignum_div_dc(dfsch_bignum_abs(a), dfsch_bignum_abs(b), qp, rp);
   } else {
     bignum_div_big(a, b, qp, rp);
   }
@@ -884,6 +1274,225 @@ static bignum_t* barret_reduce(bignum_t* x, bignum_t* m, bignum_t* mu){
   return r;
 }
 
+/*
+ * Montgomery multiplication (HAC 14.32, 14.36) for odd moduli. Product is
+ * computed by long multiplication (or squaring) into scratch buffer and
+ * then reduced, final subtraction is done by masking, so running time 
+ * depends only on modulus length. All buffers are allocated once per 
+ * exponentiation.
+ */
+typedef struct montgomery_t {
+  word_t* m;
+  size_t n;
+  word_t mp;  /* -m^-1 mod B */
+  word_t* t;  /* 2n words of product */
+  word_t* s;  /* n words for final subtraction */
+} montgomery_t;
+
+static void montgomery_init(montgomery_t* mo, bignum_t* m){
+  dword_t x = m->words[0];
+  int i;
+
+  /* Newton iteration, each step doubles number of correct bits */
+  for (i = 0; i < 6; i++){
+    x *= 2 - m->words[0] * x;
+  }
+
+  mo->m = m->words;
+  mo->n = m->length;
+  mo->mp = (word_t)(0 - x) & WORD_MASK;
+  mo->t = GC_MALLOC_ATOMIC(3 * mo->n * sizeof(word_t));
+  mo->s = mo->t + 2 * mo->n;
+}
+
+/* r = t B^-n mod m */
+static void montgomery_reduce(montgomery_t* mo, word_t* r){
+  word_t* t = mo->t;
+  size_t n = mo->n;
+  size_t i;
+  size_t j;
+  dword_t cy;
+  word_t c = 0;
+  word_t u;
+  word_t mask;
+
+  for (i = 0; i < n; i++){
+    u = (word_t)(t[i] * mo->mp) & WORD_MASK;
+    cy = 0;
+    for (j = 0; j < n; j++){
+      cy += t[i + j] + (dword_t)u * mo->m[j];
+      t[i + j] = cy & WORD_MASK;
+      cy >>= WORD_BITS;
+    }
+    cy += (dword_t)t[i + n] + c;
+    t[i + n] = cy & WORD_MASK;
+    c = cy >> WORD_BITS;
+  }
+
+  /* subtract m when there is carry out or no borrow */
+  c |= words_sub(mo->s, t + n, n, mo->m, n) ^ 1;
+  mask = (word_t)(0 - c);
+  for (i = 0; i < n; i++){
+    r[i] = (mo->s[i] & mask) | (t[n + i] & ~mask);
+  }
+}
+
+/* r = a b B^-n mod m, r can be same as a or b */
+static void montgomery_mul(montgomery_t* mo, word_t* r, word_t* a, word_t* b){
+  if (a == b){
+    words_sqr_basecase(mo->t, a, mo->n);
+  } else {
+    words_mul_basecase(mo->t, a, mo->n, b, mo->n);
+  }
+  montgomery_reduce(mo, r);
+}
+
+static void montgomery_from_bignum(montgomery_t* mo, word_t* r, 
+                                   bignum_t* a, word_t* rr){
+  memset(r, 0, mo->n * sizeof(word_t));
+  memcpy(r, a->words, a->length * sizeof(word_t));
+  montgomery_mul(mo, r, r, rr);
+}
+
+static bignum_t* montgomery_to_bignum(montgomery_t* mo, word_t* a){
+  word_t* r = GC_MALLOC_ATOMIC(mo->n * sizeof(word_t));
+  memcpy(mo->t, a, mo->n * sizeof(word_t));
+  memset(mo->t + mo->n, 0, mo->n * sizeof(word_t));
+  montgomery_reduce(mo, r);
+  return words_to_bignum(r, mo->n);
+}
+
+static int exp_window_bits(size_t bits){
+  if (bits > 671){
+    return 6;
+  } else if (bits > 239){
+    return 5;
+  } else if (bits > 79){
+    return 4;
+  } else if (bits > 23){
+    return 3;
+  } else {
+    return 1;
+  }
+}
+
+static size_t bignum_get_bits(bignum_t* b, size_t pos, int count){
+  size_t r = 0;
+  while (count > 0){
+    count--;
+    r <<= 1;
+    if (pos + count < bignum_num_bits(b)){
+      r |= bignum_get_bit(b, pos + count);
+    }
+  }
+  return r;
+}
+
+/*
+ * Sliding window (HAC 14.85) over table of odd powers of base or, in 
+ * constant time mode, fixed window with every table entry read for each 
+ * multiplication.
+ */
+static bignum_t* bignum_exp_montgomery(bignum_t* b, bignum_t* e, 
+                                       bignum_t* m, int consttime){
+  montgomery_t mo;
+  size_t n = m->length;
+  size_t bits;
+  int k;
+  size_t entries;
+  size_t i;
+  size_t j;
+  size_t l;
+  size_t d;
+  word_t mask;
+  word_t* rr;
+  word_t* table;
+  word_t* acc;
+  word_t* tmp;
+  bignum_t* g;
+  bignum_t* r2;
+  int first;
+
+  if (consttime){
+    bits = bignum_num_bits(e);
+  } else {
+    bits = e->length ? dfsch_bignum_msb(e) + 1 : 0;
+  }
+  k = exp_window_bits(bits);
+
+  montgomery_init(&mo, m);
+  dfsch_bignum_div(b, m, NULL, &g);
+  dfsch_bignum_div(bignum_shl_words(make_bignum_digit(1), 2 * n), m, 
+                   NULL, &r2);
+
+  entries = consttime ? (1 << k) : (1 << (k - 1));
+  rr = GC_MALLOC_ATOMIC((entries + 3) * n * sizeof(word_t));
+  acc = rr + n;
+  tmp = acc + n;
+  table = tmp + n;
+
+  memset(rr, 0, n * sizeof(word_t));
+  memcpy(rr, r2->words, r2->length * sizeof(word_t));
+
+  montgomery_from_bignum(&mo, acc, make_bignum_digit(1), rr);
+
+  if (consttime){
+    memcpy(table, acc, n * sizeof(word_t));
+    montgomery_from_bignum(&mo, table + n, g, rr);
+    for (i = 2; i < entries; i++){
+      montgomery_mul(&mo, table + i * n, table + (i - 1) * n, table + n);
+    }
+
+    for (i = (bits + k - 1) / k; i > 0; i--){
+      for (j = 0; j < k; j++){
+        montgomery_mul(&mo, acc, acc, acc);
+      }
+      d = bignum_get_bits(e, (i - 1) * k, k);
+      memset(tmp, 0, n * sizeof(word_t));
+      for (l = 0; l < entries; l++){
+        mask = (word_t)(0 - (word_t)(l == d));
+        for (j = 0; j < n; j++){
+          tmp[j] |= table[l * n + j] & mask;
+        }
+      }
+      montgomery_mul(&mo, acc, acc, tmp);
+    }
+  } else {
+    montgomery_from_bignum(&mo, table, g, rr);
+    montgomery_mul(&mo, tmp, table, table);
+    for (i = 1; i < entries; i++){
+      montgomery_mul(&mo, table + i * n, table + (i - 1) * n, tmp);
+    }
+
+    first = 1;
+    i = bits;
+    while (i > 0){
+      if (!bignum_get_bit(e, i - 1)){
+        montgomery_mul(&mo, acc, acc, acc);
+        i--;
+        continue;
+      }
+      l = i > k ? i - k : 0;
+      while (!bignum_get_bit(e, l)){
+        l++;
+      }
+      d = bignum_get_bits(e, l, i - l);
+      if (first){
+        memcpy(acc, table + (d >> 1) * n, n * sizeof(word_t));
+        first = 0;
+      } else {
+        for (j = l; j < i; j++){
+          montgomery_mul(&mo, acc, acc, acc);
+        }
+        montgomery_mul(&mo, acc, acc, table + (d >> 1) * n);
+      }
+      i = l;
+    }
+  }
+
+  return montgomery_to_bignum(&mo, acc);
+}
+
 bignum_t* dfsch_bignum_exp(bignum_t* b, bignum_t* e, bignum_t* m){
   bignum_t* r;
   bignum_t* mu;
@@ -899,6 +1508,10 @@ bignum_t* dfsch_bignum_exp(bignum_t* b, bignum_t* e, bignum_t* m){
     dfsch_error("Negative modulus", NULL);
   }
 
+  if (m && (m->words[0] & 1)){
+    return bignum_exp_montgomery(b, e, m, 0);
+  }
+
   if (m){
     mu = barret_prepare(m);
   }
@@ -922,6 +1535,18 @@ bignum_t* dfsch_bignum_exp(bignum_t* b, bignum_t* e, bignum_t* m){
   return r;
 }
 
+bignum_t* dfsch_bignum_exp_consttime(bignum_t* b, bignum_t* e, bignum_t* m){
+  if (b->negative){
+    dfsch_error("Negative base for modular exponentation", NULL);
+  }
+  if (m->negative || (m->length == 0) || !(m->words[0] & 1)){
+    dfsch_error("Constant time exponentation requires positive odd modulus",
+                NULL);
+  }
+
+  return bignum_exp_montgomery(b, e, m, 1);
+}
+
 static bignum_t* logop(bignum_t* a, bignum_t* b, char op){
   /* Heavily inspired by python's long_bitwise() */
   word_t ma = 0;
@@ -1014,6 +1639,10 @@ dfsch_bignum_t* dfsch_bignum_shr(bignum_t* b, size_t count){
   size_t bs = count % WORD_BITS;
   size_t ws = count / WORD_BITS;
 
+  if (b->length <= ws){
+    return make_bignum(0);
+  }
+
   r = make_bignum(b->length - ws);
   r->negative = b->negative;
   for (i = 0; i < b->length - ws - 1; i++){
@@ -1031,6 +1660,10 @@ dfsch_bignum_t* dfsch_bignum_shl(bignum_t* b, size_t count){
   size_t bs = count % WORD_BITS;
   size_t ws = count / WORD_BITS;
 
+  if (b->length == 0){
+    return b;
+  }
+
   r = make_bignum(b->length + ws + 1);
   r->negative = b->negative;
   for (i = 0; i < ws; i++){
@@ -1043,10 +1676,6 @@ dfsch_bignum_t* dfsch_bignum_shl(bignum_t* b, size_t count){
   }
   r->words[r->length - 1] = (b->words[b->length - 1] >> (WORD_BITS - bs)) & WORD_MASK;
 
-  for (i = 0; i < r->length; i++){
-    printf(";; %x \n", r->words[i]);
-  }
-
   normalize_bignum(r);
   return r;
 }
@@ -1065,12 +1694,77 @@ static int get_digits(int base){
   return digs;
 }
 
+typedef struct to_string_ctx_t {
+  unsigned base;
+  word_t chunk;      /* largest power of base that fits in word */
+  int chunk_digits;
+  bignum_t** powers; /* powers[i] = chunk^(2^i) */
+} to_string_ctx_t;
+
+/* 
+ * Writes digits of b backwards ending before end, padded with zeros to 
+ * width digits (or without leading zeros when width is 0). 
+ */
+static char* to_string_basecase(to_string_ctx_t* ctx, char* end, 
+                                bignum_t* b, size_t width){
+  char* p = end;
+  word_t d;
+  int i;
+
+  while (b->length > 0){
+    bignum_div_digit(b, ctx->chunk, &b, &d);
+    for (i = 0; i < ctx->chunk_digits; i++){
+      *(--p) = digits[d % ctx->base];
+      d /= ctx->base;
+    }
+  }
+
+  if (width){
+    while (p > end - width){
+      *(--p) = '0';
+    }
+  } else {
+    while (p < end - 1 && *p == '0'){
+      p++;
+    }
+  }
+  return p;
+}
+
+/*
+ * Divide-and-conquer conversion, b < powers[level + 1] is split into
+ * halves by powers[level] which are converted recursively. Lower half
+ * always has exactly chunk_digits * 2^level digits.
+ */
+static char* to_string_rec(to_string_ctx_t* ctx, char* end, bignum_t* b, 
+                           int level, size_t width){
+  bignum_t* q;
+  bignum_t* r;
+  size_t rw;
+
+  if (level < 0 || b->length < TO_STRING_DC_THRESHOLD){
+    return to_string_basecase(ctx, end, b, width);
+  }
+
+  if (dfsch_bignum_cmp_abs(b, ctx->powers[level]) < 0){
+    return to_string_rec(ctx, end, b, level - 1, width);
+  }
+
+  dfsch_bignum_div(b, ctx->powers[level], &q, &r);
+  rw = (size_t)ctx->chunk_digits << level;
+  end = to_string_rec(ctx, end, r, level - 1, rw);
+  return to_string_rec(ctx, end, q, level - 1, width ? width - rw : 0);
+}
+
 char* dfsch_bignum_to_string(bignum_t* b, unsigned base){
+  to_string_ctx_t ctx;
   char* buf;
-  bignum_t* r;
-  word_t d;
+  char* end;
+  size_t len;
+  dword_t c;
+  int levels;
 
-  if (base == 0 || base > 36){
+  if (base < 2 || base > 36){
     dfsch_error("Invalid base", NULL);
   }
 
@@ -1078,53 +1772,94 @@ char* dfsch_bignum_to_string(bignum_t* b, unsigned base){
     return "0";
   }
 
-  buf = GC_MALLOC_ATOMIC(b->length * get_digits(base) + 2);  
-  buf += b->length * get_digits(base) + 1;
-  *(buf--) = 0;
-  r = b;
- 
-  while (r->length > 0){
-    bignum_div_digit(r, base, &r, &d);
-    *(buf--) = digits[d];
+  ctx.base = base;
+  ctx.chunk_digits = 0;
+  c = 1;
+  while (c * base <= WORD_MASK){
+    c *= base;
+    ctx.chunk_digits++;
+  }
+  ctx.chunk = c;
+
+  ctx.powers = NULL;
+  levels = 0;
+  if (b->length >= TO_STRING_DC_THRESHOLD){
+    ctx.powers = GC_MALLOC(sizeof(bignum_t*) * 
+                           (bignum_num_bits(b) / WORD_BITS + 2));
+    ctx.powers[0] = make_bignum_digit(ctx.chunk);
+    while (ctx.powers[levels]->length * 2 <= b->length + 1){
+      ctx.powers[levels + 1] = dfsch_bignum_mul(ctx.powers[levels],
+                                                ctx.powers[levels]);
+      levels++;
+    }
   }
-  
+
+  len = b->length * get_digits(base) + ctx.chunk_digits + 2;
+  buf = GC_MALLOC_ATOMIC(len);
+  end = buf + len - 1;
+  *end = 0;
+
+  buf = to_string_rec(&ctx, end, b, levels, 0);
+
   if (b->negative){
-    *buf = '-';
-    return buf;
-  } else {
-    return buf+1;
+    *(--buf) = '-';
   }
+  return buf;
 }
 
+/* Bytes are big-endian, words are collected through bit accumulator */
 dfsch_strbuf_t* dfsch_bignum_to_bytes(dfsch_bignum_t* b){
   char* buf;
+  char* p;
   size_t len;
   size_t i;
+  dword_t acc = 0;
+  int bits = 0;
+
   len = bignum_num_bits(b) / 8 + 1;
   buf = GC_MALLOC_ATOMIC(len);
+  p = buf + len;
 
-  memset(buf, 0, len);
-  
-  for (i = 0; i < bignum_num_bits(b); i+=8){
-    buf[len - 1 - (i >> 3)] = bignum_get_word(b, i);
+  for (i = 0; i < b->length; i++){
+    acc |= ((dword_t)b->words[i]) << bits;
+    bits += WORD_BITS;
+    while (bits >= 8){
+      *(--p) = acc & 0xff;
+      acc >>= 8;
+      bits -= 8;
+    }
+  }
+  if (bits){
+    *(--p) = acc & 0xff;
   }
 
-  while (len > 0 && *buf == 0){
-    buf++;
+  len -= p - buf;
+  while (len > 0 && *p == 0){
+    p++;
     len--;
   }
 
-  return dfsch_strbuf_create(buf, len);
+  return dfsch_strbuf_create(p, len);
 }
 dfsch_bignum_t* dfsch_bignum_from_bytes(uint8_t* buf, size_t len, int negative){
-  bignum_t* b = make_bignum(len * (WORD_BITS / 8 + 1));
+  bignum_t* b = make_bignum((len * 8) / WORD_BITS + 1);
   size_t i;
+  size_t j = 0;
+  dword_t acc = 0;
+  int bits = 0;
   
   b->negative = negative;
 
-  for (i = 0; i < len; i++){
-    bignum_set_word(b, i << 3, buf[len - i - 1], 0xff);
+  for (i = len; i > 0; i--){
+    acc |= ((dword_t)buf[i - 1]) << bits;
+    bits += 8;
+    if (bits >= WORD_BITS){
+      b->words[j++] = acc & WORD_MASK;
+      acc >>= WORD_BITS;
+      bits -= WORD_BITS;
+    }
   }
+  b->words[j] = acc;
   
   normalize_bignum(b);
 
@@ -1168,11 +1903,20 @@ DFSCH_DEFINE_PRIMITIVE(integer_expt, 0){
   bignum_t* b;
   bignum_t* e;
   bignum_t* m;
+  dfsch_object_t* consttime;
   DFSCH_BIGNUM_ARG(args, b);
   DFSCH_BIGNUM_ARG(args, e);
   DFSCH_BIGNUM_ARG_OPT(args, m, NULL);
+  DFSCH_OBJECT_ARG_OPT(args, consttime, NULL);
   DFSCH_ARG_END(args);
 
+  if (consttime){
+    if (!m){
+      dfsch_error("Constant time exponentation requires modulus", NULL);
+    }
+    return dfsch_bignum_to_number(dfsch_bignum_exp_consttime(b, e, m));
+  }
+
   return dfsch_bignum_to_number(dfsch_bignum_exp(b, e, m));
 }
 
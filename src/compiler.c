@@ -169,8 +169,10 @@ static dfsch_object_t* compile_funcall(dfsch_object_t* expression,
                                        dfsch_object_t* operator,
                                        dfsch_object_t* args,
                                        dfsch_object_t* env){
+  dfsch_object_t* res;
+
   if (pure_function_p(operator) && all_constants_p(args)){
-    dfsch_object_t* res = DFSCH_INVALID_OBJECT;
+    res = DFSCH_INVALID_OBJECT;
 
     DFSCH_IGNORE_ERRORS {
       res = dfsch_apply(operator, dfsch_eval_list(args, env));
@@ -181,10 +183,16 @@ static dfsch_object_t* compile_funcall(dfsch_object_t* expression,
     }
   }
 
+  args = dfsch_compile_expression_list(args, env);
+
+  res = dfsch__compile_arithmetic(operator, args, expression);
+  if (res){
+    return res;
+  }
+
   return dfsch_cons_ast_node_cdr(dfsch_make_constant_ast_node(operator), 
                                  expression, 
-                                 dfsch_compile_expression_list(args,
-                                                               env),
+                                 args,
                                  0);
 }
 
@@ -473,6 +473,7 @@ static pthread_once_t thread_once = PTHREAD_ONCE_INIT;
 
 static void thread_info_destroy(void* ptr){
   if (ptr){
+    dfsch__random_thread_exit(ptr);
     GC_FREE(ptr);
   }
 }
@@ -494,6 +495,7 @@ dfsch__thread_info_t* dfsch__get_thread_info(){
     ei->env_freelist = GC_malloc_many(sizeof(environment_t));
 #endif
     ei->current_package = DFSCH_DFSCH_USER_PACKAGE;
+    ei->random = NULL;
     pthread_setspecific(thread_key, ei);
   }
   return ei;
@@ -586,14 +588,14 @@ char* dfsch_object_2_string(dfsch_object_t* obj,
     dfsch_writer_state_t* state = 
       dfsch_make_writer_state(max_depth,
                               mode,
-                              (dfsch_output_proc_t)sl_append,
+                              (dfsch_output_proc_t)sl_nappend,
                               sl);
     dfsch_write_object(state, obj);
     dfsch_invalidate_writer_state(state);
   } else {
     dfsch_write_object_circular(obj, 
                                 mode,
-                                (dfsch_output_proc_t)sl_append,
+                                (dfsch_output_proc_t)sl_nappend,
                                 sl);
   }
   return sl_value(sl);
@@ -647,6 +649,33 @@ dfsch_object_t* dfsch_string_2_object(char* str){
 
 static dfsch_rwlock_t environment_rwlock = DFSCH_RWLOCK_INITIALIZER;
 
+/*
+ * Frames owned by current thread are read and modified directly. Frames
+ * shared between threads are read without taking environment_rwlock.
+ * Every modification of shared frame (including clearing of its owner)
+ * goes through environment_write_lock(), which makes environment_version
+ * odd for duration of modification, readers retry when version changed
+ * while they were looking up the variable and never write into frames.
+ * Memory of replaced hash vectors and entries is reclaimed by GC only
+ * after no reader can reference it.
+ */
+static volatile size_t environment_version = 0;
+
+static void canonical_version_bump(environment_t* e){
+  __sync_fetch_and_add(&e->canonical_version, 1);
+}
+
+static void environment_write_lock(){
+  DFSCH_RWLOCK_WRLOCK(&environment_rwlock);
+  environment_version++;
+  DFSCH_MEMORY_BARRIER();
+}
+static void environment_write_unlock(){
+  DFSCH_MEMORY_BARRIER();
+  environment_version++;
+  DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
+}
+
 static environment_t* alloc_environment(dfsch__thread_info_t* ti){
   environment_t* e;
 
@@ -747,6 +776,79 @@ dfsch_object_t* dfsch_new_frame(dfsch_object_t* parent){
   return dfsch_new_frame_with_context(parent, NULL);
 }
 
+#define SHARED_LOOKUP_RETRIES 4
+
+/* 
+ * Frames owned by some thread are modified by it without any
+ * synchronization, so they have to be taken away from their owner
+ * before another thread can look into them.
+ */
+static void share_frames(environment_t* env){
+  environment_t *i;
+
+  for (i = env; i; i = i->parent){
+    if (i->owner){
+      break;
+    }
+  }
+  if (!i){
+    return;
+  }
+
+  environment_write_lock();
+  for (; i; i = i->parent){
+    i->owner = NULL;
+  }
+  environment_write_unlock();
+}
+
+static object_t* lookup_shared(object_t* name, environment_t* env){
+  environment_t *i;
+  object_t* ret;
+  size_t version;
+  int retries;
+
+  share_frames(env);
+
+  for (retries = 0; retries < SHARED_LOOKUP_RETRIES; retries++){
+    version = environment_version;
+    DFSCH_MEMORY_BARRIER();
+    if (version & 1){
+      continue;
+    }
+
+    ret = DFSCH_INVALID_OBJECT;
+    i = env;
+    while (i){
+      ret = dfsch_eqhash_ref_shared(&i->values, name);
+      if (ret != DFSCH_INVALID_OBJECT){
+        break;
+      }
+      i = i->parent;
+    }
+
+    DFSCH_MEMORY_BARRIER();
+    if (version == environment_version){
+      return ret;
+    }
+  }
+
+  /* Writers are too busy, wait for them */
+  DFSCH_RWLOCK_RDLOCK(&environment_rwlock);
+  i = env;
+  while (i){
+    ret = dfsch_eqhash_ref(&i->values, name);
+    if (ret != DFSCH_INVALID_OBJECT){
+      DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
+      return ret;
+    }
+    
+    i = i->parent;
+  }
+  DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
+  return DFSCH_INVALID_OBJECT;
+}
+
 static object_t* lookup_impl(object_t* name, 
                              environment_t* env,
                              dfsch__thread_info_t* ti) DFSCH_FUNC_HOT{
@@ -756,7 +858,6 @@ static object_t* lookup_impl(object_t* name,
   i = env;
   while (i){
     if (DFSCH_UNLIKELY(i->owner != ti)){
-      i->owner = NULL;
       goto lock;
     }
     ret = dfsch_eqhash_ref(&i->values, name);
@@ -769,24 +870,19 @@ static object_t* lookup_impl(object_t* name,
 
   goto unbound;
  lock:
-   DFSCH_RWLOCK_RDLOCK(&environment_rwlock);
-  while (i){
-    ret = dfsch_eqhash_ref(&i->values, name);
-    if (ret != DFSCH_INVALID_OBJECT){
-      DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
-      return ret;
-    }
-    
-    i->owner = NULL;
-    i = i->parent;
+  ret = lookup_shared(name, i);
+  if (ret != DFSCH_INVALID_OBJECT){
+    return ret;
   }
-  DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
 
  unbound:
   if (DFSCH_SYMBOL_P(name) && 
       ((dfsch__symbol_t*)DFSCH_TAG_REF(name))->package == DFSCH_KEYWORD_PACKAGE){
     return name; /* keywords are self-evaluating when not redefined */
   }
+  if (dfsch__autoload(name, (dfsch_object_t*)env)){
+    return lookup_impl(name, env, ti);
+  }
   dfsch_error("Unbound variable", dfsch_cons(name, (dfsch_object_t*)env));
 }
 
@@ -819,6 +915,80 @@ object_t* dfsch_env_get(object_t* name, object_t* env){
   return DFSCH_INVALID_OBJECT;
 }
 
+/*
+ * Reverse index of canonical bindings (value -> name) used by serializer
+ * instead of scanning whole environment for each object. Index is never
+ * modified after it is built, it is replaced when sum of
+ * canonical_version counters of frames in its chain changes. Counter of
+ * frame is incremented on every modification of variable with
+ * DFSCH_VAR_CANONICAL flag in that frame, so defines in unrelated
+ * environments (isolates, other top-level environments) do not
+ * invalidate the index. Indexed frames are reified, thus they are never
+ * recycled by free_environment() and their counters only grow.
+ * Precedence of bindings is same as in dfsch_env_revscan(). Indexes are
+ * kept per environment in weak table.
+ */
+
+typedef struct canonical_index_t {
+  size_t version;
+  dfsch_eqhash_t map;
+} canonical_index_t;
+
+static dfsch_object_t* canonical_indexes = NULL;
+static pthread_once_t canonical_indexes_once = PTHREAD_ONCE_INIT;
+
+static void canonical_indexes_alloc(){
+  canonical_indexes = dfsch_make_weak_key_hash();
+}
+
+static size_t canonical_chain_version(environment_t* e){
+  size_t version = 0;
+  while (e){
+    version += e->canonical_version;
+    e = e->parent;
+  }
+  return version;
+}
+
+static void index_canonical_frame(canonical_index_t* ci, environment_t* e){
+  dfsch_eqhash_entry_t* i;
+  if (e->parent){
+    index_canonical_frame(ci, e->parent);
+  }
+  /* entry list is in reverse order of dfsch_eqhash_revscan() */
+  for (i = dfsch_eqhash_2_entry_list(&e->values); i; i = i->next){
+    if (i->flags & DFSCH_VAR_CANONICAL){
+      dfsch_eqhash_set(&ci->map, i->value, i->key);
+    }
+  }
+}
+
+dfsch_object_t* dfsch_env_canonical_name(dfsch_object_t* env, 
+                                         dfsch_object_t* value){
+  canonical_index_t* ci;
+  environment_t* e = DFSCH_ASSERT_TYPE(env, DFSCH_ENVIRONMENT_TYPE);
+
+  pthread_once(&canonical_indexes_once, canonical_indexes_alloc);
+  ci = (canonical_index_t*)dfsch_mapping_ref(canonical_indexes, 
+                                             (dfsch_object_t*)e);
+
+  if (ci == (canonical_index_t*)DFSCH_INVALID_OBJECT || 
+      ci->version != canonical_chain_version(e)){
+    dfsch_reify_environment((dfsch_object_t*)e);
+    ci = GC_NEW(canonical_index_t);
+    DFSCH_RWLOCK_RDLOCK(&environment_rwlock);
+    ci->version = canonical_chain_version(e);
+    DFSCH_MEMORY_BARRIER();
+    dfsch_eqhash_init(&ci->map, 1);
+    index_canonical_frame(ci, e);
+    DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
+    dfsch_mapping_set(canonical_indexes, (dfsch_object_t*)e, 
+                      (dfsch_object_t*)ci);
+  }
+
+  return dfsch_eqhash_ref_shared(&ci->map, value);
+}
+
 dfsch_object_t* dfsch_env_revscan(dfsch_object_t* env, 
                                   dfsch_object_t* value, 
                                   int canonical){
@@ -918,33 +1088,41 @@ dfsch_object_t* dfsch_env_get_declaration_value(dfsch_object_t* name,
 object_t* dfsch_set(object_t* name, object_t* value, object_t* env){
   environment_t *i;
   dfsch__thread_info_t *ti = dfsch__get_thread_info();
+  unsigned short flags;
 
   i = DFSCH_ASSERT_TYPE(env, DFSCH_ENVIRONMENT_TYPE);
 
   while (i){
     if (i->owner != ti){
-      i->owner = NULL;
       goto lock;
     }
-    if(dfsch_eqhash_set_if_exists(&i->values, name, value, NULL))
+    if(dfsch_eqhash_set_if_exists(&i->values, name, value, &flags)){
+      if (flags & DFSCH_VAR_CANONICAL){
+        canonical_version_bump(i);
+      }
       return value;
-
+    }
     i = i->parent;
   }
 
   dfsch_error("Unbound variable",name);
  lock:
-  
-  DFSCH_RWLOCK_WRLOCK(&environment_rwlock);
+
+  environment_write_lock();
   while (i){
-    if(dfsch_eqhash_set_if_exists(&i->values, name, value, NULL)){
-      DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
+    if (i->owner != ti){
+      i->owner = NULL;
+    }
+    if(dfsch_eqhash_set_if_exists(&i->values, name, value, &flags)){
+      if (flags & DFSCH_VAR_CANONICAL){
+        canonical_version_bump(i);
+      }
+      environment_write_unlock();
       return value;
     }
-    i->owner = NULL;
     i = i->parent;
   }
-  DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
+  environment_write_unlock();
   dfsch_error("Unbound variable",name);
 
 }
@@ -952,39 +1130,55 @@ void dfsch_unset(object_t* name, object_t* env){
   environment_t *i;
 
   i = DFSCH_ASSERT_TYPE(env, DFSCH_ENVIRONMENT_TYPE);
-  DFSCH_RWLOCK_WRLOCK(&environment_rwlock);
+  environment_write_lock();
   while (i){
     if (i->decls){
       dfsch_idhash_unset(i->decls, name);
     }
     if(dfsch_eqhash_unset(&i->values, name)){
-      DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
+      canonical_version_bump(i);
+      environment_write_unlock();
       return;
     }
     i = i->parent;
   }
-  DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
+  environment_write_unlock();
   
   dfsch_error("Unbound variable",name);
 }
 
 
+static void define_in_frame(environment_t* e,
+                            object_t* name, object_t* value,
+                            unsigned short flags){
+  unsigned short old_flags = 0;
+
+  if (!dfsch_eqhash_set_if_exists(&e->values, name, value, &old_flags)){
+    dfsch_eqhash_put(&e->values, name, value);
+  }
+  if (flags){
+    dfsch_eqhash_set_flags(&e->values, name, flags);  
+  }
+  if ((flags | old_flags) & DFSCH_VAR_CANONICAL){
+    canonical_version_bump(e);
+  }
+}
+
 void dfsch_define(object_t* name, object_t* value, object_t* env,
                   unsigned short flags){
   environment_t* e = (environment_t*)DFSCH_ASSERT_TYPE(env, 
                                                        DFSCH_ENVIRONMENT_TYPE);
   dfsch__thread_info_t *ti = dfsch__get_thread_info();
-  if (e->owner != ti){
-    e->owner = NULL;
-    DFSCH_RWLOCK_WRLOCK(&environment_rwlock);
-  }
-  dfsch_eqhash_set(&e->values, name, value);  
-  if (flags){
-    dfsch_eqhash_set_flags(&e->values, name, flags);  
-  }
-  if (e->owner != ti){
-    DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
+
+  if (e->owner == ti){
+    define_in_frame(e, name, value, flags);
+    return;
   }
+
+  environment_write_lock();
+  e->owner = NULL;
+  define_in_frame(e, name, value, flags);
+  environment_write_unlock();
 }
 
 
@@ -998,11 +1192,11 @@ void dfsch_declare(dfsch_object_t* variable,
   dfsch__thread_info_t *ti = dfsch__get_thread_info();
   dfsch_object_t* ret;
 
-  DFSCH_RWLOCK_WRLOCK(&environment_rwlock);
+  environment_write_lock();
 
   for(;;){
     if (!e){
-      DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
+      environment_write_unlock();
       dfsch_error("Unbound variable", dfsch_cons(variable, env));
     }
     ret = dfsch_eqhash_ref(&e->values, variable);
@@ -1024,7 +1218,7 @@ void dfsch_declare(dfsch_object_t* variable,
   dfsch_idhash_set(e->decls, variable, 
                    dfsch_cons(dfsch_list(2, name, value), old));  
 
-  DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
+  environment_write_unlock();
 }
 
 dfsch_object_t* dfsch_get_environment_variables(dfsch_object_t* env){
@@ -1035,6 +1229,14 @@ dfsch_object_t* dfsch_get_environment_variables(dfsch_object_t* env){
   DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
   return res;
 }
+dfsch_eqhash_entry_t* dfsch__get_environment_entries(dfsch_object_t* env){
+  environment_t* e = DFSCH_ASSERT_TYPE(env, DFSCH_ENVIRONMENT_TYPE);
+  dfsch_eqhash_entry_t* res;
+  DFSCH_RWLOCK_RDLOCK(&environment_rwlock);
+  res = dfsch_eqhash_2_entry_list(&e->values);
+  DFSCH_RWLOCK_UNLOCK(&environment_rwlock);
+  return res;
+}
 dfsch_object_t* dfsch_get_parent_frame(dfsch_object_t* env){
   environment_t* e = DFSCH_ASSERT_TYPE(env, DFSCH_ENVIRONMENT_TYPE);
   return e->parent;
@@ -2195,6 +2397,7 @@ void dfsch_core_language_register(dfsch_object_t* ctx){
   dfsch__forms_register(ctx);
   dfsch__hash_native_register(ctx);
   dfsch__number_native_register(ctx);
+  dfsch__numvector_native_register(ctx);
   dfsch__string_native_register(ctx);
   dfsch__object_native_register(ctx);
   dfsch__format_native_register(ctx);
@@ -92,7 +92,10 @@ static void eqhash_large_put_low(dfsch_eqhash_entry_t* vector,
   uint32_t h = fast_ptr_hash(key);
 
   if (vector[h & mask].key != DFSCH_INVALID_OBJECT){
-    vector[h & mask].next = alloc_entry(key, value, flags, vector[h & mask].next);
+    dfsch_eqhash_entry_t* e = alloc_entry(key, value, flags, 
+                                          vector[h & mask].next);
+    DFSCH_MEMORY_BARRIER();
+    vector[h & mask].next = e;
   } else {
     vector[h & mask].key = key;
     vector[h & mask].value = value;
@@ -122,6 +125,7 @@ static void convert_to_large(dfsch_eqhash_t* hash){
   hash->contents.large.vector = vector;
   hash->contents.large.count = DFSCH_EQHASH_SMALL_SIZE;
   hash->contents.large.mask = INITIAL_MASK;  
+  DFSCH_MEMORY_BARRIER();
   hash->is_large = 1;
 }
 
@@ -140,7 +144,11 @@ static void grow_hash(dfsch_eqhash_t* hash){
     }
   }
 
+  /* Vector is replaced before mask is enlarged, so concurrent
+     dfsch_eqhash_ref_shared() never indexes past end of vector */
+  DFSCH_MEMORY_BARRIER();
   hash->contents.large.vector = vector;
+  DFSCH_MEMORY_BARRIER();
   hash->contents.large.mask = new_mask;
 }
 
@@ -226,8 +234,8 @@ static int delete_entry(dfsch_eqhash_t* hash,
   i = BUCKET(hash, h);
   while (i){
     if (i->key == key){
-      if (hash->contents.large.cache[(h >> 10) % DFSCH_EQHASH_CACHE_SIZE] == i){
-        hash->contents.large.cache[(h >> 10) % DFSCH_EQHASH_CACHE_SIZE] = NULL;
+      if (hash->contents.large.cache[(h >> 16) % DFSCH_EQHASH_CACHE_SIZE] == i){
+        hash->contents.large.cache[(h >> 16) % DFSCH_EQHASH_CACHE_SIZE] = NULL;
       }
       if (j) {
         j->next = i->next;
@@ -298,6 +306,9 @@ int dfsch_eqhash_set_if_exists(dfsch_eqhash_t* hash,
     dfsch_eqhash_entry_t* e = find_entry(hash, key);
     if (e) {
       e->value = value;
+      if (flags){
+        *flags = e->flags;
+      }
       return 1;
     }
   } else {
@@ -305,6 +316,9 @@ int dfsch_eqhash_set_if_exists(dfsch_eqhash_t* hash,
     for (i = 0; i < DFSCH_EQHASH_SMALL_SIZE; i++){
       if (hash->contents.small.keys[i] == key){
         hash->contents.small.values[i] = value;
+        if (flags){
+          *flags = hash->contents.small.flags[i];
+        }
         return 1;
       }
     }
@@ -343,6 +357,38 @@ dfsch_object_t* dfsch_eqhash_ref(dfsch_eqhash_t* hash,
   }  
   return DFSCH_INVALID_OBJECT;  
 }
+/*
+ * Variant of dfsch_eqhash_ref() that does not write anything into hash
+ * (ie. does not update lookup cache) and tolerates concurrent writer. 
+ * Result may be inconsistent when writer was active, caller has to
+ * detect that by other means.
+ */
+dfsch_object_t* dfsch_eqhash_ref_shared(dfsch_eqhash_t* hash,
+                                        dfsch_object_t* key){
+  if (hash->is_large){
+    dfsch_eqhash_entry_t* i;
+    size_t mask;
+
+    DFSCH_MEMORY_BARRIER();
+    mask = hash->contents.large.mask;
+    DFSCH_MEMORY_BARRIER();
+    i = &(hash->contents.large.vector[fast_ptr_hash(key) & mask]);
+    while (i){
+      if (i->key == key){
+        return i->value;
+      }
+      i = i->next;
+    }
+  } else {
+    int i;
+    for (i = 0; i < DFSCH_EQHASH_SMALL_SIZE; i++){
+      if (hash->contents.small.keys[i] == key){
+        return hash->contents.small.values[i];
+      }
+    }
+  }  
+  return DFSCH_INVALID_OBJECT;  
+}
 int dfsch_eqhash_ref_ex(dfsch_eqhash_t* hash,
                         dfsch_object_t* key, 
                         dfsch_object_t** value, unsigned short *flags,
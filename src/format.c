@@ -22,11 +22,15 @@
 #include "dfsch/format.h"
 
 #include <dfsch/strings.h>
+#include <dfsch/ports.h>
+#include <dfsch/writer.h>
+#include <dfsch/number.h>
 
 #include "util.h"
 #include "internal.h"
 
 #include <string.h>
+#include <ctype.h>
 
 #define FLAG_COLON 1
 #define FLAG_AT    2
@@ -71,38 +75,6 @@ static int read_num_arg(char**string){
 
 #define ARG_MAX 16
 
-static char* format_a(int flags, int argc, int*argv, dfsch_object_t* obj){
-  if (argc == 0){
-    return dfsch_object_2_string(obj, -1, DFSCH_PRINT);
-  } else {
-    return dfsch_object_2_string(obj, argv[0], DFSCH_PRINT);
-  }
-}
-static char* format_s(int flags, int argc, int*argv, dfsch_object_t* obj){
-  if (argc == 0){
-    return dfsch_object_2_string(obj, -1, DFSCH_WRITE);
-  } else {
-    return dfsch_object_2_string(obj, argv[0], DFSCH_WRITE);
-  } 
-}
-static char* format_w(int flags, int argc, int*argv, dfsch_object_t* obj){
-  return dfsch_object_2_string(obj, -1, DFSCH_WRITE);
-}
-static char* format_y(int flags, int argc, int*argv, dfsch_object_t* obj){
-  if (argc == 0){
-    return dfsch_object_2_string(obj, -1, DFSCH_WRITE);
-  } else {
-    return dfsch_object_2_string(obj, argv[0], DFSCH_WRITE);
-  }
-}
-static char* format_r(int flags, int argc, int*argv, dfsch_object_t* obj){
-  if (argc == 0){
-    return dfsch_number_to_string(obj, 10);
-  } else {
-    return dfsch_number_to_string(obj, argv[0]);
-  } 
-}
-
 typedef struct format_list_t {
   size_t cur_pos;
   dfsch_object_t* head;
@@ -170,38 +142,78 @@ static void list_backskip(format_list_t* l, size_t count){
   list_seek(l, l->cur_pos - count);
 }
 
-typedef struct format_stack_t format_stack_t;
+/*
+ * Control strings are compiled into array of directives that is then
+ * interpreted by format_run(), output is passed to output procedure 
+ * without any intermediate strings for common directives. 
+ */
 
-struct format_stack_t {
-  format_list_t* args;
-  char* start;
-  char type;
-  format_stack_t* next;
+typedef struct format_directive_t {
+  char op; /* lowercase directive character or '\0' for literal text */
+  char flags;
+  short argc;
+  int argv[ARG_MAX];
+  char* text;
+  size_t len;
+} format_directive_t;
+
+typedef struct compiled_format_t {
+  dfsch_type_t* type;
+  char* source;
+  size_t count;
+  format_directive_t* code;
+} compiled_format_t;
+
+static void compiled_format_write(compiled_format_t* cf, 
+                                  dfsch_writer_state_t* state){
+  dfsch_write_unreadable(state, (dfsch_object_t*)cf, "%s",
+                         dfsch_straquote(cf->source));
+}
+
+dfsch_type_t dfsch_compiled_format_type = {
+  .type = DFSCH_STANDARD_TYPE,
+  .name = "compiled-format",
+  .size = sizeof(compiled_format_t),
+  .write = (dfsch_type_write_t)compiled_format_write,
+  .documentation = "Format control string parsed into directives",
 };
 
-static format_stack_t* format_push(format_stack_t* prev, 
-                                   char* start, char type,
-                                   format_list_t* args){
-  format_stack_t* state = GC_NEW(format_stack_t);
+static format_directive_t* emit_directive(compiled_format_t* cf, 
+                                          size_t* alloc){
+  format_directive_t* d;
 
-  state->next = prev;
-  state->start = start;
-  state->type = type;
-  state->args = args;
+  if (cf->count == *alloc){
+    format_directive_t* code;
+    *alloc *= 2;
+    code = GC_MALLOC(sizeof(format_directive_t) * *alloc);
+    memcpy(code, cf->code, sizeof(format_directive_t) * cf->count);
+    cf->code = code;
+  }
 
-  return state;
+  d = cf->code + cf->count;
+  cf->count++;
+  return d;
+}
+static void emit_text(compiled_format_t* cf, size_t* alloc,
+                      char* text, size_t len){
+  format_directive_t* d = emit_directive(cf, alloc);
+  d->op = '\0';
+  d->text = text;
+  d->len = len;
 }
 
-char* dfsch_format(char* string, 
-                   dfsch_object_t* args){
+dfsch_object_t* dfsch_compile_format(char* string){
+  compiled_format_t* cf = 
+    (compiled_format_t*)dfsch_make_object(DFSCH_COMPILED_FORMAT_TYPE);
+  size_t alloc = 8;
+  format_directive_t* d;
   int argc;
-  int argv[ARG_MAX];
-  int neg;
-  size_t l;
-  str_list_t* out = sl_create(); 
   int flags;
-  format_stack_t* state = format_push(NULL, 
-                                      string, '\0', make_format_list(args));
+  size_t l;
+
+  cf->source = dfsch_stracpy(string);
+  cf->count = 0;
+  cf->code = GC_MALLOC(sizeof(format_directive_t) * alloc);
 
   while (*string){
     if (*string == '~'){
@@ -213,6 +225,8 @@ char* dfsch_format(char* string,
         dfsch_error("Incomplete format directive", NULL);
       }
 
+      d = emit_directive(cf, &alloc);
+
       if (strchr("0123456789'\",", *string)){
         argc = 1;
         while(1) {
@@ -229,14 +243,14 @@ char* dfsch_format(char* string,
           case '9':
           case '-':
           case '+':
-            argv[argc-1] = read_num_arg(&string);
+            d->argv[argc-1] = read_num_arg(&string);
             break;
           case ',':
-            argv[argc-1] = -1;
+            d->argv[argc-1] = -1;
             string++;
             break;
           default:
-            argv[argc-1] = 0;          
+            d->argv[argc-1] = 0;          
             string++;
             break;
           }
@@ -273,103 +287,44 @@ char* dfsch_format(char* string,
       
       /* End of arguments and flags */
 
+      d->flags = flags;
+      d->argc = argc;
+
       switch(*string){
       case '\0':
         dfsch_error("Incomplete format directive", NULL);
-      case 'a':
-      case 'A':
-        sl_append(out, format_a(flags, argc, argv, list_get(state->args)));
-        break;
-      case 's':
-      case 'S':
-        sl_append(out, format_s(flags, argc, argv, list_get(state->args)));
-        break;
-      case 'w':
-      case 'W':
-        sl_append(out, format_w(flags, argc, argv, list_get(state->args)));
-        break;
-      case 'y':
-      case 'Y':
-        sl_append(out, format_y(flags, argc, argv, list_get(state->args)));
-        break;
-      case 'r':
-      case 'R':
-        sl_append(out, format_r(flags, argc, argv, list_get(state->args)));
-        break;
-      case 'd':
-      case 'D':
-        sl_append(out, dfsch_number_to_string(list_get(state->args), 10));
-        break;
-      case 'x':
-      case 'X':
-        sl_append(out, dfsch_number_to_string(list_get(state->args), 16));
-        break;
-      case 'o':
-      case 'O':
-        sl_append(out, dfsch_number_to_string(list_get(state->args), 8));
-        break;
-      case 'b':
-      case 'B':
-        sl_append(out, dfsch_number_to_string(list_get(state->args), 2));
-        break;
-      case 'c':
-      case 'C':
-        sl_append(out, 
-                  dfsch_char_encode(dfsch_number_to_long(list_get(state->args))));
+      case 'a': case 'A':
+      case 's': case 'S':
+      case 'w': case 'W':
+      case 'y': case 'Y':
+      case 'r': case 'R':
+      case 'd': case 'D':
+      case 'x': case 'X':
+      case 'o': case 'O':
+      case 'b': case 'B':
+      case 'c': case 'C':
+      case '?':
+      case '*':
+        d->op = tolower(*string);
         break;
       case 'f':
       case 'F':
-        switch (argc){
-        case 1:
-          sl_append(out,
-                    dfsch_saprintf("%*s", argv[0],
-                                   dfsch_object_2_string(list_get(state->args), 
-                                                   1000, DFSCH_WRITE)));
-          break;
-        case 2:
-          sl_append(out, dfsch_number_format(list_get(state->args), 
-                                             argv[0], argv[1]));
-          break;
-        default:
+        if (argc != 1 && argc != 2){
           dfsch_error("Wrong number of arguments to ~f", 
                       DFSCH_MAKE_FIXNUM(argc));          
         }
-        break;
-      case '?':
-        {
-          char* fmt = dfsch_string_to_cstr(list_get(state->args));
-          sl_append(out, dfsch_format(fmt, list_get(state->args)));
-        }
-        break;
-        
-
-      case '*':
-        if (argc == 0){
-          argc = 1;
-          if (flags == FLAG_AT){
-            argv[0] = 0;
-          } else {
-            argv[0] = 1;
-          }
-        }
-
-        switch (flags){
-        case FLAG_COLON:
-          list_backskip(state->args, argv[0]);
-          break;
-        case FLAG_AT:
-          list_seek(state->args, argv[0]);
-          break;
-        default:
-          list_skip(state->args, argv[0]);
-        }
+        d->op = 'f';
         break;
       case '~':
-        sl_append(out, "~");
+        d->op = '\0';
+        d->text = "~";
+        d->len = 1;
         break;
       case '%':
       case '&':
-        sl_append(out, "\n");
+        d->op = '\0';
+        d->text = "\n";
+        d->len = 1;
         break;
       default:
         dfsch_error("Unknown format directive", NULL);
@@ -379,21 +334,288 @@ char* dfsch_format(char* string,
 
     } else {
       l = strcspn(string, "~");
-      sl_nappend(out, string, l);
+      emit_text(cf, &alloc, dfsch_strancpy(string, l), l);
       string += l;
     }
   }
 
-  return sl_value(out);
+  return (dfsch_object_t*)cf;
+}
+
+static void format_object(dfsch_object_t* obj, int max_depth, int mode,
+                          dfsch_output_proc_t proc, void* baton){
+  if (max_depth >= 0){
+    dfsch_writer_state_t* state = 
+      dfsch_make_writer_state(max_depth, mode, proc, baton);
+    dfsch_write_object(state, obj);
+    dfsch_invalidate_writer_state(state);
+  } else {
+    dfsch_write_object_circular(obj, mode, proc, baton);
+  }
+}
+
+static void format_number(dfsch_object_t* obj, int base,
+                          dfsch_output_proc_t proc, void* baton){
+  char buf[72];
+  char* ptr = buf + sizeof(buf);
+  long n;
+  unsigned long u;
+
+  if (!DFSCH_FIXNUM_P(obj)){
+    char* str = dfsch_number_to_string(obj, base);
+    proc(baton, str, strlen(str));
+    return;
+  }
+
+  if (base < 2 || base > 36){
+    dfsch_error("Invalid base", DFSCH_MAKE_FIXNUM(base));
+  }
+
+  n = DFSCH_FIXNUM_REF(obj);
+  u = n < 0 ? -(unsigned long)n : n;
+  do {
+    ptr--;
+    *ptr = "0123456789abcdefghijklmnopqrstuvwxyz"[u % base];
+    u /= base;
+  } while (u);
+  if (n < 0){
+    ptr--;
+    *ptr = '-';
+  }
+
+  proc(baton, ptr, (buf + sizeof(buf)) - ptr);
+}
+
+static void format_char(uint32_t ch, 
+                        dfsch_output_proc_t proc, void* baton){
+  char buf[4];
+  size_t len;
+
+  if (ch <= 0x7f){
+    buf[0] = ch;
+    len = 1;
+  } else if (ch <= 0x7ff) {
+    buf[0] = 0xc0 | ((ch >> 6) & 0x1f); 
+    buf[1] = 0x80 | (ch & 0x3f);
+    len = 2;
+  } else if (ch <= 0xffff) {
+    buf[0] = 0xe0 | ((ch >> 12) & 0x0f); 
+    buf[1] = 0x80 | ((ch >> 6) & 0x3f);
+    buf[2] = 0x80 | (ch & 0x3f);
+    len = 3;
+  } else {
+    buf[0] = 0xf0 | ((ch >> 18) & 0x07); 
+    buf[1] = 0x80 | ((ch >> 12) & 0x3f);
+    buf[2] = 0x80 | ((ch >> 6) & 0x3f);
+    buf[3] = 0x80 | (ch & 0x3f);
+    len = 4;
+  }
+
+  proc(baton, buf, len);
+}
+
+static dfsch_object_t* get_compiled_format(dfsch_object_t* fmt);
+
+static void format_run(compiled_format_t* cf, format_list_t* args,
+                       dfsch_output_proc_t proc, void* baton){
+  format_directive_t* d = cf->code;
+  format_directive_t* end = cf->code + cf->count;
+  char* str;
+  int count;
+
+  for (; d < end; d++){
+    switch (d->op){
+    case '\0':
+      proc(baton, d->text, d->len);
+      break;
+    case 'a':
+      format_object(list_get(args), d->argc ? d->argv[0] : -1, 
+                    DFSCH_PRINT, proc, baton);
+      break;
+    case 's':
+    case 'y':
+      format_object(list_get(args), d->argc ? d->argv[0] : -1, 
+                    DFSCH_WRITE, proc, baton);
+      break;
+    case 'w':
+      format_object(list_get(args), -1, DFSCH_WRITE, proc, baton);
+      break;
+    case 'r':
+      format_number(list_get(args), d->argc ? d->argv[0] : 10, 
+                    proc, baton);
+      break;
+    case 'd':
+      format_number(list_get(args), 10, proc, baton);
+      break;
+    case 'x':
+      format_number(list_get(args), 16, proc, baton);
+      break;
+    case 'o':
+      format_number(list_get(args), 8, proc, baton);
+      break;
+    case 'b':
+      format_number(list_get(args), 2, proc, baton);
+      break;
+    case 'c':
+      format_char(dfsch_number_to_long(list_get(args)), proc, baton);
+      break;
+    case 'f':
+      if (d->argc == 1){
+        str = dfsch_saprintf("%*s", d->argv[0],
+                             dfsch_object_2_string(list_get(args), 
+                                                   1000, DFSCH_WRITE));
+      } else {
+        str = dfsch_number_format(list_get(args), d->argv[0], d->argv[1]);
+      }
+      proc(baton, str, strlen(str));
+      break;
+    case '?':
+      {
+        compiled_format_t* sub = 
+          (compiled_format_t*)get_compiled_format(list_get(args));
+        format_run(sub, make_format_list(list_get(args)), proc, baton);
+      }
+      break;
+    case '*':
+      if (d->argc == 0){
+        count = (d->flags == FLAG_AT) ? 0 : 1;
+      } else {
+        count = d->argv[0];
+      }
+
+      switch (d->flags){
+      case FLAG_COLON:
+        list_backskip(args, count);
+        break;
+      case FLAG_AT:
+        list_seek(args, count);
+        break;
+      default:
+        list_skip(args, count);
+      }
+      break;
+    }
+  }
+}
+
+/*
+ * Compiled forms of recently used control strings, keyed by identity of
+ * string object. Entries are immutable and replaced as whole, so lookups
+ * need no locking.
+ */
+
+#define FORMAT_CACHE_SIZE 64
+
+typedef struct format_cache_entry_t {
+  dfsch_object_t* key;
+  char* ptr;
+  size_t len;
+  dfsch_object_t* compiled;
+} format_cache_entry_t;
+
+static format_cache_entry_t* format_cache[FORMAT_CACHE_SIZE];
+
+static dfsch_object_t* get_compiled_format(dfsch_object_t* fmt){
+  format_cache_entry_t* e;
+  dfsch_strbuf_t* buf;
+  size_t idx;
+
+  if (DFSCH_TYPE_OF(fmt) == DFSCH_COMPILED_FORMAT_TYPE){
+    return fmt;
+  }
+
+  buf = dfsch_string_to_buf(fmt);
+  idx = ((size_t)fmt >> 4) % FORMAT_CACHE_SIZE;
+  e = format_cache[idx];
+
+  if (e && e->key == fmt && e->ptr == buf->ptr && e->len == buf->len){
+    return e->compiled;
+  }
+
+  e = GC_NEW(format_cache_entry_t);
+  e->key = fmt;
+  e->ptr = buf->ptr;
+  e->len = buf->len;
+  e->compiled = dfsch_compile_format(dfsch_string_to_cstr(fmt));
+  DFSCH_MEMORY_BARRIER();
+  format_cache[idx] = e;
+
+  return e->compiled;
+}
+
+static size_t format_size_hint(compiled_format_t* cf){
+  size_t i;
+  size_t len = 0;
+
+  for (i = 0; i < cf->count; i++){
+    len += cf->code[i].op ? 16 : cf->code[i].len;
+  }
+
+  return len;
+}
+
+void dfsch_format_output(dfsch_object_t* format, 
+                         dfsch_object_t* args,
+                         dfsch_output_proc_t proc,
+                         void* baton){
+  format_run((compiled_format_t*)get_compiled_format(format), 
+             make_format_list(args), proc, baton);
+}
+
+dfsch_object_t* dfsch_format_string(dfsch_object_t* format, 
+                                    dfsch_object_t* args){
+  compiled_format_t* cf = 
+    (compiled_format_t*)get_compiled_format(format);
+  dfsch_object_t* sb = dfsch_make_string_builder(format_size_hint(cf));
+
+  format_run(cf, make_format_list(args), 
+             (dfsch_output_proc_t)dfsch_string_builder_append_buf, sb);
+
+  return dfsch_string_builder_to_string(sb);
+}
+
+char* dfsch_format(char* string, 
+                   dfsch_object_t* args){
+  dfsch_object_t* str = 
+    dfsch_format_string(dfsch_compile_format(string), args);
+  return dfsch_string_to_cstr(str);
+}
+
+DFSCH_DEFINE_PRIMITIVE(format, 
+                       "Format arguments according to control string. "
+                       "When first argument is port, output is written "
+                       "into it, otherwise new string is returned"
+                       DFSCH_DOC_SYNOPSIS("([port] control-string &rest args)")){
+  dfsch_object_t* port = NULL;
+  dfsch_object_t* format;
+
+  DFSCH_OBJECT_ARG(args, format);
+  if (dfsch_output_port_p(format)){
+    port = format;
+    DFSCH_OBJECT_ARG(args, format);
+  }
+
+  if (port){
+    dfsch_format_output(format, args, 
+                        (dfsch_output_proc_t)dfsch_port_write_buf, port);
+    return NULL;
+  } else {
+    return dfsch_format_string(format, args);
+  }
 }
 
-DFSCH_DEFINE_PRIMITIVE(format, NULL){
-  char* format;
-  DFSCH_STRING_ARG(args, format);
+DFSCH_DEFINE_PRIMITIVE(compile_format, 
+                       "Parse format control string in advance"){
+  char* string;
+  DFSCH_STRING_ARG(args, string);
+  DFSCH_ARG_END(args);
 
-  return dfsch_make_string_cstr(dfsch_format(format, args));
+  return dfsch_compile_format(string);
 }
 
 void dfsch__format_native_register(dfsch_object_t *ctx){
+  dfsch_defcanon_cstr(ctx, "<compiled-format>", DFSCH_COMPILED_FORMAT_TYPE);
   dfsch_defcanon_cstr(ctx, "format", DFSCH_PRIMITIVE_REF(format));  
+  dfsch_defcanon_cstr(ctx, "compile-format", 
+                      DFSCH_PRIMITIVE_REF(compile_format));  
 }
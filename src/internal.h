@@ -30,6 +30,10 @@ extern void dfsch__macros_register(dfsch_object_t *ctx);
 extern void dfsch__hash_native_register(dfsch_object_t *ctx);
 extern void dfsch__promise_native_register(dfsch_object_t *ctx);
 extern void dfsch__number_native_register(dfsch_object_t *ctx);
+extern void dfsch__numvector_native_register(dfsch_object_t *ctx);
+extern dfsch_object_t* dfsch__compile_arithmetic(dfsch_object_t* operator,
+                                                 dfsch_object_t* args,
+                                                 dfsch_object_t* expression);
 extern void dfsch__string_native_register(dfsch_object_t *ctx);
 extern void dfsch__weak_native_register(dfsch_object_t *ctx);
 extern void dfsch__format_native_register(dfsch_object_t *ctx);
@@ -42,6 +46,7 @@ extern void dfsch__conditions_register(dfsch_object_t* ctx);
 extern void dfsch__compile_register(dfsch_object_t* ctx);
 extern void dfsch__load_register(dfsch_object_t* ctx);
 extern void dfsch__specializers_register(dfsch_object_t* ctx);
+extern void dfsch__random_thread_exit(struct dfsch__thread_info_t* ti);
 
 dfsch_object_t* dfsch_make_number_from_string_noerror(char* string, int obase);
 
@@ -79,6 +84,11 @@ void dfsch__copy_breakpoint_to_compiled_ast_node(dfsch_object_t* src,
 void dfsch__allocate_breakpoint_table();
 void dfsch__maybe_free_breakpoint_table();
 
+dfsch_eqhash_entry_t* dfsch__get_environment_entries(dfsch_object_t* env);
+int dfsch__autoload(dfsch_object_t* name, dfsch_object_t* env);
+void dfsch__string_add_mapped_view(dfsch_object_t* view, 
+                                   dfsch_object_t* string);
+
 void dfsch__write_internal_reference(dfsch_writer_state_t* state,
                                      dfsch_object_t* obj,
                                      char* tag);
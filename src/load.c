@@ -34,6 +34,7 @@
 
 #ifdef __unix__
 #include <dlfcn.h>
+#include <sys/mman.h>
 #endif
 
 #ifdef __WIN32__
@@ -44,6 +45,10 @@
 #include <dfsch/strings.h>
 #include <dfsch/introspect.h>
 #include <dfsch/magic.h>
+#include <dfsch/serdes.h>
+#include <dfsch/sha256.h>
+#include <dfsch/weak.h>
+#include "src/internal.h"
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -183,11 +188,105 @@ char* read_file(char* fname){
   return sl_value(sl);
 }
 
+typedef void (*map_file_proc_t)(dfsch_strbuf_t* buf, void* baton);
+
+/*
+ * Call proc with whole contents of given file, on unix systems file is
+ * mapped directly into memory and unmapped when proc returns.
+ */
+static void map_file(char* fname, map_file_proc_t proc, void* baton){
+  dfsch_strbuf_t sb;
+#if defined(__unix__)
+  struct stat st;
+  void* map;
+  int fd;
+
+  fd = open(fname, O_RDONLY);
+  if (fd < 0){
+    dfsch_operating_system_error(dfsch_saprintf("Cannot open file %s",
+                                                fname));
+  }
+  if (fstat(fd, &st) != 0){
+    close(fd);
+    dfsch_operating_system_error("fstat");
+  }
+  if (st.st_size == 0){
+    close(fd);
+    sb.ptr = "";
+    sb.len = 0;
+    proc(&sb, baton);
+    return;
+  }
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED){
+    dfsch_operating_system_error("mmap");
+  }
+
+  DFSCH_UNWIND {
+    sb.ptr = map;
+    sb.len = st.st_size;
+    proc(&sb, baton);
+  } DFSCH_PROTECT {
+    munmap(map, st.st_size);
+  } DFSCH_PROTECT_END;
+#else
+  FILE* f = fopen(fname, "rb");
+  str_list_t* sl = sl_create();
+  char buf[8192];
+  size_t r;
+
+  if (!f){
+    dfsch_operating_system_error(dfsch_saprintf("Cannot open file %s",
+                                                fname));
+  }
+  while ((r = fread(buf, 1, 8192, f)) > 0){
+    sl_nappend(sl, strancpy(buf, r), r);
+  }
+  fclose(f);
+
+  sb = *dfsch_sl_value_strbuf(sl);
+  proc(&sb, baton);
+#endif
+}
+
+static void load_source(dfsch_object_t* env,
+                        char* fname,
+                        int toplevel,
+                        char* source,
+                        size_t len,
+                        int use_cache);
+
+typedef struct load_scm_ctx_t {
+  dfsch_object_t* env;
+  char* fname;
+  int toplevel;
+  int use_cache;
+} load_scm_ctx_t;
+
+static void load_scm_buf(dfsch_strbuf_t* sb, load_scm_ctx_t* ctx){
+  load_source(ctx->env, ctx->fname, ctx->toplevel, sb->ptr, sb->len, 
+              ctx->use_cache);
+}
+
+static void load_scm(dfsch_object_t* env, char* fname, int toplevel,
+                     int use_cache){
+  load_scm_ctx_t ctx;
+
+  ctx.env = env;
+  ctx.fname = fname;
+  ctx.toplevel = toplevel;
+  ctx.use_cache = use_cache;
+
+  map_file(fname, (map_file_proc_t)load_scm_buf, &ctx);
+}
+
 void dfsch_load_scm(dfsch_object_t* env, char* fname, int toplevel){
-  dfsch_load_source(env, fname, toplevel, read_file(fname));
+  load_scm(env, fname, toplevel, 0);
 }
 
-static char* read_dsz(FILE* f){
+static char* read_dsz(FILE* f, size_t* plen){
   size_t len;
   size_t clen;
   uint32_t cksum;
@@ -253,10 +352,12 @@ static char* read_dsz(FILE* f){
     dfsch_error("Invalid DSZ trailer", NULL);
   }
   
+  *plen = len;
   return payload;
 }
 
-void dfsch_load_dsz(dfsch_object_t* env, char* fname, int toplevel){
+static void load_dsz(dfsch_object_t* env, char* fname, int toplevel,
+                     int use_cache){
   FILE* f;
   int err=0;
   int l=0;
@@ -265,31 +366,255 @@ void dfsch_load_dsz(dfsch_object_t* env, char* fname, int toplevel){
   load_operation_t this_op;
   dfsch_package_t* saved_package = dfsch_get_current_package();
   char* source;
+  size_t len;
 
   f = fopen(fname, "rb");
   if (!f){
     dfsch_operating_system_error("fopen");
   }
 
-  dfsch_load_source(env, fname, toplevel, read_dsz(f));
+  source = read_dsz(f, &len);
+  load_source(env, fname, toplevel, source, len, use_cache);
 }
 
+void dfsch_load_dsz(dfsch_object_t* env, char* fname, int toplevel){
+  load_dsz(env, fname, toplevel, 0);
+}
+
+/*
+ * Module cache
+ *
+ * Top-level forms read from module source are stored in serialized
+ * form in directory named by *module-cache-directory* (initialized from
+ * DFSCH_MODULE_CACHE environment variable, cache is not used when it is
+ * not a string). Only modules loaded by load! and require are cached.
+ *
+ * Cache file name is derived from SHA-256 hash of everything that
+ * affects result of reading the source: interpreter build ID, file name
+ * (which is recorded in source annotations), current package with
+ * packages it uses and source text. When the same source is loaded again
+ * in the same state, forms are deserialized from cache file instead of
+ * parsing the source.
+ *
+ * Cache file is written only when all forms consist of plain data,
+ * objects produced by read-time evaluation are not stored.
+ */
+
+#define MODULE_CACHE_FORMAT "DfMc"
+
+static char* get_module_cache_directory(dfsch_object_t* env){
+  dfsch_object_t* dir = dfsch_env_get_cstr(env, "*module-cache-directory*");
+
+  if (dir == DFSCH_INVALID_OBJECT || !dfsch_string_p(dir)){
+    return NULL;
+  }
+  return dfsch_string_to_cstr(dir);
+}
+
+static void hash_cstr(dfsch_sha256_context_t* md, char* str){
+  dfsch_sha256_process(md, (unsigned char*)str, strlen(str) + 1);
+}
+
+static char* get_module_cache_file_name(char* dir, char* fname,
+                                        char* source, size_t len){
+  dfsch_sha256_context_t md;
+  unsigned char digest[32];
+  char name[65];
+  dfsch_package_t* package = dfsch_get_current_package();
+  dfsch_object_t* uses = dfsch_package_use_list(package);
+  dfsch_object_t* u;
+  int i;
+
+  dfsch_sha256_setup(&md);
+  hash_cstr(&md, dfsch_get_build_id());
+  hash_cstr(&md, fname);
+  hash_cstr(&md, dfsch_package_name((dfsch_object_t*)package));
+  while (DFSCH_PAIR_P(uses)){
+    u = DFSCH_FAST_CAR(uses);
+    if (DFSCH_PAIR_P(u)){
+      hash_cstr(&md, dfsch_saprintf("%s=", 
+                                    dfsch_string_to_cstr(DFSCH_FAST_CAR(u))));
+      u = DFSCH_FAST_CDR(u);
+    }
+    hash_cstr(&md, dfsch_package_name(u));
+    uses = DFSCH_FAST_CDR(uses);
+  }
+  hash_cstr(&md, "");
+  dfsch_sha256_process(&md, (unsigned char*)source, len);
+  dfsch_sha256_result(&md, digest);
+
+  for (i = 0; i < 32; i++){
+    sprintf(name + i * 2, "%02x", digest[i]);
+  }
+
+  return dfsch_saprintf("%s/%s.dfc", dir, name);
+}
+
+typedef struct module_cache_writer_t {
+  dfsch_serializer_t* s;
+  str_list_t* sl;
+  int failed;
+} module_cache_writer_t;
+
+static int module_cache_object_hook(dfsch_serializer_t* s,
+                                    dfsch_object_t* obj,
+                                    void* baton){
+  if (!obj || DFSCH_PAIR_P(obj) || DFSCH_SYMBOL_P(obj) || 
+      DFSCH_CHARACTER_P(obj) || dfsch_number_p(obj) || 
+      dfsch_string_p(obj) || dfsch_vector_p(obj) ||
+      DFSCH_INSTANCE_P(obj, DFSCH_BYTE_VECTOR_TYPE)){
+    return 0;
+  }
+  dfsch_error("Object cannot be stored in module cache", obj);
+  return 0;
+}
+
+static module_cache_writer_t* make_module_cache_writer(){
+  module_cache_writer_t* w = GC_NEW(module_cache_writer_t);
+  
+  w->sl = sl_create();
+  w->s = dfsch_make_serializer((dfsch_output_proc_t)sl_nappend, w->sl);
+  dfsch_serializer_set_object_hook(w->s, module_cache_object_hook, NULL);
+  dfsch_serializer_write_stream_header(w->s, MODULE_CACHE_FORMAT);
+
+  return w;
+}
+
+static void module_cache_record(module_cache_writer_t* w, 
+                                dfsch_object_t* object){
+  if (w->failed){
+    return;
+  }
+
+  w->failed = 1;
+  DFSCH_IGNORE_ERRORS {
+    dfsch_serialize_object(w->s, object);
+    w->failed = 0;
+  } DFSCH_END_IGNORE_ERRORS;
+}
+
+static void write_module_cache(module_cache_writer_t* w, 
+                               char* dir, char* fname){
+  dfsch_strbuf_t* sb;
+  char* tmpname;
+  FILE* f;
+
+  dfsch_serialize_invalid_object(w->s);
+  sb = dfsch_sl_value_strbuf(w->sl);
+
+#ifdef __WIN32__
+  mkdir(dir);
+#else
+  mkdir(dir, 0777);
+#endif
+
+  /* Cache file is created under temporary name and then atomically
+     renamed, so concurrent loaders never see incomplete file */
+  tmpname = dfsch_saprintf("%s.%d", fname, (int)getpid());
+  f = fopen(tmpname, "wb");
+  if (!f){
+    return;
+  }
+  if (fwrite(sb->ptr, sb->len, 1, f) != 1){
+    fclose(f);
+    unlink(tmpname);
+    return;
+  }
+  if (fclose(f) != 0 || rename(tmpname, fname) != 0){
+    unlink(tmpname);
+  }
+}
+
+static void read_module_cache(dfsch_strbuf_t* sb, 
+                              dfsch_list_collector_t* forms){
+  dfsch_deserializer_t* ds;
+  dfsch_object_t* object;
+
+  ds = dfsch_make_deserializer((dfsch_input_proc_t)dfsch_strbuf_inputproc,
+                               sb);
+  dfsch_deserializer_read_stream_header(ds, MODULE_CACHE_FORMAT);
+
+  for (;;){
+    object = dfsch_deserialize_object(ds);
+    if (object == DFSCH_INVALID_OBJECT){
+      break;
+    }
+    dfsch_list_collect(forms, object);
+  }
+}
+
+/*
+ * Returns list of forms stored in cache file or DFSCH_INVALID_OBJECT
+ * when file cannot be read or is corrupt. Whole file is deserialized
+ * before any form is evaluated, so caller can fall back to parsing the
+ * source without evaluating anything twice.
+ */
+static dfsch_object_t* load_module_cache(char* fname){
+  dfsch_list_collector_t* forms = dfsch_make_list_collector();
+  dfsch_object_t* res = DFSCH_INVALID_OBJECT;
+
+  DFSCH_IGNORE_ERRORS {
+    map_file(fname, (map_file_proc_t)read_module_cache, forms);
+    res = dfsch_collected_list(forms);
+  } DFSCH_END_IGNORE_ERRORS;
+
+  return res;
+}
+
+typedef struct load_source_ctx_t {
+  dfsch_object_t* env;
+  module_cache_writer_t* cache;
+} load_source_ctx_t;
+
 static int load_source_callback(dfsch_object_t* object,
-                                dfsch_object_t* env){
-  dfsch_eval(object, env);
+                                load_source_ctx_t* ctx){
+  if (ctx->cache){
+    module_cache_record(ctx->cache, object);
+  }
+  dfsch_eval(object, ctx->env);
   return 1;
 }
 
-void dfsch_load_source(dfsch_object_t* env,
-                       char* fname,
-                       int toplevel,
-                       char* source){
+/*
+ * Source is fed into parser in chunks of this size, so only incomplete
+ * top-level form has to be held in parser's buffer and memory used
+ * does not depend on size of loaded file.
+ */
+#define LOAD_CHUNK_SIZE 65536
+
+static void load_source(dfsch_object_t* env,
+                        char* fname,
+                        int toplevel,
+                        char* source,
+                        size_t len,
+                        int use_cache){
   dfsch_parser_ctx_t *parser = dfsch_parser_create();
   load_thread_info_t* lti = get_load_ti();
   load_operation_t this_op;
   dfsch_package_t* saved_package = dfsch_get_current_package();
+  load_source_ctx_t ctx;
+  char* cache_dir = NULL;
+  char* cache_file = NULL;
+  dfsch_object_t* cached = DFSCH_INVALID_OBJECT;
+  size_t off;
+  size_t clen;
+
+  ctx.env = env;
+  ctx.cache = NULL;
+
+  if (use_cache){
+    cache_dir = get_module_cache_directory(env);
+  }
+  if (cache_dir){
+    cache_file = get_module_cache_file_name(cache_dir, fname, source, len);
+    /* Unreadable or corrupt entry is treated as a miss and replaced */
+    cached = load_module_cache(cache_file);
+    if (cached == DFSCH_INVALID_OBJECT){
+      ctx.cache = make_module_cache_writer();
+    }
+  }
 
-  dfsch_parser_callback(parser, load_source_callback, env);
+  dfsch_parser_callback(parser, load_source_callback, &ctx);
   dfsch_parser_set_source(parser, dfsch_make_string_cstr(fname));
   dfsch_parser_eval_env(parser, env);
 
@@ -299,16 +624,46 @@ void dfsch_load_source(dfsch_object_t* env,
     this_op.next = lti->operation;
     lti->operation = &this_op;
 
-    dfsch_parser_feed(parser, source);    
+    if (cached != DFSCH_INVALID_OBJECT){
+      dfsch_object_t* i = cached;
+      while (DFSCH_PAIR_P(i)){
+        dfsch_eval(DFSCH_FAST_CAR(i), env);
+        i = DFSCH_FAST_CDR(i);
+      }
+    } else {
+      for (off = 0; off < len; off += clen){
+        clen = len - off;
+        if (clen > LOAD_CHUNK_SIZE){
+          clen = LOAD_CHUNK_SIZE;
+        }
+        dfsch_parser_feed_buf(parser, source + off, clen);
+      }
+      dfsch_parser_feed(parser, "\n");
+    }
   } DFSCH_PROTECT {
     lti->operation = this_op.next;
     dfsch_set_current_package(saved_package);
   } DFSCH_PROTECT_END;
 
+  if (cached != DFSCH_INVALID_OBJECT){
+    return;
+  }
+
   if (dfsch_parser_get_level(parser)!=0){
       dfsch_error("Syntax error at end of input",
                   dfsch_make_string_cstr(fname));
-  }  
+  }
+
+  if (ctx.cache && !ctx.cache->failed){
+    write_module_cache(ctx.cache, cache_dir, cache_file);
+  }
+}
+
+void dfsch_load_source(dfsch_object_t* env,
+                       char* fname,
+                       int toplevel,
+                       char* source){
+  load_source(env, fname, toplevel, source, strlen(source), 0);
 }
 
 
@@ -409,25 +764,75 @@ static char* pathname_directory(char* path){
 typedef struct module_loader_t {
   char* path_ext;
   void (*load)(char* fname, dfsch_object_t* env, int as_toplevel);
+  int native;
 } module_loader_t;
 
 static void scm_loader(char* fname, dfsch_object_t* env, int as_toplevel){
-  dfsch_load_scm(env, fname, as_toplevel);
+  load_scm(env, fname, as_toplevel, 1);
 }
 static void dsz_loader(char* fname, dfsch_object_t* env, int as_toplevel){
-  dfsch_load_dsz(env, fname, as_toplevel);
+  load_dsz(env, fname, as_toplevel, 1);
 }
 static void so_loader(char* fname, dfsch_object_t* env, int as_toplevel){
   dfsch_load_so(env, fname, get_module_symbol(fname), as_toplevel);
 }
 
 static module_loader_t loaders[] = {
-  {".scm", scm_loader},
-  {".dsz", dsz_loader},
-  {".so", so_loader},
-  {".dsl", so_loader},
+  {".scm", scm_loader, 0},
+  {".dsz", dsz_loader, 0},
+  {".so", so_loader, 1},
+  {".dsl", so_loader, 1},
 };
 
+/*
+ * Native modules cannot be stored in image, so we keep list of them 
+ * for each environment (in reverse load order) to be able to load them
+ * again when image is restored.
+ */
+
+static dfsch_object_t* native_modules = NULL;
+static pthread_mutex_t native_modules_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static dfsch_object_t* get_native_modules(dfsch_object_t* env){
+  dfsch_object_t* modules = NULL;
+
+  pthread_mutex_lock(&native_modules_mutex);
+  if (native_modules){
+    modules = dfsch_mapping_ref(native_modules, env);
+    if (modules == DFSCH_INVALID_OBJECT){
+      modules = NULL;
+    }
+  }
+  pthread_mutex_unlock(&native_modules_mutex);
+
+  return modules;
+}
+
+static void add_native_module(dfsch_object_t* env, char* name){
+  dfsch_object_t* modules;
+
+  pthread_mutex_lock(&native_modules_mutex);
+  if (!native_modules){
+    native_modules = dfsch_make_weak_key_hash();
+  }
+  modules = dfsch_mapping_ref(native_modules, env);
+  if (modules == DFSCH_INVALID_OBJECT){
+    modules = NULL;
+  }
+  dfsch_mapping_set(native_modules, env,
+                    dfsch_cons(dfsch_make_string_cstr(name), modules));
+  pthread_mutex_unlock(&native_modules_mutex);
+}
+
+static void run_loader(module_loader_t* loader, char* fname, 
+                       dfsch_object_t* env, char* name, int as_toplevel){
+  loader->load(fname, env, as_toplevel);
+
+  if (loader->native){
+    add_native_module(env, name);
+  }
+}
+
 void dfsch_load(dfsch_object_t* env, char* name, 
                 dfsch_object_t* path_list,
                 int as_toplevel){
@@ -476,7 +881,7 @@ void dfsch_load(dfsch_object_t* env, char* name,
         for (i = 0; i < sizeof(loaders) / sizeof(module_loader_t); i++){
           if (strcmp(pathpart + strlen(pathpart) - strlen(loaders[i].path_ext),
                      loaders[i].path_ext) == 0){
-            loaders[i].load(pathpart, env, as_toplevel);	      
+            run_loader(&loaders[i], pathpart, env, name, as_toplevel);
             return;
           }
         }
@@ -490,7 +895,7 @@ void dfsch_load(dfsch_object_t* env, char* name,
       fname = stracat(pathpart, loaders[i].path_ext);
       if (stat(fname, &st) == 0 && (S_ISREG(st.st_mode) || 
                                     S_ISLNK(st.st_mode))){
-        loaders[i].load(fname, env, as_toplevel);	      
+        run_loader(&loaders[i], fname, env, name, as_toplevel);
         return;
       }
     }
@@ -550,6 +955,135 @@ void dfsch_provide(dfsch_object_t* env, char* name){
                                modules));
 }
 
+/*
+ * Autoload declarations map symbol to module that defines it. When
+ * such symbol is looked up while unbound in top-level environment of
+ * declaring frame (or any of its child frames), the module is required
+ * into that top-level environment and lookup retried. Declaration is
+ * removed only after module was successfully loaded, so failed load is
+ * retried on next lookup.
+ */
+
+typedef struct autoload_t {
+  dfsch_object_t* env;
+  char* module;
+  int loading;
+  pthread_t loader;
+  struct autoload_t* next;
+} autoload_t;
+
+static dfsch_eqhash_t autoloads;
+static int autoloads_initialized = 0;
+static pthread_mutex_t autoload_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static dfsch_object_t* top_level_frame(dfsch_object_t* env){
+  dfsch_object_t* parent;
+
+  while ((parent = dfsch_get_parent_frame(env))){
+    env = parent;
+  }
+
+  return env;
+}
+
+void dfsch_autoload(dfsch_object_t* env, dfsch_object_t* name, char* module){
+  autoload_t* al = GC_NEW(autoload_t);
+
+  al->env = top_level_frame(env);
+  al->module = module;
+
+  pthread_mutex_lock(&autoload_mutex);
+  if (!autoloads_initialized){
+    dfsch_eqhash_init(&autoloads, 0);
+    autoloads_initialized = 1;
+  }
+  al->next = (autoload_t*)dfsch_eqhash_ref(&autoloads, name);
+  if (al->next == (autoload_t*)DFSCH_INVALID_OBJECT){
+    al->next = NULL;
+  }
+  dfsch_eqhash_set(&autoloads, name, (dfsch_object_t*)al);
+  pthread_mutex_unlock(&autoload_mutex);
+}
+
+void dfsch_autoload_pkgcstr(dfsch_object_t* env, char* module,
+                            char* package, char** names){
+  dfsch_package_t* pkg = (dfsch_package_t*)dfsch_make_package(package, NULL);
+
+  while (*names){
+    dfsch_autoload(env, dfsch_intern_symbol(pkg, *names), module);
+    names++;
+  }
+}
+
+static void remove_autoload(dfsch_object_t* name, autoload_t* al){
+  autoload_t* head;
+  autoload_t** i;
+
+  pthread_mutex_lock(&autoload_mutex);
+  head = (autoload_t*)dfsch_eqhash_ref(&autoloads, name);
+  if (head == (autoload_t*)DFSCH_INVALID_OBJECT){
+    pthread_mutex_unlock(&autoload_mutex);
+    return;
+  }
+
+  for (i = &head; *i; i = &((*i)->next)){
+    if (*i == al){
+      *i = al->next;
+      break;
+    }
+  }
+
+  if (head){
+    dfsch_eqhash_set(&autoloads, name, (dfsch_object_t*)head);
+  } else {
+    dfsch_eqhash_unset(&autoloads, name);
+  }
+  pthread_mutex_unlock(&autoload_mutex);
+}
+
+int dfsch__autoload(dfsch_object_t* name, dfsch_object_t* env){
+  autoload_t* found;
+  dfsch_object_t* top_level = top_level_frame(env);
+
+  pthread_mutex_lock(&autoload_mutex);
+  if (!autoloads_initialized){
+    pthread_mutex_unlock(&autoload_mutex);
+    return 0;
+  }
+
+  found = (autoload_t*)dfsch_eqhash_ref(&autoloads, name);
+  if (found == (autoload_t*)DFSCH_INVALID_OBJECT){
+    pthread_mutex_unlock(&autoload_mutex);
+    return 0;
+  }
+
+  while (found && found->env != top_level){
+    found = found->next;
+  }
+
+  /* Module that looks up symbol it is supposed to define */
+  if (!found || (found->loading && 
+                 pthread_equal(found->loader, pthread_self()))){
+    pthread_mutex_unlock(&autoload_mutex);
+    return 0;
+  }
+
+  found->loading = 1;
+  found->loader = pthread_self();
+  pthread_mutex_unlock(&autoload_mutex);
+
+  DFSCH_UNWIND {
+    dfsch_require(found->env, found->module, NULL);
+  } DFSCH_PROTECT {
+    pthread_mutex_lock(&autoload_mutex);
+    found->loading = 0;
+    pthread_mutex_unlock(&autoload_mutex);
+  } DFSCH_PROTECT_END;
+
+  remove_autoload(name, found);
+  return 1;
+}
+
 void dfsch_load_add_module_source(dfsch_object_t* ctx,
                                   dfsch_object_t* src){
   dfsch_object_t* path = dfsch_env_get_cstr(ctx, "*load-path*");
@@ -564,6 +1098,159 @@ void dfsch_load_extend_path(dfsch_object_t* ctx, char* dir){
   dfsch_load_add_module_source(ctx, dfsch_make_string_cstr(dir));
 }
 
+/*
+ * Images are serialized snapshots of one environment frame (usually
+ * top-level environment after loading all modules used by application).
+ *
+ * Stored are non-canonical bindings with serializable values and
+ * canonical bindings that are not recreated by booting core library and
+ * loading native modules listed in image (ie. procedures and constants
+ * defined by application). To find out which canonical bindings are
+ * recreated, fresh environment is booted when saving the image. References
+ * to objects of these bindings are resolved by name in environment image
+ * is loaded into, everything else is stored by value. Canonical binding
+ * that has to be stored but cannot be serialized (eg. class) is an error,
+ * as image without it would be incomplete.
+ *
+ * Core library itself is not part of image: its classes, generic
+ * functions and packages cannot be serialized and booting it takes
+ * about a millisecond, which is small part of process startup. Image
+ * replaces loading of application modules, which is what dominates
+ * startup of larger programs.
+ *
+ * Image is written into temporary file which is renamed over the
+ * target only after whole image was written, so failed save never
+ * leaves truncated image behind.
+ */
+
+#define IMAGE_FORMAT "DfIm"
+
+static void image_write(FILE* f, char* buf, size_t len){
+  if (len && fwrite(buf, len, 1, f) != 1){
+    dfsch_operating_system_error("fwrite");
+  }
+}
+
+static dfsch_object_t* image_boot_environment(dfsch_object_t* modules){
+  dfsch_object_t* env = dfsch_make_top_level_environment();
+
+  while (DFSCH_PAIR_P(modules)){
+    dfsch_require(env, dfsch_string_to_cstr(DFSCH_FAST_CAR(modules)), NULL);
+    modules = DFSCH_FAST_CDR(modules);
+  }
+
+  return env;
+}
+
+static int image_binding_p(dfsch_eqhash_entry_t* i, dfsch_object_t* boot){
+  if ((i->flags & DFSCH_VAR_CANONICAL) == 0){
+    return dfsch_type_serializable_p(DFSCH_TYPE_OF(i->value));
+  }
+
+  if (dfsch_env_get(i->key, boot) != DFSCH_INVALID_OBJECT){
+    return 0;
+  }
+  if (!dfsch_type_serializable_p(DFSCH_TYPE_OF(i->value))){
+    dfsch_error("Canonical binding cannot be stored in image", i->key);
+  }
+  return 1;
+}
+
+void dfsch_save_image(dfsch_object_t* env, char* fname){
+  dfsch_serializer_t* s;
+  dfsch_eqhash_entry_t* entries = dfsch__get_environment_entries(env);
+  dfsch_eqhash_entry_t* i;
+  dfsch_object_t* modules = dfsch_reverse(get_native_modules(env));
+  dfsch_object_t* boot = image_boot_environment(modules);
+  dfsch_object_t* canon = dfsch_new_frame(dfsch_get_parent_frame(env));
+  dfsch_object_t* bindings = NULL;
+  char* tmpname;
+  FILE* f;
+
+  for (i = entries; i; i = i->next){
+    if (image_binding_p(i, boot)){
+      bindings = dfsch_cons((dfsch_object_t*)i, bindings);
+    } else if (i->flags & DFSCH_VAR_CANONICAL){
+      dfsch_define(i->key, i->value, canon, DFSCH_VAR_CANONICAL);
+    }
+  }
+  bindings = dfsch_reverse(bindings);
+
+  tmpname = dfsch_saprintf("%s.tmp", fname);
+  f = fopen(tmpname, "wb");
+  if (!f){
+    dfsch_operating_system_error(dfsch_saprintf("Cannot open file %s",
+                                                tmpname));
+  }
+
+  DFSCH_UNWIND {
+    s = dfsch_make_serializer((dfsch_output_proc_t)image_write, f);
+    dfsch_serializer_set_canonical_environment(s, canon);
+    dfsch_serializer_write_stream_header(s, IMAGE_FORMAT);
+    dfsch_serialize_cstr(s, dfsch_get_build_id());
+    dfsch_serialize_object(s, modules);
+
+    while (DFSCH_PAIR_P(bindings)){
+      i = (dfsch_eqhash_entry_t*)DFSCH_FAST_CAR(bindings);
+      dfsch_serialize_integer(s, i->flags);
+      dfsch_serialize_object(s, i->key);
+      dfsch_serialize_object(s, i->value);
+      bindings = DFSCH_FAST_CDR(bindings);
+    }
+    dfsch_serialize_integer(s, -1);
+    if (fflush(f) != 0){
+      dfsch_operating_system_error("fflush");
+    }
+  } DFSCH_PROTECT {
+    fclose(f);
+    DFSCH_UNWIND_DETECT {
+      unlink(tmpname);
+    }
+  } DFSCH_PROTECT_END;
+
+  if (rename(tmpname, fname) != 0){
+    int err = errno;
+    unlink(tmpname);
+    dfsch_operating_system_error_saved(err, "rename");
+  }
+}
+
+static void load_image_buf(dfsch_strbuf_t* sb, dfsch_object_t* env){
+  dfsch_deserializer_t* ds;
+  dfsch_object_t* modules;
+  int64_t flags;
+
+  ds = dfsch_make_deserializer((dfsch_input_proc_t)dfsch_strbuf_inputproc,
+                               sb);
+  dfsch_deserializer_set_canonical_environment(ds, env);
+  dfsch_deserializer_read_stream_header(ds, IMAGE_FORMAT);
+  if (strcmp(dfsch_deserialize_strbuf(ds)->ptr, dfsch_get_build_id()) != 0){
+    dfsch_error("Image was created by different build of dfsch", NULL);
+  }
+
+  modules = dfsch_deserialize_object(ds);
+  while (DFSCH_PAIR_P(modules)){
+    dfsch_require(env, dfsch_string_to_cstr(DFSCH_FAST_CAR(modules)), NULL);
+    modules = DFSCH_FAST_CDR(modules);
+  }
+
+  for (;;){
+    dfsch_object_t* name;
+    dfsch_object_t* value;
+    flags = dfsch_deserialize_integer(ds);
+    if (flags < 0){
+      break;
+    }
+    name = dfsch_deserialize_object(ds);
+    value = dfsch_deserialize_object(ds);
+    dfsch_define(name, value, env, flags);
+  }
+}
+
+void dfsch_load_image(dfsch_object_t* env, char* fname){
+  map_file(fname, (map_file_proc_t)load_image_buf, env);
+}
+
 typedef struct read_ctx_t {
   dfsch_object_t* head;
   dfsch_object_t* tail;
@@ -585,77 +1272,107 @@ static int read_callback(dfsch_object_t *obj, read_ctx_t* ctx){
 }
 
 dfsch_object_t* dfsch_read_scm(char* scm_name, dfsch_object_t* eval_env){
-  FILE* f = fopen(scm_name,"r");
-  char buf[8193];
   read_ctx_t ictx;
-  ssize_t r;
-  int err=0;
-  dfsch_object_t *obj;
-
-  if (!f){
-    dfsch_operating_system_error("fopen");
-  }
 
-  obj = dfsch_read_scm_stream(f, scm_name, eval_env);
+  ictx.head = NULL;
 
-  fclose(f);
+  dfsch_read_scm_callback(scm_name, eval_env, 
+                          (dfsch_parser_callback_t)read_callback, &ictx);
     
-  return obj;
+  return ictx.head;
 }
 
 dfsch_object_t* dfsch_read_scm_fd(int f, char* name, dfsch_object_t* eval_env){
-  char buf[8193];
   read_ctx_t ictx;
-  ssize_t r;
-  int err=0;
 
   ictx.head = NULL;
 
+  dfsch_read_scm_fd_callback(f, name, eval_env, 
+                             (dfsch_parser_callback_t)read_callback, &ictx);
+
+  return ictx.head;
+}
+
+static void read_scm_end(dfsch_parser_ctx_t* parser, char* name){
+  if (dfsch_parser_feed(parser, "\n") == 0 &&
+      dfsch_parser_get_level(parser) != 0){
+      dfsch_error("Syntax error at end of input",
+                  dfsch_make_string_cstr(name));
+  }  
+}
+
+#define READ_CHUNK_SIZE 65536
+
+void dfsch_read_scm_fd_callback(int f, char* name, 
+                                dfsch_object_t* eval_env,
+                                dfsch_parser_callback_t callback,
+                                void* baton){
+  char* buf = GC_MALLOC_ATOMIC(READ_CHUNK_SIZE);
+  ssize_t r;
   dfsch_parser_ctx_t *parser = dfsch_parser_create();
-  dfsch_parser_callback(parser, read_callback, &ictx);
+
+  dfsch_parser_callback(parser, callback, baton);
+  dfsch_parser_set_source(parser, dfsch_make_string_cstr(name));
   dfsch_parser_eval_env(parser, eval_env);
 
-  while (!err && (r = read(f, buf, 8192))>0){
-    buf[r]=0;
-    err = dfsch_parser_feed(parser,buf);
+  for (;;){
+    r = read(f, buf, READ_CHUNK_SIZE);
+    if (r < 0){
+      if (errno == EINTR){
+        dfsch_async_apply_check();
+        continue;
+      }
+      dfsch_operating_system_error("read");
+    }
+    if (r == 0){
+      break;
+    }
+    if (dfsch_parser_feed_buf(parser, buf, r)){
+      return;
+    }
   }
 
-  if (r<0){
-    dfsch_operating_system_error("read");
+  read_scm_end(parser, name);
+}
+
+void dfsch_read_scm_callback(char* scm_name, 
+                             dfsch_object_t* eval_env,
+                             dfsch_parser_callback_t callback,
+                             void* baton){
+  int f = open(scm_name, O_RDONLY);
+
+  if (f < 0){
+    dfsch_operating_system_error(dfsch_saprintf("Cannot open file %s",
+                                                scm_name));
   }
- 
-  if (dfsch_parser_get_level(parser)!=0){
-      dfsch_error("Syntax error at end of input",
-                  dfsch_make_string_cstr(name));
-  }  
 
-  return ictx.head;
-  
+  DFSCH_UNWIND {
+    dfsch_read_scm_fd_callback(f, scm_name, eval_env, callback, baton);
+  } DFSCH_PROTECT {
+    close(f);
+  } DFSCH_PROTECT_END;
 }
+
 dfsch_object_t* dfsch_read_scm_stream(FILE* f, 
                                       char* name, 
                                       dfsch_object_t* eval_env){
-  char buf[8193];
+  char buf[8192];
   read_ctx_t ictx;
-  ssize_t r;
-  int err=0;
-  int l=0;
+  size_t r;
 
   ictx.head = NULL;
 
   dfsch_parser_ctx_t *parser = dfsch_parser_create();
-  dfsch_parser_callback(parser, read_callback, &ictx);
+  dfsch_parser_callback(parser, 
+                        (dfsch_parser_callback_t)read_callback, &ictx);
   dfsch_parser_set_source(parser, dfsch_make_string_cstr(name));
   dfsch_parser_eval_env(parser, eval_env);
 
-  while (fgets(buf, 8192, f)){
-    dfsch_parser_feed(parser,buf);
+  while ((r = fread(buf, 1, 8192, f)) > 0){
+    dfsch_parser_feed_buf(parser, buf, r);
   }
 
-  if (dfsch_parser_get_level(parser)!=0){
-      dfsch_error("Syntax error at end of input",
-                  dfsch_make_string_cstr(name));
-  }  
+  read_scm_end(parser, name);
 
   return ictx.head;
 }
@@ -719,9 +1436,73 @@ DFSCH_DEFINE_FORM(provide, {}, NULL){
   return NULL;
 }
 
-DFSCH_DEFINE_PRIMITIVE(read_scm, NULL){
+DFSCH_DEFINE_FORM(autoload, {}, 
+                  "Require module when any of given symbols is first "
+                  "looked up while unbound"){
+  char* module;
+  dfsch_object_t* name;
+
+  args = dfsch_eval_list(args, env);
+  DFSCH_STRING_OR_SYMBOL_ARG(args, module);
+
+  while (DFSCH_PAIR_P(args)){
+    DFSCH_OBJECT_ARG(args, name);
+    if (!DFSCH_SYMBOL_P(name)){
+      dfsch_error("Not a symbol", name);
+    }
+    dfsch_autoload(env, name, module);
+  }
+  DFSCH_ARG_END(args);
+
+  return NULL;
+}
+
+DFSCH_DEFINE_FORM(save_image, {}, 
+                  "Save bindings of current environment frame that are "
+                  "not created by core library into image file"){
+  char* file_name;
+
+  args = dfsch_eval_list(args, env);
+  DFSCH_STRING_ARG(args, file_name);
+  DFSCH_ARG_END(args);
+
+  dfsch_save_image(env, file_name);
+  return NULL;
+}
+DFSCH_DEFINE_FORM(load_image, {}, 
+                  "Restore bindings saved by save-image! into current "
+                  "environment frame"){
+  char* file_name;
+
+  args = dfsch_eval_list(args, env);
+  DFSCH_STRING_ARG(args, file_name);
+  DFSCH_ARG_END(args);
+
+  dfsch_load_image(env, file_name);
+  return NULL;
+}
+
+static int read_scm_apply_callback(dfsch_object_t* obj, 
+                                   dfsch_object_t* proc){
+  dfsch_apply(proc, dfsch_list(1, obj));
+  return 1;
+}
+
+DFSCH_DEFINE_PRIMITIVE(read_scm, 
+                       "Read list of all objects in file, or call proc "
+                       "on each object as soon as it is read"){
   char* filename;
+  dfsch_object_t* proc;
   DFSCH_STRING_ARG(args, filename);
+  DFSCH_OBJECT_ARG_OPT(args, proc, NULL);
+  DFSCH_ARG_END(args);
+
+  if (proc){
+    dfsch_read_scm_callback(filename, NULL, 
+                            (dfsch_parser_callback_t)read_scm_apply_callback,
+                            proc);
+    return NULL;
+  }
 
   return dfsch_read_scm(filename, NULL);
 }
@@ -794,14 +1575,22 @@ dfsch_object_t* dfsch_load_construct_default_path(){
   return path;
 }
 void dfsch__load_register(dfsch_object_t *ctx){
+  char* cache_dir = getenv("DFSCH_MODULE_CACHE");
+
   dfsch_define_cstr(ctx, "*load-path*", 
                     dfsch_load_construct_default_path());
+  dfsch_define_cstr(ctx, "*module-cache-directory*", 
+                    (cache_dir && *cache_dir) ? 
+                    dfsch_make_string_cstr(cache_dir) : NULL);
   dfsch_defcanon_cstr(ctx, "load-scm!",  DFSCH_FORM_REF(load_scm));
   dfsch_defcanon_cstr(ctx, "read-scm", DFSCH_PRIMITIVE_REF(read_scm));
   dfsch_defcanon_cstr(ctx, "load-so!", DFSCH_FORM_REF(load_so));
   dfsch_defcanon_cstr(ctx, "load!", DFSCH_FORM_REF(load));
   dfsch_defcanon_cstr(ctx, "require", DFSCH_FORM_REF(require));
   dfsch_defcanon_cstr(ctx, "provide", DFSCH_FORM_REF(provide));
+  dfsch_defcanon_cstr(ctx, "autoload!", DFSCH_FORM_REF(autoload));
+  dfsch_defcanon_cstr(ctx, "save-image!", DFSCH_FORM_REF(save_image));
+  dfsch_defcanon_cstr(ctx, "load-image!", DFSCH_FORM_REF(load_image));
 
   dfsch_defcanon_cstr(ctx, "when-toplevel", DFSCH_FORM_REF(when_toplevel));
   dfsch_defcanon_cstr(ctx, "current-load-file", 
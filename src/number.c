@@ -25,6 +25,7 @@
 #include <dfsch/strings.h>
 #include <dfsch/random.h>
 #include <dfsch/serdes.h>
+#include <dfsch/compiler.h>
 #include "util.h"
 #include "internal.h"
 #include <stdio.h>
@@ -2143,6 +2144,282 @@ DFSCH_DEFINE_PRIMITIVE(make_number_sequence, NULL){
 }
 
 
+/*
+ * Fused arithmetic
+ *
+ * Compiler replaces nested calls of + - * and / by one node that evaluates
+ * whole expression tree and keeps intermediate inexact results as unboxed
+ * doubles, only final result is boxed. Operations on exact operands are
+ * performed by generic functions, so result is same as with nested calls.
+ */
+
+#define ARITH_ADD 0
+#define ARITH_SUB 1
+#define ARITH_MUL 2
+#define ARITH_DIV 3
+
+typedef struct arith_node_t {
+  dfsch_type_t* type;
+  int op;
+  size_t argc;
+  dfsch_object_t* argv[];
+} arith_node_t;
+
+static void arith_node_serialize(arith_node_t* n, dfsch_serializer_t* s){
+  size_t i;
+  dfsch_serialize_stream_symbol(s, "arithmetic-node");
+  dfsch_serialize_integer(s, n->op);
+  dfsch_serialize_integer(s, n->argc);
+  for (i = 0; i < n->argc; i++){
+    dfsch_serialize_object(s, n->argv[i]);
+  }
+}
+
+static dfsch_type_t arith_node_type = {
+  DFSCH_STANDARD_TYPE,
+  NULL,
+  sizeof(arith_node_t),
+  "arithmetic-node",
+  .serialize = (dfsch_type_serialize_t)arith_node_serialize,
+};
+
+DFSCH_DEFINE_DESERIALIZATION_HANDLER("arithmetic-node", arith_node){
+  arith_node_t* n;
+  int op = dfsch_deserialize_integer(ds);
+  int64_t argc = dfsch_deserialize_integer(ds);
+  size_t i;
+
+  if (op < ARITH_ADD || op > ARITH_DIV || argc < 0){
+    dfsch_error("Invalid arithmetic node in stream", (dfsch_object_t*)ds);
+  }
+
+  n = GC_MALLOC(sizeof(arith_node_t) + argc * sizeof(dfsch_object_t*));
+  n->type = &arith_node_type;
+  n->op = op;
+  n->argc = argc;
+  dfsch_deserializer_put_partial_object(ds, (dfsch_object_t*)n);
+
+  for (i = 0; i < argc; i++){
+    n->argv[i] = dfsch_deserialize_object(ds);
+  }
+
+  return (dfsch_object_t*)n;
+}
+
+typedef struct arith_value_t {
+  int unboxed;
+  double d;
+  dfsch_object_t* obj;
+} arith_value_t;
+
+static void arith_set(arith_value_t* v, dfsch_object_t* obj){
+  if (DFSCH_TYPE_OF(obj) == DFSCH_FLONUM_TYPE){
+    v->unboxed = 1;
+    v->d = ((flonum_t*)obj)->flonum;
+  } else {
+    v->unboxed = 0;
+    v->obj = obj;
+  }
+}
+
+static double arith_double(arith_value_t* v){
+  return v->unboxed ? v->d : dfsch_number_to_double(v->obj);
+}
+
+static void arith_combine(int op, arith_value_t* acc, arith_value_t* v){
+  double x;
+  double y;
+
+  if (!acc->unboxed && !v->unboxed){
+    switch (op){
+    case ARITH_ADD:
+      arith_set(acc, dfsch_number_add(acc->obj, v->obj));
+      break;
+    case ARITH_SUB:
+      arith_set(acc, dfsch_number_sub(acc->obj, v->obj));
+      break;
+    case ARITH_MUL:
+      arith_set(acc, dfsch_number_mul(acc->obj, v->obj));
+      break;
+    case ARITH_DIV:
+      arith_set(acc, dfsch_number_div(acc->obj, v->obj));
+      break;
+    }
+    return;
+  }
+
+  x = arith_double(acc);
+  y = arith_double(v);
+  acc->unboxed = 1;
+
+  switch (op){
+  case ARITH_ADD:
+    acc->d = x + y;
+    break;
+  case ARITH_SUB:
+    acc->d = x - y;
+    break;
+  case ARITH_MUL:
+    acc->d = x * y;
+    break;
+  case ARITH_DIV:
+    if (y == 0.0){
+      dfsch_error("Division by zero", NULL);
+    }
+    acc->d = x / y;
+    break;
+  }
+}
+
+static void arith_eval(dfsch_object_t* expr, dfsch_object_t* env,
+                       arith_value_t* acc){
+  arith_node_t* n;
+  arith_value_t v;
+  size_t i = 0;
+
+  if (DFSCH_TYPE_OF(expr) != &arith_node_type){
+    if (DFSCH_SYMBOL_P(expr) || DFSCH_PAIR_P(expr)){
+      expr = dfsch_eval(expr, env);
+    }
+    arith_set(acc, expr);
+    return;
+  }
+
+  n = (arith_node_t*)expr;
+  switch (n->op){
+  case ARITH_ADD:
+    arith_set(acc, DFSCH_MAKE_FIXNUM(0));
+    break;
+  case ARITH_MUL:
+    arith_set(acc, DFSCH_MAKE_FIXNUM(1));
+    break;
+  default:
+    arith_eval(n->argv[0], env, acc);
+    i = 1;
+    if (n->argc == 1){
+      if (n->op == ARITH_SUB){
+        if (acc->unboxed){
+          acc->d = -acc->d;
+        } else {
+          arith_set(acc, dfsch_number_neg(acc->obj));
+        }
+      } else {
+        v = *acc;
+        arith_set(acc, DFSCH_MAKE_FIXNUM(1));
+        arith_combine(ARITH_DIV, acc, &v);
+      }
+      return;
+    }
+  }
+
+  for (; i < n->argc; i++){
+    arith_eval(n->argv[i], env, &v);
+    arith_combine(n->op, acc, &v);
+  }
+}
+
+DFSCH_DEFINE_FORM(unboxed_arithmetic, {},
+                  "Evaluate fused arithmetic expression tree"){
+  dfsch_object_t* tree;
+  arith_value_t v;
+
+  DFSCH_OBJECT_ARG(args, tree);
+  DFSCH_ARG_END(args);
+
+  arith_eval(tree, env, &v);
+
+  if (v.unboxed){
+    return dfsch_make_number_from_double(v.d);
+  }
+  return v.obj;
+}
+
+static int arith_op(dfsch_object_t* proc){
+  if (proc == DFSCH_PRIMITIVE_REF(plus)){
+    return ARITH_ADD;
+  } else if (proc == DFSCH_PRIMITIVE_REF(minus)){
+    return ARITH_SUB;
+  } else if (proc == DFSCH_PRIMITIVE_REF(mult)){
+    return ARITH_MUL;
+  } else if (proc == DFSCH_PRIMITIVE_REF(slash)){
+    return ARITH_DIV;
+  }
+  return -1;
+}
+
+static dfsch_object_t* arith_tree(int op, dfsch_object_t* args);
+
+static dfsch_object_t* arith_absorb(dfsch_object_t* arg){
+  int op;
+
+  if (!DFSCH_PAIR_P(arg)){
+    return NULL;
+  }
+
+  if (DFSCH_FAST_CAR(arg) == DFSCH_FORM_REF(unboxed_arithmetic)){
+    return DFSCH_FAST_CAR(DFSCH_FAST_CDR(arg));
+  }
+
+  op = arith_op(DFSCH_FAST_CAR(arg));
+  if (op < 0){
+    return NULL;
+  }
+  return arith_tree(op, DFSCH_FAST_CDR(arg));
+}
+
+static dfsch_object_t* arith_tree(int op, dfsch_object_t* args){
+  size_t argc = dfsch_list_length_check(args);
+  arith_node_t* n;
+  dfsch_object_t* tree;
+  size_t i;
+
+  if (argc == 0 && (op == ARITH_SUB || op == ARITH_DIV)){
+    return NULL; /* leave arity error to primitive */
+  }
+
+  n = GC_MALLOC(sizeof(arith_node_t) + argc * sizeof(dfsch_object_t*));
+  n->type = &arith_node_type;
+  n->op = op;
+  n->argc = argc;
+
+  for (i = 0; i < argc; i++, args = DFSCH_FAST_CDR(args)){
+    tree = arith_absorb(DFSCH_FAST_CAR(args));
+    n->argv[i] = tree ? tree : DFSCH_FAST_CAR(args);
+  }
+
+  return (dfsch_object_t*)n;
+}
+
+dfsch_object_t* dfsch__compile_arithmetic(dfsch_object_t* operator,
+                                          dfsch_object_t* args,
+                                          dfsch_object_t* expression){
+  int op = arith_op(operator);
+  dfsch_object_t* i;
+  dfsch_object_t* tree;
+
+  if (op < 0){
+    return NULL;
+  }
+
+  /* Single operation gains nothing from fusion */
+  for (i = args; DFSCH_PAIR_P(i); i = DFSCH_FAST_CDR(i)){
+    if (arith_absorb(DFSCH_FAST_CAR(i))){
+      break;
+    }
+  }
+  if (!DFSCH_PAIR_P(i)){
+    return NULL;
+  }
+
+  tree = arith_tree(op, args);
+  if (!tree){
+    return NULL;
+  }
+
+  return dfsch_cons_ast_node(DFSCH_FORM_REF(unboxed_arithmetic),
+                             expression, 1, tree);
+}
+
 void dfsch__number_native_register(dfsch_object_t *ctx){
   dfsch_defcanon_cstr(ctx, "<number>", DFSCH_NUMBER_TYPE);
   dfsch_defcanon_cstr(ctx, "<real>", DFSCH_REAL_TYPE);
@@ -2158,6 +2435,9 @@ void dfsch__number_native_register(dfsch_object_t *ctx){
   dfsch_defcanon_cstr(ctx, "*", DFSCH_PRIMITIVE_REF(mult));
   dfsch_defcanon_cstr(ctx, "/", DFSCH_PRIMITIVE_REF(slash));
   dfsch_defcanon_cstr(ctx, "/i", DFSCH_PRIMITIVE_REF(slash_i));
+  dfsch_defcanon_pkgcstr(ctx, DFSCH_DFSCH_INTERNAL_PACKAGE,
+                         "%unboxed-arithmetic",
+                         DFSCH_FORM_REF(unboxed_arithmetic));
   dfsch_defcanon_cstr(ctx, "%", DFSCH_PRIMITIVE_REF(modulo));
   dfsch_defcanon_cstr(ctx, "=", DFSCH_PRIMITIVE_REF(number_equal));
   dfsch_defcanon_cstr(ctx, "<", DFSCH_PRIMITIVE_REF(lt));
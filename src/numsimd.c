@@ -0,0 +1,430 @@
+/*
+ * dfsch - dfox's quick and dirty scheme implementation
+ *   Vectorized numeric kernels
+ * Copyright (C) 2005-2014 Ales Hakl
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "numsimd.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+  && !defined(DFSCH_NO_SIMD)
+#define X86_SIMD
+#include <immintrin.h>
+#endif
+
+/*
+ * Portable implementation
+ */
+
+/* Lane i accumulates elements i, i + 8, i + 16, ... */
+#define LANES 8
+
+static double combine_lanes(double* a){
+  return ((a[0] + a[4]) + (a[2] + a[6])) + ((a[1] + a[5]) + (a[3] + a[7]));
+}
+
+static double f64_sum_c(double* x, size_t n){
+  double a[LANES] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  double s;
+  size_t i = 0;
+  int j;
+
+  for (; i + LANES <= n; i += LANES){
+    for (j = 0; j < LANES; j++){
+      a[j] += x[i + j];
+    }
+  }
+  s = combine_lanes(a);
+  for (; i < n; i++){
+    s += x[i];
+  }
+  return s;
+}
+
+static double f64_dot_c(double* x, double* y, size_t n){
+  double a[LANES] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  double s;
+  size_t i = 0;
+  int j;
+
+  for (; i + LANES <= n; i += LANES){
+    for (j = 0; j < LANES; j++){
+      a[j] += x[i + j] * y[i + j];
+    }
+  }
+  s = combine_lanes(a);
+  for (; i < n; i++){
+    s += x[i] * y[i];
+  }
+  return s;
+}
+
+static void f64_minmax_c(double* x, size_t n, double* min, double* max){
+  double lo = *min;
+  double hi = *max;
+  int nan = 0;
+  size_t i;
+
+  for (i = 0; i < n; i++){
+    double v = x[i];
+    nan |= (v != v);
+    if (v < lo){
+      lo = v;
+    }
+    if (v > hi){
+      hi = v;
+    }
+  }
+
+  if (nan){
+    lo = hi = NAN;
+  }
+  *min = lo;
+  *max = hi;
+}
+
+static void f64_axpy_c(double* r, double a, double* x, double* y, size_t n){
+  size_t i;
+
+  for (i = 0; i < n; i++){
+    r[i] = a * x[i] + y[i];
+  }
+}
+
+static uint64_t u8_sum_c(uint8_t* x, size_t n){
+  uint64_t s = 0;
+  size_t i;
+
+  for (i = 0; i < n; i++){
+    s += x[i];
+  }
+  return s;
+}
+
+#ifdef X86_SIMD
+
+/*
+ * SSE2
+ */
+
+__attribute__((target("sse2")))
+static double f64_sum_sse2(double* x, size_t n){
+  __m128d p0 = _mm_setzero_pd();
+  __m128d p1 = _mm_setzero_pd();
+  __m128d p2 = _mm_setzero_pd();
+  __m128d p3 = _mm_setzero_pd();
+  double a[LANES];
+  double s;
+  size_t i = 0;
+
+  for (; i + LANES <= n; i += LANES){
+    p0 = _mm_add_pd(p0, _mm_loadu_pd(x + i));
+    p1 = _mm_add_pd(p1, _mm_loadu_pd(x + i + 2));
+    p2 = _mm_add_pd(p2, _mm_loadu_pd(x + i + 4));
+    p3 = _mm_add_pd(p3, _mm_loadu_pd(x + i + 6));
+  }
+  _mm_storeu_pd(a, p0);
+  _mm_storeu_pd(a + 2, p1);
+  _mm_storeu_pd(a + 4, p2);
+  _mm_storeu_pd(a + 6, p3);
+  s = combine_lanes(a);
+  for (; i < n; i++){
+    s += x[i];
+  }
+  return s;
+}
+
+__attribute__((target("sse2")))
+static double f64_dot_sse2(double* x, double* y, size_t n){
+  __m128d p0 = _mm_setzero_pd();
+  __m128d p1 = _mm_setzero_pd();
+  __m128d p2 = _mm_setzero_pd();
+  __m128d p3 = _mm_setzero_pd();
+  double a[LANES];
+  double s;
+  size_t i = 0;
+
+  for (; i + LANES <= n; i += LANES){
+    p0 = _mm_add_pd(p0, _mm_mul_pd(_mm_loadu_pd(x + i),
+                                   _mm_loadu_pd(y + i)));
+    p1 = _mm_add_pd(p1, _mm_mul_pd(_mm_loadu_pd(x + i + 2),
+                                   _mm_loadu_pd(y + i + 2)));
+    p2 = _mm_add_pd(p2, _mm_mul_pd(_mm_loadu_pd(x + i + 4),
+                                   _mm_loadu_pd(y + i + 4)));
+    p3 = _mm_add_pd(p3, _mm_mul_pd(_mm_loadu_pd(x + i + 6),
+                                   _mm_loadu_pd(y + i + 6)));
+  }
+  _mm_storeu_pd(a, p0);
+  _mm_storeu_pd(a + 2, p1);
+  _mm_storeu_pd(a + 4, p2);
+  _mm_storeu_pd(a + 6, p3);
+  s = combine_lanes(a);
+  for (; i < n; i++){
+    s += x[i] * y[i];
+  }
+  return s;
+}
+
+__attribute__((target("sse2")))
+static void f64_minmax_sse2(double* x, size_t n, double* min, double* max){
+  __m128d lo = _mm_set1_pd(*min);
+  __m128d hi = _mm_set1_pd(*max);
+  __m128d nan = _mm_setzero_pd();
+  double l[2];
+  double h[2];
+  size_t i = 0;
+
+  for (; i + 2 <= n; i += 2){
+    __m128d v = _mm_loadu_pd(x + i);
+    nan = _mm_or_pd(nan, _mm_cmpunord_pd(v, v));
+    lo = _mm_min_pd(lo, v);
+    hi = _mm_max_pd(hi, v);
+  }
+  _mm_storeu_pd(l, lo);
+  _mm_storeu_pd(h, hi);
+  *min = l[0] < l[1] ? l[0] : l[1];
+  *max = h[0] > h[1] ? h[0] : h[1];
+  f64_minmax_c(x + i, n - i, min, max);
+  if (_mm_movemask_pd(nan)){
+    *min = *max = NAN;
+  }
+}
+
+__attribute__((target("sse2")))
+static void f64_axpy_sse2(double* r, double a, double* x, double* y,
+                          size_t n){
+  __m128d va = _mm_set1_pd(a);
+  size_t i = 0;
+
+  for (; i + 2 <= n; i += 2){
+    _mm_storeu_pd(r + i, _mm_add_pd(_mm_mul_pd(va, _mm_loadu_pd(x + i)),
+                                    _mm_loadu_pd(y + i)));
+  }
+  f64_axpy_c(r + i, a, x + i, y + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static uint64_t u8_sum_sse2(uint8_t* x, size_t n){
+  __m128i zero = _mm_setzero_si128();
+  __m128i acc = _mm_setzero_si128();
+  uint64_t s[2];
+  size_t i = 0;
+
+  for (; i + 16 <= n; i += 16){
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((__m128i*)(x + i)),
+                                          zero));
+  }
+  _mm_storeu_si128((__m128i*)s, acc);
+  return s[0] + s[1] + u8_sum_c(x + i, n - i);
+}
+
+/*
+ * AVX2
+ */
+
+__attribute__((target("avx2")))
+static double f64_sum_avx2(double* x, size_t n){
+  __m256d p0 = _mm256_setzero_pd();
+  __m256d p1 = _mm256_setzero_pd();
+  double a[LANES];
+  double s;
+  size_t i = 0;
+
+  for (; i + LANES <= n; i += LANES){
+    p0 = _mm256_add_pd(p0, _mm256_loadu_pd(x + i));
+    p1 = _mm256_add_pd(p1, _mm256_loadu_pd(x + i + 4));
+  }
+  _mm256_storeu_pd(a, p0);
+  _mm256_storeu_pd(a + 4, p1);
+  s = combine_lanes(a);
+  for (; i < n; i++){
+    s += x[i];
+  }
+  return s;
+}
+
+__attribute__((target("avx2")))
+static double f64_dot_avx2(double* x, double* y, size_t n){
+  __m256d p0 = _mm256_setzero_pd();
+  __m256d p1 = _mm256_setzero_pd();
+  double a[LANES];
+  double s;
+  size_t i = 0;
+
+  /* no FMA, products are rounded in same way as in other versions */
+  for (; i + LANES <= n; i += LANES){
+    p0 = _mm256_add_pd(p0, _mm256_mul_pd(_mm256_loadu_pd(x + i),
+                                         _mm256_loadu_pd(y + i)));
+    p1 = _mm256_add_pd(p1, _mm256_mul_pd(_mm256_loadu_pd(x + i + 4),
+                                         _mm256_loadu_pd(y + i + 4)));
+  }
+  _mm256_storeu_pd(a, p0);
+  _mm256_storeu_pd(a + 4, p1);
+  s = combine_lanes(a);
+  for (; i < n; i++){
+    s += x[i] * y[i];
+  }
+  return s;
+}
+
+__attribute__((target("avx2")))
+static void f64_minmax_avx2(double* x, size_t n, double* min, double* max){
+  __m256d lo = _mm256_set1_pd(*min);
+  __m256d hi = _mm256_set1_pd(*max);
+  __m256d nan = _mm256_setzero_pd();
+  double l[4];
+  double h[4];
+  size_t i = 0;
+  int j;
+
+  for (; i + 4 <= n; i += 4){
+    __m256d v = _mm256_loadu_pd(x + i);
+    nan = _mm256_or_pd(nan, _mm256_cmp_pd(v, v, _CMP_UNORD_Q));
+    lo = _mm256_min_pd(lo, v);
+    hi = _mm256_max_pd(hi, v);
+  }
+  _mm256_storeu_pd(l, lo);
+  _mm256_storeu_pd(h, hi);
+  for (j = 0; j < 4; j++){
+    if (l[j] < *min){
+      *min = l[j];
+    }
+    if (h[j] > *max){
+      *max = h[j];
+    }
+  }
+  f64_minmax_sse2(x + i, n - i, min, max);
+  if (_mm256_movemask_pd(nan)){
+    *min = *max = NAN;
+  }
+}
+
+__attribute__((target("avx2")))
+static void f64_axpy_avx2(double* r, double a, double* x, double* y,
+                          size_t n){
+  __m256d va = _mm256_set1_pd(a);
+  size_t i = 0;
+
+  for (; i + 4 <= n; i += 4){
+    _mm256_storeu_pd(r + i,
+                     _mm256_add_pd(_mm256_mul_pd(va, _mm256_loadu_pd(x + i)),
+                                   _mm256_loadu_pd(y + i)));
+  }
+  f64_axpy_sse2(r + i, a, x + i, y + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static uint64_t u8_sum_avx2(uint8_t* x, size_t n){
+  __m256i zero = _mm256_setzero_si256();
+  __m256i acc = _mm256_setzero_si256();
+  uint64_t s[4];
+  size_t i = 0;
+
+  for (; i + 32 <= n; i += 32){
+    acc = _mm256_add_epi64(acc,
+                           _mm256_sad_epu8(_mm256_loadu_si256((__m256i*)
+                                                              (x + i)),
+                                           zero));
+  }
+  _mm256_storeu_si256((__m256i*)s, acc);
+  return s[0] + s[1] + s[2] + s[3] + u8_sum_sse2(x + i, n - i);
+}
+
+#endif
+
+/*
+ * Dispatch
+ */
+
+typedef struct kernels_t {
+  char* name;
+  double (*f64_sum)(double* x, size_t n);
+  double (*f64_dot)(double* x, double* y, size_t n);
+  void (*f64_minmax)(double* x, size_t n, double* min, double* max);
+  void (*f64_axpy)(double* r, double a, double* x, double* y, size_t n);
+  uint64_t (*u8_sum)(uint8_t* x, size_t n);
+} kernels_t;
+
+static kernels_t kernels_c = {
+  "none", f64_sum_c, f64_dot_c, f64_minmax_c, f64_axpy_c, u8_sum_c
+};
+#ifdef X86_SIMD
+static kernels_t kernels_sse2 = {
+  "sse2", f64_sum_sse2, f64_dot_sse2, f64_minmax_sse2, f64_axpy_sse2,
+  u8_sum_sse2
+};
+static kernels_t kernels_avx2 = {
+  "avx2", f64_sum_avx2, f64_dot_avx2, f64_minmax_avx2, f64_axpy_avx2,
+  u8_sum_avx2
+};
+#endif
+
+static kernels_t* kernels = NULL;
+
+static kernels_t* select_kernels(){
+  kernels_t* k = &kernels_c;
+#ifdef X86_SIMD
+  char* limit = getenv("DFSCH_SIMD");
+
+  __builtin_cpu_init();
+  if (limit && strcmp(limit, "none") == 0){
+    k = &kernels_c;
+  } else if (__builtin_cpu_supports("avx2") &&
+             !(limit && strcmp(limit, "sse2") == 0)){
+    k = &kernels_avx2;
+  } else if (__builtin_cpu_supports("sse2")){
+    k = &kernels_sse2;
+  }
+#endif
+  kernels = k; /* every thread selects the same thing */
+  return k;
+}
+
+static kernels_t* get_kernels(){
+  kernels_t* k = kernels;
+  if (!k){
+    k = select_kernels();
+  }
+  return k;
+}
+
+char* dfsch__numsimd_implementation(){
+  return get_kernels()->name;
+}
+
+double dfsch__f64_sum(double* x, size_t n){
+  return get_kernels()->f64_sum(x, n);
+}
+double dfsch__f64_dot(double* x, double* y, size_t n){
+  return get_kernels()->f64_dot(x, y, n);
+}
+void dfsch__f64_minmax(double* x, size_t n, double* min, double* max){
+  *min = *max = x[0];
+  get_kernels()->f64_minmax(x, n, min, max);
+}
+void dfsch__f64_axpy(double* r, double a, double* x, double* y, size_t n){
+  get_kernels()->f64_axpy(r, a, x, y, n);
+}
+uint64_t dfsch__u8_sum(uint8_t* x, size_t n){
+  return get_kernels()->u8_sum(x, n);
+}
@@ -0,0 +1,51 @@
+/*
+ * dfsch - dfox's quick and dirty scheme implementation
+ *   Vectorized numeric kernels
+ * Copyright (C) 2005-2014 Ales Hakl
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef H__dfsch___numsimd__
+#define H__dfsch___numsimd__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Bulk kernels used by numeric vector primitives. Implementation is
+ * selected on first use in same way as for string kernels (see
+ * strsimd.h), DFSCH_SIMD environment variable applies to both.
+ *
+ * Sums are accumulated in eight interleaved lanes that are combined in
+ * fixed order, so all implementations produce identical results.
+ */
+
+/** Sum of n doubles */
+double dfsch__f64_sum(double* x, size_t n);
+/** Dot product of two vectors of n doubles */
+double dfsch__f64_dot(double* x, double* y, size_t n);
+/** Smallest and largest of n > 0 doubles, both are NaN when any element
+    is NaN */
+void dfsch__f64_minmax(double* x, size_t n, double* min, double* max);
+/** r[i] = a * x[i] + y[i] */
+void dfsch__f64_axpy(double* r, double a, double* x, double* y, size_t n);
+/** Sum of n bytes */
+uint64_t dfsch__u8_sum(uint8_t* x, size_t n);
+/** Name of selected implementation */
+char* dfsch__numsimd_implementation();
+
+#endif
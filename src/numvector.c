@@ -0,0 +1,1008 @@
+/*
+ * dfsch - dfox's quick and dirty scheme implementation
+ *   Homogeneous numeric vectors
+ * Copyright (C) 2005-2014 Ales Hakl
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "dfsch/numvector.h"
+#include <dfsch/number.h>
+#include <dfsch/serdes.h>
+#include "internal.h"
+#include "util.h"
+#include "numsimd.h"
+
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * Elements are stored unboxed directly after header, storage is declared
+ * as 64bit words so that it is suitably aligned for all element types.
+ */
+
+typedef struct numvector_t {
+  dfsch_type_t* type;
+  size_t length;
+  uint64_t data[];
+} numvector_t;
+
+#define F64(nv) ((double*)(nv)->data)
+#define S64(nv) ((int64_t*)(nv)->data)
+#define U8(nv) ((uint8_t*)(nv)->data)
+
+static size_t element_size(dfsch_type_t* type){
+  if (type == DFSCH_U8VECTOR_TYPE){
+    return 1;
+  } else {
+    return 8;
+  }
+}
+
+static numvector_t* alloc_numvector(dfsch_type_t* type, size_t length){
+  numvector_t* nv = GC_MALLOC_ATOMIC(sizeof(numvector_t) +
+                                     length * element_size(type));
+  nv->type = type;
+  nv->length = length;
+  return nv;
+}
+
+static numvector_t* assert_numvector(dfsch_object_t* obj){
+  return DFSCH_ASSERT_INSTANCE(obj, DFSCH_NUMERIC_VECTOR_TYPE);
+}
+
+static uint8_t number_to_u8(dfsch_object_t* n){
+  long l = dfsch_number_to_long(n);
+  if (l < 0 || l > 255){
+    dfsch_error("Value out of range", n);
+  }
+  return l;
+}
+
+static dfsch_object_t* nv_ref(numvector_t* nv, size_t k){
+  k = DFSCH_ASSERT_SEQUENCE_INDEX(nv, k, nv->length);
+  if (nv->type == DFSCH_F64VECTOR_TYPE){
+    return dfsch_make_number_from_double(F64(nv)[k]);
+  } else if (nv->type == DFSCH_S64VECTOR_TYPE){
+    return dfsch_make_number_from_int64(S64(nv)[k]);
+  } else {
+    return DFSCH_MAKE_FIXNUM(U8(nv)[k]);
+  }
+}
+static void nv_set(numvector_t* nv, size_t k, dfsch_object_t* v){
+  k = DFSCH_ASSERT_SEQUENCE_INDEX(nv, k, nv->length);
+  if (nv->type == DFSCH_F64VECTOR_TYPE){
+    F64(nv)[k] = dfsch_number_to_double(v);
+  } else if (nv->type == DFSCH_S64VECTOR_TYPE){
+    S64(nv)[k] = dfsch_number_to_int64(v);
+  } else {
+    U8(nv)[k] = number_to_u8(v);
+  }
+}
+static size_t nv_length(numvector_t* nv){
+  return nv->length;
+}
+
+static dfsch_object_t* nv_get_iterator(numvector_t* nv){
+  dfsch_list_collector_t* lc = dfsch_make_list_collector();
+  size_t i;
+
+  for (i = 0; i < nv->length; i++){
+    dfsch_list_collect(lc, nv_ref(nv, i));
+  }
+
+  return dfsch_collected_list(lc);
+}
+
+static void nv_write(numvector_t* nv, dfsch_writer_state_t* state){
+  size_t i;
+
+  dfsch_write_unreadable_start(state, (dfsch_object_t*)nv);
+  for (i = 0; i < nv->length; i++){
+    if (i != 0){
+      dfsch_write_string(state, " ");
+    }
+    dfsch_write_object(state, nv_ref(nv, i));
+  }
+  dfsch_write_unreadable_end(state);
+}
+
+static int nv_equal_p(numvector_t* a, numvector_t* b){
+  size_t i;
+
+  if (a->length != b->length){
+    return 0;
+  }
+
+  if (a->type == DFSCH_F64VECTOR_TYPE){
+    for (i = 0; i < a->length; i++){
+      if (F64(a)[i] != F64(b)[i]){
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  return memcmp(a->data, b->data, a->length * element_size(a->type)) == 0;
+}
+
+static uint32_t nv_hash(numvector_t* nv){
+  uint32_t h = nv->length ^ 0xa5a5a5a5;
+  size_t i;
+
+  for (i = 0; i < nv->length; i++){
+    uint64_t w;
+    if (nv->type == DFSCH_F64VECTOR_TYPE){
+      double d = F64(nv)[i];
+      if (d == 0.0){ /* -0.0 is equal to 0.0 */
+        d = 0.0;
+      }
+      memcpy(&w, &d, sizeof(w));
+    } else if (nv->type == DFSCH_S64VECTOR_TYPE){
+      w = S64(nv)[i];
+    } else {
+      w = U8(nv)[i];
+    }
+    h = (h << 7) + (h >> 25) + (uint32_t)w + (uint32_t)(w >> 32);
+  }
+
+  return h;
+}
+
+static void nv_serialize(numvector_t* nv, dfsch_serializer_t* s){
+  size_t i;
+
+  if (nv->type == DFSCH_U8VECTOR_TYPE){
+    dfsch_serialize_stream_symbol(s, "u8vector");
+    dfsch_serialize_string(s, (char*)nv->data, nv->length);
+    return;
+  }
+
+  if (nv->type == DFSCH_F64VECTOR_TYPE){
+    dfsch_serialize_stream_symbol(s, "f64vector");
+  } else {
+    dfsch_serialize_stream_symbol(s, "s64vector");
+  }
+  dfsch_serialize_integer(s, nv->length);
+  for (i = 0; i < nv->length; i++){
+    dfsch_serialize_integer(s, (int64_t)nv->data[i]);
+  }
+}
+
+static dfsch_object_t* deserialize_words(dfsch_deserializer_t* ds,
+                                         dfsch_type_t* type){
+  size_t length = dfsch_deserialize_integer(ds);
+  numvector_t* nv = alloc_numvector(type, length);
+  size_t i;
+
+  for (i = 0; i < length; i++){
+    nv->data[i] = (uint64_t)dfsch_deserialize_integer(ds);
+  }
+
+  dfsch_deserializer_put_partial_object(ds, (dfsch_object_t*)nv);
+  return (dfsch_object_t*)nv;
+}
+DFSCH_DEFINE_DESERIALIZATION_HANDLER("f64vector", f64vector){
+  return deserialize_words(ds, DFSCH_F64VECTOR_TYPE);
+}
+DFSCH_DEFINE_DESERIALIZATION_HANDLER("s64vector", s64vector){
+  return deserialize_words(ds, DFSCH_S64VECTOR_TYPE);
+}
+DFSCH_DEFINE_DESERIALIZATION_HANDLER("u8vector", u8vector){
+  dfsch_strbuf_t* sb = dfsch_deserialize_strbuf(ds);
+  numvector_t* nv = alloc_numvector(DFSCH_U8VECTOR_TYPE, sb->len);
+  memcpy(nv->data, sb->ptr, sb->len);
+  dfsch_deserializer_put_partial_object(ds, (dfsch_object_t*)nv);
+  return (dfsch_object_t*)nv;
+}
+
+static dfsch_collection_methods_t nv_collection = {
+  .get_iterator = (dfsch_collection_get_iterator_t)nv_get_iterator,
+};
+
+static dfsch_sequence_methods_t nv_sequence = {
+  .ref = (dfsch_sequence_ref_t)nv_ref,
+  .set = (dfsch_sequence_set_t)nv_set,
+  .length = (dfsch_sequence_length_t)nv_length,
+};
+
+dfsch_type_t dfsch_numeric_vector_type = {
+  .type = DFSCH_ABSTRACT_TYPE,
+  .superclass = NULL,
+  .name = "numeric-vector",
+  .size = 0,
+};
+
+#define NUMVECTOR_TYPE(cname, sname)                                    \
+  dfsch_type_t cname = {                                                \
+    .type = DFSCH_STANDARD_TYPE,                                        \
+    .superclass = DFSCH_NUMERIC_VECTOR_TYPE,                            \
+    .name = sname,                                                      \
+    .size = sizeof(numvector_t),                                        \
+    .equal_p = (dfsch_type_equal_p_t)nv_equal_p,                        \
+    .write = (dfsch_type_write_t)nv_write,                              \
+    .hash = (dfsch_type_hash_t)nv_hash,                                 \
+    .collection = &nv_collection,                                       \
+    .sequence = &nv_sequence,                                           \
+    .serialize = (dfsch_type_serialize_t)nv_serialize,                  \
+  }
+
+NUMVECTOR_TYPE(dfsch_f64vector_type, "f64vector");
+NUMVECTOR_TYPE(dfsch_s64vector_type, "s64vector");
+NUMVECTOR_TYPE(dfsch_u8vector_type, "u8vector");
+
+dfsch_object_t* dfsch_make_numeric_vector(dfsch_type_t* type,
+                                          size_t length){
+  numvector_t* nv;
+
+  if (type != DFSCH_F64VECTOR_TYPE && type != DFSCH_S64VECTOR_TYPE &&
+      type != DFSCH_U8VECTOR_TYPE){
+    dfsch_error("Not a numeric vector type", (dfsch_object_t*)type);
+  }
+
+  nv = alloc_numvector(type, length);
+  memset(nv->data, 0, length * element_size(type));
+  return (dfsch_object_t*)nv;
+}
+dfsch_object_t* dfsch_list_2_numeric_vector(dfsch_type_t* type,
+                                            dfsch_object_t* list){
+  size_t length = dfsch_list_length_check(list);
+  numvector_t* nv =
+    (numvector_t*)dfsch_make_numeric_vector(type, length);
+  dfsch_object_t* i = list;
+  size_t j;
+
+  for (j = 0; j < length; j++, i = DFSCH_FAST_CDR(i)){
+    nv_set(nv, j, DFSCH_FAST_CAR(i));
+  }
+
+  return (dfsch_object_t*)nv;
+}
+size_t dfsch_numeric_vector_length(dfsch_object_t* nv){
+  return assert_numvector(nv)->length;
+}
+
+double* dfsch_f64vector_data(dfsch_object_t* obj, size_t* len){
+  numvector_t* nv = DFSCH_ASSERT_TYPE(obj, DFSCH_F64VECTOR_TYPE);
+  if (len){
+    *len = nv->length;
+  }
+  return F64(nv);
+}
+int64_t* dfsch_s64vector_data(dfsch_object_t* obj, size_t* len){
+  numvector_t* nv = DFSCH_ASSERT_TYPE(obj, DFSCH_S64VECTOR_TYPE);
+  if (len){
+    *len = nv->length;
+  }
+  return S64(nv);
+}
+uint8_t* dfsch_u8vector_data(dfsch_object_t* obj, size_t* len){
+  numvector_t* nv = DFSCH_ASSERT_TYPE(obj, DFSCH_U8VECTOR_TYPE);
+  if (len){
+    *len = nv->length;
+  }
+  return U8(nv);
+}
+
+/*
+ * Element-wise arithmetic
+ *
+ * f64vectors follow IEEE semantics (division by zero produces infinity or
+ * NaN), integer vectors are computed modulo 2^64 or 2^8 respectively and
+ * division by zero is signalled as error.
+ */
+
+#define OP_ADD 0
+#define OP_SUB 1
+#define OP_MUL 2
+#define OP_DIV 3
+
+#define ELEMENTWISE(r, x, y, n, OP, Y)          \
+  for (i = 0; i < (n); i++){                    \
+    (r)[i] = (x)[i] OP (Y);                     \
+  }
+
+#define ELEMENTWISE_OPS(r, x, y, n, Y)                  \
+  switch (op){                                          \
+  case OP_ADD: ELEMENTWISE(r, x, y, n, +, Y); break;    \
+  case OP_SUB: ELEMENTWISE(r, x, y, n, -, Y); break;    \
+  case OP_MUL: ELEMENTWISE(r, x, y, n, *, Y); break;    \
+  case OP_DIV: ELEMENTWISE(r, x, y, n, /, Y); break;    \
+  }
+
+static void f64_arith(int op, double* r, double* x, double* y,
+                      double s, size_t n){
+  size_t i;
+  if (y){
+    ELEMENTWISE_OPS(r, x, y, n, y[i]);
+  } else {
+    ELEMENTWISE_OPS(r, x, y, n, s);
+  }
+}
+
+static int64_t s64_op(int op, int64_t a, int64_t b){
+  switch (op){
+  case OP_ADD:
+    return (int64_t)((uint64_t)a + (uint64_t)b);
+  case OP_SUB:
+    return (int64_t)((uint64_t)a - (uint64_t)b);
+  case OP_MUL:
+    return (int64_t)((uint64_t)a * (uint64_t)b);
+  default:
+    if (b == 0){
+      dfsch_error("Division by zero", NULL);
+    }
+    if (b == -1){ /* INT64_MIN / -1 overflows */
+      return (int64_t)(0 - (uint64_t)a);
+    }
+    return a / b;
+  }
+}
+static void s64_arith(int op, int64_t* r, int64_t* x, int64_t* y,
+                      int64_t s, size_t n){
+  size_t i;
+
+  if (op == OP_ADD || op == OP_SUB || op == OP_MUL){
+    uint64_t* ur = (uint64_t*)r;
+    uint64_t* ux = (uint64_t*)x;
+    uint64_t* uy = (uint64_t*)y;
+    uint64_t us = (uint64_t)s;
+    if (y){
+      ELEMENTWISE_OPS(ur, ux, uy, n, uy[i]);
+    } else {
+      ELEMENTWISE_OPS(ur, ux, uy, n, us);
+    }
+    return;
+  }
+
+  for (i = 0; i < n; i++){
+    r[i] = s64_op(op, x[i], y ? y[i] : s);
+  }
+}
+
+static void u8_arith(int op, uint8_t* r, uint8_t* x, uint8_t* y,
+                     uint8_t s, size_t n){
+  size_t i;
+
+  if (op == OP_DIV){
+    if (y){
+      for (i = 0; i < n; i++){
+        if (y[i] == 0){
+          dfsch_error("Division by zero", NULL);
+        }
+      }
+    } else if (s == 0){
+      dfsch_error("Division by zero", NULL);
+    }
+  }
+
+  if (y){
+    ELEMENTWISE_OPS(r, x, y, n, y[i]);
+  } else {
+    ELEMENTWISE_OPS(r, x, y, n, s);
+  }
+}
+
+static dfsch_object_t* nv_arith(int op,
+                                dfsch_object_t* a,
+                                dfsch_object_t* b){
+  numvector_t* x = assert_numvector(a);
+  numvector_t* y = NULL;
+  numvector_t* r;
+
+  if (DFSCH_TYPE_OF(b) == x->type){
+    y = (numvector_t*)b;
+    if (y->length != x->length){
+      dfsch_error("Vector lengths differ", dfsch_list(2, a, b));
+    }
+  }
+
+  r = alloc_numvector(x->type, x->length);
+
+  if (x->type == DFSCH_F64VECTOR_TYPE){
+    f64_arith(op, F64(r), F64(x), y ? F64(y) : NULL,
+              y ? 0.0 : dfsch_number_to_double(b), x->length);
+  } else if (x->type == DFSCH_S64VECTOR_TYPE){
+    s64_arith(op, S64(r), S64(x), y ? S64(y) : NULL,
+              y ? 0 : dfsch_number_to_int64(b), x->length);
+  } else {
+    u8_arith(op, U8(r), U8(x), y ? U8(y) : NULL,
+             y ? 0 : number_to_u8(b), x->length);
+  }
+
+  return (dfsch_object_t*)r;
+}
+
+dfsch_object_t* dfsch_numeric_vector_add(dfsch_object_t* a,
+                                         dfsch_object_t* b){
+  return nv_arith(OP_ADD, a, b);
+}
+dfsch_object_t* dfsch_numeric_vector_sub(dfsch_object_t* a,
+                                         dfsch_object_t* b){
+  return nv_arith(OP_SUB, a, b);
+}
+dfsch_object_t* dfsch_numeric_vector_mul(dfsch_object_t* a,
+                                         dfsch_object_t* b){
+  return nv_arith(OP_MUL, a, b);
+}
+dfsch_object_t* dfsch_numeric_vector_div(dfsch_object_t* a,
+                                         dfsch_object_t* b){
+  return nv_arith(OP_DIV, a, b);
+}
+
+/*
+ * Reductions
+ */
+
+/* Exact 64bit accumulator, spills into generic number on overflow */
+typedef struct s64_acc_t {
+  int64_t acc;
+  dfsch_object_t* spill;
+} s64_acc_t;
+
+static void s64_acc_add(s64_acc_t* a, int64_t v){
+  if ((v > 0 && a->acc > INT64_MAX - v) ||
+      (v < 0 && a->acc < INT64_MIN - v)){
+    a->spill = dfsch_number_add(a->spill,
+                                dfsch_make_number_from_int64(a->acc));
+    a->acc = 0;
+  }
+  a->acc += v;
+}
+static void s64_acc_add_product(s64_acc_t* a, int64_t x, int64_t y){
+  int64_t p;
+
+  if (x == 0 || y == 0){
+    return;
+  }
+  p = (int64_t)((uint64_t)x * (uint64_t)y);
+  if ((x == -1 && y == INT64_MIN) || (y == -1 && x == INT64_MIN) ||
+      p / y != x){
+    a->spill = dfsch_number_add(a->spill,
+                                dfsch_number_mul
+                                (dfsch_make_number_from_int64(x),
+                                 dfsch_make_number_from_int64(y)));
+    return;
+  }
+  s64_acc_add(a, p);
+}
+static dfsch_object_t* s64_acc_value(s64_acc_t* a){
+  return dfsch_number_add(a->spill, dfsch_make_number_from_int64(a->acc));
+}
+
+dfsch_object_t* dfsch_numeric_vector_sum(dfsch_object_t* obj){
+  numvector_t* nv = assert_numvector(obj);
+  size_t i;
+
+  if (nv->type == DFSCH_F64VECTOR_TYPE){
+    return dfsch_make_number_from_double(dfsch__f64_sum(F64(nv), nv->length));
+  } else if (nv->type == DFSCH_S64VECTOR_TYPE){
+    s64_acc_t a = {0, DFSCH_MAKE_FIXNUM(0)};
+    for (i = 0; i < nv->length; i++){
+      s64_acc_add(&a, S64(nv)[i]);
+    }
+    return s64_acc_value(&a);
+  } else {
+    return dfsch_make_number_from_uint64(dfsch__u8_sum(U8(nv), nv->length));
+  }
+}
+
+static dfsch_object_t* nv_extreme(dfsch_object_t* obj, int max){
+  numvector_t* nv = assert_numvector(obj);
+  size_t i;
+  size_t best = 0;
+
+  if (nv->length == 0){
+    dfsch_error("Vector is empty", obj);
+  }
+
+  if (nv->type == DFSCH_F64VECTOR_TYPE){
+    double lo;
+    double hi;
+    dfsch__f64_minmax(F64(nv), nv->length, &lo, &hi);
+    return dfsch_make_number_from_double(max ? hi : lo);
+  }
+
+  for (i = 1; i < nv->length; i++){
+    int better;
+    if (nv->type == DFSCH_S64VECTOR_TYPE){
+      better = max ? S64(nv)[i] > S64(nv)[best] : S64(nv)[i] < S64(nv)[best];
+    } else {
+      better = max ? U8(nv)[i] > U8(nv)[best] : U8(nv)[i] < U8(nv)[best];
+    }
+    if (better){
+      best = i;
+    }
+  }
+
+  return nv_ref(nv, best);
+}
+
+dfsch_object_t* dfsch_numeric_vector_min(dfsch_object_t* nv){
+  return nv_extreme(nv, 0);
+}
+dfsch_object_t* dfsch_numeric_vector_max(dfsch_object_t* nv){
+  return nv_extreme(nv, 1);
+}
+
+dfsch_object_t* dfsch_numeric_vector_dot(dfsch_object_t* a,
+                                         dfsch_object_t* b){
+  numvector_t* x = assert_numvector(a);
+  numvector_t* y = DFSCH_ASSERT_TYPE(b, x->type);
+  size_t i;
+
+  if (x->length != y->length){
+    dfsch_error("Vector lengths differ", dfsch_list(2, a, b));
+  }
+
+  if (x->type == DFSCH_F64VECTOR_TYPE){
+    return dfsch_make_number_from_double(dfsch__f64_dot(F64(x), F64(y),
+                                                        x->length));
+  } else if (x->type == DFSCH_S64VECTOR_TYPE){
+    s64_acc_t acc = {0, DFSCH_MAKE_FIXNUM(0)};
+    for (i = 0; i < x->length; i++){
+      s64_acc_add_product(&acc, S64(x)[i], S64(y)[i]);
+    }
+    return s64_acc_value(&acc);
+  } else {
+    uint64_t s = 0;
+    for (i = 0; i < x->length; i++){
+      s += (uint32_t)U8(x)[i] * U8(y)[i];
+    }
+    return dfsch_make_number_from_uint64(s);
+  }
+}
+
+dfsch_object_t* dfsch_numeric_vector_prefix_sum(dfsch_object_t* obj){
+  numvector_t* nv = assert_numvector(obj);
+  numvector_t* r;
+  size_t i;
+
+  if (nv->type == DFSCH_F64VECTOR_TYPE){
+    double s = 0.0;
+    r = alloc_numvector(DFSCH_F64VECTOR_TYPE, nv->length);
+    for (i = 0; i < nv->length; i++){
+      s += F64(nv)[i];
+      F64(r)[i] = s;
+    }
+  } else {
+    /* prefix sums of bytes do not fit into bytes */
+    uint64_t s = 0;
+    r = alloc_numvector(DFSCH_S64VECTOR_TYPE, nv->length);
+    for (i = 0; i < nv->length; i++){
+      s += nv->type == DFSCH_S64VECTOR_TYPE ? (uint64_t)S64(nv)[i] : U8(nv)[i];
+      S64(r)[i] = (int64_t)s;
+    }
+  }
+
+  return (dfsch_object_t*)r;
+}
+
+dfsch_object_t* dfsch_numeric_vector_axpy(dfsch_object_t* a,
+                                          dfsch_object_t* xv,
+                                          dfsch_object_t* yv){
+  numvector_t* x = assert_numvector(xv);
+  numvector_t* y = DFSCH_ASSERT_TYPE(yv, x->type);
+  numvector_t* r;
+  size_t i;
+
+  if (x->length != y->length){
+    dfsch_error("Vector lengths differ", dfsch_list(2, xv, yv));
+  }
+
+  r = alloc_numvector(x->type, x->length);
+
+  if (x->type == DFSCH_F64VECTOR_TYPE){
+    dfsch__f64_axpy(F64(r), dfsch_number_to_double(a), F64(x), F64(y),
+                    x->length);
+  } else if (x->type == DFSCH_S64VECTOR_TYPE){
+    uint64_t s = (uint64_t)dfsch_number_to_int64(a);
+    for (i = 0; i < x->length; i++){
+      S64(r)[i] = (int64_t)(s * (uint64_t)S64(x)[i] + (uint64_t)S64(y)[i]);
+    }
+  } else {
+    uint8_t s = number_to_u8(a);
+    for (i = 0; i < x->length; i++){
+      U8(r)[i] = s * U8(x)[i] + U8(y)[i];
+    }
+  }
+
+  return (dfsch_object_t*)r;
+}
+
+/*
+ * Sorting
+ *
+ * 64bit elements are mapped to unsigned keys that sort in same order and
+ * sorted by LSD radix sort, bytes are sorted by counting. Negative zero
+ * sorts before positive one and NaNs go to the end (or to the beginning
+ * when their sign bit is set).
+ */
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+static uint64_t f64_key(uint64_t b){
+  return (b >> 63) ? ~b : b | ((uint64_t)1 << 63);
+}
+static uint64_t f64_unkey(uint64_t k){
+  return (k >> 63) ? k & ~((uint64_t)1 << 63) : ~k;
+}
+
+static void insertion_sort_keys(uint64_t* k, size_t n){
+  size_t i;
+  size_t j;
+
+  for (i = 1; i < n; i++){
+    uint64_t v = k[i];
+    for (j = i; j > 0 && k[j - 1] > v; j--){
+      k[j] = k[j - 1];
+    }
+    k[j] = v;
+  }
+}
+
+static void radix_sort_keys(uint64_t* k, size_t n){
+  size_t (*counts)[RADIX_SIZE];
+  uint64_t* tmp;
+  uint64_t* src = k;
+  uint64_t* dst;
+  size_t i;
+  int p;
+
+  if (n < 64){
+    insertion_sort_keys(k, n);
+    return;
+  }
+
+  counts = GC_MALLOC_ATOMIC(sizeof(size_t) * RADIX_SIZE * RADIX_PASSES);
+  memset(counts, 0, sizeof(size_t) * RADIX_SIZE * RADIX_PASSES);
+  for (i = 0; i < n; i++){
+    for (p = 0; p < RADIX_PASSES; p++){
+      counts[p][(k[i] >> (p * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+    }
+  }
+
+  tmp = GC_MALLOC_ATOMIC(sizeof(uint64_t) * n);
+  dst = tmp;
+
+  for (p = 0; p < RADIX_PASSES; p++){
+    size_t sum = 0;
+    size_t c;
+    int shift = p * RADIX_BITS;
+
+    if (counts[p][(k[0] >> shift) & (RADIX_SIZE - 1)] == n){
+      continue; /* all keys share this digit */
+    }
+
+    for (i = 0; i < RADIX_SIZE; i++){
+      c = counts[p][i];
+      counts[p][i] = sum;
+      sum += c;
+    }
+    for (i = 0; i < n; i++){
+      dst[counts[p][(src[i] >> shift) & (RADIX_SIZE - 1)]++] = src[i];
+    }
+
+    dst = src;
+    src = (src == k) ? tmp : k;
+  }
+
+  if (src != k){
+    memcpy(k, src, sizeof(uint64_t) * n);
+  }
+}
+
+dfsch_object_t* dfsch_numeric_vector_sort(dfsch_object_t* obj){
+  numvector_t* nv = assert_numvector(obj);
+  size_t n = nv->length;
+  size_t i;
+
+  if (nv->type == DFSCH_U8VECTOR_TYPE){
+    size_t counts[256];
+    size_t j = 0;
+    int v;
+
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i < n; i++){
+      counts[U8(nv)[i]]++;
+    }
+    for (v = 0; v < 256; v++){
+      memset(U8(nv) + j, v, counts[v]);
+      j += counts[v];
+    }
+  } else if (nv->type == DFSCH_S64VECTOR_TYPE){
+    for (i = 0; i < n; i++){
+      nv->data[i] ^= (uint64_t)1 << 63;
+    }
+    radix_sort_keys(nv->data, n);
+    for (i = 0; i < n; i++){
+      nv->data[i] ^= (uint64_t)1 << 63;
+    }
+  } else {
+    for (i = 0; i < n; i++){
+      nv->data[i] = f64_key(nv->data[i]);
+    }
+    radix_sort_keys(nv->data, n);
+    for (i = 0; i < n; i++){
+      nv->data[i] = f64_unkey(nv->data[i]);
+    }
+  }
+
+  return obj;
+}
+
+/*
+ * Histogram
+ *
+ * Range [lo, hi] is split into equal bins, hi itself falls into last bin
+ * and values outside of range (and NaNs) are not counted. Byte vectors
+ * are counted into four interleaved tables, so runs of equal values do
+ * not serialize on one counter.
+ */
+
+#define NO_BIN ((size_t)-1)
+
+static size_t bin_index(double x, double lo, double scale, size_t bins){
+  size_t k = (size_t)((x - lo) * scale);
+  return k < bins ? k : bins - 1;
+}
+
+dfsch_object_t* dfsch_numeric_vector_histogram(dfsch_object_t* obj,
+                                               size_t bins,
+                                               double lo, double hi){
+  numvector_t* nv = assert_numvector(obj);
+  numvector_t* r;
+  double scale;
+  size_t i;
+
+  if (bins == 0 || !(hi > lo)){
+    dfsch_error("Invalid histogram range",
+                dfsch_list(3,
+                           dfsch_make_number_from_long(bins),
+                           dfsch_make_number_from_double(lo),
+                           dfsch_make_number_from_double(hi)));
+  }
+
+  r = (numvector_t*)dfsch_make_numeric_vector(DFSCH_S64VECTOR_TYPE, bins);
+  scale = bins / (hi - lo);
+
+  if (nv->type == DFSCH_F64VECTOR_TYPE){
+    for (i = 0; i < nv->length; i++){
+      double x = F64(nv)[i];
+      if (x >= lo && x <= hi){
+        S64(r)[bin_index(x, lo, scale, bins)]++;
+      }
+    }
+  } else if (nv->type == DFSCH_S64VECTOR_TYPE){
+    for (i = 0; i < nv->length; i++){
+      double x = (double)S64(nv)[i];
+      if (x >= lo && x <= hi){
+        S64(r)[bin_index(x, lo, scale, bins)]++;
+      }
+    }
+  } else {
+    uint64_t counts[4][256];
+    size_t map[256];
+    int v;
+
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i + 4 <= nv->length; i += 4){
+      counts[0][U8(nv)[i]]++;
+      counts[1][U8(nv)[i + 1]]++;
+      counts[2][U8(nv)[i + 2]]++;
+      counts[3][U8(nv)[i + 3]]++;
+    }
+    for (; i < nv->length; i++){
+      counts[0][U8(nv)[i]]++;
+    }
+
+    for (v = 0; v < 256; v++){
+      map[v] = (v >= lo && v <= hi) ? bin_index(v, lo, scale, bins) : NO_BIN;
+    }
+    for (v = 0; v < 256; v++){
+      if (map[v] != NO_BIN){
+        S64(r)[map[v]] += counts[0][v] + counts[1][v] +
+          counts[2][v] + counts[3][v];
+      }
+    }
+  }
+
+  return (dfsch_object_t*)r;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Scheme binding
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static dfsch_object_t* make_filled(dfsch_type_t* type, dfsch_object_t* args){
+  size_t length;
+  dfsch_object_t* fill;
+  numvector_t* nv;
+  size_t i;
+
+  DFSCH_LONG_ARG(args, length);
+  DFSCH_OBJECT_ARG_OPT(args, fill, NULL);
+  DFSCH_ARG_END(args);
+
+  nv = (numvector_t*)dfsch_make_numeric_vector(type, length);
+  if (fill){
+    for (i = 0; i < length; i++){
+      nv_set(nv, i, fill);
+    }
+  }
+  return (dfsch_object_t*)nv;
+}
+
+DFSCH_DEFINE_PRIMITIVE(make_f64vector,
+                       "Allocate new vector of doubles"
+                       DFSCH_DOC_SYNOPSIS("(length &optional fill)")){
+  return make_filled(DFSCH_F64VECTOR_TYPE, args);
+}
+DFSCH_DEFINE_PRIMITIVE(make_s64vector,
+                       "Allocate new vector of signed 64bit integers"
+                       DFSCH_DOC_SYNOPSIS("(length &optional fill)")){
+  return make_filled(DFSCH_S64VECTOR_TYPE, args);
+}
+DFSCH_DEFINE_PRIMITIVE(make_u8vector,
+                       "Allocate new vector of bytes"
+                       DFSCH_DOC_SYNOPSIS("(length &optional fill)")){
+  return make_filled(DFSCH_U8VECTOR_TYPE, args);
+}
+
+DFSCH_DEFINE_PRIMITIVE(f64vector, "Create vector of doubles from arguments"){
+  return dfsch_list_2_numeric_vector(DFSCH_F64VECTOR_TYPE, args);
+}
+DFSCH_DEFINE_PRIMITIVE(s64vector,
+                       "Create vector of signed 64bit integers from arguments"){
+  return dfsch_list_2_numeric_vector(DFSCH_S64VECTOR_TYPE, args);
+}
+DFSCH_DEFINE_PRIMITIVE(u8vector, "Create vector of bytes from arguments"){
+  return dfsch_list_2_numeric_vector(DFSCH_U8VECTOR_TYPE, args);
+}
+
+DFSCH_DEFINE_PRIMITIVE(list_2_numeric_vector,
+                       "Convert list of numbers into numeric vector"
+                       DFSCH_DOC_SYNOPSIS("(type list)")){
+  dfsch_type_t* type;
+  dfsch_object_t* list;
+  DFSCH_TYPE_ARG(args, type);
+  DFSCH_OBJECT_ARG(args, list);
+  DFSCH_ARG_END(args);
+
+  return dfsch_list_2_numeric_vector(type, list);
+}
+
+#define BINARY_PRIMITIVE(name, fun, doc)                \
+  DFSCH_DEFINE_PRIMITIVE(name, doc                      \
+                         DFSCH_DOC_SYNOPSIS("(a b)")){  \
+    dfsch_object_t* a;                                  \
+    dfsch_object_t* b;                                  \
+    DFSCH_OBJECT_ARG(args, a);                          \
+    DFSCH_OBJECT_ARG(args, b);                          \
+    DFSCH_ARG_END(args);                                \
+    return fun(a, b);                                   \
+  }
+#define UNARY_PRIMITIVE(name, fun, doc)                         \
+  DFSCH_DEFINE_PRIMITIVE(name, doc                              \
+                         DFSCH_DOC_SYNOPSIS("(vector)")){       \
+    dfsch_object_t* v;                                          \
+    DFSCH_OBJECT_ARG(args, v);                                  \
+    DFSCH_ARG_END(args);                                        \
+    return fun(v);                                              \
+  }
+
+BINARY_PRIMITIVE(numeric_vector_add, dfsch_numeric_vector_add,
+                 "Element-wise sum of vector and vector or number");
+BINARY_PRIMITIVE(numeric_vector_sub, dfsch_numeric_vector_sub,
+                 "Element-wise difference of vector and vector or number");
+BINARY_PRIMITIVE(numeric_vector_mul, dfsch_numeric_vector_mul,
+                 "Element-wise product of vector and vector or number");
+BINARY_PRIMITIVE(numeric_vector_div, dfsch_numeric_vector_div,
+                 "Element-wise quotient of vector and vector or number");
+BINARY_PRIMITIVE(numeric_vector_dot, dfsch_numeric_vector_dot,
+                 "Dot product of two vectors");
+UNARY_PRIMITIVE(numeric_vector_prefix_sum, dfsch_numeric_vector_prefix_sum,
+                "Vector of running sums of vector elements");
+UNARY_PRIMITIVE(numeric_vector_sort, dfsch_numeric_vector_sort,
+                "Sort vector in place into ascending order");
+UNARY_PRIMITIVE(numeric_vector_sum, dfsch_numeric_vector_sum,
+                "Sum of all vector elements");
+UNARY_PRIMITIVE(numeric_vector_min, dfsch_numeric_vector_min,
+                "Smallest element of vector");
+UNARY_PRIMITIVE(numeric_vector_max, dfsch_numeric_vector_max,
+                "Largest element of vector");
+
+DFSCH_DEFINE_PRIMITIVE(numeric_vector_axpy,
+                       "Compute a * x + y element-wise"
+                       DFSCH_DOC_SYNOPSIS("(a x y)")){
+  dfsch_object_t* a;
+  dfsch_object_t* x;
+  dfsch_object_t* y;
+  DFSCH_OBJECT_ARG(args, a);
+  DFSCH_OBJECT_ARG(args, x);
+  DFSCH_OBJECT_ARG(args, y);
+  DFSCH_ARG_END(args);
+
+  return dfsch_numeric_vector_axpy(a, x, y);
+}
+
+DFSCH_DEFINE_PRIMITIVE(numeric_vector_histogram,
+                       "Count vector elements falling into equally sized bins"
+                       DFSCH_DOC_SYNOPSIS("(vector bins lo hi)")){
+  dfsch_object_t* v;
+  long bins;
+  double lo;
+  double hi;
+  DFSCH_OBJECT_ARG(args, v);
+  DFSCH_LONG_ARG(args, bins);
+  DFSCH_DOUBLE_ARG(args, lo);
+  DFSCH_DOUBLE_ARG(args, hi);
+  DFSCH_ARG_END(args);
+
+  if (bins <= 0){
+    dfsch_error("Invalid number of bins", dfsch_make_number_from_long(bins));
+  }
+
+  return dfsch_numeric_vector_histogram(v, bins, lo, hi);
+}
+
+void dfsch__numvector_native_register(dfsch_object_t *ctx){
+  dfsch_defcanon_cstr(ctx, "<numeric-vector>", DFSCH_NUMERIC_VECTOR_TYPE);
+  dfsch_defcanon_cstr(ctx, "<f64vector>", DFSCH_F64VECTOR_TYPE);
+  dfsch_defcanon_cstr(ctx, "<s64vector>", DFSCH_S64VECTOR_TYPE);
+  dfsch_defcanon_cstr(ctx, "<u8vector>", DFSCH_U8VECTOR_TYPE);
+
+  dfsch_defcanon_cstr(ctx, "make-f64vector",
+                      DFSCH_PRIMITIVE_REF(make_f64vector));
+  dfsch_defcanon_cstr(ctx, "make-s64vector",
+                      DFSCH_PRIMITIVE_REF(make_s64vector));
+  dfsch_defcanon_cstr(ctx, "make-u8vector",
+                      DFSCH_PRIMITIVE_REF(make_u8vector));
+  dfsch_defcanon_cstr(ctx, "f64vector", DFSCH_PRIMITIVE_REF(f64vector));
+  dfsch_defcanon_cstr(ctx, "s64vector", DFSCH_PRIMITIVE_REF(s64vector));
+  dfsch_defcanon_cstr(ctx, "u8vector", DFSCH_PRIMITIVE_REF(u8vector));
+  dfsch_defcanon_cstr(ctx, "list->numeric-vector",
+                      DFSCH_PRIMITIVE_REF(list_2_numeric_vector));
+
+  dfsch_defcanon_cstr(ctx, "numeric-vector+",
+                      DFSCH_PRIMITIVE_REF(numeric_vector_add));
+  dfsch_defcanon_cstr(ctx, "numeric-vector-",
+                      DFSCH_PRIMITIVE_REF(numeric_vector_sub));
+  dfsch_defcanon_cstr(ctx, "numeric-vector*",
+                      DFSCH_PRIMITIVE_REF(numeric_vector_mul));
+  dfsch_defcanon_cstr(ctx, "numeric-vector/",
+                      DFSCH_PRIMITIVE_REF(numeric_vector_div));
+  dfsch_defcanon_cstr(ctx, "numeric-vector-dot",
+                      DFSCH_PRIMITIVE_REF(numeric_vector_dot));
+  dfsch_defcanon_cstr(ctx, "numeric-vector-sum",
+                      DFSCH_PRIMITIVE_REF(numeric_vector_sum));
+  dfsch_defcanon_cstr(ctx, "numeric-vector-min",
+                      DFSCH_PRIMITIVE_REF(numeric_vector_min));
+  dfsch_defcanon_cstr(ctx, "numeric-vector-max",
+                      DFSCH_PRIMITIVE_REF(numeric_vector_max));
+  dfsch_defcanon_cstr(ctx, "numeric-vector-prefix-sum",
+                      DFSCH_PRIMITIVE_REF(numeric_vector_prefix_sum));
+  dfsch_defcanon_cstr(ctx, "numeric-vector-axpy",
+                      DFSCH_PRIMITIVE_REF(numeric_vector_axpy));
+  dfsch_defcanon_cstr(ctx, "numeric-vector-sort!",
+                      DFSCH_PRIMITIVE_REF(numeric_vector_sort));
+  dfsch_defcanon_cstr(ctx, "numeric-vector-histogram",
+                      DFSCH_PRIMITIVE_REF(numeric_vector_histogram));
+}
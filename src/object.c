@@ -142,22 +142,163 @@ static void instance_write(dfsch_object_t*obj, dfsch_writer_state_t* state){
   dfsch_write_unreadable_with_slots(state, obj);
 }
 
+/*
+ * Instances are serialized according to per-class plan listing all slots
+ * (including inherited ones) in order in which their values are written.
+ * First instance of class in stream carries class and slot names, later
+ * ones only plan index and packed slot values. Plain object slots are
+ * accessed directly, bypassing slot type methods.
+ */
+
+typedef struct dfsch__instance_plan_t {
+  dfsch_type_t* klass;
+  size_t count;
+  dfsch_slot_t** slots;
+  char* direct;
+} instance_plan_t;
+
+static instance_plan_t* make_instance_plan(dfsch_type_t* klass,
+                                           size_t count){
+  instance_plan_t* plan = GC_NEW(instance_plan_t);
+  plan->klass = klass;
+  plan->count = count;
+  plan->slots = GC_MALLOC(sizeof(dfsch_slot_t*) * count);
+  plan->direct = GC_MALLOC_ATOMIC(count);
+  return plan;
+}
+
+static void plan_slot(instance_plan_t* plan, size_t i, dfsch_slot_t* slot){
+  plan->slots[i] = slot;
+  plan->direct[i] = (slot->type == DFSCH_OBJECT_SLOT_TYPE && 
+                     slot->access == DFSCH_SLOT_ACCESS_RW);
+}
+
+static instance_plan_t* class_instance_plan(dfsch_type_t* klass){
+  instance_plan_t* plan;
+  dfsch_type_t* k;
+  dfsch_slot_t* j;
+  size_t count = 0;
+  size_t i = 0;
+
+  if (DFSCH_INSTANCE_P(klass, DFSCH_STANDARD_CLASS_TYPE) &&
+      ((class_t*)klass)->serialization_plan){
+    return ((class_t*)klass)->serialization_plan;
+  }
+
+  for (k = klass; k; k = k->superclass){
+    for (j = k->slots; j->type; j++){
+      count++;
+    }
+  }
+
+  plan = make_instance_plan(klass, count);
+  for (k = klass; k; k = k->superclass){
+    for (j = k->slots; j->type; j++){
+      plan_slot(plan, i, j);
+      i++;
+    }
+  }
+
+  if (DFSCH_INSTANCE_P(klass, DFSCH_STANDARD_CLASS_TYPE)){
+    ((class_t*)klass)->serialization_plan = plan;
+  }
+  return plan;
+}
+
+static void serialize_slot_values(instance_plan_t* plan,
+                                  dfsch_object_t* obj, 
+                                  dfsch_serializer_t* s){
+  size_t i;
+  for (i = 0; i < plan->count; i++){
+    dfsch_slot_t* slot = plan->slots[i];
+    if (plan->direct[i]){
+      dfsch_serialize_object(s, *((dfsch_object_t**)
+                                  (((char*)obj) + slot->offset)));
+    } else {
+      dfsch_serialize_object(s, dfsch_slot_ref(obj, slot, 1));
+    }
+  }
+}
+
+static void deserialize_slot_values(instance_plan_t* plan,
+                                    dfsch_object_t* obj, 
+                                    dfsch_deserializer_t* ds){
+  size_t i;
+  for (i = 0; i < plan->count; i++){
+    dfsch_slot_t* slot = plan->slots[i];
+    if (plan->direct[i]){
+      *((dfsch_object_t**)(((char*)obj) + slot->offset)) = 
+        dfsch_deserialize_object(ds);
+    } else {
+      dfsch_slot_set(obj, slot, dfsch_deserialize_object(ds), 1);
+    }
+  }
+}
+
 static void instance_serialize(dfsch_object_t* obj, dfsch_serializer_t* s){
   dfsch_type_t* klass = DFSCH_TYPE_OF(obj);
-  dfsch_serialize_stream_symbol(s, "class-instance");
-  dfsch_serialize_object(s, klass);
-  while (klass){
-    dfsch_slot_t* i = klass->slots;
-    while (i->type){
-      dfsch_serialize_stream_symbol(s, i->name);
-      dfsch_serialize_object(s, dfsch_slot_ref(obj, i, 1));
-      i++;
+  instance_plan_t* plan = class_instance_plan(klass);
+  int idx = dfsch_serializer_plan_index(s, (dfsch_object_t*)klass);
+  size_t i;
+
+  if (idx >= 0){
+    dfsch_serialize_stream_symbol(s, "class-instance-packed");
+    dfsch_serialize_integer(s, idx);
+  } else {
+    dfsch_serialize_stream_symbol(s, "class-instance-plan");
+    dfsch_serialize_object(s, klass);
+    /* Plan is numbered after class, same as in deserializer */
+    dfsch_serializer_add_plan(s, (dfsch_object_t*)klass);
+    dfsch_serialize_integer(s, plan->count);
+    for (i = 0; i < plan->count; i++){
+      dfsch_serialize_stream_symbol(s, plan->slots[i]->name);
     }
-    klass = klass->superclass;
   }
-  dfsch_serialize_stream_symbol(s, NULL);
+
+  serialize_slot_values(plan, obj, s);
+}
+
+DFSCH_DEFINE_DESERIALIZATION_HANDLER("class-instance-plan", 
+                                     class_instance_plan){
+  dfsch_object_t** place = dfsch_deserializer__skip_object(ds);
+  dfsch_type_t* klass;
+  instance_plan_t* plan;
+  dfsch_object_t* ins;
+  dfsch_object_t* obj;
+  size_t count;
+  size_t i;
+
+  obj = dfsch_deserialize_object(ds);
+  klass = DFSCH_ASSERT_INSTANCE(obj, DFSCH_STANDARD_CLASS_TYPE);
+  count = dfsch_deserialize_integer(ds);
+  plan = make_instance_plan(klass, count);
+  for (i = 0; i < count; i++){
+    char* name = dfsch_deserialize_stream_symbol(ds);
+    if (!name){
+      dfsch_error("Invalid serialized stream: missing slot name", klass);
+    }
+    plan_slot(plan, i, dfsch_find_slot(klass, name));
+  }
+  dfsch_deserializer_add_plan(ds, plan);
+
+  *place = ins = dfsch_make_object(klass);
+  deserialize_slot_values(plan, ins, ds);
+  return ins;
+}
+
+DFSCH_DEFINE_DESERIALIZATION_HANDLER("class-instance-packed", 
+                                     class_instance_packed){
+  dfsch_object_t** place = dfsch_deserializer__skip_object(ds);
+  instance_plan_t* plan;
+  dfsch_object_t* ins;
+
+  plan = dfsch_deserializer_plan_ref(ds, dfsch_deserialize_integer(ds));
+  *place = ins = dfsch_make_object(plan->klass);
+  deserialize_slot_values(plan, ins, ds);
+  return ins;
 }
 
+/* Format used before introduction of plans, slot by slot with names */
 DFSCH_DEFINE_DESERIALIZATION_HANDLER("class-instance", class_instance){
   dfsch_type_t* klass;
   dfsch_object_t* ins;
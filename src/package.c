@@ -751,6 +751,27 @@ dfsch_object_t* dfsch_list_all_packages(){
 dfsch_object_t* dfsch_package_exported_symbols(dfsch_package_t* pkg){
   return dfsch_list_copy(pkg->exported_symbols);
 }
+dfsch_object_t* dfsch_package_use_list(dfsch_package_t* pkg){
+  dfsch_list_collector_t* lc = dfsch_make_list_collector();
+  dfsch_object_t* i;
+  alias_list_t* j;
+
+  pthread_mutex_lock(&symbol_lock);
+  i = pkg->use_list;
+  while (DFSCH_PAIR_P(i)){
+    dfsch_list_collect(lc, DFSCH_FAST_CAR(i));
+    i = DFSCH_FAST_CDR(i);
+  }
+  j = pkg->alias_list;
+  while (j){
+    dfsch_list_collect(lc, dfsch_cons(dfsch_make_string_cstr(j->alias),
+                                      (dfsch_object_t*)j->package));
+    j = j->next;
+  }
+  pthread_mutex_unlock(&symbol_lock);
+
+  return dfsch_collected_list(lc);
+}
 void dfsch_for_package_symbols(dfsch_package_t* pkg,
                                dfsch_package_iteration_cb_t cb,
                                void* baton){
@@ -58,26 +58,50 @@ char_table_entry_t char_table[]={
   {"linefeed", '\n'}
 };
 
+/*
+ * Pending input is kept as NUL-terminated string buf[start..len), consumed 
+ * data is only skipped over and space is reclaimed when more data arrives.
+ */
 typedef struct string_queue_t {
   char* buf;
+  size_t start;
+  size_t len;
   size_t all;
 } string_queue_t;
 
+#define QUEUE_INITIAL_SIZE 512
+
 static string_queue_t *create_queue(){
   string_queue_t *q = GC_MALLOC(sizeof(string_queue_t));
-  q->buf = GC_MALLOC_ATOMIC(512);
-  q->all = 512;
+  q->buf = GC_MALLOC_ATOMIC(QUEUE_INITIAL_SIZE);
+  q->all = QUEUE_INITIAL_SIZE;
   if (!q->buf){
     abort();
   }
   q->buf[0]=0;
+  q->start = 0;
+  q->len = 0;
   return q;
 }
 static char* get_queue(string_queue_t *q){
-  return q->buf;
+  return q->buf + q->start;
 }
-static char* feed_queue(string_queue_t *q, char* data){
-  size_t new_size = strlen(q->buf) + strlen(data)+1;
+/*
+ * Tokenizer works on NUL-terminated data, so embedded NUL bytes are dropped
+ * (as they always were), rest of data is still queued.
+ */
+static void feed_queue(string_queue_t *q, char* data, size_t dlen){
+  char* nul = memchr(data, 0, dlen);
+  size_t new_size;
+
+  new_size = q->len + dlen + 1;
+  if (q->start && (new_size > q->all || q->start > q->all / 2)){
+    memmove(q->buf, q->buf + q->start, q->len - q->start);
+    q->len -= q->start;
+    new_size -= q->start;
+    q->start = 0;
+  }
+
   if (new_size > q->all){
     q->buf = GC_REALLOC(q->buf, new_size+(new_size/2));
     q->all = new_size+(new_size/2);
@@ -85,39 +109,53 @@ static char* feed_queue(string_queue_t *q, char* data){
       abort();
     }
   }
-  strncat(q->buf, data, new_size);
+  if (nul){
+    while (dlen){
+      if (*data){
+        q->buf[q->len] = *data;
+        q->len++;
+      }
+      data++;
+      dlen--;
+    }
+  } else {
+    memcpy(q->buf + q->len, data, dlen);
+    q->len += dlen;
+  }
+  q->buf[q->len] = 0;
 
 #ifdef Q_DEBUG
   printf(";; Queue is now: [[[%s]]] \n",get_queue(q));
 #endif
-
+}
+static void empty_queue(string_queue_t *q){
+  q->start = 0;
+  q->len = 0;
+  if (q->all > QUEUE_INITIAL_SIZE * 8){
+    q->buf = GC_REALLOC(q->buf, QUEUE_INITIAL_SIZE);
+    q->all = QUEUE_INITIAL_SIZE;
+    if (!q->buf){
+      abort();
+    }
+  }
+  q->buf[0] = 0;
 }
 static void consume_queue(string_queue_t *q, char* new){
-  size_t nl = strlen(new)+1;
-  memmove(q->buf, new, nl);
-
 #ifdef Q_DEBUG
   printf(";; Trimmed: [[[%s]]]",new);
 #endif
 
-  if (nl < q->all/2){
-    q->buf = GC_REALLOC(q->buf, nl);
-    q->all = nl;    
-    if (!q->buf){
-      abort();
-    }
+  q->start = new - q->buf;
+  if (q->start >= q->len){
+    empty_queue(q);
   }
 
 #ifdef Q_DEBUG
   printf(";; Queue is now: [[[%s]]] \n",get_queue(q));
 #endif
-
-
 }
-static void empty_queue(string_queue_t *q){
-  if (q->buf){
-    *(q->buf)=0;
-  }
+static size_t queue_pending(string_queue_t *q){
+  return q->len - q->start;
 }
 
 
@@ -157,6 +195,7 @@ struct dfsch_parser_ctx_t {
   } tokenizer_state;
 
   unsigned int hash_arg;
+  size_t scan; /* already scanned part of incomplete token */
 
   void (*dispatch_atom_hook)(dfsch_parser_ctx_t* ctx,
                              char* str);
@@ -179,6 +218,7 @@ struct dfsch_parser_ctx_t {
 static void parser_reset(dfsch_parser_ctx_t *ctx){
   empty_queue(ctx->q);
   ctx->tokenizer_state = T_NONE;
+  ctx->scan = 0;
   ctx->parser = NULL;
   ctx->level = 0 ;
   ctx->line = 1;
@@ -790,7 +830,7 @@ static void dispatch_atom(dfsch_parser_ctx_t *ctx, char *data){
  * "normal" scheme ports and such things.
  */
 static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
-  while (*data){
+  while (*data && !ctx->error){
     switch (ctx->tokenizer_state){
     case T_NONE:
       while(*data==' ' || *data=='\n' || *data == '\t' || *data == '\r' 
@@ -818,7 +858,6 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
         ctx->column++;
 	
 	parse_open(ctx);
-	if (ctx->error) return;
 
 	break;
       case '\'':
@@ -826,7 +865,6 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
         ctx->column++;
 	
 	parse_quote(ctx, DFSCH_SYM_QUOTE);
-	if (ctx->error) return;
 
 	break;
       case '`':
@@ -842,7 +880,6 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
         }else{
           parse_quote(ctx, DFSCH_SYM_QUASIQUOTE);
         }
-	if (ctx->error) return;
 
 	break;
       case ',':
@@ -862,7 +899,6 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
         }else{
           parse_quote(ctx, DFSCH_SYM_UNQUOTE);
         }
-	if (ctx->error) return;
 
 	break;
       case '#':
@@ -878,7 +914,6 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
         ctx->column++;
 	
 	parse_close(ctx);
-	if (ctx->error) return;
 
 	break;
       case ';':
@@ -894,7 +929,6 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
 	    *data == '\f' || *data==0   || *data=='('  || *data==')'){
           ctx->column++;
 	  parse_dot(ctx);
-	  if (ctx->error) return;
 	  
 	  break;
 	}
@@ -907,11 +941,13 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
       break;
     case T_ATOM:
       {
-	char *e = strpbrk(data, "() \t\n\r\f;");
+	char *e = strpbrk(data + ctx->scan, "() \t\n\r\f;");
 	if (!e){
+          ctx->scan = queue_pending(ctx->q) - (data - get_queue(ctx->q));
           consume_queue(ctx->q, data);
 	  return;
 	}
+        ctx->scan = 0;
 	char *s = GC_MALLOC_ATOMIC((size_t)(e-data)+1);
 	strncpy(s,data,e-data);
 	s[e-data]=0;
@@ -922,7 +958,6 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
         } else {
           dispatch_atom(ctx, s);
         }
-	if (ctx->error) return;
 
         ctx->column += e-data;
 	data = e;
@@ -932,24 +967,25 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
       }
     case T_STRING: // TODO: count characters and lines
       {
-	char *e = data;
+	char *e = data + ctx->scan;
         while (*e != '"'){
-          if (!*e){
+          if (!*e || (*e == '\\' && !e[1])){
+            ctx->scan = e - data;
             consume_queue(ctx->q, data);
             return;
           }
-          if (*e == '\\' && e[1]){
+          if (*e == '\\'){
             e++;
           }
           e++;
         }
+        ctx->scan = 0;
 
 	char *s = GC_MALLOC_ATOMIC((size_t)(e-data)+1);
 	strncpy(s, data, e-data);
 	s[e-data]=0;
 
 	dispatch_string(ctx, s);
-	if (ctx->error) return;
 
 	data = e+1;
 	
@@ -958,24 +994,25 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
      }
     case T_BYTE_VECTOR: // TODO: count characters and lines
       {
-	char *e = data;
+	char *e = data + ctx->scan;
         while (*e != '"'){
-          if (!*e){
+          if (!*e || (*e == '\\' && !e[1])){
+            ctx->scan = e - data;
             consume_queue(ctx->q, data);
             return;
           }
-          if (*e == '\\' && e[1]){
+          if (*e == '\\'){
             e++;
           }
           e++;
         }
+        ctx->scan = 0;
 
 	char *s = GC_MALLOC_ATOMIC((size_t)(e-data)+1);
 	strncpy(s, data, e-data);
 	s[e-data]=0;
 
 	dispatch_byte_vector(ctx, s);
-	if (ctx->error) return;
 
 	data = e+1;
 	
@@ -1019,7 +1056,6 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
         ctx->column++;
 
         parse_object(ctx,NULL);
-	if (ctx->error) return;
         ctx->tokenizer_state = T_NONE;
         break;
       case 't':
@@ -1028,7 +1064,6 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
         ctx->column++;
 
         parse_object(ctx,DFSCH_SYM_TRUE);
-	if (ctx->error) return;
         ctx->tokenizer_state = T_NONE;  
         break;
       case 'x':
@@ -1080,7 +1115,6 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
         break;
       case '(':
         parse_vector(ctx);
-        if (ctx->error) return;
         ctx->tokenizer_state = T_NONE;
         break;
       case '<':
@@ -1124,11 +1158,13 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
       {
         unsigned char c = *data;
         if ((c>='a' && c<= 'z') || (c>='A' && c<= 'Z')){
-          char *e = strpbrk(data, "() \t\n\r\f;");
+          char *e = strpbrk(data + ctx->scan, "() \t\n\r\f;");
           if (!e){
+            ctx->scan = queue_pending(ctx->q) - (data - get_queue(ctx->q));
             consume_queue(ctx->q, data);
             return;
           }
+          ctx->scan = 0;
           if (e - data ==  1) // One character
             goto simple;
 
@@ -1153,7 +1189,6 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
 
             if (ascii_strcasecmp(s, char_table[i].name)==0){
               parse_object(ctx, DFSCH_MAKE_CHARACTER(char_table[i].ch));
-              if (ctx->error) return;
               goto char_out;
             }
           } 
@@ -1238,12 +1273,29 @@ static void tokenizer_process (dfsch_parser_ctx_t *ctx, char* data){
   consume_queue(ctx->q, data);
 }
 
-int dfsch_parser_feed(dfsch_parser_ctx_t *ctx, char* data){
+static void parser_feed_low(dfsch_parser_ctx_t *ctx, 
+                            char* data, size_t len){
   ctx->error = 0;
-  DFSCH_UNWIND{
-    feed_queue(ctx->q, data);
+  feed_queue(ctx->q, data, len);
+  tokenizer_process(ctx, get_queue(ctx->q));
+}
+
+/* Length of prefix of data that does not end up pending in queue */
+static size_t used_input(dfsch_parser_ctx_t *ctx, char* data, size_t len){
+  size_t pending = queue_pending(ctx->q);
+
+  while (pending && len){
+    len--;
+    if (data[len]){
+      pending--;
+    }
+  }
+  return len;
+}
 
-    tokenizer_process(ctx, get_queue(ctx->q));
+int dfsch_parser_feed_buf(dfsch_parser_ctx_t *ctx, char* data, size_t len){
+  DFSCH_UNWIND{
+    parser_feed_low(ctx, data, len);
   }DFSCH_PROTECT{
 
   }DFSCH_UNWIND_DETECT{
@@ -1252,6 +1304,9 @@ int dfsch_parser_feed(dfsch_parser_ctx_t *ctx, char* data){
 
   return ctx->error;
 }
+int dfsch_parser_feed(dfsch_parser_ctx_t *ctx, char* data){
+  return dfsch_parser_feed_buf(ctx, data, strlen(data));
+}
 int dfsch_parser_feed_line(dfsch_parser_ctx_t *ctx, char* data){
   int ret;
   if (ret = dfsch_parser_feed(ctx, data)){
@@ -1276,6 +1331,7 @@ int dfsch_parser_get_level(dfsch_parser_ctx_t *ctx){
 void dfsch_parser_reset(dfsch_parser_ctx_t *ctx){
   empty_queue(ctx->q);
   ctx->tokenizer_state = T_NONE;
+  ctx->scan = 0;
   ctx->parser = NULL;
   ctx->level = 0 ;
   ctx->error = 0;
@@ -1296,31 +1352,60 @@ static int read_callback(dfsch_object_t* obj, dfsch_object_t** res){
 }
 
 /*
- * There is slight bug - when first character after atom is (, ) or ;
- * it's silently thrown away. This clearly is undesired behavior, but
- * in my opinion does not break anyhing significant. So let's call it 
- * feature for now.
+ * When port is able to lend its buffer, lent chunks are fed into parser in
+ * small pieces (so reading short datum does not copy whole chunk) and only
+ * data actually used by returned object are consumed from port.
+ * Otherwise port is read byte by byte and delimiter that terminated atom
+ * is pushed back into port.
  */
 
+#define FEED_PIECE_SIZE (QUEUE_INITIAL_SIZE / 2)
+
 dfsch_object_t* dfsch_parser_read_from_port(dfsch_object_t* port){
   dfsch_parser_ctx_t* parser = dfsch_parser_create();
   int ch;
-  char buf[2];
+  char c;
+  char* buf;
+  size_t len;
   dfsch_object_t* res;
   int ok = 0;
 
   dfsch_port_batch_read_start(port);
   dfsch_parser_callback(parser, (dfsch_parser_callback_t)read_callback, &res);
   DFSCH_UNWIND {
-    while ((ch = dfsch_port_batch_read(port)) != -1){
-      buf[0] = ch;
-      buf[1] = 0;
-      
-      if (dfsch_parser_feed(parser, buf)){
-        dfsch_port_batch_read_end(port);
-        ok = 1;
-        break;
+    buf = dfsch_port_batch_read_buf(port, &len);
+    if (buf){
+      while (len){
+        if (len > FEED_PIECE_SIZE){
+          len = FEED_PIECE_SIZE;
+        }
+        parser_feed_low(parser, buf, len);
+        if (parser->error){
+          dfsch_port_batch_read_consume(port, 
+                                        used_input(parser, buf, len));
+          ok = 1;
+          break;
+        }
+        dfsch_port_batch_read_consume(port, len);
+        buf = dfsch_port_batch_read_buf(port, &len);
       }
+    } else {
+      while ((ch = dfsch_port_batch_read(port)) != -1){
+        c = ch;
+        parser_feed_low(parser, &c, 1);
+        if (parser->error){
+          if (queue_pending(parser->q)){
+            dfsch_port_batch_unread(port, c);
+          }
+          ok = 1;
+          break;
+        }
+      }
+    }
+    if (!ok && parser->tokenizer_state == T_ATOM){
+      /* atom terminated by end of file */
+      parser_feed_low(parser, "\n", 1);
+      ok = parser->error;
     }
   } DFSCH_PROTECT {
     dfsch_port_batch_read_end(port);
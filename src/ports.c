@@ -30,6 +30,7 @@
 #include <dfsch/number.h>
 #include <dfsch/magic.h>
 #include <dfsch/parse.h>
+#include <dfsch/writer.h>
 #include "internal.h"
 #include "util.h"
 
@@ -75,7 +76,11 @@ int dfsch_seekable_port_p(dfsch_object_t* port){
 
 void dfsch_port_write_buf(dfsch_port_t* port, char*buf, size_t size){
   if (((dfsch_port_type_t*)(DFSCH_TYPE_OF(port)))->write_buf){
-    int freshline = buf[size - 1] == '\n';
+    int freshline;
+    if (size == 0){
+      return;
+    }
+    freshline = buf[size - 1] == '\n';
     ((dfsch_port_type_t*)(DFSCH_TYPE_OF(port)))->write_buf(port, buf, size);
     port->freshline = freshline;
   } else {
@@ -86,6 +91,59 @@ void dfsch_port_write_cstr(dfsch_port_t* port, char*str){
   dfsch_port_write_buf(port, str, strlen(str));
 }
 
+/*
+ * Writer output is collected into small buffer on stack and passed to port
+ * in larger chunks, instead of building whole string representation first.
+ */
+
+#define PORT_WRITER_BUFFER 4096
+
+typedef struct port_writer_t {
+  dfsch_port_t* port;
+  size_t len;
+  char buf[PORT_WRITER_BUFFER];
+} port_writer_t;
+
+static void port_writer_flush(port_writer_t* pw){
+  if (pw->len){
+    dfsch_port_write_buf(pw->port, pw->buf, pw->len);
+    pw->len = 0;
+  }
+}
+static void port_writer_output(port_writer_t* pw, char* buf, size_t len){
+  if (len > PORT_WRITER_BUFFER - pw->len){
+    port_writer_flush(pw);
+    if (len >= PORT_WRITER_BUFFER){
+      dfsch_port_write_buf(pw->port, buf, len);
+      return;
+    }
+  }
+  memcpy(pw->buf + pw->len, buf, len);
+  pw->len += len;
+}
+
+void dfsch_port_write_object(dfsch_port_t* port, dfsch_object_t* obj,
+                             int max_depth, int readability){
+  port_writer_t pw;
+
+  pw.port = port;
+  pw.len = 0;
+
+  if (max_depth >= 0){
+    dfsch_writer_state_t* state = 
+      dfsch_make_writer_state(max_depth, readability,
+                              (dfsch_output_proc_t)port_writer_output, &pw);
+    dfsch_write_object(state, obj);
+    dfsch_invalidate_writer_state(state);
+  } else {
+    dfsch_write_object_circular(obj, readability,
+                                (dfsch_output_proc_t)port_writer_output, 
+                                &pw);
+  }
+
+  port_writer_flush(&pw);
+}
+
 
 ssize_t dfsch_port_read_buf(dfsch_port_t* port, char*buf, size_t size){
   if (((dfsch_port_type_t*)(DFSCH_TYPE_OF(port)))->read_buf){
@@ -158,6 +216,18 @@ void dfsch_port_batch_unread(dfsch_port_t* port, char ch){
   port->pushback_content = ch;
 }
 
+char* dfsch_port_batch_read_buf(dfsch_port_t* port, size_t* len){
+  if (port->pushback || 
+      !((dfsch_port_type_t*)(DFSCH_TYPE_OF(port)))->batch_read_buf){
+    return NULL;
+  }
+  return ((dfsch_port_type_t*)(DFSCH_TYPE_OF(port)))->batch_read_buf(port, 
+                                                                    len);
+}
+void dfsch_port_batch_read_consume(dfsch_port_t* port, size_t len){
+  ((dfsch_port_type_t*)(DFSCH_TYPE_OF(port)))->batch_read_consume(port, len);
+}
+
 void dfsch_port_freshline(dfsch_port_t* port){
   if (!port->freshline){
     port->freshline = 1;
@@ -165,6 +235,20 @@ void dfsch_port_freshline(dfsch_port_t* port){
   }
 }
 
+void dfsch_port_flush(dfsch_port_t* port){
+  if (((dfsch_port_type_t*)(DFSCH_TYPE_OF(port)))->flush){
+    ((dfsch_port_type_t*)(DFSCH_TYPE_OF(port)))->flush(port);
+  }
+}
+void dfsch_port_set_buffering(dfsch_port_t* port, int mode, size_t size){
+  if (((dfsch_port_type_t*)(DFSCH_TYPE_OF(port)))->set_buffering){
+    ((dfsch_port_type_t*)(DFSCH_TYPE_OF(port)))->set_buffering(port, 
+                                                               mode, size);
+  } else {
+    dfsch_error("Port does not support buffering control", port);
+  }
+}
+
 
 dfsch_strbuf_t* dfsch_port_readline(dfsch_port_t* port){
   return dfsch_port_readline_len(port, 0);
@@ -407,10 +491,91 @@ dfsch_object_t* dfsch_string_output_port(){
 
   return (dfsch_object_t*)port;
 }
+/*
+ * Unsynchronized variant of string-output-port for ports used only by one
+ * thread (with-output-to-string and similar). Data are kept in one
+ * contiguous buffer that is handed out by value without copying and
+ * copied on next write.
+ */
+
+typedef struct local_string_output_port_t {
+  dfsch_port_t super;
+  char* buf;
+  size_t len;
+  size_t cap;
+  int shared;
+} local_string_output_port_t;
+
+static void local_string_output_port_write_buf(local_string_output_port_t* port, 
+                                               char*buf, size_t len){
+  if (port->shared || len > port->cap - port->len){
+    size_t cap = port->cap;
+    char* nbuf;
+
+    if (len > cap - port->len){
+      cap *= 2;
+      if (cap < 64){
+        cap = 64;
+      }
+      if (len > cap - port->len){
+        cap = port->len + len;
+      }
+    }
+
+    nbuf = GC_MALLOC_ATOMIC(cap + 1);
+    memcpy(nbuf, port->buf, port->len);
+    port->buf = nbuf;
+    port->cap = cap;
+    port->shared = 0;
+  }
+
+  memcpy(port->buf + port->len, buf, len);
+  port->len += len;
+}
+
+dfsch_port_type_t dfsch_local_string_output_port_type = {
+  {
+    DFSCH_PORT_TYPE_TYPE,
+    DFSCH_STRING_OUTPUT_PORT_TYPE,
+    sizeof(local_string_output_port_t),
+    "local-string-output-port",
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    
+    NULL,
+    "Output only port backed by string, not safe for concurrent use"
+  },
+  (dfsch_port_write_buf_t)local_string_output_port_write_buf,
+};
+
+dfsch_object_t* dfsch_local_string_output_port(size_t size_hint){
+  local_string_output_port_t* port = 
+    (local_string_output_port_t*)
+    dfsch_make_object((dfsch_type_t*)DFSCH_LOCAL_STRING_OUTPUT_PORT_TYPE);
+
+  port->len = 0;
+  port->cap = size_hint;
+  port->buf = GC_MALLOC_ATOMIC(size_hint + 1);
+  port->shared = 0;
+
+  return (dfsch_object_t*)port;
+}
+
 dfsch_strbuf_t* dfsch_string_output_port_value(dfsch_object_t* port){
   string_output_port_t* p;
   dfsch_strbuf_t* buf;
 
+  if (DFSCH_TYPE_OF(port) == 
+      (dfsch_type_t*)DFSCH_LOCAL_STRING_OUTPUT_PORT_TYPE){
+    local_string_output_port_t* lp = (local_string_output_port_t*)port;
+
+    lp->buf[lp->len] = 0;
+    lp->shared = 1;
+    return dfsch_strbuf_create(lp->buf, lp->len);
+  }
+
   p = (string_output_port_t*)DFSCH_ASSERT_TYPE(port, 
                                                (dfsch_type_t*)
                                                DFSCH_STRING_OUTPUT_PORT_TYPE);
@@ -484,6 +649,31 @@ static int64_t string_input_port_tell(string_input_port_t* port){
   return port->cur;
 }
 
+/* 
+ * Parser copies lent data, so only bounded chunk is lent at once, otherwise 
+ * each read would copy whole rest of string.
+ */
+#define STRING_INPUT_PORT_CHUNK_SIZE 4096
+
+static char* string_input_port_batch_read_buf(string_input_port_t* port,
+                                              size_t* len){
+  char* ret;
+  pthread_mutex_lock(port->mutex);
+  ret = port->buf + port->cur;
+  *len = port->len - port->cur;
+  if (*len > STRING_INPUT_PORT_CHUNK_SIZE){
+    *len = STRING_INPUT_PORT_CHUNK_SIZE;
+  }
+  pthread_mutex_unlock(port->mutex);
+  return ret;
+}
+static void string_input_port_batch_read_consume(string_input_port_t* port,
+                                                 size_t len){
+  pthread_mutex_lock(port->mutex);
+  port->cur += len;
+  pthread_mutex_unlock(port->mutex);
+}
+
 
 dfsch_port_type_t dfsch_string_input_port_type = {
   {
@@ -502,6 +692,10 @@ dfsch_port_type_t dfsch_string_input_port_type = {
   .read_buf = (dfsch_port_read_buf_t)string_input_port_read_buf,
   .seek = (dfsch_port_seek_t)string_input_port_seek,
   .tell = (dfsch_port_seek_t)string_input_port_tell,
+  .batch_read_buf = 
+  (dfsch_port_batch_read_buf_t)string_input_port_batch_read_buf,
+  .batch_read_consume = 
+  (dfsch_port_batch_read_consume_t)string_input_port_batch_read_consume,
 };
 
 dfsch_object_t* dfsch_string_input_port(char* buf, size_t len){
@@ -548,6 +742,43 @@ static void file_port_write_buf(file_port_t* port,
     }
   }
 }
+static void file_port_flush(file_port_t* port){
+  if (!port->open){
+    dfsch_error("Port is closed", (dfsch_object_t*)port);
+  }
+
+  if (fflush(port->file) != 0){
+    dfsch_operating_system_error("fflush");    
+  }
+}
+/*
+ * stdio only guarantees setvbuf() to work before first I/O operation on
+ * stream, so this is mostly useful for freshly opened files.
+ */
+static void file_port_set_buffering(file_port_t* port, 
+                                    int mode, size_t size){
+  int stdio_mode;
+
+  if (!port->open){
+    dfsch_error("Port is closed", (dfsch_object_t*)port);
+  }
+
+  switch (mode){
+  case DFSCH_PORT_BUFFER_NONE:
+    stdio_mode = _IONBF;
+    break;
+  case DFSCH_PORT_BUFFER_LINE:
+    stdio_mode = _IOLBF;
+    break;
+  default:
+    stdio_mode = _IOFBF;
+  }
+
+  fflush(port->file);
+  if (setvbuf(port->file, NULL, stdio_mode, size ? size : BUFSIZ) != 0){
+    dfsch_operating_system_error("setvbuf");    
+  }
+}
 static ssize_t file_port_read_buf(file_port_t* port,
                                   char* buf, size_t len){
   size_t ret;
@@ -692,6 +923,8 @@ dfsch_port_type_t dfsch_file_input_output_port_type = {
 
   .seek = (dfsch_port_seek_t)file_port_seek,
   .tell = (dfsch_port_tell_t)file_port_tell,
+  .flush = (dfsch_port_flush_t)file_port_flush,
+  .set_buffering = (dfsch_port_set_buffering_t)file_port_set_buffering,
 #ifdef __unix__
   .batch_read_start = (dfsch_port_batch_read_start_t)file_port_batch_read_start,
   .batch_read_end = (dfsch_port_batch_read_end_t)file_port_batch_read_end,
@@ -743,6 +976,8 @@ dfsch_port_type_t dfsch_file_output_port_type = {
 
   .seek = (dfsch_port_seek_t)file_port_seek,
   .tell = (dfsch_port_tell_t)file_port_tell,
+  .flush = (dfsch_port_flush_t)file_port_flush,
+  .set_buffering = (dfsch_port_set_buffering_t)file_port_set_buffering,
 };
 
 
@@ -931,28 +1166,24 @@ DFSCH_DEFINE_PRIMITIVE(write, NULL){
   dfsch_port_t* port;
   dfsch_object_t* object;
   dfsch_object_t* strict;
-  char *buf;
   DFSCH_OBJECT_ARG(args, object);
   DFSCH_PORT_ARG_OPT(args, port, dfsch_current_output_port());  
   DFSCH_OBJECT_ARG_OPT(args, strict, NULL);  
   DFSCH_ARG_END(args);
 
-  buf = dfsch_object_2_string(object, 1000, (strict != NULL) ? 
-                              DFSCH_STRICT_WRITE : DFSCH_WRITE);
-  dfsch_port_write_buf(port, buf, strlen(buf));
+  dfsch_port_write_object(port, object, 1000, (strict != NULL) ? 
+                          DFSCH_STRICT_WRITE : DFSCH_WRITE);
   
   return NULL;
 }
 DFSCH_DEFINE_PRIMITIVE(display, NULL){
   dfsch_port_t* port;
   dfsch_object_t* object;
-  char *buf;
   DFSCH_OBJECT_ARG(args, object);
   DFSCH_PORT_ARG_OPT(args, port, dfsch_current_output_port());  
   DFSCH_ARG_END(args);
 
-  buf = dfsch_object_2_string(object, 1000, DFSCH_PRINT);
-  dfsch_port_write_buf(port, buf, strlen(buf));
+  dfsch_port_write_object(port, object, 1000, DFSCH_PRINT);
   
   return NULL;
 }
@@ -979,6 +1210,42 @@ DFSCH_DEFINE_PRIMITIVE(freshline,
   return NULL;
 }
 
+DFSCH_DEFINE_PRIMITIVE(flush_output, 
+                       "Write out data buffered in output port"){
+  dfsch_port_t* port;
+  DFSCH_PORT_ARG_OPT(args, port, dfsch_current_output_port());  
+  DFSCH_ARG_END(args);
+
+  dfsch_port_flush(port);
+  
+  return NULL;
+}
+DFSCH_DEFINE_PRIMITIVE(set_port_buffering, 
+                       "Set output buffering mode of port to :none, :line "
+                       "or :full, with optional buffer size"){
+  dfsch_port_t* port;
+  int mode = DFSCH_PORT_BUFFER_FULL;
+  long size;
+
+  DFSCH_PORT_ARG(args, port);
+  DFSCH_FLAG_PARSER_BEGIN_ONE(args, mode);
+  DFSCH_FLAG_VALUE("none", DFSCH_PORT_BUFFER_NONE, mode);
+  DFSCH_FLAG_VALUE("line", DFSCH_PORT_BUFFER_LINE, mode);
+  DFSCH_FLAG_VALUE("full", DFSCH_PORT_BUFFER_FULL, mode);
+  DFSCH_FLAG_PARSER_END(args);
+  DFSCH_LONG_ARG_OPT(args, size, 0);
+  DFSCH_ARG_END(args);
+
+  if (size < 0){
+    dfsch_error("Buffer size must be non-negative", 
+                dfsch_make_number_from_long(size));
+  }
+
+  dfsch_port_set_buffering(port, mode, size);
+  
+  return NULL;
+}
+
 DFSCH_DEFINE_PRIMITIVE(read, "Read one object from port"){
   dfsch_port_t* port;
   char *buf;
@@ -1092,6 +1359,21 @@ DFSCH_DEFINE_PRIMITIVE(string_output_port, NULL){
   DFSCH_ARG_END(args);
   return dfsch_string_output_port();
 }
+DFSCH_DEFINE_PRIMITIVE(local_string_output_port, 
+                       "Create string output port that is not synchronized "
+                       "and thus usable only by one thread at a time"
+                       DFSCH_DOC_SYNOPSIS("(&optional size-hint)")){
+  long size_hint;
+  DFSCH_LONG_ARG_OPT(args, size_hint, 0);
+  DFSCH_ARG_END(args);
+
+  if (size_hint < 0){
+    dfsch_error("Size hint must be non-negative", 
+                dfsch_make_number_from_long(size_hint));
+  }
+
+  return dfsch_local_string_output_port(size_hint);
+}
 DFSCH_DEFINE_PRIMITIVE(string_output_port_value, 
                        "Return data output into <string-output-port> instance. "
                        "Optional argument `string?` requests output as immutable "
@@ -1106,6 +1388,17 @@ DFSCH_DEFINE_PRIMITIVE(string_output_port_value,
 
   buf = dfsch_string_output_port_value(port);
 
+  if (DFSCH_TYPE_OF(port) == 
+      (dfsch_type_t*)DFSCH_LOCAL_STRING_OUTPUT_PORT_TYPE){
+    /* Port copies shared buffer before next write, but byte-vectors are 
+       mutable */
+    if (string_p){
+      return dfsch_make_string_nocopy(buf);
+    } else {
+      return dfsch_make_byte_vector(buf->ptr, buf->len);
+    }
+  }
+
   if (string_p){
     return dfsch_make_string_strbuf(buf);
   } else {
@@ -1165,6 +1458,8 @@ void dfsch__port_native_register(dfsch_object_t *ctx){
                       DFSCH_FILE_INPUT_OUTPUT_PORT_TYPE);
   dfsch_defcanon_cstr(ctx, "<string-input-port>", DFSCH_STRING_INPUT_PORT_TYPE);
   dfsch_defcanon_cstr(ctx, "<string-output-port>", DFSCH_STRING_OUTPUT_PORT_TYPE);
+  dfsch_defcanon_cstr(ctx, "<local-string-output-port>", 
+                      DFSCH_LOCAL_STRING_OUTPUT_PORT_TYPE);
   dfsch_defcanon_cstr(ctx, "<eof-object>", DFSCH_EOF_OBJECT_TYPE);
   dfsch_defcanon_cstr(ctx, "<port-line-iterator>", 
                       DFSCH_PORT_LINE_ITERATOR_TYPE);
@@ -1192,6 +1487,10 @@ void dfsch__port_native_register(dfsch_object_t *ctx){
                     DFSCH_PRIMITIVE_REF(newline));
   dfsch_defcanon_cstr(ctx, "freshline", 
                     DFSCH_PRIMITIVE_REF(freshline));
+  dfsch_defcanon_cstr(ctx, "flush-output", 
+                    DFSCH_PRIMITIVE_REF(flush_output));
+  dfsch_defcanon_cstr(ctx, "set-port-buffering!", 
+                    DFSCH_PRIMITIVE_REF(set_port_buffering));
   dfsch_defcanon_cstr(ctx, "read", 
                     DFSCH_PRIMITIVE_REF(read));
 
@@ -1215,6 +1514,8 @@ void dfsch__port_native_register(dfsch_object_t *ctx){
 
   dfsch_defcanon_cstr(ctx, "string-output-port", 
                     DFSCH_PRIMITIVE_REF(string_output_port));
+  dfsch_defcanon_cstr(ctx, "local-string-output-port", 
+                    DFSCH_PRIMITIVE_REF(local_string_output_port));
   dfsch_defcanon_cstr(ctx, "string-output-port-value", 
                     DFSCH_PRIMITIVE_REF(string_output_port_value));
   dfsch_defcanon_cstr(ctx, "string-input-port", 
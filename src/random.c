@@ -33,9 +33,14 @@
 #endif
 
 #include <fcntl.h>
+#include <string.h>
 #include <unistd.h>
 #include <errno.h>
 #include <dfsch/sha256.h>
+#include <dfsch/strings.h>
+#include <dfsch/numvector.h>
+#include <dfsch/magic.h>
+#include "internal.h"
 
 dfsch_type_t dfsch_random_state_type = {
   DFSCH_ABSTRACT_TYPE,
@@ -50,8 +55,6 @@ dfsch_type_t dfsch_random_state_type_type = {
   "random-state-type",
 };
 
-static dfsch_object_t* random_state;
-
 typedef struct random_init_t {
   uint8_t uninitialized[16];
   time_t time;
@@ -100,48 +103,51 @@ static void init_seed(random_init_t* seed){
 #endif
 }
 
-static dfsch_object_t* make_default_state(){
-  random_init_t seed;
-  init_seed(&seed);
-  return dfsch_make_default_random_state(&seed, sizeof(random_init_t));
-}
-
-dfsch_object_t* dfsch_get_random_state(){
-  if (!random_state){
-    random_state = make_default_state();
+static dfsch_random_state_type_t* state_type(dfsch_object_t* state){
+  if (DFSCH_TYPE_OF(state)->type != DFSCH_RANDOM_STATE_TYPE_TYPE){
+    dfsch_error("Not a random state", state);
   }
-  return random_state;
-}
-void dfsch_set_random_state(dfsch_object_t* state){
-  random_state = state;
+  return (dfsch_random_state_type_t*)(DFSCH_TYPE_OF(state));
 }
 
 void dfsch_random_get_bytes(dfsch_object_t* state, uint8_t* buf, size_t len){
   if (!state){
     state = dfsch_get_random_state();
   }
-  if (DFSCH_TYPE_OF(state)->type != DFSCH_RANDOM_STATE_TYPE_TYPE){
-    dfsch_error("Not a random state", state);
+  state_type(state)->get_bytes(state, buf, len);
+}
+uint64_t dfsch_random_get_u64(dfsch_object_t* state){
+  dfsch_random_state_type_t* t;
+  uint8_t buf[8];
+  if (!state){
+    state = dfsch_get_random_state();
+  }
+  t = state_type(state);
+  if (t->get_u64){
+    return t->get_u64(state);
   }
-  ((dfsch_random_state_type_t*)(DFSCH_TYPE_OF(state)))->get_bytes(state, buf, len);
+  t->get_bytes(state, buf, 8);
+  return ((uint64_t)buf[0]) | ((uint64_t)buf[1] << 8) 
+    | ((uint64_t)buf[2] << 16) | ((uint64_t)buf[3] << 24)
+    | ((uint64_t)buf[4] << 32) | ((uint64_t)buf[5] << 40) 
+    | ((uint64_t)buf[6] << 48) | ((uint64_t)buf[7] << 56);
 }
 int64_t dfsch_random_get_integer(dfsch_object_t* state, int64_t max){
-  int64_t bits;
-  uint64_t val;
+  uint64_t bits;
+  uint64_t threshold;
+  if (max <= 0){
+    dfsch_error("Maximum must be positive", DFSCH_MAKE_FIXNUM(max));
+  }
+  /* Reject values from incomplete last interval of 2^64 */
+  threshold = (-(uint64_t)max) % (uint64_t)max;
   do {
-    dfsch_random_get_bytes(state, &bits, sizeof(int64_t));
-    if (bits < 0){
-      bits = -bits;
-    }
-    val = bits % max;
-  } while (bits - val + (max+1) < 0);
-  return val;
+    bits = dfsch_random_get_u64(state);
+  } while (bits < threshold);
+  return bits % (uint64_t)max;
 }
 double dfsch_random_get_double(dfsch_object_t* state){
-  uint64_t val;
-  dfsch_random_get_bytes(state, &val, sizeof(uint64_t));
-  val &= (1LL << 53) - 1;
-  return (double)val/(double)(1LL << 53);
+  return (double)(dfsch_random_get_u64(state) >> 11) 
+    / (double)(1LL << 53);
 }
 dfsch_object_t* dfsch_random_get_number(dfsch_object_t* state, 
                                         dfsch_object_t* max){
@@ -173,54 +179,109 @@ dfsch_object_t* dfsch_random_get_bignum(dfsch_object_t* state,
   }
 }
 
+void dfsch_random_fill(dfsch_object_t* state, dfsch_object_t* vector){
+  size_t len;
+  size_t i;
+
+  if (!state){
+    state = dfsch_get_random_state();
+  }
+  state_type(state);
+
+  if (DFSCH_TYPE_OF(vector) == DFSCH_BYTE_VECTOR_TYPE){
+    dfsch_strbuf_t* buf = dfsch_byte_vector_to_buf(vector);
+    dfsch_random_get_bytes(state, buf->ptr, buf->len);
+  } else if (DFSCH_TYPE_OF(vector) == DFSCH_U8VECTOR_TYPE){
+    uint8_t* data = dfsch_u8vector_data(vector, &len);
+    dfsch_random_get_bytes(state, data, len);
+  } else if (DFSCH_TYPE_OF(vector) == DFSCH_S64VECTOR_TYPE){
+    int64_t* data = dfsch_s64vector_data(vector, &len);
+    for (i = 0; i < len; i++){
+      data[i] = dfsch_random_get_u64(state);
+    }
+  } else if (DFSCH_TYPE_OF(vector) == DFSCH_F64VECTOR_TYPE){
+    double* data = dfsch_f64vector_data(vector, &len);
+    for (i = 0; i < len; i++){
+      data[i] = dfsch_random_get_double(state);
+    }
+  } else {
+    dfsch_error("Cannot fill object with random data", vector);
+  }
+}
+
+/*
+ * MT19937, words are generated in blocks of 624 and returned in little
+ * endian byte order
+ */
+
+#define MT_N 624
+#define MT_M 397
+
 typedef struct default_state_t {
   dfsch_type_t* type;
   int mt_index;
-  uint32_t mt[624];
-  int ob_index;
-  uint32_t obuf;
+  uint32_t mt[MT_N];
 } default_state_t;
 
-static uint8_t mt_get_one_byte(default_state_t* state){
+#define MT_MIX(a, b, c)                                                 \
+  ((c) ^ ((((a) & 0x80000000) | ((b) & 0x7fffffff)) >> 1)              \
+   ^ (((b) & 1) ? 0x9908b0df : 0))
+
+static void mt_twist(default_state_t* state){
+  uint32_t* mt = state->mt;
   int i;
-  uint32_t y;
 
-  if (state->ob_index == 0){
-    if (state->mt_index == 0){
-      for (i = 0; i < 624; i++){
-        y = (state->mt[i] &  0x80000000) +
-          (state->mt[(i + 1) % 624] & 0x7fffffff);
-        state->mt[i] = state->mt[(i + 397) % 624] ^ (y >> 1);
-        if (y & 0x00000001){
-          state->mt[i] ^= 0x9908b0df;
-        }
-      }
-    }
-    
-    y = state->mt[state->mt_index];
-    y ^= y >> 11;
-    y ^= (y << 7) & 0x9d2c5680;
-    y ^= (y << 15) & 0xefc60000;
-    y ^= y >> 18;
-    state->ob_index = 3;
-    state->obuf = y >> 8;
-    return y & 0xff;
-  } else {
-    state->ob_index--;
-    y = state->obuf;
-    state->obuf = y >> 8;
-    return y & 0xff;
+  for (i = 0; i < MT_N - MT_M; i++){
+    mt[i] = MT_MIX(mt[i], mt[i + 1], mt[i + MT_M]);
+  }
+  for (; i < MT_N - 1; i++){
+    mt[i] = MT_MIX(mt[i], mt[i + 1], mt[i + MT_M - MT_N]);
   }
+  mt[MT_N - 1] = MT_MIX(mt[MT_N - 1], mt[0], mt[MT_M - 1]);
+  state->mt_index = 0;
+}
+
+static uint32_t mt_get_word(default_state_t* state){
+  uint32_t y;
 
+  if (state->mt_index >= MT_N){
+    mt_twist(state);
+  }
+    
+  y = state->mt[state->mt_index++];
+  y ^= y >> 11;
+  y ^= (y << 7) & 0x9d2c5680;
+  y ^= (y << 15) & 0xefc60000;
+  y ^= y >> 18;
+  return y;
 }
 
 static void default_get_bytes(default_state_t* state, uint8_t* buf, size_t len){
-  while (len){
-    *buf = mt_get_one_byte(state);
-    buf++;
-    len--;
+  uint32_t y;
+
+  while (len >= 4){
+    y = mt_get_word(state);
+    buf[0] = y;
+    buf[1] = y >> 8;
+    buf[2] = y >> 16;
+    buf[3] = y >> 24;
+    buf += 4;
+    len -= 4;
+  }
+  if (len){
+    y = mt_get_word(state);
+    while (len){
+      *buf = y;
+      y >>= 8;
+      buf++;
+      len--;
+    }
   }
 }
+static uint64_t default_get_u64(default_state_t* state){
+  uint64_t lo = mt_get_word(state);
+  return lo | ((uint64_t)mt_get_word(state) << 32);
+}
 
 dfsch_random_state_type_t dfsch_default_random_state_type = {
   {
@@ -234,14 +295,14 @@ dfsch_random_state_type_t dfsch_default_random_state_type = {
     NULL
   },
   (dfsch_random_get_bytes_t)default_get_bytes,
-  1
+  1,
+  (dfsch_random_get_u64_t)default_get_u64
 };
 dfsch_object_t* dfsch_make_default_random_state(uint8_t* seed, size_t len){
   default_state_t* state = dfsch_make_object(DFSCH_DEFAULT_RANDOM_STATE_TYPE);
   int i;
   
-  state->ob_index = 0;
-  state->mt_index = 0;
+  state->mt_index = MT_N;
   
   if (len == 0){
     seed = "0000";
@@ -253,7 +314,7 @@ dfsch_object_t* dfsch_make_default_random_state(uint8_t* seed, size_t len){
     | (seed[2 % len] << 16)
     | (seed[3 % len] << 24);
 
-  for (i = 1; i < 624; i++){
+  for (i = 1; i < MT_N; i++){
     state->mt[i] = (seed[(i*4 + 0) % len] 
                     | (seed[(i*4 + 1) % len] << 8)
                     | (seed[(i*4 + 2) % len] << 16)
@@ -357,6 +418,140 @@ dfsch_object_t* dfsch_make_lcg_random_state(uint32_t seed){
   return lcg;
 }
 
+/*
+ * xoshiro256** by David Blackman and Sebastiano Vigna, produces 64 bits
+ * per step and supports jumping ahead by 2^128 steps, which is used to
+ * derive independent streams from one seed.
+ */
+
+typedef struct xoshiro_state_t {
+  dfsch_type_t* type;
+  uint64_t s[4];
+} xoshiro_state_t;
+
+static inline uint64_t rotl(uint64_t x, int k){
+  return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t xoshiro_next(xoshiro_state_t* state){
+  uint64_t* s = state->s;
+  uint64_t result = rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+
+  return result;
+}
+
+static void xoshiro_jump(xoshiro_state_t* state){
+  static const uint64_t jump[] = { 
+    0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 
+    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL 
+  };
+  uint64_t s[4] = {0, 0, 0, 0};
+  int i;
+  int b;
+
+  for (i = 0; i < 4; i++){
+    for (b = 0; b < 64; b++){
+      if (jump[i] & (1ULL << b)){
+        s[0] ^= state->s[0];
+        s[1] ^= state->s[1];
+        s[2] ^= state->s[2];
+        s[3] ^= state->s[3];
+      }
+      xoshiro_next(state);
+    }
+  }
+  memcpy(state->s, s, sizeof(s));
+}
+
+static void xoshiro_get_bytes(xoshiro_state_t* state, 
+                              uint8_t* buf, size_t len){
+  uint64_t y;
+  int i;
+
+  while (len >= 8){
+    y = xoshiro_next(state);
+    for (i = 0; i < 8; i++){
+      buf[i] = y >> (i * 8);
+    }
+    buf += 8;
+    len -= 8;
+  }
+  if (len){
+    y = xoshiro_next(state);
+    while (len){
+      *buf = y;
+      y >>= 8;
+      buf++;
+      len--;
+    }
+  }
+}
+
+dfsch_random_state_type_t dfsch_xoshiro_random_state_type = {
+  {
+    DFSCH_RANDOM_STATE_TYPE_TYPE,
+    DFSCH_RANDOM_STATE_TYPE,
+    sizeof(xoshiro_state_t),
+    "xoshiro-random-state",
+    NULL,
+    NULL,
+    NULL,
+    NULL
+  },
+  (dfsch_random_get_bytes_t)xoshiro_get_bytes,
+  1,
+  (dfsch_random_get_u64_t)xoshiro_next
+};
+
+dfsch_object_t* dfsch_make_xoshiro_random_state(uint8_t* seed, size_t len){
+  xoshiro_state_t* state = dfsch_make_object(DFSCH_XOSHIRO_RANDOM_STATE_TYPE);
+  dfsch_sha256_context_t ctx;
+  uint8_t digest[32];
+  int i;
+  int j;
+
+  dfsch_sha256_setup(&ctx);
+  dfsch_sha256_process(&ctx, seed, len);
+  dfsch_sha256_result(&ctx, digest);
+
+  for (i = 0; i < 4; i++){
+    state->s[i] = 0;
+    for (j = 0; j < 8; j++){
+      state->s[i] |= (uint64_t)digest[i * 8 + j] << (j * 8);
+    }
+  }
+  if (!(state->s[0] | state->s[1] | state->s[2] | state->s[3])){
+    state->s[0] = 1; /* all-zero state is fixed point */
+  }
+
+  return (dfsch_object_t*)state;
+}
+
+dfsch_object_t* dfsch_random_state_jump(dfsch_object_t* state, size_t count){
+  xoshiro_state_t* orig;
+  xoshiro_state_t* res;
+
+  if (!state){
+    state = dfsch_get_random_state();
+  }
+  orig = DFSCH_ASSERT_INSTANCE(state, DFSCH_XOSHIRO_RANDOM_STATE_TYPE);
+  res = dfsch_make_object(DFSCH_XOSHIRO_RANDOM_STATE_TYPE);
+  memcpy(res->s, orig->s, sizeof(res->s));
+  while (count){
+    xoshiro_jump(res);
+    count--;
+  }
+  return (dfsch_object_t*)res;
+}
+
 static pthread_mutex_t id_mutex = PTHREAD_MUTEX_INITIALIZER;
 static random_init_t id_seed;
 static char id_last[32];
@@ -408,6 +603,214 @@ int dfsch_check_scoped_id(char id[20], char scope[16]){
 }
 
 
+/*
+ * Default random state is per-thread. Each thread gets its own stream of
+ * xoshiro256** derived from master seed by jumping ahead, streams are
+ * allocated in order in which threads are created (or first ask for
+ * random numbers), so runs with the same master seed and same order of
+ * thread creation are reproducible.
+ *
+ * Only owning thread replaces its state. States restored from snapshot
+ * for other threads are stored as pending (under streams_mutex) and 
+ * picked up by owning thread on its next use of default state.
+ */
+
+typedef struct thread_slot_t thread_slot_t;
+struct thread_slot_t {
+  dfsch_object_t* state;
+  dfsch_object_t* volatile pending;
+  thread_slot_t* next;
+  thread_slot_t* prev;
+};
+
+static pthread_mutex_t streams_mutex = PTHREAD_MUTEX_INITIALIZER;
+static xoshiro_state_t* next_stream;
+static thread_slot_t* slots;
+
+static xoshiro_state_t* copy_xoshiro(xoshiro_state_t* state){
+  xoshiro_state_t* res = dfsch_make_object(DFSCH_XOSHIRO_RANDOM_STATE_TYPE);
+  memcpy(res->s, state->s, sizeof(res->s));
+  return res;
+}
+
+static void init_next_stream(){
+  random_init_t seed;
+
+  if (!next_stream){
+    init_seed(&seed);
+    next_stream = 
+      (xoshiro_state_t*)dfsch_make_xoshiro_random_state((uint8_t*)&seed, 
+                                                        sizeof(seed));
+  }
+}
+
+static dfsch_object_t* allocate_stream(){
+  xoshiro_state_t* res;
+
+  init_next_stream();
+  res = copy_xoshiro(next_stream);
+  xoshiro_jump(next_stream);
+  return (dfsch_object_t*)res;
+}
+
+dfsch_object_t* dfsch_random_make_stream(){
+  dfsch_object_t* res;
+  pthread_mutex_lock(&streams_mutex);
+  res = allocate_stream();
+  pthread_mutex_unlock(&streams_mutex);
+  return res;
+}
+
+static thread_slot_t* get_slot(dfsch__thread_info_t* ti, 
+                               dfsch_object_t* state){
+  thread_slot_t* slot = ti->random;
+
+  if (DFSCH_UNLIKELY(!slot)){
+    slot = GC_NEW(thread_slot_t);
+    pthread_mutex_lock(&streams_mutex);
+    slot->state = state ? state : allocate_stream();
+    slot->pending = NULL;
+    slot->prev = NULL;
+    slot->next = slots;
+    if (slots){
+      slots->prev = slot;
+    }
+    slots = slot;
+    pthread_mutex_unlock(&streams_mutex);
+    ti->random = slot;
+  }
+  return slot;
+}
+
+void dfsch__random_thread_exit(dfsch__thread_info_t* ti){
+  thread_slot_t* slot = ti->random;
+  if (!slot){
+    return;
+  }
+  pthread_mutex_lock(&streams_mutex);
+  if (slot->prev){
+    slot->prev->next = slot->next;
+  } else {
+    slots = slot->next;
+  }
+  if (slot->next){
+    slot->next->prev = slot->prev;
+  }
+  pthread_mutex_unlock(&streams_mutex);
+  ti->random = NULL;
+}
+
+dfsch_object_t* dfsch_get_random_state(){
+  thread_slot_t* slot = get_slot(dfsch__get_thread_info(), NULL);
+
+  if (DFSCH_UNLIKELY(slot->pending != NULL)){
+    pthread_mutex_lock(&streams_mutex);
+    slot->state = slot->pending;
+    slot->pending = NULL;
+    pthread_mutex_unlock(&streams_mutex);
+  }
+  return slot->state;
+}
+void dfsch_set_random_state(dfsch_object_t* state){
+  thread_slot_t* slot = get_slot(dfsch__get_thread_info(), state);
+  pthread_mutex_lock(&streams_mutex);
+  slot->state = state;
+  slot->pending = NULL;
+  pthread_mutex_unlock(&streams_mutex);
+}
+
+void dfsch_random_set_seed(uint8_t* seed, size_t len){
+  thread_slot_t* slot = get_slot(dfsch__get_thread_info(), NULL);
+  pthread_mutex_lock(&streams_mutex);
+  next_stream = 
+    (xoshiro_state_t*)dfsch_make_xoshiro_random_state(seed, len);
+  slot->state = allocate_stream();
+  slot->pending = NULL;
+  pthread_mutex_unlock(&streams_mutex);
+}
+
+/*
+ * Snapshots hold copies of all per-thread states of deterministic types,
+ * other states (reading files) are stored as is.
+ */
+
+typedef struct snapshot_entry_t {
+  thread_slot_t* slot;
+  dfsch_object_t* state;
+} snapshot_entry_t;
+
+typedef struct random_snapshot_t {
+  dfsch_type_t* type;
+  dfsch_object_t* next_stream;
+  size_t count;
+  snapshot_entry_t* entries;
+} random_snapshot_t;
+
+dfsch_type_t dfsch_random_snapshot_type = {
+  DFSCH_STANDARD_TYPE,
+  NULL,
+  sizeof(random_snapshot_t),
+  "random-snapshot",
+  NULL,
+  NULL,
+  NULL
+};
+
+static dfsch_object_t* copy_state(dfsch_object_t* state){
+  dfsch_random_state_type_t* type = state_type(state);
+  dfsch_object_t* res;
+  if (!type->deterministic){
+    return state;
+  }
+  res = dfsch_make_object((dfsch_type_t*)type);
+  memcpy(res, state, type->type.size);
+  return res;
+}
+
+dfsch_object_t* dfsch_random_save_states(){
+  random_snapshot_t* snap = dfsch_make_object(DFSCH_RANDOM_SNAPSHOT_TYPE);
+  thread_slot_t* slot;
+  size_t i;
+
+  dfsch_get_random_state();
+
+  pthread_mutex_lock(&streams_mutex);
+  init_next_stream();
+  snap->next_stream = dfsch_make_object(DFSCH_XOSHIRO_RANDOM_STATE_TYPE);
+  memcpy(snap->next_stream, next_stream, sizeof(xoshiro_state_t));
+  snap->count = 0;
+  for (slot = slots; slot; slot = slot->next){
+    snap->count++;
+  }
+  snap->entries = GC_MALLOC(sizeof(snapshot_entry_t) * snap->count);
+  for (i = 0, slot = slots; slot; slot = slot->next, i++){
+    snap->entries[i].slot = slot;
+    snap->entries[i].state = copy_state(slot->pending ? 
+                                        slot->pending : slot->state);
+  }
+  pthread_mutex_unlock(&streams_mutex);
+
+  return (dfsch_object_t*)snap;
+}
+void dfsch_random_restore_states(dfsch_object_t* snapshot){
+  random_snapshot_t* snap = DFSCH_ASSERT_INSTANCE(snapshot, 
+                                                  DFSCH_RANDOM_SNAPSHOT_TYPE);
+  thread_slot_t* own = get_slot(dfsch__get_thread_info(), NULL);
+  size_t i;
+
+  pthread_mutex_lock(&streams_mutex);
+  next_stream = copy_xoshiro((xoshiro_state_t*)snap->next_stream);
+  for (i = 0; i < snap->count; i++){
+    if (snap->entries[i].slot == own){
+      own->state = copy_state(snap->entries[i].state);
+      own->pending = NULL;
+    } else {
+      snap->entries[i].slot->pending = copy_state(snap->entries[i].state);
+    }
+  }
+  pthread_mutex_unlock(&streams_mutex);
+}
+
 DFSCH_DEFINE_PRIMITIVE(random_bytes, 0){
   size_t len;
   uint8_t *buf;
@@ -446,6 +849,17 @@ DFSCH_DEFINE_PRIMITIVE(random, 0){
 
   return dfsch_random_get_number(state, max);
 }
+DFSCH_DEFINE_PRIMITIVE(random_fill, 
+                       "Fill byte-vector or numeric vector with random data"){
+  dfsch_object_t* vector;
+  dfsch_object_t* state;
+  DFSCH_OBJECT_ARG(args, vector);
+  DFSCH_OBJECT_ARG_OPT(args, state, NULL);
+  DFSCH_ARG_END(args);
+
+  dfsch_random_fill(state, vector);
+  return vector;
+}
 DFSCH_DEFINE_PRIMITIVE(make_default_random_state, 0){
   dfsch_strbuf_t* seed;
   DFSCH_BUFFER_ARG(args, seed);
@@ -466,6 +880,46 @@ DFSCH_DEFINE_PRIMITIVE(make_lcg_random_state, 0){
   return dfsch_make_lcg_random_state(seed);
 }
 
+DFSCH_DEFINE_PRIMITIVE(make_xoshiro_random_state, 0){
+  dfsch_strbuf_t* seed;
+  DFSCH_BUFFER_ARG(args, seed);
+  DFSCH_ARG_END(args);
+  return dfsch_make_xoshiro_random_state(seed->ptr, seed->len);
+}
+DFSCH_DEFINE_PRIMITIVE(random_state_jump, 
+                       "Return independent copy of random state advanced "
+                       "by count * 2^128 steps"){
+  dfsch_object_t* state;
+  size_t count;
+  DFSCH_OBJECT_ARG(args, state);
+  DFSCH_LONG_ARG_OPT(args, count, 1);
+  DFSCH_ARG_END(args);
+  return dfsch_random_state_jump(state, count);
+}
+
+DFSCH_DEFINE_PRIMITIVE(set_random_seed, 
+                       "Reseed per-thread random states from master seed, "
+                       "current thread gets first stream"){
+  dfsch_strbuf_t* seed;
+  DFSCH_BUFFER_ARG(args, seed);
+  DFSCH_ARG_END(args);
+  dfsch_random_set_seed(seed->ptr, seed->len);
+  return NULL;
+}
+DFSCH_DEFINE_PRIMITIVE(save_random_states, 
+                       "Snapshot random states of all threads"){
+  DFSCH_ARG_END(args);
+  return dfsch_random_save_states();
+}
+DFSCH_DEFINE_PRIMITIVE(restore_random_states, 
+                       "Restore random states of all threads from snapshot"){
+  dfsch_object_t* snapshot;
+  DFSCH_OBJECT_ARG(args, snapshot);
+  DFSCH_ARG_END(args);
+  dfsch_random_restore_states(snapshot);
+  return NULL;
+}
+
 DFSCH_DEFINE_PRIMITIVE(get_random_id, 0){
   char buf[16];
   DFSCH_ARG_END(args);
@@ -515,11 +969,22 @@ void dfsch__random_register(dfsch_object_t *ctx){
                     DFSCH_DEFAULT_RANDOM_STATE_TYPE);
   dfsch_defcanon_cstr(ctx, "<file-random-state>", DFSCH_FILE_RANDOM_STATE_TYPE);
   dfsch_defcanon_cstr(ctx, "<lcg-random-state>", DFSCH_LCG_RANDOM_STATE_TYPE);
+  dfsch_defcanon_cstr(ctx, "<xoshiro-random-state>", 
+                    DFSCH_XOSHIRO_RANDOM_STATE_TYPE);
 
   dfsch_defcanon_cstr(ctx, "random-bytes", DFSCH_PRIMITIVE_REF(random_bytes));
   dfsch_defcanon_cstr(ctx, "random-flonum", DFSCH_PRIMITIVE_REF(random_flonum));
   dfsch_defcanon_cstr(ctx, "random-bignum", DFSCH_PRIMITIVE_REF(random_bignum));
   dfsch_defcanon_cstr(ctx, "random", DFSCH_PRIMITIVE_REF(random));
+  dfsch_defcanon_cstr(ctx, "random-fill!", DFSCH_PRIMITIVE_REF(random_fill));
+
+  dfsch_defcanon_cstr(ctx, "<random-snapshot>", DFSCH_RANDOM_SNAPSHOT_TYPE);
+  dfsch_defcanon_cstr(ctx, "set-random-seed!", 
+                    DFSCH_PRIMITIVE_REF(set_random_seed));
+  dfsch_defcanon_cstr(ctx, "save-random-states", 
+                    DFSCH_PRIMITIVE_REF(save_random_states));
+  dfsch_defcanon_cstr(ctx, "restore-random-states!", 
+                    DFSCH_PRIMITIVE_REF(restore_random_states));
 
   dfsch_defcanon_cstr(ctx, "make-default-random-state", 
                     DFSCH_PRIMITIVE_REF(make_default_random_state));
@@ -527,6 +992,10 @@ void dfsch__random_register(dfsch_object_t *ctx){
                     DFSCH_PRIMITIVE_REF(make_file_random_state));
   dfsch_defcanon_cstr(ctx, "make-lcg-random-state", 
                     DFSCH_PRIMITIVE_REF(make_lcg_random_state));
+  dfsch_defcanon_cstr(ctx, "make-xoshiro-random-state", 
+                    DFSCH_PRIMITIVE_REF(make_xoshiro_random_state));
+  dfsch_defcanon_cstr(ctx, "random-state-jump", 
+                    DFSCH_PRIMITIVE_REF(random_state_jump));
 
   dfsch_defcanon_cstr(ctx, "get-random-id", 
                     DFSCH_PRIMITIVE_REF(get_random_id));
@@ -36,6 +36,7 @@
 #include <dfsch/lib/cinspect.h>
 #include <dfsch/lib/cmdopts.h>
 #include <dfsch/lib/console.h>
+#include <dfsch/lib/crypto.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -126,6 +127,8 @@ static void load_scm(dfsch_object_t* env, char* fname){
 }
 
 
+static char* crypto_autoload_names[] = DFSCH_CRYPTO_AUTOLOAD_NAMES;
+
 int main(int argc, char**argv){
   int c;
   dfsch_object_t* ctx;
@@ -147,11 +150,12 @@ int main(int argc, char**argv){
   dfsch_activate_segv_handler();
 
   ctx = dfsch_make_top_level_environment();
+  dfsch_autoload_pkgcstr(ctx, "crypto", "crypto", crypto_autoload_names);
 
   dfsch_set_standard_io_ports();
   dfsch_cinspect_set_as_inspector();                                        
 
-  while ((c=getopt(argc, argv, "+ir:l:L:e:E:hvdX:?")) != -1){
+  while ((c=getopt(argc, argv, "+ir:l:L:I:e:E:hvdX:?")) != -1){
     switch (c){
     case 'r':
       dfsch_require(ctx, optarg, NULL);
@@ -162,6 +166,9 @@ int main(int argc, char**argv){
     case 'L':
       dfsch_load_extend_path(ctx, optarg);
       break;
+    case 'I':
+      dfsch_load_image(ctx, optarg);
+      break;
     case 'X':
       if (strcmp(optarg, "help") == 0 || strcmp(optarg, "list") == 0){
         dfsch_print_vm_parameters();
@@ -203,6 +210,7 @@ int main(int argc, char**argv){
       puts("  -l <filename>     Load scheme file on startup");
       puts("  -r <module-name>  Require (load) module on startup");
       puts("  -L <directory>    Append directory to *load-path*");
+      puts("  -I <filename>     Restore image saved by save-image!");
       puts("  -e <expression>   Execute given expression");
       puts("  -E <expression>   Evaluate given expression");
       puts("  -X <name>=<value> Set VM parameter");
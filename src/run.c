@@ -29,6 +29,7 @@
 #include <dfsch/load.h>
 #include <dfsch/ports.h>
 #include <dfsch/lib/cmdopts.h>
+#include <dfsch/lib/crypto.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -54,6 +55,8 @@ static void sigint_handler_break(int sig){
   dfsch_async_apply_self(DFSCH_PRIMITIVE_REF(break));
 }
 
+static char* crypto_autoload_names[] = DFSCH_CRYPTO_AUTOLOAD_NAMES;
+
 int main(int argc, char**argv){
   int c;
   dfsch_object_t* ctx;
@@ -75,13 +78,17 @@ int main(int argc, char**argv){
   dfsch_activate_segv_handler();
 
   ctx = dfsch_make_top_level_environment();
+  dfsch_autoload_pkgcstr(ctx, "crypto", "crypto", crypto_autoload_names);
   dfsch_set_standard_io_ports();
                                         
-  while ((c=getopt(argc, argv, "+L:X:mzvch?" WINDOWS_FLAGS)) != -1){
+  while ((c=getopt(argc, argv, "+L:I:X:mzvch?" WINDOWS_FLAGS)) != -1){
     switch (c){
     case 'L':
       dfsch_load_extend_path(ctx, optarg);
       break;
+    case 'I':
+      dfsch_load_image(ctx, optarg);
+      break;
     case 'm':
       run_module = 1;
       break;
@@ -118,6 +125,7 @@ int main(int argc, char**argv){
       printf("Usage: %s [<options>] [<filename> ...]\n\n", argv[0]);
       puts("Options:");
       puts("  -L <directory>    Append directory to *load-path*");
+      puts("  -I <filename>     Restore image saved by save-image!");
       puts("  -X <name>=<value> Set VM parameter");
       puts("     +<name>          to 1");
       puts("     -<name>          to 0");
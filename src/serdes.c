@@ -4,6 +4,9 @@
 #include <dfsch/ports.h>
 
 #include "util.h"
+#include "internal.h"
+
+#include <pthread.h>
 
 /*
  * Integer serialization format:
@@ -50,6 +53,8 @@ struct dfsch_serializer_t {
   int obj_idx;
   dfsch_strhash_t sym_map;
   int sym_idx;
+  dfsch_eqhash_t plan_map;
+  int plan_idx;
 
   dfsch_output_proc_t oproc;
   void* op_baton;
@@ -62,6 +67,7 @@ struct dfsch_serializer_t {
 
   dfsch_object_t* canon_env;
   int compress;
+  size_t lazy_threshold;
 };
 
 dfsch_type_t dfsch_serializer_type = {
@@ -82,6 +88,8 @@ dfsch_serializer_t* dfsch_make_serializer(dfsch_output_proc_t op,
   s->sym_idx = 0;
   dfsch_eqhash_init(&s->obj_map, 1);
   s->obj_idx = 0;
+  dfsch_eqhash_init(&s->plan_map, 0);
+  s->plan_idx = 0;
   s->compress = 0;
 
   return s;
@@ -106,7 +114,31 @@ void dfsch_serializer_set_canonical_environment(dfsch_serializer_t* s,
                                                 dfsch_object_t* env){
   s->canon_env = env;
 }
+void dfsch_serializer_set_lazy_threshold(dfsch_serializer_t* s,
+                                         size_t threshold){
+  s->lazy_threshold = threshold;
+}
+
+
+/*
+ * Plans describe layout shared by many objects (eg. slots of class) and
+ * are written into stream only once, later objects refer to them by
+ * stream-local index assigned in order of their first occurence. 
+ */
 
+int dfsch_serializer_plan_index(dfsch_serializer_t* s,
+                                dfsch_object_t* key){
+  dfsch_object_t* idx = dfsch_eqhash_ref(&s->plan_map, key);
+  if (idx == DFSCH_INVALID_OBJECT){
+    return -1;
+  }
+  return (int)idx;
+}
+int dfsch_serializer_add_plan(dfsch_serializer_t* s,
+                              dfsch_object_t* key){
+  dfsch_eqhash_set(&s->plan_map, key, (dfsch_object_t*)(s->plan_idx));
+  return s->plan_idx++;
+}
 
 static void serialize_bytes(dfsch_serializer_t* s,
                             char* buf,
@@ -163,6 +195,54 @@ void dfsch_serialize_invalid_object(dfsch_serializer_t* s){
   dfsch_serialize_stream_symbol(s, "invalid-object");
 }
 
+/*
+ * Lazy subtrees:
+ *  - stream symbol "lazy-object"
+ *  - length as integer
+ *  - independent serialized stream of the subtree (*length), sharing
+ *    only canonical environment with enclosing stream
+ *
+ * Subtree occupies exactly one object index in enclosing stream, so back
+ * references around it stay valid, but its contents cannot refer to
+ * objects outside of it. Deserializers either build it immediately or
+ * wrap it in lazy-object proxy that deserializes it on first access.
+ */
+
+static int lazy_candidate_p(dfsch_object_t* obj, size_t threshold){
+  dfsch_type_t* type = DFSCH_TYPE_OF(obj);
+
+  if (type == DFSCH_VECTOR_TYPE){
+    return dfsch_vector_length(obj) >= threshold;
+  }
+  if (type == DFSCH_STRING_TYPE || type == DFSCH_BYTE_VECTOR_TYPE){
+    return dfsch_string_to_buf(obj)->len >= threshold;
+  }
+  return 0;
+}
+
+static void serialize_lazy_payload(dfsch_serializer_t* s,
+                                   dfsch_strbuf_t* payload){
+  dfsch_serialize_stream_symbol(s, "lazy-object");
+  dfsch_serialize_integer(s, payload->len);
+  serialize_bytes(s, payload->ptr, payload->len);
+}
+
+static void serialize_lazy_object(dfsch_serializer_t* s,
+                                  dfsch_object_t* obj){
+  str_list_t* sl = sl_create();
+  dfsch_serializer_t* sub = dfsch_make_serializer(sl_nappend, sl);
+
+  sub->canon_env = s->canon_env;
+  sub->compress = s->compress;
+  sub->object_hook = s->object_hook;
+  sub->oh_baton = s->oh_baton;
+  sub->unserializable = s->unserializable;
+  sub->uh_baton = s->uh_baton;
+
+  dfsch_serialize_object(sub, obj);
+  serialize_lazy_payload(s, dfsch_sl_value_strbuf(sl));
+}
+
 void dfsch_serialize_object(dfsch_serializer_t* s,
                             dfsch_object_t* obj){
   dfsch_type_t* klass;
@@ -173,11 +253,13 @@ void dfsch_serialize_object(dfsch_serializer_t* s,
       return;
     }  
     
-    dfsch_put_serialized_object(s, obj);
+    /* not yet in obj_map, so no need to look for existing entry */
+    dfsch_eqhash_put(&s->obj_map, obj, (dfsch_object_t*)(s->obj_idx));
+    s->obj_idx++;
   }
 
   if (s->canon_env){
-    dfsch_object_t* sym = dfsch_env_revscan(s->canon_env, obj, 1);
+    dfsch_object_t* sym = dfsch_env_canonical_name(s->canon_env, obj);
     if (sym != DFSCH_INVALID_OBJECT && DFSCH_SYMBOL_P(sym)){
       dfsch_package_t* package = dfsch_symbol_package(sym);
       char* name = dfsch_symbol(sym);
@@ -190,6 +272,11 @@ void dfsch_serialize_object(dfsch_serializer_t* s,
     }
   }
 
+  if (s->lazy_threshold && lazy_candidate_p(obj, s->lazy_threshold)){
+    serialize_lazy_object(s, obj);
+    return;
+  }
+
   if (s->object_hook){
     if (s->object_hook(s, obj, s->oh_baton)){
       return;
@@ -215,7 +302,8 @@ void dfsch_serialize_object(dfsch_serializer_t* s,
 
 void dfsch_serialize_integer(dfsch_serializer_t* s,
                              int64_t i){
-  char *buf = GC_MALLOC_ATOMIC(9);
+  /* Output procedures copy short buffers, so this does not escape */
+  char buf[9];
 
   if (i >= -(1 << 6) && (i < (1 << 6))){
     buf[0] = i & 0x7f;
@@ -353,6 +441,13 @@ struct dfsch_deserializer_t {
   void* uh_baton;
 
   dfsch_object_t* canon_env;
+
+  int lazy;
+  dfsch_object_t* lazy_source;
+
+  void** plans;
+  size_t plans_len;
+  size_t plan_idx;
 };
 
 dfsch_type_t dfsch_deserializer_type = {
@@ -399,10 +494,30 @@ dfsch_deserializer_t* dfsch_deserializer(dfsch_object_t* obj){
   return DFSCH_ASSERT_INSTANCE(obj, DFSCH_DESERIALIZER_TYPE);
 }
 
+void dfsch_deserializer_add_plan(dfsch_deserializer_t* ds, void* plan){
+  if (ds->plan_idx >= ds->plans_len){
+    ds->plans_len = ds->plans_len ? ds->plans_len * 2 : 16;
+    ds->plans = GC_REALLOC(ds->plans, ds->plans_len * sizeof(void*));
+  }
+  ds->plans[ds->plan_idx] = plan;
+  ds->plan_idx++;
+}
+void* dfsch_deserializer_plan_ref(dfsch_deserializer_t* ds, int idx){
+  if (idx < 0 || idx >= ds->plan_idx){
+    dfsch_error("Invalid plan reference in stream", ds);
+  }
+  return ds->plans[idx];
+}
+
 void dfsch_deserializer_set_canonical_environment(dfsch_deserializer_t* ds,
                                                   dfsch_object_t* env){
   ds->canon_env = env;
 }
+void dfsch_deserializer_set_lazy(dfsch_deserializer_t* ds,
+                                 dfsch_object_t* source){
+  ds->lazy = 1;
+  ds->lazy_source = source;
+}
 
 
 static void deserialize_bytes(dfsch_deserializer_t* ds, char*buf, size_t len){
@@ -506,11 +621,10 @@ void dfsch_deserializer_put_partial_object(dfsch_deserializer_t* ds,
   *(dfsch_deserializer__skip_object(ds)) = obj;
 }
 
-int64_t dfsch_deserialize_integer(dfsch_deserializer_t* ds){
-  unsigned char lead;
+static int64_t deserialize_integer_rest(dfsch_deserializer_t* ds,
+                                        unsigned char lead){
   unsigned char buf[8];
   int64_t val = 0;
-  deserialize_bytes(ds, &lead, 1);
 
   if ((lead & 0x80) == 0x00){
     val = lead;
@@ -584,6 +698,11 @@ int64_t dfsch_deserialize_integer(dfsch_deserializer_t* ds){
 
   return val;
 }
+int64_t dfsch_deserialize_integer(dfsch_deserializer_t* ds){
+  unsigned char lead;
+  deserialize_bytes(ds, &lead, 1);
+  return deserialize_integer_rest(ds, lead);
+}
 dfsch_strbuf_t* dfsch_deserialize_strbuf(dfsch_deserializer_t* ds){
   dfsch_strbuf_t* s = GC_NEW(dfsch_strbuf_t);
   long len;
@@ -710,6 +829,284 @@ dfsch_object_t* dfsch_deserialize(dfsch_strbuf_t* sb,
   return dfsch_deserialize_object(ds);
 }
 
+/*
+ * Lazy objects and record streams
+ *
+ * Lazy object is forced transparently only through generic sequence and
+ * collection protocols (seq-ref, seq-length, iteration...). Type
+ * specific accessors (vector-ref, string-ref, car...) do not know about
+ * the proxy and signal type error for unforced object, such values have
+ * to be passed through force-lazy first.
+ */
+
+typedef struct lazy_object_t {
+  dfsch_type_t* type;
+  dfsch_object_t* value;
+  dfsch_strbuf_t* data; /* NULL when forced */
+  dfsch_object_t* source;
+  dfsch_object_t* canon_env;
+} lazy_object_t;
+
+static pthread_mutex_t lazy_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static dfsch_strbuf_t* lazy_object_data(lazy_object_t* lo, 
+                                        dfsch_object_t** value){
+  dfsch_strbuf_t* data;
+  pthread_mutex_lock(&lazy_mutex);
+  data = lo->data;
+  *value = lo->value;
+  pthread_mutex_unlock(&lazy_mutex);
+  return data;
+}
+
+dfsch_object_t* dfsch_force_lazy_object(dfsch_object_t* obj){
+  lazy_object_t* lo;
+  dfsch_strbuf_t* data;
+  dfsch_object_t* value;
+
+  if (DFSCH_TYPE_OF(obj) != DFSCH_LAZY_OBJECT_TYPE){
+    return obj;
+  }
+  lo = (lazy_object_t*)obj;
+
+  data = lazy_object_data(lo, &value);
+  if (!data){
+    return value;
+  }
+
+  /* Deserialized outside of lock, concurrent forcing threads agree on
+     whichever result was stored first */
+  value = dfsch_deserialize(data, lo->canon_env);
+
+  pthread_mutex_lock(&lazy_mutex);
+  if (lo->data){
+    lo->value = value;
+    lo->data = NULL;
+    lo->source = NULL;
+  }
+  value = lo->value;
+  pthread_mutex_unlock(&lazy_mutex);
+
+  return value;
+}
+int dfsch_lazy_object_forced_p(dfsch_object_t* obj){
+  dfsch_object_t* value;
+  lazy_object_t* lo = DFSCH_ASSERT_TYPE(obj, DFSCH_LAZY_OBJECT_TYPE);
+  return lazy_object_data(lo, &value) == NULL;
+}
+
+static dfsch_object_t* lazy_ref(dfsch_object_t* lo, int k){
+  return dfsch_sequence_ref(dfsch_force_lazy_object(lo), k);
+}
+static void lazy_set(dfsch_object_t* lo, int k, dfsch_object_t* value){
+  dfsch_sequence_set(dfsch_force_lazy_object(lo), k, value);
+}
+static size_t lazy_length(dfsch_object_t* lo){
+  return dfsch_sequence_length(dfsch_force_lazy_object(lo));
+}
+static dfsch_object_t* lazy_get_iterator(dfsch_object_t* lo){
+  return dfsch_collection_get_iterator(dfsch_force_lazy_object(lo));
+}
+
+static dfsch_sequence_methods_t lazy_sequence = {
+  .ref = lazy_ref,
+  .set = lazy_set,
+  .length = lazy_length,
+};
+static dfsch_collection_methods_t lazy_collection = {
+  .get_iterator = lazy_get_iterator,
+};
+
+/* Unforced objects are written back without being deserialized */
+static void lazy_serialize(lazy_object_t* lo, dfsch_serializer_t* s){
+  dfsch_object_t* value;
+  dfsch_strbuf_t* data = lazy_object_data(lo, &value);
+
+  if (data){
+    serialize_lazy_payload(s, data);
+  } else {
+    serialize_lazy_object(s, value);
+  }
+}
+
+dfsch_type_t dfsch_lazy_object_type = {
+  .type = DFSCH_STANDARD_TYPE,
+  .superclass = NULL,
+  .name = "lazy-object",
+  .size = sizeof(lazy_object_t),
+  .documentation = "Serialized subtree deserialized on first access",
+  .sequence = &lazy_sequence,
+  .collection = &lazy_collection,
+  .serialize = lazy_serialize,
+};
+
+/* Reads len bytes, sharing storage with input when reading from memory */
+static dfsch_strbuf_t* deserialize_slice(dfsch_deserializer_t* ds,
+                                         size_t len){
+  char* buf;
+
+  if (ds->iproc == (dfsch_input_proc_t)dfsch_strbuf_inputproc){
+    dfsch_strbuf_t* in = ds->ip_baton;
+    dfsch_strbuf_t* res;
+    if (len > in->len){
+      dfsch_error("Unexpected end of serialized stream", NULL);
+    }
+    res = dfsch_strbuf_create(in->ptr, len);
+    in->ptr += len;
+    in->len -= len;
+    return res;
+  }
+
+  buf = GC_MALLOC_ATOMIC(len);
+  deserialize_bytes(ds, buf, len);
+  return dfsch_strbuf_create(buf, len);
+}
+
+DFSCH_DEFINE_DESERIALIZATION_HANDLER("lazy-object", lazy_object){
+  dfsch_object_t** slot = dfsch_deserializer__skip_object(ds);
+  size_t len = dfsch_deserialize_integer(ds);
+  dfsch_strbuf_t* data = deserialize_slice(ds, len);
+  dfsch_object_t* obj;
+
+  if (ds->lazy){
+    lazy_object_t* lo = dfsch_make_object(DFSCH_LAZY_OBJECT_TYPE);
+    lo->data = data;
+    lo->source = ds->lazy_source;
+    lo->canon_env = ds->canon_env;
+    obj = (dfsch_object_t*)lo;
+  } else {
+    dfsch_deserializer_t* sub = dfsch_make_deserializer(dfsch_strbuf_inputproc,
+                                                        data);
+    sub->canon_env = ds->canon_env;
+    sub->unknown = ds->unknown;
+    sub->uh_baton = ds->uh_baton;
+    obj = dfsch_deserialize_object(sub);
+  }
+
+  *slot = obj;
+  return obj;
+}
+
+/*
+ * Record stream is sequence of length-prefixed independently serialized 
+ * objects:
+ *  - length as integer
+ *  - serialized object (*length)
+ *
+ * which allows skipping records without parsing them.
+ */
+
+void dfsch_serialize_record(dfsch_output_proc_t op, void* baton,
+                            dfsch_object_t* obj,
+                            dfsch_object_t* canon_env,
+                            size_t lazy_threshold){
+  str_list_t* sl = sl_create();
+  dfsch_serializer_t* s = dfsch_make_serializer(sl_nappend, sl);
+  dfsch_serializer_t* framing = dfsch_make_serializer(op, baton);
+  dfsch_strbuf_t* payload;
+
+  s->canon_env = canon_env;
+  s->lazy_threshold = lazy_threshold;
+  dfsch_serialize_object(s, obj);
+
+  payload = dfsch_sl_value_strbuf(sl);
+  dfsch_serialize_integer(framing, payload->len);
+  serialize_bytes(framing, payload->ptr, payload->len);
+}
+
+typedef struct record_cursor_t {
+  dfsch_type_t* type;
+  dfsch_deserializer_t* framing;
+  dfsch_object_t* source; /* retained for slices of mapped buffers */
+  dfsch_object_t* canon_env;
+  int lazy;
+  size_t index;
+} record_cursor_t;
+
+dfsch_type_t dfsch_record_cursor_type = {
+  .type = DFSCH_STANDARD_TYPE,
+  .superclass = NULL,
+  .name = "record-cursor",
+  .size = sizeof(record_cursor_t),
+  .documentation = "Position in stream of serialized records",
+};
+
+dfsch_object_t* dfsch_make_record_cursor(dfsch_object_t* source,
+                                         dfsch_object_t* canon_env,
+                                         int lazy){
+  record_cursor_t* rc = dfsch_make_object(DFSCH_RECORD_CURSOR_TYPE);
+
+  if (dfsch_port_p(source)){
+    rc->framing = dfsch_make_deserializer(dfsch_port_read_buf, source);
+  } else {
+    rc->framing = dfsch_make_deserializer(dfsch_strbuf_inputproc,
+                                          dfsch_copy_strbuf(dfsch_string_to_buf(source)));
+    rc->source = source;
+    dfsch__string_add_mapped_view((dfsch_object_t*)rc, source);
+  }
+  rc->canon_env = canon_env;
+  rc->lazy = lazy;
+
+  return (dfsch_object_t*)rc;
+}
+
+static int cursor_next_length(record_cursor_t* rc, size_t* len){
+  unsigned char lead;
+  
+  if (rc->framing->iproc(rc->framing->ip_baton, &lead, 1) != 1){
+    return 0;
+  }
+  *len = deserialize_integer_rest(rc->framing, lead);
+  return 1;
+}
+
+dfsch_object_t* dfsch_record_cursor_next(dfsch_object_t* cursor){
+  record_cursor_t* rc = DFSCH_ASSERT_TYPE(cursor, DFSCH_RECORD_CURSOR_TYPE);
+  dfsch_deserializer_t* ds;
+  size_t len;
+
+  if (!cursor_next_length(rc, &len)){
+    return dfsch_eof_object();
+  }
+
+  ds = dfsch_make_deserializer(dfsch_strbuf_inputproc,
+                               deserialize_slice(rc->framing, len));
+  ds->canon_env = rc->canon_env;
+  if (rc->lazy){
+    dfsch_deserializer_set_lazy(ds, (dfsch_object_t*)rc);
+  }
+  rc->index++;
+
+  return dfsch_deserialize_object(ds);
+}
+
+size_t dfsch_record_cursor_skip(dfsch_object_t* cursor, size_t count){
+  record_cursor_t* rc = DFSCH_ASSERT_TYPE(cursor, DFSCH_RECORD_CURSOR_TYPE);
+  size_t skipped = 0;
+  size_t len;
+  char buf[4096];
+
+  while (skipped < count && cursor_next_length(rc, &len)){
+    if (rc->source){
+      deserialize_slice(rc->framing, len);
+    } else {
+      while (len > 0){
+        size_t chunk = len < sizeof(buf) ? len : sizeof(buf);
+        deserialize_bytes(rc->framing, buf, chunk);
+        len -= chunk;
+      }
+    }
+    skipped++;
+    rc->index++;
+  }
+
+  return skipped;
+}
+size_t dfsch_record_cursor_index(dfsch_object_t* cursor){
+  record_cursor_t* rc = DFSCH_ASSERT_TYPE(cursor, DFSCH_RECORD_CURSOR_TYPE);
+  return rc->index;
+}
+
 typedef struct smap_t {
   dfsch_type_t* type;
   dfsch_object_t* mapping;
@@ -967,12 +1364,109 @@ DFSCH_DEFINE_PRIMITIVE(deserialize_integer,
   return dfsch_make_number_from_int64(dfsch_deserialize_integer(deserializer));
 }
 
+DFSCH_DEFINE_PRIMITIVE(write_serialized_record,
+                       "Write object into port as one record of record "
+                       "stream, vectors and strings of at least "
+                       "lazy-threshold elements are serialized as lazy "
+                       "subtrees"){
+  dfsch_object_t* port;
+  dfsch_object_t* object;
+  dfsch_object_t* canon_env;
+  long lazy_threshold;
+  DFSCH_OBJECT_ARG(args, port);
+  DFSCH_OBJECT_ARG(args, object);
+  DFSCH_OBJECT_ARG_OPT(args, canon_env, NULL);
+  DFSCH_LONG_ARG_OPT(args, lazy_threshold, 0);
+  DFSCH_ARG_END(args);
+
+  if (lazy_threshold < 0){
+    dfsch_error("Threshold must not be negative", 
+                dfsch_make_number_from_long(lazy_threshold));
+  }
+
+  dfsch_serialize_record(dfsch_port_write_buf, port, object, canon_env,
+                         lazy_threshold);
+
+  return NULL;
+}
+
+DFSCH_DEFINE_PRIMITIVE(make_record_cursor,
+                       "Make cursor over record stream read from port or "
+                       "buffer (possibly mapped file), lazy subtrees are "
+                       "returned as lazy objects when third argument is "
+                       "true (use force-lazy before type specific "
+                       "accessors)"){
+  dfsch_object_t* source;
+  dfsch_object_t* canon_env;
+  dfsch_object_t* lazy;
+  DFSCH_OBJECT_ARG(args, source);
+  DFSCH_OBJECT_ARG_OPT(args, canon_env, NULL);
+  DFSCH_OBJECT_ARG_OPT(args, lazy, NULL);
+  DFSCH_ARG_END(args);
+
+  return dfsch_make_record_cursor(source, canon_env, lazy != NULL);
+}
+
+DFSCH_DEFINE_PRIMITIVE(record_cursor_next,
+                       "Read next record or return EOF object"){
+  dfsch_object_t* cursor;
+  DFSCH_OBJECT_ARG(args, cursor);
+  DFSCH_ARG_END(args);
+
+  return dfsch_record_cursor_next(cursor);
+}
+DFSCH_DEFINE_PRIMITIVE(record_cursor_skip,
+                       "Skip records without deserializing them, returns "
+                       "number of records skipped"){
+  dfsch_object_t* cursor;
+  long count;
+  DFSCH_OBJECT_ARG(args, cursor);
+  DFSCH_LONG_ARG_OPT(args, count, 1);
+  DFSCH_ARG_END(args);
+
+  if (count < 0){
+    dfsch_error("Count must not be negative", 
+                dfsch_make_number_from_long(count));
+  }
+
+  return dfsch_make_number_from_long(dfsch_record_cursor_skip(cursor, 
+                                                              count));
+}
+DFSCH_DEFINE_PRIMITIVE(record_cursor_index,
+                       "Number of records already read or skipped"){
+  dfsch_object_t* cursor;
+  DFSCH_OBJECT_ARG(args, cursor);
+  DFSCH_ARG_END(args);
+
+  return dfsch_make_number_from_long(dfsch_record_cursor_index(cursor));
+}
+
+DFSCH_DEFINE_PRIMITIVE(force_lazy,
+                       "Deserialize lazy object, other objects are returned "
+                       "unchanged"){
+  dfsch_object_t* object;
+  DFSCH_OBJECT_ARG(args, object);
+  DFSCH_ARG_END(args);
+
+  return dfsch_force_lazy_object(object);
+}
+DFSCH_DEFINE_PRIMITIVE(lazy_object_forced_p,
+                       "Was lazy object already deserialized?"){
+  dfsch_object_t* object;
+  DFSCH_OBJECT_ARG(args, object);
+  DFSCH_ARG_END(args);
+
+  return dfsch_bool(dfsch_lazy_object_forced_p(object));
+}
+
 void dfsch__serdes_register(dfsch_object_t* env){
   dfsch_defcanon_cstr(env, "<serializer>", DFSCH_SERIALIZER_TYPE);
   dfsch_defcanon_cstr(env, "<deserializer>", DFSCH_DESERIALIZER_TYPE);
 
   dfsch_defcanon_cstr(env, "<serializing-map>", 
                       DFSCH_SERIALIZING_MAP_TYPE);  
+  dfsch_defcanon_cstr(env, "<lazy-object>", DFSCH_LAZY_OBJECT_TYPE);
+  dfsch_defcanon_cstr(env, "<record-cursor>", DFSCH_RECORD_CURSOR_TYPE);
 
   dfsch_defcanon_cstr(env, "serialize",
                       DFSCH_PRIMITIVE_REF(serialize));
@@ -1014,5 +1508,20 @@ void dfsch__serdes_register(dfsch_object_t* env){
                       DFSCH_PRIMITIVE_REF(deserialize_integer));
   dfsch_defcanon_cstr(env, "deserialize-bytes!",
                       DFSCH_PRIMITIVE_REF(deserialize_bytes));
+
+  dfsch_defcanon_cstr(env, "write-serialized-record",
+                      DFSCH_PRIMITIVE_REF(write_serialized_record));
+  dfsch_defcanon_cstr(env, "make-record-cursor",
+                      DFSCH_PRIMITIVE_REF(make_record_cursor));
+  dfsch_defcanon_cstr(env, "record-cursor-next!",
+                      DFSCH_PRIMITIVE_REF(record_cursor_next));
+  dfsch_defcanon_cstr(env, "record-cursor-skip!",
+                      DFSCH_PRIMITIVE_REF(record_cursor_skip));
+  dfsch_defcanon_cstr(env, "record-cursor-index",
+                      DFSCH_PRIMITIVE_REF(record_cursor_index));
+  dfsch_defcanon_cstr(env, "force-lazy",
+                      DFSCH_PRIMITIVE_REF(force_lazy));
+  dfsch_defcanon_cstr(env, "lazy-object-forced?",
+                      DFSCH_PRIMITIVE_REF(lazy_object_forced_p));
   
 }
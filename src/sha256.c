@@ -11,6 +11,14 @@
 #include <dfsch/sha256.h>
 #include "lib/crypto/macros.h"
 
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+  && !defined(DFSCH_NO_SIMD)
+#define X86_SIMD
+#include <immintrin.h>
+#endif
+
 /**
   @file sha256.c
   LTC_SHA256 by Tom St Denis 
@@ -28,14 +36,14 @@
 #define Gamma1(x)       (S(x, 17) ^ S(x, 19) ^ R(x, 10))
 
 /* compress 512-bits */
-void  dfsch_sha256_compress(dfsch_sha256_context_t * md, unsigned char *buf)
+static void sha256_compress_c(uint32_t* state, const unsigned char *buf)
 {
     ulong32 S[8], W[64], t0, t1;
     int i;
 
     /* copy state into S */
     for (i = 0; i < 8; i++) {
-        S[i] = md->state[i];
+        S[i] = state[i];
     }
 
     /* copy the state into 512-bits into W[0..15] */
@@ -123,8 +131,283 @@ void  dfsch_sha256_compress(dfsch_sha256_context_t * md, unsigned char *buf)
 #undef RND     
         /* feedback */
     for (i = 0; i < 8; i++) {
-        md->state[i] = md->state[i] + S[i];
+        state[i] = state[i] + S[i];
+    }
+}
+
+static void sha256_blocks_c(uint32_t* state, const unsigned char* in,
+                            size_t blocks)
+{
+    while (blocks--) {
+        sha256_compress_c(state, in);
+        in += 64;
+    }
+}
+
+#ifdef X86_SIMD
+
+/*
+ * SHA extensions, state is kept in two registers as ABEF and CDGH.
+ */
+
+static const uint32_t K256[64] __attribute__((aligned(16))) = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define SHANI_BSWAP_MASK                                                \
+    _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL)
+
+#define SHANI_LOAD_STATE(state, abef, cdgh) {                           \
+    __m128i t_ = _mm_shuffle_epi32(_mm_loadu_si128((__m128i*)(state)),  \
+                                   0xb1);                               \
+    cdgh = _mm_shuffle_epi32(_mm_loadu_si128((__m128i*)((state) + 4)),  \
+                             0x1b);                                     \
+    abef = _mm_alignr_epi8(t_, cdgh, 8);                                \
+    cdgh = _mm_blend_epi16(cdgh, t_, 0xf0); }
+
+#define SHANI_STORE_STATE(state, abef, cdgh) {                          \
+    __m128i t_ = _mm_shuffle_epi32(abef, 0x1b);                         \
+    cdgh = _mm_shuffle_epi32(cdgh, 0xb1);                               \
+    _mm_storeu_si128((__m128i*)(state), _mm_blend_epi16(t_, cdgh, 0xf0)); \
+    _mm_storeu_si128((__m128i*)((state) + 4),                           \
+                     _mm_alignr_epi8(cdgh, t_, 8)); }
+
+#define SHANI_LOAD_MSG(in, i)                                           \
+    _mm_shuffle_epi8(_mm_loadu_si128((__m128i*)((in) + 16 * (i))),      \
+                     SHANI_BSWAP_MASK)
+
+/* Four rounds using message words m */
+#define SHANI_QROUNDS(abef, cdgh, m, k) {                               \
+    __m128i t_ = _mm_add_epi32(m, _mm_load_si128((__m128i*)(k)));       \
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, t_);                       \
+    t_ = _mm_shuffle_epi32(t_, 0x0e);                                   \
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, t_); }
+
+/* Replace m0 (W[t-16..t-13]) by W[t..t+3] */
+#define SHANI_SCHEDULE(m0, m1, m2, m3)                                  \
+    m0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(m0, m1), \
+                                            _mm_alignr_epi8(m3, m2, 4)), \
+                              m3)
+
+__attribute__((target("sha,ssse3,sse4.1")))
+static void sha256_blocks_shani(uint32_t* state, const unsigned char* in,
+                                size_t blocks)
+{
+    __m128i abef, cdgh, abef_save, cdgh_save, m0, m1, m2, m3;
+    int g;
+
+    SHANI_LOAD_STATE(state, abef, cdgh);
+    while (blocks--) {
+        abef_save = abef;
+        cdgh_save = cdgh;
+
+        m0 = SHANI_LOAD_MSG(in, 0);
+        m1 = SHANI_LOAD_MSG(in, 1);
+        m2 = SHANI_LOAD_MSG(in, 2);
+        m3 = SHANI_LOAD_MSG(in, 3);
+        SHANI_QROUNDS(abef, cdgh, m0, K256);
+        SHANI_QROUNDS(abef, cdgh, m1, K256 + 4);
+        SHANI_QROUNDS(abef, cdgh, m2, K256 + 8);
+        SHANI_QROUNDS(abef, cdgh, m3, K256 + 12);
+        for (g = 16; g < 64; g += 16) {
+            SHANI_SCHEDULE(m0, m1, m2, m3);
+            SHANI_QROUNDS(abef, cdgh, m0, K256 + g);
+            SHANI_SCHEDULE(m1, m2, m3, m0);
+            SHANI_QROUNDS(abef, cdgh, m1, K256 + g + 4);
+            SHANI_SCHEDULE(m2, m3, m0, m1);
+            SHANI_QROUNDS(abef, cdgh, m2, K256 + g + 8);
+            SHANI_SCHEDULE(m3, m0, m1, m2);
+            SHANI_QROUNDS(abef, cdgh, m3, K256 + g + 12);
+        }
+
+        abef = _mm_add_epi32(abef, abef_save);
+        cdgh = _mm_add_epi32(cdgh, cdgh_save);
+        in += 64;
+    }
+    SHANI_STORE_STATE(state, abef, cdgh);
+}
+
+/*
+ * AVX2 multi-buffer, eight messages are hashed at once with one message
+ * per 32bit lane. Only used for dfsch_sha256_digest_many() on CPUs
+ * without SHA extensions.
+ */
+
+#define X8_ROR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n),          \
+                                     _mm256_slli_epi32(x, 32 - (n)))
+#define X8_XOR3(x, y, z) _mm256_xor_si256(_mm256_xor_si256(x, y), z)
+#define X8_ADD3(x, y, z) _mm256_add_epi32(_mm256_add_epi32(x, y), z)
+
+__attribute__((target("avx2")))
+static void sha256_blocks_x8_avx2(uint32_t** state, 
+                                  const unsigned char** in,
+                                  size_t blocks)
+{
+    uint32_t tmp[8] __attribute__((aligned(32)));
+    const unsigned char* p[8];
+    __m256i s[8], w[16];
+    __m256i a, b, c, d, e, f, g, h, t0, t1;
+    uint32_t x;
+    int i, j;
+
+    for (j = 0; j < 8; j++) {
+        p[j] = in[j];
+    }
+    for (i = 0; i < 8; i++) {
+        for (j = 0; j < 8; j++) {
+            tmp[j] = state[j][i];
+        }
+        s[i] = _mm256_load_si256((__m256i*)tmp);
+    }
+
+    while (blocks--) {
+        a = s[0]; b = s[1]; c = s[2]; d = s[3];
+        e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+        for (i = 0; i < 64; i++) {
+            if (i < 16) {
+                for (j = 0; j < 8; j++) {
+                    memcpy(&x, p[j] + 4 * i, 4);
+                    tmp[j] = __builtin_bswap32(x);
+                }
+                w[i] = _mm256_load_si256((__m256i*)tmp);
+            } else {
+                t0 = w[(i - 15) & 15];
+                t1 = w[(i - 2) & 15];
+                t0 = X8_XOR3(X8_ROR(t0, 7), X8_ROR(t0, 18),
+                             _mm256_srli_epi32(t0, 3));
+                t1 = X8_XOR3(X8_ROR(t1, 17), X8_ROR(t1, 19),
+                             _mm256_srli_epi32(t1, 10));
+                w[i & 15] = _mm256_add_epi32(X8_ADD3(w[i & 15], t0, t1),
+                                             w[(i - 7) & 15]);
+            }
+
+            t0 = X8_ADD3(h, 
+                         X8_XOR3(X8_ROR(e, 6), X8_ROR(e, 11), 
+                                 X8_ROR(e, 25)),
+                         _mm256_xor_si256(_mm256_and_si256(e, f), 
+                                          _mm256_andnot_si256(e, g)));
+            t0 = X8_ADD3(t0, _mm256_set1_epi32(K256[i]), w[i & 15]);
+            t1 = _mm256_add_epi32(X8_XOR3(X8_ROR(a, 2), X8_ROR(a, 13), 
+                                          X8_ROR(a, 22)),
+                                  _mm256_or_si256(
+                                    _mm256_and_si256(_mm256_or_si256(a, b),
+                                                     c),
+                                    _mm256_and_si256(a, b)));
+            h = g; g = f; f = e;
+            e = _mm256_add_epi32(d, t0);
+            d = c; c = b; b = a;
+            a = _mm256_add_epi32(t0, t1);
+        }
+
+        s[0] = _mm256_add_epi32(s[0], a); s[1] = _mm256_add_epi32(s[1], b);
+        s[2] = _mm256_add_epi32(s[2], c); s[3] = _mm256_add_epi32(s[3], d);
+        s[4] = _mm256_add_epi32(s[4], e); s[5] = _mm256_add_epi32(s[5], f);
+        s[6] = _mm256_add_epi32(s[6], g); s[7] = _mm256_add_epi32(s[7], h);
+        for (j = 0; j < 8; j++) {
+            p[j] += 64;
+        }
+    }
+
+    for (i = 0; i < 8; i++) {
+        _mm256_store_si256((__m256i*)tmp, s[i]);
+        for (j = 0; j < 8; j++) {
+            state[j][i] = tmp[j];
+        }
+    }
+}
+
+#endif
+
+/*
+ * Compression function is selected on first use, DFSCH_SIMD=none forces
+ * portable code and DFSCH_SIMD=avx2 ignores SHA extensions (as for
+ * string kernels).
+ */
+
+typedef struct kernels_t {
+    char* name;
+    void (*blocks)(uint32_t* state, const unsigned char* in, size_t blocks);
+    /* eight messages at once, NULL when it would not help */
+    void (*blocks_x8)(uint32_t** state, const unsigned char** in,
+                      size_t blocks);
+} kernels_t;
+
+static kernels_t kernels_c = {
+    .name = "c",
+    .blocks = sha256_blocks_c,
+    .blocks_x8 = NULL,
+};
+
+#ifdef X86_SIMD
+static kernels_t kernels_avx2 = {
+    .name = "avx2",
+    .blocks = sha256_blocks_c,
+    .blocks_x8 = sha256_blocks_x8_avx2,
+};
+static kernels_t kernels_shani = {
+    .name = "sha-ni",
+    .blocks = sha256_blocks_shani,
+    .blocks_x8 = NULL,
+};
+#endif
+
+static kernels_t* kernels = NULL;
+
+static kernels_t* select_kernels()
+{
+    kernels_t* k = &kernels_c;
+#ifdef X86_SIMD
+    char* limit = getenv("DFSCH_SIMD");
+
+    __builtin_cpu_init();
+    if (limit && strcmp(limit, "none") == 0) {
+        k = &kernels_c;
+    } else if (__builtin_cpu_supports("sha") && 
+               __builtin_cpu_supports("sse4.1") &&
+               !(limit && strcmp(limit, "avx2") == 0)) {
+        k = &kernels_shani;
+    } else if (__builtin_cpu_supports("avx2")) {
+        k = &kernels_avx2;
+    }
+#endif
+    kernels = k; /* every thread selects the same thing */
+    return k;
+}
+
+static kernels_t* get_kernels()
+{
+    kernels_t* k = kernels;
+    if (!k) {
+        k = select_kernels();
     }
+    return k;
+}
+
+char* dfsch_sha256_implementation()
+{
+    return get_kernels()->name;
+}
+
+void dfsch_sha256_compress(dfsch_sha256_context_t * md, unsigned char *buf)
+{
+    get_kernels()->blocks(md->state, buf, 1);
+}
+
+static void sha256_compress_blocks(dfsch_sha256_context_t * md, 
+                                   unsigned char *buf, size_t blocks)
+{
+    get_kernels()->blocks(md->state, buf, blocks);
 }
 
 void dfsch_sha256_setup(dfsch_sha256_context_t* md)
@@ -148,7 +431,8 @@ void dfsch_sha256_setup(dfsch_sha256_context_t* md)
    @param inlen  The length of the data (octets)
    @return CRYPT_OK if successful
 */
-HASH_PROCESS(dfsch_sha256_process, dfsch_sha256_compress, dfsch_sha256_context_t, 64)
+HASH_PROCESS_BLOCKS(dfsch_sha256_process, sha256_compress_blocks, 
+                    dfsch_sha256_context_t, 64)
 
 /**
    Terminate the hash to get the digest
@@ -193,3 +477,134 @@ void dfsch_sha256_result(dfsch_sha256_context_t * md, unsigned char *out)
     }
 }
 
+
+/*
+ * Multi-buffer hashing. Every message is seen as run of its complete
+ * blocks followed by padded tail. Eight lanes are compressed together
+ * for as long as all of them have some blocks left, finished lane is
+ * refilled with next message.
+ */
+
+typedef struct lane_t {
+    uint32_t state[8];
+    const unsigned char* run;
+    size_t run_blocks;
+    unsigned char tail[128];
+    size_t tail_blocks;
+} lane_t;
+
+static const uint32_t sha256_iv[8] = {
+    0x6A09E667UL, 0xBB67AE85UL, 0x3C6EF372UL, 0xA54FF53AUL,
+    0x510E527FUL, 0x9B05688CUL, 0x1F83D9ABUL, 0x5BE0CD19UL
+};
+
+static void lane_init(lane_t* l, const unsigned char* in, size_t len)
+{
+    size_t rest = len % 64;
+
+    memcpy(l->state, sha256_iv, sizeof(l->state));
+
+    l->run = in;
+    l->run_blocks = len / 64;
+
+    l->tail_blocks = rest < 56 ? 1 : 2;
+    if (rest) {
+        memcpy(l->tail, in + len - rest, rest);
+    }
+    l->tail[rest] = 0x80;
+    memset(l->tail + rest + 1, 0, 64 * l->tail_blocks - rest - 9);
+    STORE64H((ulong64)len * 8, l->tail + 64 * l->tail_blocks - 8);
+
+    if (l->run_blocks == 0) {
+        l->run = l->tail;
+        l->run_blocks = l->tail_blocks;
+        l->tail_blocks = 0;
+    }
+}
+
+static void lane_advance(lane_t* l, size_t blocks)
+{
+    l->run += 64 * blocks;
+    l->run_blocks -= blocks;
+    if (l->run_blocks == 0 && l->tail_blocks != 0) {
+        l->run = l->tail;
+        l->run_blocks = l->tail_blocks;
+        l->tail_blocks = 0;
+    }
+}
+
+static void lane_finish(kernels_t* k, lane_t* l, unsigned char* out)
+{
+    int i;
+
+    while (l->run_blocks) {
+        k->blocks(l->state, l->run, l->run_blocks);
+        lane_advance(l, l->run_blocks);
+    }
+
+    for (i = 0; i < 8; i++) {
+        STORE32H(l->state[i], out + (4*i));
+    }
+}
+
+void dfsch_sha256_digest_many(size_t count,
+                              const unsigned char** in, size_t* len,
+                              unsigned char** out)
+{
+    kernels_t* k = get_kernels();
+    dfsch_sha256_context_t md;
+    lane_t lanes[8];
+    size_t msg[8];
+    uint32_t* states[8];
+    const unsigned char* runs[8];
+    size_t next = 0;
+    size_t n;
+    int active = 0;
+    int j;
+
+    if (k->blocks_x8 && count >= 8) {
+        for (j = 0; j < 8; j++) {
+            lane_init(&lanes[j], in[next], len[next]);
+            msg[j] = next++;
+            states[j] = lanes[j].state;
+        }
+        active = 8;
+
+        while (active == 8) {
+            n = lanes[0].run_blocks;
+            for (j = 1; j < 8; j++) {
+                n = MIN(n, lanes[j].run_blocks);
+            }
+            for (j = 0; j < 8; j++) {
+                runs[j] = lanes[j].run;
+            }
+            k->blocks_x8(states, runs, n);
+
+            for (j = 0; j < 8; j++) {
+                lane_advance(&lanes[j], n);
+                if (lanes[j].run_blocks == 0) {
+                    lane_finish(k, &lanes[j], out[msg[j]]);
+                    if (next < count) {
+                        lane_init(&lanes[j], in[next], len[next]);
+                        msg[j] = next++;
+                    } else {
+                        active--;
+                    }
+                }
+            }
+        }
+    }
+
+    /* lanes that were not finished by multi-buffer loop */
+    for (j = 0; j < 8 && active; j++) {
+        if (lanes[j].run_blocks) {
+            lane_finish(k, &lanes[j], out[msg[j]]);
+        }
+    }
+    
+    for (; next < count; next++) {
+        dfsch_sha256_setup(&md);
+        dfsch_sha256_process(&md, in[next], len[next]);
+        dfsch_sha256_result(&md, out[next]);
+    }
+}
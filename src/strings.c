@@ -24,9 +24,18 @@
 #include <dfsch/serdes.h>
 #include "types.h"
 #include <string.h>
+#include <stdlib.h>
 
 #include "udata.h"
 #include "util.h"
+#include "strsimd.h"
+
+#if defined(__unix__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 dfsch_strbuf_t dfsch_empty_strbuf = {
   .len = 0,
@@ -85,69 +94,97 @@ static char escape_table[] = {
 static char hex_table[] = "0123456789abcdef";
 
 static void string_write(dfsch_string_t* o, dfsch_writer_state_t* state){
-  char *b;
-  char *i;
-  int j;
-  size_t len = 0;
+  char esc[4];
+  size_t j;
+  size_t run = 0;
 
   if (dfsch_writer_state_print_p(state)){
-    dfsch_write_string(state, o->buf.ptr);
+    dfsch_write_strbuf(state, o->buf.ptr, o->buf.len);
+    return;
+  }
+  if (dfsch_writer_state_cmark_p(state)){
     return;
   }
 
+  /* Runs of characters that need no escaping are passed to output as 
+     they are */
+  dfsch_write_strbuf(state, "\"", 1);
   for (j = 0; j < o->buf.len; ++j){
-    switch (escape_table[o->buf.ptr[j]]){
-    case 0:
-      len += 1;
-      break;
-    case 1:
-      len += 4;
-      break;
-    default:
-      len += 2;
-      break;
+    unsigned char ch = o->buf.ptr[j];
+    if (escape_table[ch] == 0){
+      continue;
     }
-  }
 
-  b = GC_MALLOC_ATOMIC(len+3);
-  i = b;
- 
-  *i='"';
-  i++;
+    if (j > run){
+      dfsch_write_strbuf(state, o->buf.ptr + run, j - run);
+    }
+    run = j + 1;
 
-  for (j = 0; j < o->buf.len; ++j){
-    switch (escape_table[(unsigned char)(o->buf.ptr[j])]){
-    case 0:
-      *i = o->buf.ptr[j];
-      i++;
-      break;
-    case 1:
-      i[0] = '\\';
-      i[1] = 'x';
-      i[2] = hex_table[(((unsigned char)o->buf.ptr[j]) >> 4) & 0xf];
-      i[3] = hex_table[(((unsigned char)o->buf.ptr[j])     ) & 0xf];
-      i += 4;
-      break;
-    default:
-      i[0] = '\\';
-      i[1] = escape_table[(unsigned char)(o->buf.ptr[j])];
-      i += 2;
-      break;
+    esc[0] = '\\';
+    if (escape_table[ch] == 1){
+      esc[1] = 'x';
+      esc[2] = hex_table[(ch >> 4) & 0xf];
+      esc[3] = hex_table[ch & 0xf];
+      dfsch_write_strbuf(state, esc, 4);
+    } else {
+      esc[1] = escape_table[ch];
+      dfsch_write_strbuf(state, esc, 2);
     }
   }
-
-  *i='"';
-  i[1]=0;
-
-  dfsch_write_string(state, b);
+  if (j > run){
+    dfsch_write_strbuf(state, o->buf.ptr + run, j - run);
+  }
+  dfsch_write_strbuf(state, "\"", 1);
 }
 
 #define HASH_CACHE_CUTOFF 256
 
-typedef struct hash_cached_string_t {
+/*
+ * Every object of type string is allocated with this header, which caches
+ * information derived from its contents. Length in characters and whether
+ * the string is pure ASCII are computed on first use, strings longer than
+ * STRING_INDEX_CUTOFF bytes with non-ASCII characters also get sparse 
+ * index of byte offsets of every STRING_INDEX_STEP-th character.
+ *
+ * Long strings are allocated as separate header and atomic data, so that
+ * header can point to index.
+ */
+
+#define STRING_INDEX_CUTOFF 256
+#define STRING_INDEX_STEP 64
+
+#define STRING_INFO_VALID 1
+#define STRING_INFO_ASCII 2
+
+typedef struct string_info_t {
   dfsch_string_t content;
   uint32_t hash;
-} hash_cached_string_t;
+  uint32_t flags;
+  size_t length;
+  size_t* index;
+} string_info_t;
+
+static string_info_t* alloc_string(size_t len){
+  string_info_t* s;
+
+  if (len > STRING_INDEX_CUTOFF){
+    s = GC_NEW(string_info_t);
+    s->content.buf.ptr = GC_MALLOC_ATOMIC(len+1);
+  } else {
+    s = GC_MALLOC_ATOMIC(sizeof(string_info_t)+len+1);
+    s->content.buf.ptr = (char *)(s + 1);
+  }
+
+  s->content.type = DFSCH_STRING_TYPE;
+  s->content.buf.len = len;
+  s->content.buf.ptr[len] = 0;
+  s->hash = 0;
+  s->flags = 0;
+  s->length = 0;
+  s->index = NULL;
+
+  return s;
+}
 
 typedef struct string_constructor_t {
   dfsch_collection_constructor_type_t* type;
@@ -229,7 +266,7 @@ static uint32_t calculate_hash(char* ptr, size_t len){
 
 static uint32_t string_hash(dfsch_string_t* s){
   if (s->buf.len > HASH_CACHE_CUTOFF){
-    hash_cached_string_t* hc = s;
+    string_info_t* hc = (string_info_t*)s;
     if (!hc->hash){
       hc->hash = calculate_hash(s->buf.ptr, s->buf.len);
     } 
@@ -273,7 +310,7 @@ dfsch_type_t dfsch_proto_string_type = {
 dfsch_type_t dfsch_string_type = {
   DFSCH_STANDARD_TYPE,
   DFSCH_PROTO_STRING_TYPE,
-  sizeof(dfsch_string_t),
+  sizeof(string_info_t),
   "string",
   (dfsch_type_equal_p_t)string_equal_p,
   (dfsch_type_write_t)string_write,
@@ -334,39 +371,18 @@ dfsch_object_t* dfsch_make_string_strbuf(dfsch_strbuf_t* strbuf){
   return dfsch_make_string_buf(strbuf->ptr, strbuf->len);
 }
 dfsch_object_t* dfsch_make_string_buf(char* ptr, size_t len){
-  dfsch_string_t *s;
-
-  if (len > HASH_CACHE_CUTOFF){
-    s = GC_MALLOC_ATOMIC(sizeof(dfsch_string_t)+len+1);
-    s->buf.ptr = (char *)(s + 1);
-  } else {
-    s = GC_MALLOC_ATOMIC(sizeof(hash_cached_string_t)+len+1);
-    s->buf.ptr = (char *)(((hash_cached_string_t*)s) + 1);
-  }
-
-  s->type = DFSCH_STRING_TYPE;
-
-  s->buf.len = len;
+  string_info_t *s = alloc_string(len);
 
   if(ptr) // For allocating space to be used later
-    memcpy(s->buf.ptr, ptr, len);
-
-  s->buf.ptr[len] = 0;
+    memcpy(s->content.buf.ptr, ptr, len);
 
   return (dfsch_object_t*)s;
 }
 
 dfsch_object_t* dfsch_make_string_for_write(size_t len, char**buf){
-  dfsch_string_t *s = GC_MALLOC_ATOMIC(sizeof(dfsch_string_t)+len+1);
+  string_info_t *s = alloc_string(len);
 
-  s->type = DFSCH_STRING_TYPE;
-
-  s->buf.ptr = (char *)(s + 1);
-  s->buf.len = len;
-
-  (*buf) = s->buf.ptr;
-
-  s->buf.ptr[len] = 0;
+  (*buf) = s->content.buf.ptr;
 
   return (dfsch_object_t*)s;
 }
@@ -380,21 +396,38 @@ dfsch_object_t* dfsch_make_string_nocopy(dfsch_strbuf_t* buf){
 
   return (dfsch_object_t*)s;
 }
-char* dfsch_string_to_cstr(dfsch_object_t* obj){
-  dfsch_string_t* s = DFSCH_ASSERT_TYPE(obj, STRING);
+/*
+ * Strings sharing storage with other strings (ie. substrings of mapped
+ * files) are not NUL-terminated and have to be copied.
+ */
+static char* string_cstr(dfsch_string_t* s){
+  char* res;
 
-  if (strlen(s->buf.ptr) != s->buf.len){
+  if (memchr(s->buf.ptr, 0, s->buf.len)){
     dfsch_error("Cannot convert string with embedded NULs to char*",
                 s);
   }
 
-  return s->buf.ptr;
+  if (s->buf.ptr[s->buf.len] == '\0'){
+    return s->buf.ptr;
+  }
+
+  res = GC_MALLOC_ATOMIC(s->buf.len + 1);
+  memcpy(res, s->buf.ptr, s->buf.len);
+  res[s->buf.len] = '\0';
+  return res;
+}
+
+char* dfsch_string_to_cstr(dfsch_object_t* obj){
+  dfsch_string_t* s = DFSCH_ASSERT_TYPE(obj, STRING);
+
+  return string_cstr(s);
 }
 char* dfsch_proto_string_to_cstr(dfsch_object_t* obj){
   dfsch_strbuf_t* sb = dfsch_string_to_buf(obj);
   char* res = GC_MALLOC_ATOMIC(sb->len + 1);
 
-  if (strlen(sb->ptr) != sb->len){
+  if (memchr(sb->ptr, 0, sb->len)){
     dfsch_error("Cannot convert string with embedded NULs to char*",
                 sb);
   }
@@ -412,12 +445,7 @@ char* dfsch_string_or_symbol_to_cstr(dfsch_object_t* obj){
 
   s = DFSCH_ASSERT_TYPE(obj, STRING);
 
-  if (strlen(s->buf.ptr) != s->buf.len){
-    dfsch_error("Cannot convert string with embedded NULs to char*",
-                s);
-  }
-
-  return s->buf.ptr;
+  return string_cstr(s);
 }
 dfsch_strbuf_t* dfsch_string_to_buf(dfsch_object_t* obj){
   dfsch_string_t* s = DFSCH_ASSERT_INSTANCE(obj, DFSCH_PROTO_STRING_TYPE);
@@ -430,6 +458,290 @@ dfsch_strbuf_t* dfsch_byte_vector_to_buf(dfsch_object_t* obj){
   return &(s->buf);  
 }
 
+/*
+ * Mapped files
+ *
+ * Contents of file are mapped into memory outside of GC heap and wrapped
+ * in string or byte-vector object. Substrings of such objects share the
+ * mapping, which is unmapped when it becomes unreachable. Mapping is 
+ * private, so writes into mapped byte-vector do not propagate into file.
+ *
+ * Live mappings are kept in table allocated outside of GC heap (so it
+ * does not keep them alive), sorted by address, which allows substring 
+ * operations to recognize strings pointing into mapped memory. Range 
+ * covered by all mappings only grows, so pointers outside of it are
+ * rejected without taking the lock.
+ *
+ * Each object referencing mapped memory (string, substring, record 
+ * cursor) is counted as view of the mapping until it is collected.
+ */
+
+typedef struct file_mapping_t {
+  char* addr;
+  size_t size;
+  size_t map_len;
+  volatile size_t views;
+} file_mapping_t;
+
+typedef struct mapped_string_t {
+  string_info_t str;
+  file_mapping_t* mapping;
+} mapped_string_t;
+
+static file_mapping_t** mappings = NULL;
+static size_t mappings_count = 0;
+static size_t mappings_alloc = 0;
+static char* volatile mappings_low = NULL;
+static char* volatile mappings_high = NULL;
+static pthread_mutex_t mappings_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Index of first mapping starting above ptr */
+static size_t mapping_search(char* ptr){
+  size_t lo = 0;
+  size_t hi = mappings_count;
+  size_t mid;
+
+  while (lo < hi){
+    mid = lo + (hi - lo) / 2;
+    if (mappings[mid]->addr <= ptr){
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static file_mapping_t* find_mapping(char* ptr){
+  file_mapping_t* res = NULL;
+  size_t i;
+
+  if (ptr < mappings_low || ptr >= mappings_high){
+    return NULL;
+  }
+
+  pthread_mutex_lock(&mappings_mutex);
+  i = mapping_search(ptr);
+  if (i > 0 && ptr < mappings[i - 1]->addr + mappings[i - 1]->map_len){
+    res = mappings[i - 1];
+  }
+  pthread_mutex_unlock(&mappings_mutex);
+
+  return res;
+}
+
+static void register_mapping(file_mapping_t* m){
+  size_t i;
+
+  pthread_mutex_lock(&mappings_mutex);
+  if (mappings_count == mappings_alloc){
+    mappings_alloc = mappings_alloc ? mappings_alloc * 2 : 8;
+    mappings = realloc(mappings, sizeof(file_mapping_t*) * mappings_alloc);
+    if (!mappings){
+      abort();
+    }
+  }
+  i = mapping_search(m->addr);
+  memmove(mappings + i + 1, mappings + i, 
+          sizeof(file_mapping_t*) * (mappings_count - i));
+  mappings[i] = m;
+  mappings_count++;
+
+  if (!mappings_low || m->addr < mappings_low){
+    mappings_low = m->addr;
+  }
+  if (m->addr + m->map_len > mappings_high){
+    mappings_high = m->addr + m->map_len;
+  }
+  pthread_mutex_unlock(&mappings_mutex);
+}
+
+static void mapping_finalizer(file_mapping_t* m, void* cd){
+  size_t i;
+
+  pthread_mutex_lock(&mappings_mutex);
+  i = mapping_search(m->addr);
+  if (i > 0 && mappings[i - 1] == m){
+    mappings_count--;
+    memmove(mappings + i - 1, mappings + i,
+            sizeof(file_mapping_t*) * (mappings_count - (i - 1)));
+  }
+  pthread_mutex_unlock(&mappings_mutex);
+
+#if defined(__unix__)
+  munmap(m->addr, m->map_len);
+#endif
+}
+
+static void view_finalizer(dfsch_object_t* view, file_mapping_t* m){
+  __sync_fetch_and_sub(&m->views, 1);
+}
+
+static void add_view(dfsch_object_t* view, file_mapping_t* m){
+  __sync_fetch_and_add(&m->views, 1);
+  GC_REGISTER_FINALIZER(view, (GC_finalization_proc)view_finalizer,
+                        m, NULL, NULL);
+}
+
+static dfsch_object_t* make_mapped_string(dfsch_type_t* type,
+                                          file_mapping_t* m,
+                                          char* ptr, size_t len){
+  mapped_string_t* ms = GC_NEW(mapped_string_t);
+
+  ms->str.content.type = type;
+  ms->str.content.buf.ptr = ptr;
+  ms->str.content.buf.len = len;
+  ms->mapping = m;
+  add_view((dfsch_object_t*)ms, m);
+
+  return (dfsch_object_t*)ms;
+}
+
+/*
+ * Count view as user of mapping backing string, when there is one.
+ */
+void dfsch__string_add_mapped_view(dfsch_object_t* view, 
+                                   dfsch_object_t* string){
+  file_mapping_t* m = find_mapping(dfsch_string_to_buf(string)->ptr);
+
+  if (m){
+    add_view(view, m);
+  }
+}
+
+/*
+ * Make string or byte-vector of given type sharing storage with string 
+ * whose contents start at base, when it is backed by mapped file, 
+ * otherwise return NULL.
+ */
+static dfsch_object_t* make_shared_substring(dfsch_type_t* type,
+                                             char* base,
+                                             char* ptr, size_t len){
+  file_mapping_t* m = find_mapping(base);
+
+  if (!m){
+    return NULL;
+  }
+
+  return make_mapped_string(type, m, ptr, len);
+}
+
+static dfsch_object_t* map_file(char* fname, dfsch_type_t* type){
+#if defined(__unix__)
+  file_mapping_t* m;
+  struct stat st;
+  long page = sysconf(_SC_PAGESIZE);
+  void* addr;
+  int fd;
+
+  fd = open(fname, O_RDONLY);
+  if (fd < 0){
+    dfsch_operating_system_error(dfsch_saprintf("Cannot open file %s",
+                                                fname));
+  }
+  if (fstat(fd, &st) != 0){
+    close(fd);
+    dfsch_operating_system_error("fstat");
+  }
+
+  m = GC_NEW_ATOMIC(file_mapping_t);
+  m->size = st.st_size;
+  m->views = 0;
+  /* at least one zero byte past the end, so mapped string is C string */
+  m->map_len = (m->size / page + 1) * page;
+
+  addr = mmap(NULL, m->map_len, PROT_READ | PROT_WRITE, 
+              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED){
+    close(fd);
+    dfsch_operating_system_error("mmap");
+  }
+  if (m->size && 
+      mmap(addr, m->size, PROT_READ | PROT_WRITE, 
+           MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED){
+    close(fd);
+    munmap(addr, m->map_len);
+    dfsch_operating_system_error("mmap");
+  }
+  close(fd);
+
+  m->addr = addr;
+  register_mapping(m);
+  GC_REGISTER_FINALIZER(m, (GC_finalization_proc)mapping_finalizer,
+                        NULL, NULL, NULL);
+
+  return make_mapped_string(type, m, m->addr, m->size);
+#else
+  FILE* f = fopen(fname, "rb");
+  str_list_t* sl = sl_create();
+  char buf[8192];
+  size_t r;
+  dfsch_strbuf_t* sb;
+
+  if (!f){
+    dfsch_operating_system_error(dfsch_saprintf("Cannot open file %s",
+                                                fname));
+  }
+  while ((r = fread(buf, 1, 8192, f)) > 0){
+    sl_nappend(sl, strancpy(buf, r), r);
+  }
+  fclose(f);
+
+  sb = sl_value_strbuf(sl);
+  if (type == DFSCH_BYTE_VECTOR_TYPE){
+    return dfsch_make_byte_vector_nocopy(sb->ptr, sb->len);
+  } else {
+    return dfsch_make_string_nocopy(sb);
+  }
+#endif
+}
+
+dfsch_object_t* dfsch_make_string_mapped(char* fname){
+  return map_file(fname, DFSCH_STRING_TYPE);
+}
+dfsch_object_t* dfsch_make_byte_vector_mapped(char* fname){
+  return map_file(fname, DFSCH_BYTE_VECTOR_TYPE);
+}
+
+/*
+ * File can be unmapped only through its last view, other views would
+ * otherwise silently see zeros instead of file contents. Views that are
+ * no longer reachable are given chance to be collected first. Mapping 
+ * itself stays reserved until the object is collected, its contents are
+ * replaced by zero-filled pages.
+ */
+void dfsch_unmap_string(dfsch_object_t* obj){
+  dfsch_string_t* s = DFSCH_ASSERT_INSTANCE(obj, DFSCH_PROTO_STRING_TYPE);
+  file_mapping_t* m = find_mapping(s->buf.ptr);
+
+  if (!m){
+    dfsch_error("Not a mapped file", obj);
+  }
+
+  if (m->views > 1){
+    GC_gcollect();
+    GC_invoke_finalizers();
+  }
+  if (m->views > 1){
+    dfsch_error("Mapped file is shared with other objects", obj);
+  }
+
+#if defined(__unix__)
+  if (m->size && 
+      mmap(m->addr, m->size, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED){
+    dfsch_operating_system_error("mmap");
+  }
+#endif
+
+  s->buf.len = 0;
+  if (DFSCH_TYPE_OF(s) == STRING){
+    ((string_info_t*)s)->hash = 0;
+    ((string_info_t*)s)->flags = 0;
+    ((string_info_t*)s)->index = NULL;
+  }
+}
+
 int dfsch_string_cmp(dfsch_strbuf_t* a, dfsch_strbuf_t* b){
   if (a->len != b->len){
     size_t l = (a->len < b->len) ? a->len : b->len;
@@ -519,6 +831,7 @@ dfsch_object_t* dfsch_string_byte_substring(dfsch_object_t* string,
                                             ssize_t start,
                                             ssize_t end){
   dfsch_string_t* s = DFSCH_ASSERT_INSTANCE(string, DFSCH_PROTO_STRING_TYPE);
+  dfsch_object_t* res;
 
   if (start < 0){
     start = s->buf.len + start + 1;
@@ -536,6 +849,12 @@ dfsch_object_t* dfsch_string_byte_substring(dfsch_object_t* string,
     dfsch_error("Index out of bounds",
                 dfsch_make_number_from_long(start));
 
+  res = make_shared_substring(DFSCH_STRING_TYPE, s->buf.ptr,
+                              s->buf.ptr + start, end - start);
+  if (res){
+    return res;
+  }
+
   return dfsch_make_string_buf(s->buf.ptr+start, end-start);
 }
 
@@ -647,57 +966,129 @@ static uint32_t get_char(char* p, char* e){
   return 0xfffd; /* REPLACEMENT CHARACTER */
 }
 
+/* First byte always starts character, see next_char() */
 static size_t string_length(char* i, char* e){
-  size_t l = 0;
-
   if (i == e){
     return 0;
   }
 
+  return 1 + dfsch__utf8_count_heads(i + 1, e - i - 1);
+}
 
-  while (i){
-    l++;
+static string_info_t* get_string_info(dfsch_object_t* string){
+  string_info_t* si;
+
+  if (DFSCH_TYPE_OF(string) != STRING){
+    return NULL;
+  }
+
+  si = (string_info_t*)string;
+  if (!(si->flags & STRING_INFO_VALID)){
+    char* i = si->content.buf.ptr;
+    size_t len = si->content.buf.len;
+    int ascii = dfsch__ascii_prefix(i, len) == len;
+
+    si->length = ascii ? len : string_length(i, i + len);
+    DFSCH_MEMORY_BARRIER();
+    si->flags = STRING_INFO_VALID | (ascii ? STRING_INFO_ASCII : 0);
+  }
+
+  return si;
+}
+
+static size_t* get_string_index(string_info_t* si){
+  size_t* index = si->index;
+  char* b;
+  char* i;
+  char* e;
+  size_t l;
+
+  if (index){
+    return index;
+  }
+
+  b = si->content.buf.ptr;
+  e = b + si->content.buf.len;
+  index = GC_MALLOC_ATOMIC(sizeof(size_t) * 
+                           (si->length / STRING_INDEX_STEP + 1));
+  
+  for (i = b, l = 0; i; i = next_char(i, e), l++){
+    if (l % STRING_INDEX_STEP == 0){
+      index[l / STRING_INDEX_STEP] = i - b;
+    }
+  }
+
+  DFSCH_MEMORY_BARRIER();
+  si->index = index;
+  return index;
+}
+
+/*
+ * Return pointer to k-th character of string, end of buffer when k is
+ * length of string and NULL when it is out of range.
+ */
+static char* string_char_ptr(dfsch_object_t* string, dfsch_strbuf_t* buf,
+                             size_t k){
+  string_info_t* si = get_string_info(string);
+  char* i = buf->ptr;
+  char* e = buf->ptr + buf->len;
+  size_t l;
+
+  if (si){
+    if (k >= si->length){
+      return k == si->length ? e : NULL;
+    }
+    if (si->flags & STRING_INFO_ASCII){
+      return i + k;
+    }
+    if (buf->len > STRING_INDEX_CUTOFF){
+      i += get_string_index(si)[k / STRING_INDEX_STEP];
+      k %= STRING_INDEX_STEP;
+    }
+  }
+
+  if (i == e){
+    return k == 0 ? e : NULL;
+  }
+
+  for (l = 0; l < k; l++){
     i = next_char(i, e);
+    if (!i){
+      return l + 1 == k ? e : NULL;
+    }
   }
 
-  return l;
+  return i;
 }
 
 size_t dfsch_string_length(dfsch_object_t* string){
   dfsch_strbuf_t* buf = dfsch_string_to_buf(string);
+  string_info_t* si = get_string_info(string);
+
+  if (si){
+    return si->length;
+  }
+
   return string_length(buf->ptr, buf->ptr + buf->len);
 }
 
 uint32_t dfsch_string_ref(dfsch_object_t* string, size_t index){
   dfsch_strbuf_t* buf = dfsch_string_to_buf(string);
-  char* i = buf->ptr;
   char* e = buf->ptr + buf->len;
-  size_t l = 0;
+  char* i = string_char_ptr(string, buf, index);
 
-  if (buf->len == 0){
+  if (!i || i == e){
     dfsch_error("Index out of bound",
                 dfsch_make_number_from_long(index));
   }
 
-  while (i){
-    if (l == index){
-      return get_char(i, e);
-    }
-
-    l++;
-    i = next_char(i, e);
-  }
-
-  dfsch_error("Index out of bound",
-              dfsch_make_number_from_long(index));
+  return get_char(i, e);
 }
 
 dfsch_object_t* dfsch_string_substring(dfsch_object_t* string,
                                        ssize_t start, ssize_t end){
   dfsch_strbuf_t* buf = dfsch_string_to_buf(string);
-  char* i = buf->ptr;
-  char* e = buf->ptr + buf->len;
-  size_t l = 0;
+  dfsch_object_t* res;
   char* sp = NULL;
   char* ep = NULL;
 
@@ -720,39 +1111,27 @@ dfsch_object_t* dfsch_string_substring(dfsch_object_t* string,
                 dfsch_make_number_from_long(start));
   }
 
-  while (i){
-    if (l == start){
-      sp = i;
-      if (end == -1){
-        ep = buf->ptr + buf->len; 
-      }
-    }
-    if (l == end){
-      break;
-    }
-    l++;
-    i = next_char(i, e);
-  }
-  if (end == l){
-    if (i) {
-      ep = i;
-    } else {
-      ep = e;
-    }
-  }
-  if (start == l){
-    sp = ep;
-  }
-
+  sp = string_char_ptr(string, buf, start);
   if (!sp){
     dfsch_error("Index out of bounds", 
                 dfsch_make_number_from_long(start));
   }
+
+  if (end == -1){
+    ep = buf->ptr + buf->len;
+  } else {
+    ep = string_char_ptr(string, buf, end);
+  }
   if (!ep){
     dfsch_error("Index out of bounds", 
                 dfsch_make_number_from_long(end));
   }
 
+  res = make_shared_substring(DFSCH_STRING_TYPE, buf->ptr, sp, ep - sp);
+  if (res){
+    return res;
+  }
+
   return dfsch_make_string_buf(sp, ep - sp);
 }
 dfsch_object_t* dfsch_string_2_list(dfsch_object_t* string){
@@ -925,6 +1304,14 @@ static dfsch_object_t* string_case(dfsch_object_t* s, int m){
     return dfsch_make_string_buf(NULL, 0);
   }
 
+  if (m != TITLECASE && 
+      dfsch__ascii_prefix(buf->ptr, buf->len) == buf->len){
+    char* out;
+    dfsch_object_t* res = dfsch_make_string_for_write(buf->len, &out);
+    dfsch__ascii_case(out, buf->ptr, buf->len, m == UPCASE);
+    return res;
+  }
+
   len = 0;
   f = 1;
   while (i){
@@ -1083,21 +1470,26 @@ int dfsch_string_ci_gte_p(dfsch_strbuf_t* a, dfsch_strbuf_t* b){
 }
 
 static int search_impl(char* ni, char* ne,  char* hi, char* he){
-  int pos = 0;
+  char* m = hi;
 
   if (ni == ne){
     return 0;
   }
 
-  while ((he - hi) >= (ne - ni)){
-    if (memcmp(ni, hi, ne - ni) == 0){
-      return pos;
+  for (;;){
+    m = dfsch__memmem(m, he - m, ni, ne - ni);
+    if (!m){
+      return -1;
     }
-    hi = next_char(hi, he);
-    pos++;
+    if (m == hi || (*m & 0xc0) != 0x80){ /* only at character boundary */
+      return string_length(hi, m);
+    }
+    m++;
   }
-  
-  return -1;  
+}
+
+int dfsch_string_valid_utf8_p(dfsch_strbuf_t* buf){
+  return dfsch__utf8_valid_prefix(buf->ptr, buf->len) == buf->len;
 }
 
 int dfsch_string_search(dfsch_strbuf_t* n, dfsch_strbuf_t* h){
@@ -1954,11 +2346,18 @@ dfsch_object_t* dfsch_byte_vector_subvector(dfsch_object_t* bv,
                                             size_t off,
                                             size_t len){
   dfsch_string_t* s = DFSCH_ASSERT_INSTANCE(bv, DFSCH_BYTE_VECTOR_TYPE);
+  dfsch_object_t* res;
   
-  if (off + len >= s->buf.len){
+  if (off + len > s->buf.len){
     dfsch_index_error(s, off + len, s->buf.len);
   }
 
+  res = make_shared_substring(DFSCH_BYTE_VECTOR_TYPE, s->buf.ptr,
+                              s->buf.ptr + off, len);
+  if (res){
+    return res;
+  }
+
   return dfsch_make_byte_vector_nocopy(s->buf.ptr + off, len);
 }
 
@@ -2115,6 +2514,150 @@ uint32_t dfsch_character(dfsch_object_t* obj){
   return DFSCH_SMALL_VALUE_REF(ch);
 }
 
+/////////////////////////////////////////////////////////////////////////////
+//
+// String builders
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Growable buffer with amortized O(1) append. Contents are handed over to
+ * resulting string without copying, builder starts with empty buffer
+ * afterwards. Builders are not safe to use from multiple threads.
+ */
+
+#define STRING_BUILDER_MIN_CAPACITY 64
+
+typedef struct string_builder_t {
+  dfsch_type_t* type;
+  char* buf;
+  size_t len;
+  size_t cap;
+} string_builder_t;
+
+static void string_builder_write(string_builder_t* sb, 
+                                 dfsch_writer_state_t* state){
+  dfsch_write_unreadable_start(state, (dfsch_object_t*)sb);
+  dfsch_write_string(state, dfsch_saprintf("%zd bytes", sb->len));
+  dfsch_write_unreadable_end(state);
+}
+
+dfsch_type_t dfsch_string_builder_type = {
+  .type = DFSCH_STANDARD_TYPE,
+  .name = "string-builder",
+  .size = sizeof(string_builder_t),
+  .write = (dfsch_type_write_t)string_builder_write,
+  .documentation = "Mutable buffer for incremental construction of strings",
+};
+
+dfsch_object_t* dfsch_make_string_builder(size_t size_hint){
+  string_builder_t* sb = 
+    (string_builder_t*)dfsch_make_object(DFSCH_STRING_BUILDER_TYPE);
+
+  sb->len = 0;
+  sb->cap = size_hint;
+  sb->buf = size_hint ? GC_MALLOC_ATOMIC(size_hint + 1) : NULL;
+
+  return (dfsch_object_t*)sb;
+}
+
+static char* string_builder_reserve(string_builder_t* sb, size_t len){
+  if (sb->cap - sb->len < len){
+    size_t cap = sb->cap * 2;
+    char* buf;
+
+    if (cap < STRING_BUILDER_MIN_CAPACITY){
+      cap = STRING_BUILDER_MIN_CAPACITY;
+    }
+    if (cap - sb->len < len){
+      cap = sb->len + len;
+    }
+
+    buf = GC_MALLOC_ATOMIC(cap + 1);
+    memcpy(buf, sb->buf, sb->len);
+    sb->buf = buf;
+    sb->cap = cap;
+  }
+
+  return sb->buf + sb->len;
+}
+
+void dfsch_string_builder_append_buf(dfsch_object_t* builder, 
+                                     char* ptr, size_t len){
+  string_builder_t* sb = DFSCH_ASSERT_TYPE(builder, 
+                                           DFSCH_STRING_BUILDER_TYPE);
+
+  memcpy(string_builder_reserve(sb, len), ptr, len);
+  sb->len += len;
+}
+
+void dfsch_string_builder_append_char(dfsch_object_t* builder, 
+                                      uint32_t ch){
+  string_builder_t* sb = DFSCH_ASSERT_TYPE(builder, 
+                                           DFSCH_STRING_BUILDER_TYPE);
+  char* out = string_builder_reserve(sb, 4);
+
+  if (ch <= 0x7f){
+    out[0] = ch;
+    sb->len += 1;
+  } else if (ch <= 0x7ff) {
+    out[0] = 0xc0 | ((ch >> 6) & 0x1f); 
+    out[1] = 0x80 | (ch & 0x3f);
+    sb->len += 2;
+  } else if (ch <= 0xffff) {
+    out[0] = 0xe0 | ((ch >> 12) & 0x0f); 
+    out[1] = 0x80 | ((ch >> 6) & 0x3f);
+    out[2] = 0x80 | (ch & 0x3f);
+    sb->len += 3;
+  } else {
+    out[0] = 0xf0 | ((ch >> 18) & 0x07); 
+    out[1] = 0x80 | ((ch >> 12) & 0x3f);
+    out[2] = 0x80 | ((ch >> 6) & 0x3f);
+    out[3] = 0x80 | (ch & 0x3f);
+    sb->len += 4;
+  } 
+}
+
+void dfsch_string_builder_append(dfsch_object_t* builder, 
+                                 dfsch_object_t* obj){
+  if (DFSCH_CHARACTER_P(obj)){
+    dfsch_string_builder_append_char(builder, dfsch_character(obj));
+  } else if (dfsch_number_p(obj)){
+    char* str = dfsch_number_to_string(obj, 10);
+    dfsch_string_builder_append_buf(builder, str, strlen(str));
+  } else {
+    dfsch_string_t* s = DFSCH_ASSERT_INSTANCE(obj, DFSCH_PROTO_STRING_TYPE);
+    dfsch_string_builder_append_buf(builder, s->buf.ptr, s->buf.len);
+  }
+}
+
+size_t dfsch_string_builder_byte_length(dfsch_object_t* builder){
+  string_builder_t* sb = DFSCH_ASSERT_TYPE(builder, 
+                                           DFSCH_STRING_BUILDER_TYPE);
+  return sb->len;
+}
+
+dfsch_object_t* dfsch_string_builder_to_string(dfsch_object_t* builder){
+  string_builder_t* sb = DFSCH_ASSERT_TYPE(builder, 
+                                           DFSCH_STRING_BUILDER_TYPE);
+  dfsch_string_t* s;
+
+  if (sb->len == 0){
+    return dfsch_make_string_buf(NULL, 0);
+  }
+
+  s = (dfsch_string_t*)dfsch_make_object(DFSCH_STRING_TYPE);
+  s->buf.ptr = sb->buf;
+  s->buf.len = sb->len;
+  s->buf.ptr[s->buf.len] = 0;
+
+  sb->buf = NULL;
+  sb->len = 0;
+  sb->cap = 0;
+
+  return (dfsch_object_t*)s;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //
 // Scheme binding
@@ -2337,6 +2880,84 @@ DFSCH_DEFINE_PRIMITIVE(string_search, 0){
 
   return DFSCH_MAKE_FIXNUM(dfsch_string_search(needle, haystack));
 }
+DFSCH_DEFINE_PRIMITIVE(make_string_builder, 
+                       "Create new string builder, optional argument is "
+                       "expected size of result in bytes"){
+  long size_hint;
+
+  DFSCH_LONG_ARG_OPT(args, size_hint, 0);
+  DFSCH_ARG_END(args);
+
+  if (size_hint < 0){
+    dfsch_error("Size hint must be non-negative", 
+                dfsch_make_number_from_long(size_hint));
+  }
+
+  return dfsch_make_string_builder(size_hint);
+}
+DFSCH_DEFINE_PRIMITIVE(string_builder_append, 
+                       "Append strings, characters and decimal "
+                       "representations of numbers to string builder"){
+  dfsch_object_t* builder;
+
+  DFSCH_OBJECT_ARG(args, builder);
+  DFSCH_ASSERT_TYPE(builder, DFSCH_STRING_BUILDER_TYPE);
+
+  while (DFSCH_PAIR_P(args)){
+    dfsch_string_builder_append(builder, DFSCH_FAST_CAR(args));
+    args = DFSCH_FAST_CDR(args);
+  }
+
+  return builder;
+}
+DFSCH_DEFINE_PRIMITIVE(string_builder_append_number, 
+                       "Append representation of number in given radix "
+                       "to string builder"){
+  dfsch_object_t* builder;
+  dfsch_object_t* num;
+  long radix;
+  char* str;
+
+  DFSCH_OBJECT_ARG(args, builder);
+  DFSCH_OBJECT_ARG(args, num);
+  DFSCH_LONG_ARG_OPT(args, radix, 10);
+  DFSCH_ARG_END(args);
+
+  str = dfsch_number_to_string(num, radix);
+  dfsch_string_builder_append_buf(builder, str, strlen(str));
+
+  return builder;
+}
+DFSCH_DEFINE_PRIMITIVE(string_builder_byte_length, 
+                       "Number of bytes accumulated in string builder"){
+  dfsch_object_t* builder;
+
+  DFSCH_OBJECT_ARG(args, builder);
+  DFSCH_ARG_END(args);
+
+  return dfsch_make_number_from_long(dfsch_string_builder_byte_length(builder));
+}
+DFSCH_DEFINE_PRIMITIVE(string_builder_2_string, 
+                       "Return accumulated contents as string without "
+                       "copying and reset string builder"){
+  dfsch_object_t* builder;
+
+  DFSCH_OBJECT_ARG(args, builder);
+  DFSCH_ARG_END(args);
+
+  return dfsch_string_builder_to_string(builder);
+}
+
+DFSCH_DEFINE_PRIMITIVE(string_valid_utf8_p, 
+                       "Is contents of string or byte-vector well formed "
+                       "UTF-8?"){
+  dfsch_strbuf_t* buf;
+
+  DFSCH_BUFFER_ARG(args, buf);
+  DFSCH_ARG_END(args);
+
+  return dfsch_bool(dfsch_string_valid_utf8_p(buf));
+}
 DFSCH_DEFINE_PRIMITIVE(string_search_ci, 0){
   dfsch_strbuf_t* needle;
   dfsch_strbuf_t* haystack;
@@ -2531,6 +3152,35 @@ DFSCH_DEFINE_PRIMITIVE(byte_vector_subvector,
 
   return dfsch_byte_vector_subvector(original, offset, length);
 }
+DFSCH_DEFINE_PRIMITIVE(map_file_string,
+                       "Map contents of file into memory as string"){
+  char* fname;
+
+  DFSCH_STRING_ARG(args, fname);
+  DFSCH_ARG_END(args);
+
+  return dfsch_make_string_mapped(fname);
+}
+DFSCH_DEFINE_PRIMITIVE(map_file_byte_vector,
+                       "Map contents of file into memory as byte-vector"){
+  char* fname;
+
+  DFSCH_STRING_ARG(args, fname);
+  DFSCH_ARG_END(args);
+
+  return dfsch_make_byte_vector_mapped(fname);
+}
+DFSCH_DEFINE_PRIMITIVE(unmap_file, 
+                       "Release file mapped by map-file-string or "
+                       "map-file-byte-vector"){
+  dfsch_object_t* string;
+
+  DFSCH_OBJECT_ARG(args, string);
+  DFSCH_ARG_END(args);
+
+  dfsch_unmap_string(string);
+  return NULL;
+}
 DFSCH_DEFINE_PRIMITIVE(byte_vector_translate, 
                        "Replace bytes in FROM with coresponding bytes in TO"){
   dfsch_object_t* string;
@@ -2927,6 +3577,19 @@ void dfsch__string_native_register(dfsch_object_t *ctx){
 
   dfsch_defcanon_cstr(ctx, "string-search", 
 		   DFSCH_PRIMITIVE_REF(string_search));
+  dfsch_defcanon_cstr(ctx, "<string-builder>", DFSCH_STRING_BUILDER_TYPE);
+  dfsch_defcanon_cstr(ctx, "make-string-builder", 
+		   DFSCH_PRIMITIVE_REF(make_string_builder));
+  dfsch_defcanon_cstr(ctx, "string-builder-append!", 
+		   DFSCH_PRIMITIVE_REF(string_builder_append));
+  dfsch_defcanon_cstr(ctx, "string-builder-append-number!", 
+		   DFSCH_PRIMITIVE_REF(string_builder_append_number));
+  dfsch_defcanon_cstr(ctx, "string-builder-byte-length", 
+		   DFSCH_PRIMITIVE_REF(string_builder_byte_length));
+  dfsch_defcanon_cstr(ctx, "string-builder->string", 
+		   DFSCH_PRIMITIVE_REF(string_builder_2_string));
+  dfsch_defcanon_cstr(ctx, "string-valid-utf8?", 
+		   DFSCH_PRIMITIVE_REF(string_valid_utf8_p));
   dfsch_defcanon_cstr(ctx, "string-search-ci", 
 		   DFSCH_PRIMITIVE_REF(string_search_ci));
 
@@ -2960,6 +3623,12 @@ void dfsch__string_native_register(dfsch_object_t *ctx){
 		   DFSCH_PRIMITIVE_REF(copy_into_byte_vector));
   dfsch_defcanon_cstr(ctx, "byte-vector-subvector", 
 		   DFSCH_PRIMITIVE_REF(byte_vector_subvector));
+  dfsch_defcanon_cstr(ctx, "map-file-string", 
+		   DFSCH_PRIMITIVE_REF(map_file_string));
+  dfsch_defcanon_cstr(ctx, "map-file-byte-vector", 
+		   DFSCH_PRIMITIVE_REF(map_file_byte_vector));
+  dfsch_defcanon_cstr(ctx, "unmap-file!", 
+		   DFSCH_PRIMITIVE_REF(unmap_file));
   dfsch_defcanon_cstr(ctx, "byte-vector-translate", 
 		   DFSCH_PRIMITIVE_REF(byte_vector_translate));
   dfsch_defcanon_cstr(ctx, "string-translate", 
@@ -0,0 +1,401 @@
+/*
+ * dfsch - dfox's quick and dirty scheme implementation
+ *   Vectorized string scanning
+ * Copyright (C) 2005-2014 Ales Hakl
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "strsimd.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+  && !defined(DFSCH_NO_SIMD)
+#define X86_SIMD
+#include <immintrin.h>
+#endif
+
+/*
+ * Portable implementation
+ */
+
+#define HIGH_BITS ((uint64_t)0x8080808080808080ULL)
+
+static size_t ascii_prefix_c(char* ptr, size_t len){
+  size_t i = 0;
+  uint64_t w;
+
+  while (i + 8 <= len){
+    memcpy(&w, ptr + i, 8);
+    if (w & HIGH_BITS){
+      break;
+    }
+    i += 8;
+  }
+  while (i < len && !(ptr[i] & 0x80)){
+    i++;
+  }
+  return i;
+}
+
+static size_t count_heads_c(char* ptr, size_t len){
+  size_t i;
+  size_t count = 0;
+
+  for (i = 0; i < len; i++){
+    count += ((ptr[i] & 0xc0) != 0x80);
+  }
+  return count;
+}
+
+static void ascii_case_c(char* dst, char* src, size_t len, int upcase){
+  size_t i;
+  char lo = upcase ? 'a' : 'A';
+
+  for (i = 0; i < len; i++){
+    char c = src[i];
+    if (c >= lo && c <= lo + 25){
+      c ^= 0x20;
+    }
+    dst[i] = c;
+  }
+}
+
+static char* memmem_c(char* h, size_t hlen, char* n, size_t nlen){
+  char* e;
+  char* i = h;
+
+  if (nlen > hlen){
+    return NULL;
+  }
+
+  e = h + hlen - nlen + 1;
+  while (i < e){
+    i = memchr(i, n[0], e - i);
+    if (!i){
+      return NULL;
+    }
+    if (memcmp(i + 1, n + 1, nlen - 1) == 0){
+      return i;
+    }
+    i++;
+  }
+  return NULL;
+}
+
+#ifdef X86_SIMD
+
+/*
+ * SSE2
+ */
+
+__attribute__((target("sse2")))
+static size_t ascii_prefix_sse2(char* ptr, size_t len){
+  size_t i = 0;
+  int mask;
+
+  while (i + 16 <= len){
+    mask = _mm_movemask_epi8(_mm_loadu_si128((__m128i*)(ptr + i)));
+    if (mask){
+      return i + __builtin_ctz(mask);
+    }
+    i += 16;
+  }
+  return i + ascii_prefix_c(ptr + i, len - i);
+}
+
+__attribute__((target("sse2")))
+static size_t count_heads_sse2(char* ptr, size_t len){
+  size_t i = 0;
+  size_t count = 0;
+  __m128i limit = _mm_set1_epi8(-65); /* 0xbf */
+  __m128i v;
+
+  while (i + 16 <= len){
+    v = _mm_loadu_si128((__m128i*)(ptr + i));
+    /* continuation bytes are 0x80..0xbf, ie. signed bytes below -64 */
+    count += 16 - __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(limit,
+                                                                      v)));
+    i += 16;
+  }
+  return count + count_heads_c(ptr + i, len - i);
+}
+
+__attribute__((target("sse2")))
+static void ascii_case_sse2(char* dst, char* src, size_t len, int upcase){
+  size_t i = 0;
+  char lo = upcase ? 'a' : 'A';
+  __m128i low = _mm_set1_epi8(lo - 1);
+  __m128i high = _mm_set1_epi8(lo + 26);
+  __m128i bit = _mm_set1_epi8(0x20);
+  __m128i v;
+  __m128i m;
+
+  while (i + 16 <= len){
+    v = _mm_loadu_si128((__m128i*)(src + i));
+    m = _mm_and_si128(_mm_cmpgt_epi8(v, low), _mm_cmpgt_epi8(high, v));
+    v = _mm_xor_si128(v, _mm_and_si128(m, bit));
+    _mm_storeu_si128((__m128i*)(dst + i), v);
+    i += 16;
+  }
+  ascii_case_c(dst + i, src + i, len - i, upcase);
+}
+
+/*
+ * Candidate positions are those where both first and last byte of needle
+ * match, only these are compared completely.
+ */
+__attribute__((target("sse2")))
+static char* memmem_sse2(char* h, size_t hlen, char* n, size_t nlen){
+  __m128i first = _mm_set1_epi8(n[0]);
+  __m128i last = _mm_set1_epi8(n[nlen - 1]);
+  size_t i = 0;
+  int mask;
+
+  while (i + nlen - 1 + 16 <= hlen){
+    __m128i a = _mm_loadu_si128((__m128i*)(h + i));
+    __m128i b = _mm_loadu_si128((__m128i*)(h + i + nlen - 1));
+    mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                           _mm_cmpeq_epi8(b, last)));
+    while (mask){
+      int bitpos = __builtin_ctz(mask);
+      if (memcmp(h + i + bitpos + 1, n + 1, nlen - 1) == 0){
+        return h + i + bitpos;
+      }
+      mask &= mask - 1;
+    }
+    i += 16;
+  }
+
+  return memmem_c(h + i, hlen - i, n, nlen);
+}
+
+/*
+ * AVX2
+ */
+
+__attribute__((target("avx2")))
+static size_t ascii_prefix_avx2(char* ptr, size_t len){
+  size_t i = 0;
+  unsigned int mask;
+
+  while (i + 32 <= len){
+    mask = _mm256_movemask_epi8(_mm256_loadu_si256((__m256i*)(ptr + i)));
+    if (mask){
+      return i + __builtin_ctz(mask);
+    }
+    i += 32;
+  }
+  return i + ascii_prefix_sse2(ptr + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t count_heads_avx2(char* ptr, size_t len){
+  size_t i = 0;
+  size_t count = 0;
+  __m256i limit = _mm256_set1_epi8(-65);
+  __m256i v;
+  unsigned int mask;
+
+  while (i + 32 <= len){
+    v = _mm256_loadu_si256((__m256i*)(ptr + i));
+    mask = _mm256_movemask_epi8(_mm256_cmpgt_epi8(limit, v));
+    count += 32 - __builtin_popcount(mask);
+    i += 32;
+  }
+  return count + count_heads_sse2(ptr + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static void ascii_case_avx2(char* dst, char* src, size_t len, int upcase){
+  size_t i = 0;
+  char lo = upcase ? 'a' : 'A';
+  __m256i low = _mm256_set1_epi8(lo - 1);
+  __m256i high = _mm256_set1_epi8(lo + 26);
+  __m256i bit = _mm256_set1_epi8(0x20);
+  __m256i v;
+  __m256i m;
+
+  while (i + 32 <= len){
+    v = _mm256_loadu_si256((__m256i*)(src + i));
+    m = _mm256_and_si256(_mm256_cmpgt_epi8(v, low),
+                         _mm256_cmpgt_epi8(high, v));
+    v = _mm256_xor_si256(v, _mm256_and_si256(m, bit));
+    _mm256_storeu_si256((__m256i*)(dst + i), v);
+    i += 32;
+  }
+  ascii_case_sse2(dst + i, src + i, len - i, upcase);
+}
+
+__attribute__((target("avx2")))
+static char* memmem_avx2(char* h, size_t hlen, char* n, size_t nlen){
+  __m256i first = _mm256_set1_epi8(n[0]);
+  __m256i last = _mm256_set1_epi8(n[nlen - 1]);
+  size_t i = 0;
+  unsigned int mask;
+
+  while (i + nlen - 1 + 32 <= hlen){
+    __m256i a = _mm256_loadu_si256((__m256i*)(h + i));
+    __m256i b = _mm256_loadu_si256((__m256i*)(h + i + nlen - 1));
+    mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                                                 _mm256_cmpeq_epi8(b, last)));
+    while (mask){
+      int bitpos = __builtin_ctz(mask);
+      if (memcmp(h + i + bitpos + 1, n + 1, nlen - 1) == 0){
+        return h + i + bitpos;
+      }
+      mask &= mask - 1;
+    }
+    i += 32;
+  }
+
+  return memmem_sse2(h + i, hlen - i, n, nlen);
+}
+
+#endif
+
+/*
+ * Dispatch
+ */
+
+typedef struct kernels_t {
+  char* name;
+  size_t (*ascii_prefix)(char* ptr, size_t len);
+  size_t (*count_heads)(char* ptr, size_t len);
+  void (*ascii_case)(char* dst, char* src, size_t len, int upcase);
+  char* (*memmem)(char* h, size_t hlen, char* n, size_t nlen);
+} kernels_t;
+
+static kernels_t kernels_c = {
+  "none", ascii_prefix_c, count_heads_c, ascii_case_c, memmem_c
+};
+#ifdef X86_SIMD
+static kernels_t kernels_sse2 = {
+  "sse2", ascii_prefix_sse2, count_heads_sse2, ascii_case_sse2, memmem_sse2
+};
+static kernels_t kernels_avx2 = {
+  "avx2", ascii_prefix_avx2, count_heads_avx2, ascii_case_avx2, memmem_avx2
+};
+#endif
+
+static kernels_t* kernels = NULL;
+
+static kernels_t* select_kernels(){
+  kernels_t* k = &kernels_c;
+#ifdef X86_SIMD
+  char* limit = getenv("DFSCH_SIMD");
+
+  __builtin_cpu_init();
+  if (limit && strcmp(limit, "none") == 0){
+    k = &kernels_c;
+  } else if (__builtin_cpu_supports("avx2") &&
+             !(limit && strcmp(limit, "sse2") == 0)){
+    k = &kernels_avx2;
+  } else if (__builtin_cpu_supports("sse2")){
+    k = &kernels_sse2;
+  }
+#endif
+  kernels = k; /* every thread selects the same thing */
+  return k;
+}
+
+static kernels_t* get_kernels(){
+  kernels_t* k = kernels;
+  if (!k){
+    k = select_kernels();
+  }
+  return k;
+}
+
+char* dfsch__strsimd_implementation(){
+  return get_kernels()->name;
+}
+
+size_t dfsch__ascii_prefix(char* ptr, size_t len){
+  return get_kernels()->ascii_prefix(ptr, len);
+}
+size_t dfsch__utf8_count_heads(char* ptr, size_t len){
+  return get_kernels()->count_heads(ptr, len);
+}
+void dfsch__ascii_case(char* dst, char* src, size_t len, int upcase){
+  get_kernels()->ascii_case(dst, src, len, upcase);
+}
+char* dfsch__memmem(char* haystack, size_t hlen,
+                    char* needle, size_t nlen){
+  if (nlen == 0){
+    return haystack;
+  }
+  if (nlen > hlen){
+    return NULL;
+  }
+  return get_kernels()->memmem(haystack, hlen, needle, nlen);
+}
+
+/*
+ * ASCII runs are skipped by vectorized code, multibyte sequences are
+ * checked one by one. Overlong forms, surrogates and code points above
+ * U+10FFFF are rejected.
+ */
+size_t dfsch__utf8_valid_prefix(char* ptr, size_t len){
+  unsigned char* p = (unsigned char*)ptr;
+  kernels_t* k = get_kernels();
+  size_t i = 0;
+  size_t j;
+  size_t n;
+  uint32_t ch;
+  uint32_t min;
+
+  for (;;){
+    i += k->ascii_prefix(ptr + i, len - i);
+    if (i >= len){
+      return len;
+    }
+
+    if ((p[i] & 0xe0) == 0xc0){
+      n = 2;
+      ch = p[i] & 0x1f;
+      min = 0x80;
+    } else if ((p[i] & 0xf0) == 0xe0){
+      n = 3;
+      ch = p[i] & 0x0f;
+      min = 0x800;
+    } else if ((p[i] & 0xf8) == 0xf0){
+      n = 4;
+      ch = p[i] & 0x07;
+      min = 0x10000;
+    } else {
+      return i;
+    }
+
+    if (i + n > len){
+      return i;
+    }
+    for (j = 1; j < n; j++){
+      if ((p[i + j] & 0xc0) != 0x80){
+        return i;
+      }
+      ch = (ch << 6) | (p[i + j] & 0x3f);
+    }
+    if (ch < min || ch > 0x10ffff || (ch >= 0xd800 && ch <= 0xdfff)){
+      return i;
+    }
+
+    i += n;
+  }
+}
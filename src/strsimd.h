@@ -0,0 +1,49 @@
+/*
+ * dfsch - dfox's quick and dirty scheme implementation
+ *   Vectorized string scanning
+ * Copyright (C) 2005-2014 Ales Hakl
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef H__dfsch___strsimd__
+#define H__dfsch___strsimd__
+
+#include <stddef.h>
+
+/*
+ * Byte-level string kernels used by string primitives. Implementation is
+ * selected on first use according to CPU features (AVX2, SSE2 or plain
+ * C), environment variable DFSCH_SIMD can be set to "avx2", "sse2" or
+ * "none" to limit selection.
+ */
+
+/** Length of initial run of bytes below 0x80 */
+size_t dfsch__ascii_prefix(char* ptr, size_t len);
+/** Number of bytes that are not UTF-8 continuation bytes */
+size_t dfsch__utf8_count_heads(char* ptr, size_t len);
+/** Length of longest prefix that is well formed UTF-8 */
+size_t dfsch__utf8_valid_prefix(char* ptr, size_t len);
+/** Copy len bytes from src to dst converting ASCII letters to upper
+    (upcase != 0) or lower case */
+void dfsch__ascii_case(char* dst, char* src, size_t len, int upcase);
+/** Find first occurence of needle in haystack */
+char* dfsch__memmem(char* haystack, size_t hlen,
+                    char* needle, size_t nlen);
+/** Name of selected implementation */
+char* dfsch__strsimd_implementation();
+
+#endif
@@ -1455,6 +1455,33 @@ static void environment_serialize(environment_t* env, dfsch_serializer_t* ser){
   dfsch_serialize_integer(ser, -1); /* flags are unsigned */
 }
 
+DFSCH_DEFINE_DESERIALIZATION_HANDLER("environment-frame", environment_frame){
+  environment_t* env = (environment_t*)dfsch_new_frame(NULL);
+  int64_t flags;
+  dfsch_deserializer_put_partial_object(ds, env);
+  env->parent = dfsch_deserialize_object(ds);
+  env->context = dfsch_deserialize_object(ds);
+  env->decls = dfsch_deserialize_object(ds);
+  env->flags |= EFRAME_RETAIN;
+
+  for (;;){
+    dfsch_object_t* key;
+    dfsch_object_t* value;
+    flags = dfsch_deserialize_integer(ds);
+    if (flags < 0){
+      break;
+    }
+    key = dfsch_deserialize_object(ds);
+    value = dfsch_deserialize_object(ds);
+    dfsch_eqhash_set(&env->values, key, value);
+    if (flags){
+      dfsch_eqhash_set_flags(&env->values, key, flags);
+    }
+  }
+
+  return env;
+}
+
 DFSCH_DEFINE_PRIMITIVE(slot_sort_cmp, NULL){
   dfsch_object_t* a;
   dfsch_object_t* b;
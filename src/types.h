@@ -54,6 +54,7 @@ struct environment_t {
   dfsch_hash_t* decls;
   dfsch_object_t* context;
   int flags;
+  unsigned int canonical_version;
 };
 
 typedef struct closure_t{
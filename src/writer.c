@@ -20,10 +20,13 @@
 
 #include <dfsch/writer.h>
 #include <dfsch/eqhash.h>
+#include <dfsch/strings.h>
 
 #include "util.h"
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
 #include <assert.h>
 
 struct dfsch_writer_state_t {
@@ -66,6 +69,138 @@ dfsch_writer_state_t* dfsch_make_writer_state(int max_depth,
   return state;
 }
 
+/*
+ * Circular writer needs separate pass over whole object graph that 
+ * records every object into hash table. Most data written are trees of
+ * lists, vectors, strings and atoms, for which it is enough to check that
+ * no object that would be labeled is reachable twice. This is done by 
+ * scan_tree() with plain pointer set and when it succeeds object is 
+ * written in one pass. Objects of other types make scan fail.
+ */
+
+typedef struct ptr_set_t {
+  void** slots;
+  size_t mask;
+  size_t count;
+} ptr_set_t;
+
+#define SCAN_OK      0
+#define SCAN_SHARED  1
+#define SCAN_UNKNOWN 2
+
+static size_t ptr_set_index(ptr_set_t* set, void* ptr){
+  size_t h = ((size_t)ptr >> 3) * 0x9e3779b97f4a7c15ULL;
+  size_t i = (h >> 16) & set->mask;
+
+  while (set->slots[i] && set->slots[i] != ptr){
+    i = (i + 1) & set->mask;
+  }
+
+  return i;
+}
+static int ptr_set_contains(ptr_set_t* set, void* ptr){
+  return set->slots[ptr_set_index(set, ptr)] == ptr;
+}
+static int ptr_set_add(ptr_set_t* set, void* ptr){
+  size_t i = ptr_set_index(set, ptr);
+
+  if (set->slots[i]){
+    return 0;
+  }
+
+  set->slots[i] = ptr;
+  set->count++;
+
+  if (set->count * 2 > set->mask){
+    void** old = set->slots;
+    size_t old_size = set->mask + 1;
+    size_t j;
+
+    set->mask = old_size * 2 - 1;
+    set->slots = calloc(old_size * 2, sizeof(void*));
+    for (j = 0; j < old_size; j++){
+      if (old[j]){
+        set->slots[ptr_set_index(set, old[j])] = old[j];
+      }
+    }
+    free(old);
+  }
+
+  return 1;
+}
+
+static int circ_markable_p(dfsch_object_t* object){
+  return !DFSCH_INTERNED_SYMBOL_P(object) && 
+    !dfsch_number_p(object) && 
+    DFSCH_TYPE_OF(object) != DFSCH_PRIMITIVE_TYPE &&
+    DFSCH_TYPE_OF(object) != DFSCH_FORM_TYPE;
+}
+
+/* Mirrors marking done by first pass of dfsch_write_object() */
+static int scan_tree(ptr_set_t* set, dfsch_object_t* object){
+  dfsch_type_t* type;
+  int ret;
+
+  if (!object){
+    return SCAN_OK;
+  }
+
+  if (circ_markable_p(object) && !ptr_set_add(set, object)){
+    return SCAN_SHARED;
+  }
+
+  if (DFSCH_PAIR_P(object)){
+    dfsch_object_t* i = object;
+    while (DFSCH_PAIR_P(i)){
+      ret = scan_tree(set, DFSCH_FAST_CAR(i));
+      if (ret != SCAN_OK){
+        return ret;
+      }
+      i = DFSCH_FAST_CDR(i);
+      if (i && ptr_set_contains(set, i)){
+        return SCAN_SHARED;
+      }
+    }
+    return scan_tree(set, i);
+  }
+
+  type = DFSCH_TYPE_OF(object);
+
+  if (type == DFSCH_VECTOR_TYPE){
+    size_t len;
+    size_t j;
+    dfsch_object_t** data = dfsch_vector_as_array(object, &len);
+    for (j = 0; j < len; j++){
+      ret = scan_tree(set, data[j]);
+      if (ret != SCAN_OK){
+        return ret;
+      }
+    }
+    return SCAN_OK;
+  }
+
+  if (type == DFSCH_STRING_TYPE || type == DFSCH_BYTE_VECTOR_TYPE ||
+      type == DFSCH_SYMBOL_TYPE || DFSCH_CHARACTER_P(object) ||
+      dfsch_number_p(object)){
+    return SCAN_OK;
+  }
+
+  return SCAN_UNKNOWN;
+}
+
+static int acyclic_tree_p(dfsch_object_t* obj){
+  ptr_set_t set;
+  int ret;
+
+  set.mask = 255;
+  set.count = 0;
+  set.slots = calloc(256, sizeof(void*));
+  ret = scan_tree(&set, obj);
+  free(set.slots);
+
+  return ret == SCAN_OK;
+}
+
 void dfsch_write_object_circular(dfsch_object_t* obj,
                                  int readability,
                                  dfsch_output_proc_t proc,
@@ -73,6 +208,12 @@ void dfsch_write_object_circular(dfsch_object_t* obj,
   dfsch_writer_state_t* state = 
     dfsch_make_writer_state(INT_MAX, readability, proc, baton);
 
+  if (acyclic_tree_p(obj)){
+    dfsch_write_object(state, obj);
+    dfsch_invalidate_writer_state(state);
+    return;
+  }
+
   state->circ_pass = 1;
   dfsch_eqhash_init(&(state->circ_hash), 0);
   dfsch_write_object(state, obj);
@@ -144,10 +285,7 @@ void dfsch_write_object(dfsch_writer_state_t* state,
   }
 
   if (state->circ_pass == 1){
-    if (!DFSCH_INTERNED_SYMBOL_P(object) && 
-        !dfsch_number_p(object) && 
-        DFSCH_TYPE_OF(object) != DFSCH_PRIMITIVE_TYPE &&
-        DFSCH_TYPE_OF(object) != DFSCH_FORM_TYPE){
+    if (circ_markable_p(object)){
       if (!dfsch_eqhash_set_if_exists(&(state->circ_hash), 
                                       object, DFSCH_SYM_TRUE, NULL)){
         dfsch_eqhash_set(&(state->circ_hash), object, NULL);
@@ -215,6 +353,16 @@ void dfsch_write_object(dfsch_writer_state_t* state,
     dfsch_write_string(state, "...");
     return;
   }
+
+  if (DFSCH_FIXNUM_P(object)){
+    char buf[32];
+    if (state->circ_pass != 1){
+      dfsch_write_strbuf(state, buf, 
+                         snprintf(buf, sizeof(buf), "%" PRIdPTR, 
+                                  (ptrdiff_t)DFSCH_FIXNUM_REF(object)));
+    }
+    return;
+  }
     
   type = DFSCH_TYPE_OF(object);
   
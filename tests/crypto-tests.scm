@@ -0,0 +1,172 @@
+(require :crypto)
+
+;;; Known answer tests from FIPS 180-2, FIPS 197, RFC 4231 and SP 800-38A.
+;;; Both accelerated and portable implementations have to pass these, make
+;;; check runs the suite once more with DFSCH_SIMD=none (scm-test-portable.sh)
+;;; to check the latter.
+
+(define (hex str)
+  (hexstring->byte-vector str))
+
+(define (repeat-string str n)
+  (let ((port (string-output-port)))
+    (let loop ((i 0))
+      (when (< i n)
+        (write-string str port)
+        (loop (+ i 1))))
+    (string-output-port-value port)))
+
+(define-test sha-256-vectors (:crypto :hash)
+  (assert-equal (string->hexstring (crypto:hash-string crypto:<sha-256> "abc"))
+                "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad")
+  (assert-equal (string->hexstring
+                 (crypto:hash-string
+                  crypto:<sha-256>
+                  "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"))
+                "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1")
+  (assert-equal (string->hexstring
+                 (crypto:hash-string crypto:<sha-256>
+                                     (repeat-string "aaaaaaaaaa" 100000)))
+                "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0")
+  (assert-equal (string->hexstring
+                 (crypto:hash-string crypto:<hmac-sha-256>
+                                     "what do ya want for nothing?"
+                                     "Jefe"))
+                "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"))
+
+(define-test sha-256-many (:crypto :hash)
+  (let ((inputs (let loop ((i 0) (acc ()))
+                  (if (< i 37)
+                      (loop (+ i 1)
+                            (cons (repeat-string "x" (* i 7)) acc))
+                      acc))))
+    (assert-equal (crypto:hash-strings crypto:<sha-256> inputs)
+                  (map (lambda (i) (crypto:hash-string crypto:<sha-256> i))
+                       inputs))
+    (assert-equal (crypto:hash-strings crypto:<sha-1> inputs)
+                  (map (lambda (i) (crypto:hash-string crypto:<sha-1> i))
+                       inputs))))
+
+(define-test sha-1-vectors (:crypto :hash)
+  (assert-equal (string->hexstring (crypto:hash-string crypto:<sha-1> "abc"))
+                "a9993e364706816aba3e25717850c26c9cd0d89d")
+  (assert-equal (string->hexstring
+                 (crypto:hash-string
+                  crypto:<sha-1>
+                  "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"))
+                "84983e441c3bd26ebaae4aa1f95129e5e54670f1")
+  (assert-equal (string->hexstring
+                 (crypto:hash-string crypto:<sha-1>
+                                     (repeat-string "aaaaaaaaaa" 100000)))
+                "34aa973cd4c4daa4f61eeb2bdbad27316534016f"))
+
+(define-test aes-vectors (:crypto :cipher)
+  (let ((pt (hex "00112233445566778899aabbccddeeff")))
+    (for-each
+     (lambda (kat)
+       (let ((ctx (crypto:setup-block-cipher crypto:<aes> (hex (car kat)))))
+         (assert-equal (crypto:encrypt-block ctx pt) (hex (cadr kat)))
+         (assert-equal (crypto:decrypt-block ctx (hex (cadr kat))) pt)))
+     '(("000102030405060708090a0b0c0d0e0f"
+        "69c4e0d86a7b0430d8cdb78070b4c55a")
+       ("000102030405060708090a0b0c0d0e0f1011121314151617"
+        "dda97ca4864cdfe06eaf70a0ec0d7191")
+       ("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+        "8ea2b7ca516745bfeafc49904b496089")))))
+
+(define sp800-key (hex "2b7e151628aed2a6abf7158809cf4f3c"))
+(define sp800-iv (hex "000102030405060708090a0b0c0d0e0f"))
+(define sp800-plaintext
+  (hex (string-append "6bc1bee22e409f96e93d7e117393172a"
+                      "ae2d8a571e03ac9c9eb76fac45af8e51"
+                      "30c81c46a35ce411e5fbc1191a0a52ef"
+                      "f69f2445df4f9b17ad2b417be66c3710")))
+
+(define (mode-round-trip mode iv ct)
+  (let ((cipher (crypto:setup-block-cipher crypto:<aes> sp800-key)))
+    (and (equal? (crypto:encrypt-blocks
+                  (crypto:setup-block-cipher-mode mode cipher iv)
+                  sp800-plaintext)
+                 ct)
+         (equal? (crypto:decrypt-blocks
+                  (crypto:setup-block-cipher-mode mode cipher iv)
+                  ct)
+                 sp800-plaintext))))
+
+(define-test aes-modes-vectors (:crypto :cipher)
+  (assert-true (mode-round-trip 
+                crypto:<ecb> ""
+                (hex (string-append "3ad77bb40d7a3660a89ecaf32466ef97"
+                                    "f5d3d58503b9699de785895a96fdbaaf"
+                                    "43b1cd7f598ece23881b00e3ed030688"
+                                    "7b0c785e27e8ad3f8223207104725dd4"))))
+  (assert-true (mode-round-trip 
+                crypto:<cbc> sp800-iv
+                (hex (string-append "7649abac8119b246cee98e9b12e9197d"
+                                    "5086cb9b507219ee95db113a917678b2"
+                                    "73bed6b8e3c1743b7116e69e22229516"
+                                    "3ff1caa1681fac09120eca307586e1a7"))))
+  (assert-true (mode-round-trip 
+                crypto:<cfb> sp800-iv
+                (hex (string-append "3b3fd92eb72dad20333449f8e83cfb4a"
+                                    "c8a64537a0b3a93fcde3cdad9f1ce58b"
+                                    "26751f67a3cbb140b1808cf187a4f4df"
+                                    "c04b05357c5d1c0eeac4c66f9ff7f2e6"))))
+  (assert-true (mode-round-trip 
+                crypto:<ofb> sp800-iv
+                (hex (string-append "3b3fd92eb72dad20333449f8e83cfb4a"
+                                    "7789508d16918f03f53c52dac54ed825"
+                                    "9740051e9c5fecf64344f7a82260edcc"
+                                    "304c6528f659c77866a510d9c1d6ae5e")))))
+
+;;; CTR counter is incremented as little endian number, which differs
+;;; from SP 800-38A, so only first block is known answer. Rest is checked
+;;; against ECB encryption of counters and against stream cipher variant.
+
+(define-test aes-ctr (:crypto :cipher)
+  (let* ((cipher (crypto:setup-block-cipher crypto:<aes> sp800-key))
+         (iv (hex "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"))
+         (counters (hex (string-append "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"
+                                       "f1f1f2f3f4f5f6f7f8f9fafbfcfdfeff"
+                                       "f2f1f2f3f4f5f6f7f8f9fafbfcfdfeff"
+                                       "f3f1f2f3f4f5f6f7f8f9fafbfcfdfeff")))
+         (keystream (crypto:encrypt-blocks
+                     (crypto:setup-block-cipher-mode crypto:<ecb> cipher "")
+                     counters))
+         (zeros (make-byte-vector 64))
+         (ct (crypto:encrypt-blocks
+              (crypto:setup-block-cipher-mode crypto:<ctr> cipher iv)
+              sp800-plaintext)))
+    (assert-equal (byte-vector-subvector ct 0 16)
+                  (hex "874d6191b620e3261bef6864990db6ce"))
+    (assert-equal (crypto:encrypt-blocks
+                   (crypto:setup-block-cipher-mode crypto:<ctr> cipher iv)
+                   zeros)
+                  keystream)
+    (assert-equal (crypto:decrypt-blocks
+                   (crypto:setup-block-cipher-mode crypto:<ctr> cipher iv)
+                   ct)
+                  sp800-plaintext)
+    (let ((stream (crypto:setup-stream-cipher
+                   (crypto:make-ctr-cipher crypto:<aes>)
+                   sp800-key iv)))
+      (assert-equal (crypto:apply-stream-cipher
+                     stream (byte-vector-subvector sp800-plaintext 0 7))
+                    (byte-vector-subvector ct 0 7))
+      (assert-equal (crypto:apply-stream-cipher
+                     stream (byte-vector-subvector sp800-plaintext 7 57))
+                    (byte-vector-subvector ct 7 57)))))
+
+(define-test aes-modes-long (:crypto :cipher)
+  (let ((cipher (crypto:setup-block-cipher crypto:<aes> sp800-key))
+        (data (repeat-string "0123456789abcdefghijklmnopqrstu" 16)))
+    (for-each
+     (lambda (mode)
+       (let ((iv (if (eq? mode crypto:<ecb>) "" sp800-iv)))
+         (assert-equal (crypto:decrypt-blocks
+                        (crypto:setup-block-cipher-mode mode cipher iv)
+                        (crypto:encrypt-blocks
+                         (crypto:setup-block-cipher-mode mode cipher iv)
+                         data))
+                       (proto-string->byte-vector data))))
+     (list crypto:<ecb> crypto:<cbc> crypto:<cfb> crypto:<ofb> crypto:<ctr>))))
@@ -1,3 +1,5 @@
+(require :introspect)
+
 (define-test test-eq? (:language :equality)
   (assert-true (eq? 'a 'a))
   (assert-false (eq? 'a 'b))
@@ -51,6 +53,132 @@
   (assert-equal (>> 3523532227357930030104576 54) 
                 195595330))
 
+(define-test bignum-large-operands (:language :numbers)
+  (let ((a (random-bignum 30000))
+        (b (random-bignum 14000)))
+    (assert-equal (+ (* (/i a b) b) (% a b)) a)
+    (assert-true (< (% a b) b))
+    (assert-equal (* a a) (+ (* (+ a 1) (- a 1)) 1))
+    (assert-equal (string->number (number->string a)) a))
+  (assert-equal (% (* (integer-expt 3 5000) (integer-expt 7 4000))
+                   1000000007)
+                155477050)
+  (assert-equal (% (/i (integer-expt 3 5000) (integer-expt 7 1500))
+                   1000000007)
+                101302849)
+  (let ((s (number->string (integer-expt 2 4000))))
+    (assert-equal (string-length s) 1205)
+    (assert-equal (substring s 0 20) "13182040934309431001")))
+
+(define-test modular-exponentiation (:language :numbers)
+  (assert-equal (integer-expt 1234567890123456789
+                              789456123
+                              102030405060708091)
+                45634432514447556)
+  (let ((b (+ (integer-expt 3 300) 17))
+        (e (integer-expt 7 200))
+        (m (+ (- (integer-expt 2 1000) (integer-expt 2 500)) 1)))
+    (assert-equal (% (integer-expt b e m) 1000000007) 872527540)
+    (assert-equal (integer-expt b e m #t) (integer-expt b e m))
+    (assert-equal (integer-expt b 0 m #t) 1)))
+
+(define-test numeric-vectors (:language :numbers)
+  (let ((a (f64vector 1 2.5 3))
+        (s (s64vector 9223372036854775807 1 -5))
+        (u (u8vector 250 3 7)))
+    (assert-equal (collection->list (numeric-vector+ a (make-f64vector 3 2)))
+                  '(3.0 4.5 5.0))
+    (assert-equal (collection->list (numeric-vector* a 2)) '(2.0 5.0 6.0))
+    (assert-equal (numeric-vector-sum a) 6.5)
+    (assert-equal (numeric-vector-dot a a) 16.25)
+    (assert-equal (numeric-vector-min a) 1.0)
+    (assert-equal (numeric-vector-max s) 9223372036854775807)
+    (assert-equal (numeric-vector-sum s) 9223372036854775803)
+    (assert-equal (seq-ref (numeric-vector+ s 1) 0) -9223372036854775808)
+    (assert-equal (collection->list (numeric-vector+ u 10)) '(4 13 17))
+    (assert-equal (numeric-vector-dot u u) 62558)
+    (seq-set! a 1 10)
+    (assert-equal (seq-ref a 1) 10.0)
+    (assert-equal (seq-length u) 3)
+    (assert-true (equal? (f64vector 0.0 1) (f64vector -0.0 1.0)))
+    (assert-equal (deserialize (serialize (list a s u))) (list a s u))))
+
+(define-test numeric-vector-kernels (:language :numbers)
+  (let ((x (make-f64vector 1000 0.5))
+        (s (s64vector 5 -3 9223372036854775807 -9223372036854775808 0)))
+    (seq-set! x 123 -7.0)
+    (seq-set! x 999 12.0)
+    (assert-equal (numeric-vector-sum x) 504.0)
+    (assert-equal (numeric-vector-dot x x) 442.5)
+    (assert-equal (numeric-vector-min x) -7.0)
+    (assert-equal (numeric-vector-max x) 12.0)
+    (let ((m (numeric-vector-max (f64vector 1 2 3 +nan. 4 5))))
+      (assert-false (= m m)))
+    (assert-equal (seq-ref (numeric-vector-axpy 2 x x) 999) 36.0)
+    (assert-equal (seq-ref (numeric-vector-prefix-sum x) 124) 55.0)
+    (assert-equal (collection->list (numeric-vector-sort! s))
+                  '(-9223372036854775808 -3 0 5 9223372036854775807))
+    (assert-equal (collection->list (numeric-vector-sort! (f64vector 3 -1 2.5)))
+                  '(-1.0 2.5 3.0))
+    (assert-equal (collection->list
+                   (numeric-vector-histogram (u8vector 0 1 2 3 200 255) 4 0 4))
+                  '(1 1 1 1))
+    (assert-equal (numeric-vector-sum
+                   (numeric-vector-histogram (u8vector 0 1 2 255 128 128)
+                                             40000 0 255))
+                  6)
+    (assert-error <error> (numeric-vector+ (u8vector 1 2) 256))
+    (assert-error <error> (numeric-vector* (u8vector 1 2) -1))
+    (assert-error <error> (numeric-vector-axpy 256 (u8vector 1) (u8vector 1)))))
+
+;; Reference values from the published MT19937 and xoshiro256** algorithms
+(define-test random-states (:language :numbers)
+  (assert-equal (collection->list
+                 (random-bytes 10 (make-default-random-state "abcd")))
+                '(178 242 25 32 252 254 215 186 102 146))
+  (assert-equal (collection->list
+                 (random-bytes 12 (make-xoshiro-random-state "seed")))
+                '(48 133 57 112 42 122 47 161 21 111 155 34))
+  (assert-equal (collection->list
+                 (random-bytes 8 (random-state-jump
+                                  (make-xoshiro-random-state "seed") 2)))
+                '(118 198 23 90 105 82 112 120))
+  (let ((v (random-fill! (make-f64vector 1000)
+                         (make-xoshiro-random-state "fill"))))
+    (assert-true (>= (numeric-vector-min v) 0.0))
+    (assert-true (< (numeric-vector-max v) 1.0)))
+  (assert-true (< (random 10) 10)))
+
+(define-test random-seed-snapshot (:language :numbers)
+  (set-random-seed! "test")
+  (let ((a (random-bytes 16)))
+    (set-random-seed! "test")
+    (assert-equal (random-bytes 16) a))
+  (let* ((snapshot (save-random-states))
+         (a (random-bignum 256)))
+    (random-bytes 100)
+    (restore-random-states! snapshot)
+    (assert-equal (random-bignum 256) a)))
+
+(define-test fused-arithmetic (:language :numbers)
+  (define (f x y z) (+ (* x y) (/ z 2) (- x) (- (* 1.5 x) y 1)))
+  (define (k x) (* (+ x 0.5) (/ x)))
+  (assert-equal (f 1 2 3) 1.0)
+  (assert-equal (f 1/3 2 3) (+ (* 1/3 2) (/ 3 2) (- 1/3) (- (* 1.5 1/3) 2 1)))
+  (assert-equal (f 2 3 4) 5.0)
+  (assert-equal (k 2.0) 1.25)
+  (assert-equal ((lambda (x y) (+ (* x y) (- x y))) 3 4) 11)
+  (assert-equal ((lambda (x y) (/ (+ x 1) (- y 1))) 1 3) 1))
+
+(define-test fused-arithmetic-serialization (:language :numbers)
+  (let ((f (lambda (x) (* 2.0 (+ 1 x)))))
+    (compile-function! f)
+    (assert-equal (f 3) 8.0)
+    (let ((g (deserialize (serialize f top-level-environment) 
+                          top-level-environment)))
+      (assert-equal (g 3) 8.0)
+      (assert-equal (g 1/2) 3.0))))
+
 (define-test bitwise-logic (:language :numbers)
   (assert-true (logtest 1 7))
   (assert-false (logtest 1 2))
@@ -88,6 +216,15 @@
   (assert-equal (string->object (object->string bn)) bn)
   (assert-equal (string->object (object->string string))  string))
 
+(define-test circular-writer (:language :writer)
+  (let ((s (string-append "a\"" "b"))
+        (l (list 1 2 3)))
+    (assert-equal (format "~s" (list s (vector -1 'x) #\c))
+                  "(\"a\\\"b\" #(-1 x) #\\c)")
+    (assert-equal (format "~s" (list s s)) "(#0=\"a\\\"b\" #0#)")
+    (set-cdr! (cddr l) l)
+    (assert-equal (format "~s" l) "#0=(1 2 3 . #0#)")))
+
 (define-test lambda-keywords (:language :functions)
   (define (opt-arg-fun &optional a (b 2) (c 3 c-supplied))
     (list a b c c-supplied))
@@ -133,13 +270,65 @@
   (assert-equal (string-split-on-character "a©cæ©b" "©")
                 '("a" "cæ" "b")))
 
+(define-test string-indexing (:language :strings :utf8)
+  (let ((s (let loop ((i 0) (parts ()))
+             (if (< i 300)
+                 (loop (+ i 1) (cons "ab©" parts))
+                 (apply string-append parts)))))
+    (assert-equal (string-length s) 900)
+    (assert-equal (string-ref s 0) #\a)
+    (assert-equal (string-ref s 452) #\ua9)
+    (assert-equal (string-ref s 899) #\ua9)
+    (assert-equal (substring s 448 453) "b©ab©")
+    (assert-equal (substring s 897 900) "ab©")))
+
+(define-test string-scanning (:language :strings :utf8)
+  (let ((s (let loop ((i 0) (parts ()))
+             (if (< i 40)
+                 (loop (+ i 1) (cons "abcdefgh" parts))
+                 (apply string-append (reverse (cons "© needle" parts)))))))
+    (assert-equal (string-length s) 328)
+    (assert-equal (string-search "needle" s) 322)
+    (assert-equal (string-search "nope" s) -1)
+    (assert-equal (substring (string-upcase s) 316 324) "EFGH© NE")
+    (assert-equal (string-downcase "ABCDEFGHIJKLMNOPQRSTUVWXYZ[@]")
+                  "abcdefghijklmnopqrstuvwxyz[@]")
+    (assert-true (string-valid-utf8? s))
+    (assert-true (not (string-valid-utf8? 
+                       (byte-list->string '(192 128)))))
+    (assert-true (not (string-valid-utf8? 
+                       (byte-list->string '(237 160 128)))))))
+
+(define-test string-builder (:language :strings)
+  (let ((sb (make-string-builder)))
+    (let loop ((i 0))
+      (when (< i 100)
+        (string-builder-append! sb "ab" #\u00a9 i)
+        (loop (+ i 1))))
+    (string-builder-append-number! sb 255 16)
+    (assert-equal (string-builder-byte-length sb) 592)
+    (let ((s (string-builder->string sb)))
+      (assert-equal (string-length s) 492)
+      (assert-equal (substring s 0 10) "ab©0ab©1ab")
+      (assert-equal (substring s 485 492) "ab©99ff"))
+    (assert-equal (string-builder-byte-length sb) 0)
+    (assert-equal (string-builder->string 
+                   (string-builder-append! sb "x" #\y))
+                  "xy")))
+
 (define-test format (:language :format)
   (assert-equal (format "~~") "~")
   (assert-equal (format "~2r ~:* ~8r ~:* ~10r ~:* ~16r" 123)
                 "1111011  173  123  7b")
   (assert-equal (format "~c" 0x3042) "あ")
   (assert-equal (format "~15f" '(1 2 3 4)) "      (1 2 3 4)")
-  (assert-equal (format "~10,5f" pi) "   3.14159"))
+  (assert-equal (format "~10,5f" pi) "   3.14159")
+  (assert-equal (format "~? ~b" "<~a>" '(1) -5) "<1> -101")
+  (let ((cf (compile-format "~a=~s~%")))
+    (assert-equal (format cf 'x "y") "x=\"y\"\n")
+    (assert-equal (with-output-to-string 
+                   (format (current-output-port) cf 1 2))
+                  "1=2\n")))
 
 
 
@@ -209,11 +398,251 @@
   (let ((res (deserialize (serialize + top-level-environment) top-level-environment)))
     (assert-true (eq? + res))))
 
+(define-test serialization-envrefs-redefined (:language :serialization)
+  (let ((env (make-top-level-environment)))
+    (serialize + env)
+    (eval '(define-class envref-test () ()) env)
+    (let ((class (eval 'envref-test env)))
+      (assert-true (eq? (deserialize (serialize class env) env) class)))
+    (eval '(define-class envref-test () (x)) env)
+    (let ((class (eval 'envref-test env)))
+      (assert-true (eq? (deserialize (serialize class env) env) class)))))
+
+(define-test serialization-class-instances (:language :serialization)
+  (let ((env (make-top-level-environment)))
+    (eval '(define-class <ser-point> () (x y)) env)
+    (eval '(define-class <ser-named-point> <ser-point> (name)) env)
+    (let* ((data (eval '(let ((a (make-instance <ser-point>))
+                              (b (make-instance <ser-named-point>))
+                              (c (make-instance <ser-point>)))
+                          (slot-set! a :x 1)
+                          (slot-set! a :y 2)
+                          (slot-set! b :x 3)
+                          (slot-set! b :y a)
+                          (slot-set! b :name "b")
+                          (slot-set! c :x c)
+                          (slot-set! c :y (list a b))
+                          (list a b c))
+                       env))
+           (res (deserialize (serialize data env) env))
+           (a (car res))
+           (b (cadr res))
+           (c (caddr res)))
+      (assert-true (eq? (type-of b) (eval '<ser-named-point> env)))
+      (assert-equal (slot-ref a :x) 1)
+      (assert-equal (slot-ref a :y) 2)
+      (assert-true (eq? (slot-ref b :y) a))
+      (assert-equal (slot-ref b :name) "b")
+      (assert-true (eq? (slot-ref c :x) c))
+      (assert-true (eq? (cadr (slot-ref c :y)) b)))))
+
 (define-test serialization-code (:language :serialization)
   (define proc (slot-ref define-class :proc))
   (let ((res (deserialize (serialize proc top-level-environment) top-level-environment)))
     (assert-true (eq? (type-of res) <standard-function>))))
 
+(define-test serialization-record-cursor (:language :serialization)
+  (let ((port (string-output-port))
+        (vec (make-vector 20 'x)))
+    (write-serialized-record port (list 1 vec vec) () 16)
+    (write-serialized-record port '(2 #(a b)) () 16)
+    (write-serialized-record port "third")
+    (let* ((data (string-output-port-value port))
+           (cursor (make-record-cursor data () #t))
+           (rec (record-cursor-next! cursor))
+           (lazy (cadr rec)))
+      (assert-true (eq? lazy (caddr rec)))
+      (assert-false (lazy-object-forced? lazy))
+      ;; type specific accessors do not force the proxy
+      (assert-error <error> (vector-ref lazy 0))
+      (assert-false (lazy-object-forced? lazy))
+      (assert-equal (seq-ref lazy 0) 'x)
+      (assert-equal (seq-length lazy) 20)
+      (assert-true (lazy-object-forced? lazy))
+      (assert-equal (force-lazy lazy) vec)
+      (assert-equal (vector-ref (force-lazy lazy) 0) 'x)
+      (assert-equal (record-cursor-skip! cursor 1) 1)
+      (assert-equal (record-cursor-next! cursor) "third")
+      (assert-true (eof-object? (record-cursor-next! cursor)))
+      (assert-equal (record-cursor-index cursor) 3)
+      (let ((eager (make-record-cursor (string-input-port data))))
+        (assert-equal (record-cursor-next! eager) (list 1 vec vec))
+        (assert-equal (record-cursor-next! eager) '(2 #(a b)))))))
+
+(define-test image-roundtrip (:language :serialization)
+  (let ((env (make-top-level-environment))
+        (copy (make-top-level-environment)))
+    (eval '(define image-data '(1 2 #(a b) "foo")) env)
+    (eval '(define (image-square x) (* x x)) env)
+    (eval '(define (image-fourth x) (image-square (image-square x))) env)
+    (eval '(define image-procedures (list image-square car)) env)
+    (eval '(save-image! "image-test.dfim") env)
+    (eval '(load-image! "image-test.dfim") copy)
+    (os:unlink "image-test.dfim")
+    (assert-equal (eval 'image-data copy) '(1 2 #(a b) "foo"))
+    (assert-equal (eval '(image-fourth 2) copy) 16)
+    (assert-true (eval '(eq? (car image-procedures) image-square) copy))
+    (assert-true (eval '(eq? (cadr image-procedures) car) copy))))
+
+(define-test image-unserializable-canonical (:language :serialization)
+  (let ((env (make-top-level-environment)))
+    (eval '(define-class image-class () ()) env)
+    (assert-error <error> (eval '(save-image! "image-test.dfim") env))
+    (assert-true (not (member "image-test.dfim" (directory-entries "."))))))
+
+(define-test image-failed-save (:language :serialization)
+  (let ((env (make-top-level-environment))
+        (copy (make-top-level-environment)))
+    (eval '(define image-data 1) env)
+    (eval '(save-image! "image-test.dfim") env)
+    (eval `(define image-data (list 2 ,(string-output-port))) env)
+    (assert-error <error> (eval '(save-image! "image-test.dfim") env))
+    (assert-true (not (member "image-test.dfim.tmp" (directory-entries "."))))
+    (eval '(load-image! "image-test.dfim") copy)
+    (os:unlink "image-test.dfim")
+    (assert-equal (eval 'image-data copy) 1)))
+
+(define-test read-scm-callback (:language :io)
+  (let ((port (open-file-port "read-test.scm" "w"))
+        (forms ()))
+    (write-string "(a 1) \"b\" c" port)
+    (close-file-port! port)
+    (read-scm "read-test.scm" (lambda (x) (set! forms (cons x forms))))
+    (os:unlink "read-test.scm")
+    (assert-equal (reverse forms) '((a 1) "b" c))))
+
+(define-test mapped-strings (:language :io)
+  (let ((port (open-file-port "mapped-test.txt" "w")))
+    (write-string "hello mapped world" port)
+    (close-file-port! port))
+  (let* ((s (map-file-string "mapped-test.txt"))
+         (sub (substring s 6 12)))
+    (os:unlink "mapped-test.txt")
+    (assert-equal s "hello mapped world")
+    (assert-equal sub "mapped")
+    (assert-equal (string->symbol sub) 'mapped)
+    (assert-equal (string-search "world" s) 13)
+    (assert-error <error> (unmap-file! s))
+    (assert-equal sub "mapped"))
+  (write-test-file "mapped-test.txt" "unmapped")
+  (let ((s (map-file-string "mapped-test.txt")))
+    (os:unlink "mapped-test.txt")
+    (assert-equal s "unmapped")
+    (unmap-file! s)
+    (assert-equal s "")))
+
+(define-test mapped-strings-many (:language :io)
+  (let ((names (map (lambda (i) (string-append "mapped-test-" 
+                                               (number->string i) ".txt"))
+                    '(0 1 2 3 4 5 6 7 8 9))))
+    (for-each (lambda (name) (write-test-file name name)) names)
+    (let ((strings (map map-file-string names)))
+      (for-each os:unlink names)
+      ;; substrings of all mappings are recognized as mapped
+      (for-each (lambda (s) 
+                  (let ((sub (substring s 7 11)))
+                    (assert-equal sub "test")
+                    (assert-error <error> (unmap-file! sub))
+                    (assert-equal sub "test")))
+                (reverse strings))
+      (assert-error <error> (unmap-file! (string-append "te" "st"))))))
+
+(define-test mapped-record-cursor (:language :io)
+  (let ((port (open-file-port "mapped-records.dat" "w")))
+    (write-serialized-record port (make-vector 20 'x) () 16)
+    (close-file-port! port))
+  (let* ((data (map-file-string "mapped-records.dat"))
+         (cursor (make-record-cursor data () #t))
+         (lazy (record-cursor-next! cursor)))
+    (os:unlink "mapped-records.dat")
+    (assert-error <error> (unmap-file! data))
+    (assert-equal (seq-length lazy) 20)))
+
+(define-test port-buffering (:language :io)
+  (let ((out (open-file-port "buffering-test.txt" "w")))
+    (set-port-buffering! out :full 1024)
+    (write-string "buffered" out)
+    (let ((in (open-file-port "buffering-test.txt" "r")))
+      (assert-equal (read-whole-port in) #"")
+      (close-file-port! in))
+    (flush-output out)
+    (let ((in (open-file-port "buffering-test.txt" "r")))
+      (assert-equal (read-whole-port in) #"buffered")
+      (close-file-port! in))
+    (close-file-port! out)
+    (os:unlink "buffering-test.txt")))
+
+(define-test autoload (:language :modules)
+  (autoload! :stream-functions 'dfsch:stream-filter)
+  (assert-true (eq? (type-of dfsch:stream-filter) <standard-function>)))
+
+(define-test autoload-into-top-level (:language :modules)
+  (let ((env (make-top-level-environment)))
+    (write-test-file "autoload-test.scm" "(define autoload-test-value 42)")
+    (eval '(define *load-path* '(".")) env)
+    (assert-equal (eval '(let ((x 1))
+                           (autoload! "autoload-test" 'autoload-test-value)
+                           (+ x autoload-test-value))
+                        env)
+                  43)
+    (assert-equal (eval 'autoload-test-value env) 42)
+    (os:unlink "autoload-test.scm")))
+
+(define-test autoload-retry-failed (:language :modules)
+  (let ((env (make-top-level-environment)))
+    (eval '(define *load-path* '(".")) env)
+    (eval '(autoload! "autoload-retry-test" 'autoload-retry-value) env)
+    (multiple-value-bind (value condition)
+        (ignore-errors (eval 'autoload-retry-value env))
+      (assert-equal (condition-field condition :message) "Module not found"))
+    (write-test-file "autoload-retry-test.scm" 
+                     "(define autoload-retry-value 2)")
+    (assert-equal (eval 'autoload-retry-value env) 2)
+    (os:unlink "autoload-retry-test.scm")))
+
+(define (write-test-file name text)
+  (let ((port (open-file-port name "w")))
+    (write-string text port)
+    (close-file-port! port)))
+
+(define (directory-entries dir)
+  (let ((d (os:opendir dir)))
+    (let loop ((names ()))
+      (let ((name (os:readdir d)))
+        (cond ((not name) (os:closedir d) names)
+              ((member name '("." "..")) (loop names))
+              (else (loop (cons name names))))))))
+
+(define-test module-cache (:language :modules)
+  (let ((env (make-top-level-environment))
+        (dir "module-cache-test"))
+    (define (load-module text)
+      (write-test-file "module-cache-test.scm" text)
+      (eval '(load! "module-cache-test" '(".")) env)
+      (eval 'module-cache-value env))
+    (eval `(define *module-cache-directory* ,dir) env)
+    (assert-equal (load-module "(define module-cache-value 1)") 1)
+    (let ((first (directory-entries dir)))
+      (assert-equal (length first) 1)
+      ;; changed source is not served from old entry
+      (assert-equal (load-module "(define module-cache-value 2)") 2)
+      (let ((second (filter (lambda (name) (not (member name first)))
+                            (directory-entries dir))))
+        (assert-equal (length second) 1)
+        ;; entry for first source now holds forms of second one, so
+        ;; loading first source again has to replay them
+        (os:rename (string-append dir "/" (car second))
+                   (string-append dir "/" (car first)))
+        (assert-equal (load-module "(define module-cache-value 1)") 2)
+        ;; corrupt entry is treated as a miss and replaced
+        (write-test-file (string-append dir "/" (car first)) "DfMc garbage")
+        (assert-equal (load-module "(define module-cache-value 1)") 1)
+        (assert-equal (load-module "(define module-cache-value 1)") 1)))
+    (for-each (lambda (name) (os:unlink (string-append dir "/" name)))
+              (directory-entries dir))
+    (os:rmdir dir)
+    (os:unlink "module-cache-test.scm")))
+
 
 (define-test sequences (:language :collections)
   (define l (list   'a 'b 'c 'd 'e 'f))
@@ -263,4 +692,46 @@
 
 (define-test string-ports (:language :io)
   (assert-equal (read-whole-port (string-input-port #"abc")) #"abc")
-  (assert-equal (with-output-to-string (display "foo")) "foo"))
\ No newline at end of file
+  (assert-equal (with-output-to-string (display "foo")) "foo")
+  (let ((port (local-string-output-port 4)))
+    (assert-true (instance? port <string-output-port>))
+    (display "foo" port)
+    (let ((s (string-output-port-value port #t))
+          (bv (string-output-port-value port)))
+      (write '(1 "bar") port)
+      (copy-into-byte-vector bv #"X")
+      (assert-equal s "foo")
+      (assert-equal (string-output-port-value port #t) "foo(1 \"bar\")"))))
+
+(define-test read-from-port (:language :io)
+  (let ((port (string-input-port "foo(1 2) \"a\\\"b\" 42")))
+    (assert-equal (read port) 'foo)
+    (assert-equal (read port) '(1 2))
+    (assert-equal (read port) "a\"b")
+    (assert-equal (read port) 42)
+    (assert-true (eof-object? (read port)))))
+
+(define-test read-from-long-port (:language :io)
+  (let* ((lists (let ((port (string-output-port)))
+                  (let loop ((i 0))
+                    (when (< i 3000)
+                      (write (list i (number->string i)) port)
+                      (loop (+ i 1))))
+                  (string-output-port-value port)))
+         (port (string-input-port
+                (string-append lists (with-output-to-string 
+                                      (write lists))))))
+    (assert-true (let loop ((i 0))
+                   (let ((obj (read port)))
+                     (cond ((= i 3000) (equal? obj lists))
+                           ((equal? obj (list i (number->string i)))
+                            (loop (+ i 1)))
+                           (else #f)))))
+    (assert-true (eof-object? (read port)))))
+
+(define-test read-embedded-nul (:language :io)
+  (let ((port (string-input-port 
+               (string-append "(1 2)" (string (ordinal->character 0)) " 3"))))
+    (assert-equal (read port) '(1 2))
+    (assert-equal (read port) 3)
+    (assert-true (eof-object? (read port)))))
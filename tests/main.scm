@@ -19,5 +19,8 @@
 (require :r5rs-tests)
 (require :fix-regression-tests)
 (require :compiler-tests)
+(require :crypto-tests)
+(require :threads-tests)
+(require :socket-port-tests)
 
 (test-toplevel)
\ No newline at end of file
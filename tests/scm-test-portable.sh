@@ -0,0 +1,13 @@
+#!/bin/sh
+
+# Whole suite once more with portable C code instead of SIMD and
+# instruction set extensions (SHA-NI, AES-NI), so known answer tests
+# check both implementations.
+
+BUILD_DIR="`pwd`"
+
+cd $srcdir/tests
+
+
+DFSCH_SIMD=none $BUILD_DIR/dfsch-repl \
+    -L $BUILD_DIR/.libs -L ../lib-scm -L . main.scm
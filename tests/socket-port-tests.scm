@@ -0,0 +1,66 @@
+(require :socket-port)
+
+(define (with-socket-pair proc)
+  (let* ((server (unix-bind "socket-test.sock"))
+         (client (unix-connect "socket-test.sock"))
+         (peer (server-socket-accept server)))
+    (unwind-protect
+     (proc client peer)
+     (socket-port-close! client)
+     (socket-port-close! peer)
+     (server-socket-close! server)
+     (os:unlink "socket-test.sock"))))
+
+(define (make-test-string count)
+  (let ((port (string-output-port)))
+    (let loop ((i 0))
+      (when (< i count)
+        (write-string "0123456789" port)
+        (loop (+ i 1))))
+    (string-output-port-value port)))
+
+(define-test socket-port-default-unbuffered (:socket-port :buffering)
+  (with-socket-pair
+   (lambda (client peer)
+     (write-string "not buffered\n" client)
+     (assert-equal (read-line peer) "not buffered\n"))))
+
+(define-test socket-port-flush (:socket-port :buffering)
+  (with-socket-pair
+   (lambda (client peer)
+     (set-port-buffering! client :full)
+     (write-string "first line\n" client)
+     (write-string "second line\n" client)
+     (flush-output client)
+     (assert-equal (read-line peer) "first line\n")
+     (assert-equal (read-line peer) "second line\n"))))
+
+(define-test socket-port-unbuffered (:socket-port :buffering)
+  (with-socket-pair
+   (lambda (client peer)
+     (set-port-buffering! client :full)
+     (set-port-buffering! client :none)
+     (write-string "unbuffered\n" client)
+     (assert-equal (read-line peer) "unbuffered\n"))))
+
+(define-test socket-port-line-buffered (:socket-port :buffering)
+  (with-socket-pair
+   (lambda (client peer)
+     (set-port-buffering! client :line)
+     (write-string "line " client)
+     (write-string "buffered\n" client)
+     (assert-equal (read-line peer) "line buffered\n"))))
+
+;;; Write larger than buffer is sent together with pending data by writev()
+
+(define-test socket-port-large-write (:socket-port :buffering)
+  (with-socket-pair
+   (lambda (client peer)
+     (let ((large (make-test-string 2000)))
+       (set-port-buffering! client :full 1024)
+       (write-string "pending:" client)
+       (write-string large client)
+       (write-string "\n" client)
+       (flush-output client)
+       (assert-equal (read-line peer) 
+                     (string-append "pending:" large "\n"))))))
@@ -0,0 +1,128 @@
+(require :introspect)
+(require :threads)
+
+(define (thread-results function count)
+  (let loop ((i 0) (threads ()))
+    (if (< i count)
+        (loop (+ i 1) 
+              (cons (threads:thread-create function (list i)) threads))
+        (map threads:thread-join threads))))
+
+(define (numbered-symbol prefix i)
+  (string->symbol (string-append prefix (number->string i))))
+
+;;; Threads define new variables in shared top-level environment (which
+;;; makes its hash table grow under concurrent readers) while others look
+;;; up existing ones. Every thread returns number of wrong results it saw.
+
+(define-test concurrent-define-lookup (:threads :environment)
+  (let ((env (make-top-level-environment))
+        (count 5000))
+    (eval '(define shared-anchor 42) env)
+    (assert-equal 
+     (thread-results 
+      (lambda (n)
+        (let ((prefix (string-append "stress-" (number->string n) "-")))
+          (let loop ((i 0) (errors 0))
+            (if (< i count)
+                (let ((name (numbered-symbol prefix i)))
+                  (eval `(define ,name ,i) env)
+                  (loop (+ i 1)
+                        (+ errors
+                           (if (= (eval name env) i) 0 1)
+                           (if (= (eval 'shared-anchor env) 42) 0 1)
+                           (let ((j (if (< i 10) i (- i 10))))
+                             (if (= (eval (numbered-symbol prefix j) env) j)
+                                 0 1)))))
+                errors))))
+      4)
+     '(0 0 0 0))
+    (assert-equal (eval '(+ stress-0-4999 stress-3-4999) env) 9998)))
+
+(define-test concurrent-set (:threads :environment)
+  (let ((env (make-top-level-environment))
+        (count 5000))
+    (eval '(define shared-anchor 42) env)
+    (assert-equal 
+     (thread-results 
+      (lambda (n)
+        (let ((name (numbered-symbol "counter-" n)))
+          (eval `(define ,name 0) env)
+          (let loop ((i 0) (errors 0))
+            (if (< i count)
+                (begin
+                  (eval `(set! ,name ,i) env)
+                  (loop (+ i 1)
+                        (+ errors
+                           (if (= (eval name env) i) 0 1)
+                           (if (= (eval 'shared-anchor env) 42) 0 1))))
+                errors))))
+      4)
+     '(0 0 0 0))))
+
+(define-test isolate-messages (:threads :isolate)
+  (let ((isolate (threads:isolate-create 
+                  '(let ((x (threads:isolate-receive threads:*isolate*)))
+                     (threads:isolate-send threads:*isolate* (list x x))
+                     (+ (car x) 1)))))
+    (threads:isolate-send isolate '(20 "twenty"))
+    (assert-equal (threads:isolate-receive isolate) 
+                  '((20 "twenty") (20 "twenty")))
+    (assert-equal (threads:isolate-join isolate) 21)
+    (assert-error <error> (threads:isolate-join isolate))))
+
+(define-test isolate-separate-environment (:threads :isolate)
+  (let ((isolate (threads:isolate-create 
+                  '(begin
+                     (define isolate-private-variable 1)
+                     isolate-private-variable))))
+    (assert-equal (threads:isolate-join isolate) 1)
+    (assert-error <error> (eval 'isolate-private-variable 
+                                top-level-environment))))
+
+(define-test isolate-canonical-serialization (:threads :isolate)
+  (let* ((roundtrips
+          '(let loop ((i 0) (ok 0))
+             (if (< i 500)
+                 (loop (+ i 1)
+                       (if (eq? (deserialize (serialize + top-level-environment)
+                                             top-level-environment)
+                                +)
+                           (+ ok 1)
+                           ok))
+                 ok)))
+         (isolate (threads:isolate-create roundtrips)))
+    (assert-equal (eval roundtrips top-level-environment) 500)
+    (assert-equal (threads:isolate-join isolate) 500)))
+
+(define-test isolate-error (:threads :isolate)
+  (let ((isolate (threads:isolate-create '(error "isolate failure" :object 42))))
+    (multiple-value-bind (value condition) 
+        (ignore-errors (threads:isolate-join isolate))
+      (assert-true (instance? condition <error>))
+      (let ((cause (condition-field condition :object)))
+        (assert-true (instance? cause <error>))
+        (assert-equal (condition-field cause :message) "isolate failure")
+        (assert-equal (condition-field cause :object) 42)))))
+
+;;; Snapshot is taken and restored by main thread while isolate waits for
+;;; message, isolate then has to continue from restored state.
+
+(define-test restore-random-states-other-thread (:threads :random)
+  (let ((isolate (threads:isolate-create
+                  '(begin
+                     (random-bytes 8)
+                     (threads:isolate-send threads:*isolate* 'ready)
+                     (threads:isolate-receive threads:*isolate*)
+                     (threads:isolate-send threads:*isolate* (random-bytes 8))
+                     (threads:isolate-receive threads:*isolate*)
+                     (random-bytes 8))))
+        (snapshot #f)
+        (expected #f))
+    (threads:isolate-receive isolate)
+    (set! snapshot (save-random-states))
+    (threads:isolate-send isolate 'go)
+    (set! expected (threads:isolate-receive isolate))
+    (restore-random-states! snapshot)
+    (threads:isolate-send isolate 'go)
+    (assert-equal (threads:isolate-join isolate) expected)))
@@ -0,0 +1,61 @@
+#!/usr/bin/env dfsch-repl
+
+;;; Bignum arithmetic: multiplication, squaring and division of operands of
+;;; various sizes, base conversion and RSA-sized modular exponentiation.
+
+(require 'gcollect)
+
+(define (print . args)
+  (for-each (lambda (i) (display i)) args)
+  (newline))
+
+(define-macro (measure-time name . body)
+  (let ((start-run (gensym)) (start-real (gensym)) (start-bytes (gensym)))
+    `(let ((,start-real (get-internal-real-time))
+           (,start-run (get-internal-run-time))
+           (,start-bytes (gc-total-bytes)))
+       (print ">>> " ',name)
+       ,@body
+       (print "<<< " ',name 
+              " real: " (* 1.0 (/ (- (get-internal-real-time)
+                              ,start-real)
+                           internal-time-units-per-second))
+              " run: " (* 1.0 (/ (- (get-internal-run-time)
+                                ,start-run)
+                          internal-time-units-per-second))
+              " cons'd: " (- (gc-total-bytes)
+                             ,start-bytes)))))
+
+(define (times n thunk)
+  (let loop ((i 0))
+    (when (< i n)
+      (thunk)
+      (loop (+ i 1)))))
+
+(define a-1k (random-bignum 1024))
+(define b-1k (random-bignum 1024))
+(define a-10k (random-bignum 10000))
+(define b-10k (random-bignum 10000))
+(define a-100k (random-bignum 100000))
+(define b-100k (random-bignum 100000))
+(define a-200k (random-bignum 200000))
+(define modulus (logior (random-bignum 2048) 1))
+(define exponent (random-bignum 2048))
+(define base (random-bignum 2000))
+
+(measure-time mul-1k
+  (times 20000 (lambda () (* a-1k b-1k))))
+(measure-time mul-10k
+  (times 500 (lambda () (* a-10k b-10k))))
+(measure-time mul-100k
+  (times 10 (lambda () (* a-100k b-100k))))
+(measure-time square-100k
+  (times 10 (lambda () (* a-100k a-100k))))
+(measure-time div-200k/100k
+  (times 10 (lambda () (/i a-200k b-100k))))
+(measure-time number->string-100k
+  (times 5 (lambda () (number->string a-100k))))
+(measure-time modexp-2048
+  (times 20 (lambda () (integer-expt base exponent modulus))))
+(measure-time modexp-2048-consttime
+  (times 20 (lambda () (integer-expt base exponent modulus #t))))
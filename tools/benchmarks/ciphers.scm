@@ -0,0 +1,87 @@
+#!/usr/bin/env dfsch-repl
+
+;;; Hashing and AES throughput. SHA-NI and AES-NI kernels are used when
+;;; CPU has them, DFSCH_SIMD=none selects portable code for comparison.
+
+(require 'gcollect)
+(require :crypto)
+
+(define (print . args)
+  (for-each (lambda (i) (display i)) args)
+  (newline))
+
+(define-macro (measure-throughput name bytes . body)
+  (let ((start-real (gensym)) (start-bytes (gensym))
+        (total (gensym)) (seconds (gensym)))
+    `(let ((,start-real (get-internal-real-time))
+           (,start-bytes (gc-total-bytes)))
+       (print ">>> " ',name)
+       (let ((,total (* 1.0 (begin ,@body ,bytes)))
+             (,seconds (* 1.0 (/ (- (get-internal-real-time) ,start-real)
+                                 internal-time-units-per-second))))
+         (print "<<< " ',name
+                " real: " ,seconds
+                " MB/s: " (if (> ,seconds 0)
+                              (/ ,total ,seconds 1048576)
+                              "-")
+                " cons'd: " (- (gc-total-bytes) ,start-bytes))))))
+
+(define (times n thunk)
+  (let loop ((i 0))
+    (when (< i n)
+      (thunk)
+      (loop (+ i 1)))))
+
+(define blob (make-byte-vector (* 1024 1024)))
+(define key (hexstring->byte-vector "000102030405060708090a0b0c0d0e0f"))
+(define iv (hexstring->byte-vector "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"))
+(define aes (crypto:setup-block-cipher crypto:<aes> key))
+
+(measure-throughput sha-256 (* 20 (seq-length blob))
+  (times 20 (lambda () (crypto:hash-string crypto:<sha-256> blob))))
+(measure-throughput sha-1 (* 20 (seq-length blob))
+  (times 20 (lambda () (crypto:hash-string crypto:<sha-1> blob))))
+
+(measure-throughput aes-ctr (* 20 (seq-length blob))
+  (times 20 (lambda ()
+              (crypto:encrypt-blocks
+               (crypto:setup-block-cipher-mode crypto:<ctr> aes iv)
+               blob))))
+(measure-throughput aes-cbc-encrypt (* 20 (seq-length blob))
+  (times 20 (lambda ()
+              (crypto:encrypt-blocks
+               (crypto:setup-block-cipher-mode crypto:<cbc> aes iv)
+               blob))))
+(measure-throughput aes-cbc-decrypt (* 20 (seq-length blob))
+  (times 20 (lambda ()
+              (crypto:decrypt-blocks
+               (crypto:setup-block-cipher-mode crypto:<cbc> aes iv)
+               blob))))
+
+;;; Short messages as in signed cookies, one by one and as a batch
+
+(define cookies
+  (let loop ((i 0) (acc ()))
+    (if (< i 10000)
+        (loop (+ i 1)
+              (cons (string-append "session=" (number->string (* i 7919))
+                                   "; user=" (number->string i))
+                    acc))
+        acc)))
+(define cookies-size
+  (let loop ((l cookies) (size 0))
+    (if (pair? l)
+        (loop (cdr l) (+ size (string-length (car l))))
+        size)))
+
+(measure-throughput cookies-hmac-sha-256 (* 20 cookies-size)
+  (times 20 (lambda ()
+              (for-each (lambda (c)
+                          (crypto:hash-string crypto:<hmac-sha-256> c key))
+                        cookies))))
+(measure-throughput cookies-sha-256 (* 20 cookies-size)
+  (times 20 (lambda ()
+              (for-each (lambda (c) (crypto:hash-string crypto:<sha-256> c))
+                        cookies))))
+(measure-throughput cookies-sha-256-batch (* 20 cookies-size)
+  (times 20 (lambda () (crypto:hash-strings crypto:<sha-256> cookies))))
@@ -0,0 +1,112 @@
+#!/usr/bin/env dfsch-repl
+
+;;; Inexact arithmetic: nested flonum expressions in compiled code,
+;;; aggregation over boxed lists compared with f64vectors and random
+;;; number generation for Monte Carlo style code.
+
+(require 'gcollect)
+
+(define (print . args)
+  (for-each (lambda (i) (display i)) args)
+  (newline))
+
+(define-macro (measure-time name . body)
+  (let ((start-run (gensym)) (start-real (gensym)) (start-bytes (gensym)))
+    `(let ((,start-real (get-internal-real-time))
+           (,start-run (get-internal-run-time))
+           (,start-bytes (gc-total-bytes)))
+       (print ">>> " ',name)
+       ,@body
+       (print "<<< " ',name 
+              " real: " (* 1.0 (/ (- (get-internal-real-time)
+                              ,start-real)
+                           internal-time-units-per-second))
+              " run: " (* 1.0 (/ (- (get-internal-run-time)
+                                ,start-run)
+                          internal-time-units-per-second))
+              " cons'd: " (- (gc-total-bytes)
+                             ,start-bytes)))))
+
+(define (times n thunk)
+  (let loop ((i 0))
+    (when (< i n)
+      (thunk)
+      (loop (+ i 1)))))
+
+(define (distance2 x1 y1 x2 y2)
+  (+ (* (- x2 x1) (- x2 x1)) (* (- y2 y1) (- y2 y1))))
+
+(define (polynomial x)
+  (+ (* 0.5 x x x) (* -1.25 x x) (* 3.0 x) 7.5))
+
+(define samples
+  (let loop ((i 0) (acc ()))
+    (if (< i 100000)
+        (loop (+ i 1) (cons (* i 0.001) acc))
+        acc)))
+(define sample-vector (list->numeric-vector <f64vector> samples))
+
+(define (list-sum l)
+  (let loop ((l l) (acc 0.0))
+    (if (null? l)
+        acc
+        (loop (cdr l) (+ acc (car l))))))
+
+(define (list-dot a b)
+  (let loop ((a a) (b b) (acc 0.0))
+    (if (null? a)
+        acc
+        (loop (cdr a) (cdr b) (+ acc (* (car a) (car b)))))))
+
+(measure-time distance
+  (let loop ((i 0) (acc 0.0))
+    (if (< i 300000)
+        (loop (+ i 1) (+ acc (distance2 0.5 1.5 (* i 0.25) (/ i 3.0))))
+        acc)))
+(measure-time polynomial
+  (let loop ((i 0) (acc 0.0))
+    (if (< i 300000)
+        (loop (+ i 1) (+ acc (polynomial (* i 0.001))))
+        acc)))
+(measure-time list-sum
+  (times 20 (lambda () (list-sum samples))))
+(measure-time f64vector-sum
+  (times 200 (lambda () (numeric-vector-sum sample-vector))))
+(measure-time list-dot
+  (times 20 (lambda () (list-dot samples samples))))
+(measure-time f64vector-dot
+  (times 200 (lambda () (numeric-vector-dot sample-vector sample-vector))))
+(measure-time f64vector-scale
+  (times 20 (lambda () (numeric-vector* sample-vector 1.5))))
+(measure-time f64vector-axpy
+  (times 20 (lambda () (numeric-vector-axpy 1.5 sample-vector sample-vector))))
+(measure-time f64vector-min
+  (times 200 (lambda () (numeric-vector-min sample-vector))))
+(measure-time f64vector-prefix-sum
+  (times 20 (lambda () (numeric-vector-prefix-sum sample-vector))))
+(measure-time f64vector-histogram
+  (times 20 (lambda () (numeric-vector-histogram sample-vector 64 0 100))))
+(measure-time f64vector-sort
+  (times 20 (lambda ()
+              (numeric-vector-sort! (numeric-vector* sample-vector -1)))))
+
+(define (monte-carlo-pi n state)
+  (let loop ((i 0) (hits 0))
+    (if (< i n)
+        (let ((x (random-flonum state)) (y (random-flonum state)))
+          (loop (+ i 1) (if (< (+ (* x x) (* y y)) 1.0) (+ hits 1) hits)))
+        (/ (* 4.0 hits) n))))
+
+(define mt-state (make-default-random-state "benchmark"))
+(define xoshiro-state (make-xoshiro-random-state "benchmark"))
+
+(measure-time monte-carlo-mt
+  (monte-carlo-pi 200000 mt-state))
+(measure-time monte-carlo-xoshiro
+  (monte-carlo-pi 200000 xoshiro-state))
+(measure-time random-fill-mt
+  (times 20 (lambda () (random-fill! sample-vector mt-state))))
+(measure-time random-fill-xoshiro
+  (times 20 (lambda () (random-fill! sample-vector xoshiro-state))))
+(measure-time random-bytes-xoshiro
+  (times 20 (lambda () (random-bytes 1000000 xoshiro-state))))
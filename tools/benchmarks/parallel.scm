@@ -56,8 +56,17 @@
         (thread-join (car tl))
         (join-threads (cdr tl)))))
 
+(define (monte-carlo-pi n)
+  (let loop ((i 0) (hits 0))
+    (if (< i n)
+        (let ((x (random-flonum)) (y (random-flonum)))
+          (loop (+ i 1) (if (< (+ (* x x) (* y y)) 1.0) (+ hits 1) hits)))
+        (/ (* 4.0 hits) n))))
+
 (define (tak-thread)
   (tak 24 16 8))
+(define (monte-carlo-thread)
+  (monte-carlo-pi 100000))
 (define (tak-inline-thread)
   (tak-inline 24 16 8))
 
@@ -82,3 +91,9 @@
 (measure-time tak-8 (join-threads (run-threads 8 tak-thread)))
 (measure-time tak-inline-8 (join-threads (run-threads 8 tak-inline-thread)))
 
+
+(set-random-seed! "parallel")
+(measure-time monte-carlo-1 (join-threads (run-threads 1 monte-carlo-thread)))
+(measure-time monte-carlo-2 (join-threads (run-threads 2 monte-carlo-thread)))
+(measure-time monte-carlo-4 (join-threads (run-threads 4 monte-carlo-thread)))
+(measure-time monte-carlo-8 (join-threads (run-threads 8 monte-carlo-thread)))
@@ -0,0 +1,102 @@
+#!/usr/bin/env dfsch-repl
+
+;;; Binary serialization throughput for typical records, plain and
+;;; against canonical environment (which is how module cache and images
+;;; serialize code).
+
+(require 'gcollect)
+
+(define (print . args)
+  (for-each (lambda (i) (display i)) args)
+  (newline))
+
+(define-macro (measure-throughput name bytes . body)
+  (let ((start-real (gensym)) (start-bytes (gensym)) 
+        (total (gensym)) (seconds (gensym)))
+    `(let ((,start-real (get-internal-real-time))
+           (,start-bytes (gc-total-bytes)))
+       (print ">>> " ',name)
+       (let ((,total (* 1.0 (begin ,@body ,bytes)))
+             (,seconds (* 1.0 (/ (- (get-internal-real-time) ,start-real)
+                                 internal-time-units-per-second))))
+         (print "<<< " ',name 
+                " real: " ,seconds
+                " MB/s: " (if (> ,seconds 0) 
+                              (/ ,total ,seconds 1048576)
+                              "-")
+                " cons'd: " (- (gc-total-bytes) ,start-bytes))))))
+
+(define (times n thunk)
+  (let loop ((i 0))
+    (when (< i n)
+      (thunk)
+      (loop (+ i 1)))))
+
+(define (make-record i)
+  (list 'order i (* i 1000003) (* i 0.25)
+        (string-append "customer-" (number->string i))
+        :status (vector i (+ i 1) (+ i 2) 'pending)))
+
+(define records
+  (let loop ((i 0) (acc ()))
+    (if (< i 2000)
+        (loop (+ i 1) (cons (make-record i) acc))
+        acc)))
+(define env (current-environment))
+
+(define plain-size (seq-length (serialize records)))
+(define canon-size (seq-length (serialize records env)))
+
+(print "records: " (length records) " serialized: " plain-size " bytes")
+
+(measure-throughput records (* 20 plain-size)
+  (times 20 (lambda () (serialize records))))
+(measure-throughput records-canonical (* 20 canon-size)
+  (times 20 (lambda () (serialize records env))))
+(measure-throughput round-trip (* 20 plain-size)
+  (times 20 (lambda () (deserialize (serialize records)))))
+
+;;; Record streams, reading single record by skipping all preceding ones
+;;; compared to deserializing everything.
+
+(define record-stream
+  (let ((port (string-output-port)))
+    (for-each (lambda (r) (write-serialized-record port r)) records)
+    (string-output-port-value port)))
+(define record-stream-size (seq-length record-stream))
+
+(measure-throughput records-read-all (* 20 record-stream-size)
+  (times 20 (lambda () 
+              (let ((cursor (make-record-cursor record-stream)))
+                (let loop ()
+                  (unless (eof-object? (record-cursor-next! cursor))
+                    (loop)))))))
+(measure-throughput records-skip-to-last (* 20 record-stream-size)
+  (times 20 (lambda () 
+              (let ((cursor (make-record-cursor record-stream)))
+                (record-cursor-skip! cursor (- (length records) 1))
+                (record-cursor-next! cursor)))))
+
+;;; Instances of user-defined class, layout of class is written only
+;;; once per stream.
+
+(define-class <order> ()
+  ((id :initarg :id) (amount :initarg :amount) (customer :initarg :customer)
+   (status :initarg :status)))
+
+(define orders
+  (let loop ((i 0) (acc ()))
+    (if (< i 2000)
+        (loop (+ i 1) 
+              (cons (make-instance <order> :id i :amount (* i 0.25)
+                                   :customer i :status 'pending)
+                    acc))
+        acc)))
+(define orders-size (seq-length (serialize orders env)))
+
+(print "instances: " (length orders) " serialized: " orders-size " bytes")
+
+(measure-throughput instances (* 20 orders-size)
+  (times 20 (lambda () (serialize orders env))))
+(measure-throughput instances-round-trip (* 20 orders-size)
+  (times 20 (lambda () (deserialize (serialize orders env) env))))
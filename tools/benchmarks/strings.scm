@@ -0,0 +1,65 @@
+#!/usr/bin/env dfsch-repl
+
+;;; String scanning primitives. Kernel implementation can be selected by
+;;; DFSCH_SIMD environment variable ("avx2", "sse2" or "none")
+
+(require 'gcollect)
+
+(define (print . args)
+  (for-each (lambda (i) (display i)) args)
+  (newline))
+
+(define-macro (measure-time name . body)
+  (let ((start-run (gensym)) (start-real (gensym)) (start-bytes (gensym)))
+    `(let ((,start-real (get-internal-real-time))
+           (,start-run (get-internal-run-time))
+           (,start-bytes (gc-total-bytes)))
+       (print ">>> " ',name)
+       ,@body
+       (print "<<< " ',name 
+              " real: " (* 1.0 (/ (- (get-internal-real-time)
+                              ,start-real)
+                           internal-time-units-per-second))
+              " run: " (* 1.0 (/ (- (get-internal-run-time)
+                                ,start-run)
+                          internal-time-units-per-second))
+              " cons'd: " (- (gc-total-bytes)
+                             ,start-bytes)))))
+
+(define (repeat-string str n)
+  (let loop ((i 0) (parts ()))
+    (if (< i n)
+        (loop (+ i 1) (cons str parts))
+        (apply string-append parts))))
+
+(define (times n thunk)
+  (let loop ((i 0))
+    (when (< i n)
+      (thunk)
+      (loop (+ i 1)))))
+
+(define ascii (repeat-string "The quick brown fox jumps over the lazy dog. " 
+                             2000))
+(define utf8 (repeat-string "Příliš žluťoučký kůň úpěl ďábelské ódy. " 
+                            2000))
+(define haystack (string-append ascii "needle"))
+
+(measure-time string-length-ascii
+  (times 1000 (lambda () (string-length (string-append ascii "")))))
+(measure-time string-length-utf8
+  (times 1000 (lambda () (string-length (string-append utf8 "")))))
+(measure-time string-search
+  (times 1000 (lambda () (string-search "needle" haystack))))
+(measure-time string-upcase
+  (times 200 (lambda () (string-upcase ascii))))
+(measure-time string-downcase
+  (times 200 (lambda () (string-downcase ascii))))
+(measure-time string-valid-utf8
+  (times 1000 (lambda () (string-valid-utf8? utf8))))
+(measure-time string-ref
+  (let ((len (string-length utf8)))
+    (times 10 (lambda () 
+                (let loop ((i 0))
+                  (when (< i len)
+                    (string-ref utf8 i)
+                    (loop (+ i 1))))))))